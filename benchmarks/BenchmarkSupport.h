@@ -0,0 +1,169 @@
+/*
+    This file contains the small utilities that are shared by the benchmarks,
+   such as timing, measuring stack usage, and generating source files.
+*/
+
+#ifndef TPY_BENCHMARKS_BENCHMARKSUPPORT_H
+#define TPY_BENCHMARKS_BENCHMARKSUPPORT_H
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+#include "tpy/tree/ASTNode.h"
+#include "tpy/tree/ASTVisitor.h"
+
+namespace tpy::Benchmark {
+// This is the byte that the stack of a measured thread is painted with.
+static constexpr unsigned char STACK_PAINT = 0xA5;
+
+/*
+    This function will run the callback on a thread whose stack has been painted
+   with a known byte, and return the number of stack bytes that the callback
+   touched. The stack grows downwards, so the deepest point is the lowest byte
+   that no longer holds the paint.
+*/
+inline auto measure_stack_usage(const std::function<void()> &fn,
+                                size_t stack_size = 512 * 1024 * 1024)
+    -> size_t {
+    auto stack = std::make_unique<unsigned char[]>(stack_size);
+    memset(stack.get(), STACK_PAINT, stack_size);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, stack.get(), stack_size);
+
+    auto trampoline = [](void *arg) -> void * {
+        (*static_cast<const std::function<void()> *>(arg))();
+        return nullptr;
+    };
+
+    pthread_t thread;
+    if (pthread_create(&thread, &attr, trampoline,
+                       const_cast<std::function<void()> *>(&fn)) != 0) {
+        pthread_attr_destroy(&attr);
+        throw std::runtime_error("unable to create the measured thread.");
+    }
+
+    pthread_join(thread, nullptr);
+    pthread_attr_destroy(&attr);
+
+    size_t untouched = 0;
+    while (untouched < stack_size && stack[untouched] == STACK_PAINT) {
+        ++untouched;
+    }
+
+    return stack_size - untouched;
+}
+
+/*
+    This function will run the callback the given number of times and return the
+   fastest run in seconds. The fastest run is the least disturbed by the rest of
+   the system.
+*/
+inline auto time_best_of(int runs, const std::function<void()> &fn) -> double {
+    double best = 0;
+
+    for (int i = 0; i < runs; i++) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        if (i == 0 || elapsed.count() < best) {
+            best = elapsed.count();
+        }
+    }
+
+    return best;
+}
+
+/*
+    This function will write the generated source into the temporary directory
+   and return its path, so that it can be opened by the source manager.
+*/
+inline auto write_temp_source(const std::string &name,
+                              const std::string &contents) -> std::string {
+    auto path = (std::filesystem::temp_directory_path() / name).string();
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file) {
+        throw std::runtime_error("unable to write " + path);
+    }
+
+    fwrite(contents.data(), 1, contents.size(), file);
+    fclose(file);
+
+    return path;
+}
+
+/*
+    This function will generate a module of classes and functions that resembles
+   the largest modules of a real code base.
+*/
+inline auto generate_module(size_t defs) -> std::string {
+    std::string result = "import os.path as osp, sys\nfrom typing import "
+                         "Dict, List\n\n";
+
+    for (size_t i = 0; i < defs; i++) {
+        auto n = std::to_string(i);
+
+        if (i % 2) {
+            result += "@decorator(" + n + ")\n";
+            result += "def func_" + n +
+                      "(a, b: int = 1, *args, key=None, **kwargs) -> int:\n";
+            result += "    total = a + b * " + n + "\n";
+            result += "    for i, item in enumerate(args):\n";
+            result += "        if item is None or i > len(kwargs):\n";
+            result += "            continue\n";
+            result += "        elif item < 0:\n";
+            result += "            total -= item\n";
+            result += "        else:\n";
+            result += "            total += item[i:] * osp.join(a, b)\n";
+            result += "    return total\n\n";
+        } else {
+            result += "class Class_" + n + "(Base, metaclass=Meta):\n";
+            result += "    value: Dict[str, List[int]] = {}\n\n";
+            result += "    def method(self, x):\n";
+            result += "        try:\n";
+            result += "            with open(x) as f:\n";
+            result += "                self.value[x] = [f.read(), x ** 2]\n";
+            result += "        except (KeyError, OSError) as error:\n";
+            result += "            raise ValueError(x) from error\n";
+            result += "        return self.value.get(x, None)\n\n";
+        }
+    }
+
+    return result;
+}
+
+/*
+    This function will count the nodes of a tree. An explicit stack is used, as
+   the trees of long operator chains are far too deep for recursion.
+*/
+inline auto count_nodes(Tree::ASTNode *root) -> size_t {
+    std::vector<Tree::ASTNode *> stack{root};
+    size_t count = 0;
+
+    while (!stack.empty()) {
+        auto *node = stack.back();
+        stack.pop_back();
+        ++count;
+
+        Tree::for_each_child(
+            node, [&](Tree::ASTNode *child) { stack.push_back(child); });
+    }
+
+    return count;
+}
+} // namespace tpy::Benchmark
+
+#endif
@@ -0,0 +1,291 @@
+/*
+    This benchmark compares the arena allocator with the fixed-slab arena that
+   it replaced. Both allocate the same stream of objects with the sizes and
+   alignments of AST nodes, and both parse a large generated module with the
+   default slab size. The old arena is kept here as it was, apart from its
+   name.
+
+    It then parses the same module over and over as a server would, with a
+   new arena for every parse, with one arena that is reset and keeps all of
+   its slabs, and with new arenas that share a slab pool. The calls to
+   'operator new' are counted to show how many slabs come from the system.
+
+    Finally, it runs a pipeline of passes that each replace every node of the
+   tree with a copy, once keeping the old nodes and once giving them back to
+   the arena, and shows how much the arena grows.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <forward_list>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BenchmarkSupport.h"
+#include "tpy/parse/Lexer.h"
+#include "tpy/parse/Parser.h"
+#include "tpy/source/SourceManager.h"
+#include "tpy/tree/ASTExpr.h"
+#include "tpy/tree/ASTMembers.h"
+#include "tpy/tree/ASTStmt.h"
+#include "tpy/utility/ArenaAllocator.h"
+#include "tpy/utility/SlabPool.h"
+
+using namespace tpy;
+
+// These count the calls to 'operator new' of at least a page, which are the
+// slabs and the largest vectors of the parser.
+static std::atomic<size_t> num_large_news{0};
+
+auto operator new(size_t size) -> void * {
+    if (size >= 4096) {
+        num_large_news.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (auto *memory = malloc(size)) {
+        return memory;
+    }
+    throw std::bad_alloc{};
+}
+
+auto operator delete(void *memory) noexcept -> void { free(memory); }
+
+auto operator delete(void *memory, size_t) noexcept -> void { free(memory); }
+
+namespace {
+// This is the arena from before slabs grew, which bumps by the size of the
+// object alone and allocates a 4 KiB slab whenever the current one is full.
+class FixedSlabArena {
+    using ArenaSlab = std::unique_ptr<std::byte[]>;
+
+    std::forward_list<ArenaSlab> slabs;
+    std::byte *current_pos, *end_of_current_slab;
+    size_t slab_size;
+
+  public:
+    size_t num_slabs = 0;
+
+    auto create_new_slab(size_t min_size = 0) -> void {
+        auto size = min_size > slab_size ? min_size : slab_size;
+        auto new_slab = std::make_unique<std::byte[]>(size);
+        current_pos = new_slab.get();
+        end_of_current_slab = current_pos + size;
+        slabs.push_front(std::move(new_slab));
+        num_slabs++;
+    }
+
+    explicit FixedSlabArena(size_t slab_size) : slab_size{slab_size} {
+        create_new_slab();
+    }
+
+    auto allocate_bytes(size_t size) -> void * {
+        if (static_cast<size_t>(end_of_current_slab - current_pos) < size) {
+            create_new_slab(size);
+        }
+        auto mem = current_pos;
+        current_pos += size;
+        return mem;
+    }
+};
+
+// These are the sizes of a mix of common nodes, in the proportions of a
+// typical module.
+constexpr size_t SIZES[] = {
+    sizeof(Tree::ASTNameExprNode),     sizeof(Tree::ASTNameExprNode),
+    sizeof(Tree::ASTNameExprNode),     sizeof(Tree::ASTAttrRefExprNode),
+    sizeof(Tree::ASTCallExprNode),     sizeof(Tree::ASTBinaryOpExprNode),
+    sizeof(Tree::ASTIntLiteralNode),   sizeof(Tree::ASTAssignStmtNode),
+    sizeof(Tree::ASTStringLiteralNode), 3 * sizeof(Tree::ASTNode *),
+};
+
+constexpr size_t NUM_SIZES = sizeof(SIZES) / sizeof(SIZES[0]);
+
+constexpr size_t NUM_OBJECTS = 10000000;
+
+// This copies the node itself, which shares the children of the original.
+auto clone_node(Tree::ASTNode *node, Utility::ArenaAllocator &arena)
+    -> Tree::ASTNode * {
+    switch (node->kind) {
+#define F(x, children)                                                         \
+    case Tree::ASTNodeKind::x:                                                 \
+        return arena.allocate<Tree::AST##x##Node>(                             \
+            *static_cast<Tree::AST##x##Node *>(node));
+        AST_NODE_LIST(F)
+#undef F
+    }
+
+    return nullptr;
+}
+
+// This pass replaces every node below the root with a copy, and gives the old
+// node back to the arena if it is asked to.
+auto replace_nodes(Tree::ASTNode *root, Utility::ArenaAllocator &arena,
+                   bool free_old) -> void {
+    std::vector<Tree::ASTNode *> stack{root};
+
+    while (!stack.empty()) {
+        auto *node = stack.back();
+        stack.pop_back();
+
+        Tree::NodeMembers members;
+        Tree::describe_members(node, members);
+
+        Tree::for_each_child_slot(members, [&](Tree::ASTNode **slot) {
+            auto *copy = clone_node(*slot, arena);
+            if (free_old) {
+                Tree::deallocate_node(*slot, arena);
+            }
+            *slot = copy;
+            stack.push_back(copy);
+        });
+    }
+}
+} // namespace
+
+int main() {
+    size_t old_slabs = 0, new_slabs = 0;
+
+    // Every object is touched, so that the cost of faulting the slabs in is
+    // part of both runs.
+    auto old_time = Benchmark::time_best_of(5, [&]() {
+        FixedSlabArena arena{4096};
+        for (size_t i = 0; i < NUM_OBJECTS; i++) {
+            *static_cast<char *>(arena.allocate_bytes(SIZES[i % NUM_SIZES])) =
+                0;
+        }
+        old_slabs = arena.num_slabs;
+    });
+
+    auto new_time = Benchmark::time_best_of(5, [&]() {
+        Utility::ArenaAllocator arena;
+        for (size_t i = 0; i < NUM_OBJECTS; i++) {
+            *static_cast<char *>(
+                arena.allocate_bytes(SIZES[i % NUM_SIZES], 8)) = 0;
+        }
+        new_slabs = arena.slab_count();
+    });
+
+    printf("%zu allocations\n", NUM_OBJECTS);
+    printf("%-16s %12s %12s %10s\n", "arena", "time (ms)", "ns/alloc",
+           "slabs");
+
+    auto row = [](const char *name, double seconds, size_t slabs) {
+        printf("%-16s %12.3f %12.2f %10zu\n", name, seconds * 1000,
+               seconds * 1e9 / NUM_OBJECTS, slabs);
+    };
+
+    row("fixed 4 KiB", old_time, old_slabs);
+    row("growing", new_time, new_slabs);
+
+    // The parser only takes the new arena, so the parse is timed with the
+    // default slab size, and with the large slabs that the tools use.
+    auto path = Benchmark::write_temp_source("tpy_bench_arena.py",
+                                             Benchmark::generate_module(5000));
+
+    Source::SourceManager src_mgr;
+    auto *src_file = src_mgr.open_py_src_file(path.data());
+
+    auto parse_with = [&](size_t slab_size, size_t &slabs) {
+        return Benchmark::time_best_of(5, [&]() {
+            Parse::Lexer lexer{src_file};
+            Utility::ArenaAllocator arena{slab_size};
+            Parse::Parser parser{lexer, arena};
+            parser.parse_py_module();
+            slabs = arena.slab_count();
+        });
+    };
+
+    size_t default_slabs = 0, large_slabs = 0;
+    auto default_parse = parse_with(4096, default_slabs);
+    auto large_parse = parse_with(1 << 20, large_slabs);
+
+    printf("\n%-16s %12s %10s\n", "parse", "time (ms)", "slabs");
+    printf("%-16s %12.3f %10zu\n", "4 KiB first", default_parse * 1000,
+           default_slabs);
+    printf("%-16s %12.3f %10zu\n", "1 MiB first", large_parse * 1000,
+           large_slabs);
+
+    // Every strategy parses the module the same number of times, after one
+    // parse to warm it up.
+    constexpr int NUM_PARSES = 50;
+
+    auto serve = [&](const char *name, auto &&make_arena) {
+        auto parse_once = [&]() {
+            Parse::Lexer lexer{src_file};
+            auto &arena = make_arena();
+            Parse::Parser parser{lexer, arena};
+            parser.parse_py_module();
+        };
+
+        parse_once();
+
+        auto news = num_large_news.load();
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < NUM_PARSES; i++) {
+            parse_once();
+        }
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        printf("%-16s %12.3f %14.1f\n", name,
+               elapsed.count() * 1000 / NUM_PARSES,
+               static_cast<double>(num_large_news.load() - news) / NUM_PARSES);
+    };
+
+    printf("\n%-16s %12s %14s\n", "repeated parse", "time (ms)",
+           "large news");
+
+    std::unique_ptr<Utility::ArenaAllocator> fresh;
+    serve("new arena", [&]() -> Utility::ArenaAllocator & {
+        fresh = std::make_unique<Utility::ArenaAllocator>();
+        return *fresh;
+    });
+
+    Utility::ArenaAllocator kept;
+    serve("reset(32)", [&]() -> Utility::ArenaAllocator & {
+        kept.reset(32);
+        return kept;
+    });
+
+    Utility::SlabPool pool{256 << 20};
+    serve("slab pool", [&]() -> Utility::ArenaAllocator & {
+        fresh.reset();
+        fresh = std::make_unique<Utility::ArenaAllocator>(4096, &pool);
+        return *fresh;
+    });
+    fresh.reset();
+
+    constexpr int NUM_PASSES = 10;
+
+    printf("\n%-16s %12s %14s %14s\n", "rewrite passes", "time (ms)",
+           "parsed (MiB)", "after (MiB)");
+
+    auto rewrite = [&](const char *name, bool free_old) {
+        Parse::Lexer lexer{src_file};
+        Utility::ArenaAllocator arena;
+        Parse::Parser parser{lexer, arena};
+        auto *module = parser.parse_py_module();
+        auto parsed = arena.capacity();
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < NUM_PASSES; i++) {
+            replace_nodes(module, arena, free_old);
+        }
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        printf("%-16s %12.3f %14.1f %14.1f\n", name,
+               elapsed.count() * 1000 / NUM_PASSES, parsed / 1048576.0,
+               arena.capacity() / 1048576.0);
+    };
+
+    rewrite("keep old nodes", false);
+    rewrite("free old nodes", true);
+
+    return EXIT_SUCCESS;
+}
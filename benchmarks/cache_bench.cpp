@@ -0,0 +1,93 @@
+/*
+    This benchmark compares the time of getting the tree of a large module by
+   parsing it again with the time of loading it from the AST cache. The load
+   is timed on its own, which maps the entry and checks its header, and
+   together with a walk over every node of the mapped tree and with rebuilding
+   the 'ASTNode' objects from it.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+#include "BenchmarkSupport.h"
+#include "tpy/parse/Lexer.h"
+#include "tpy/parse/Parser.h"
+#include "tpy/source/SourceManager.h"
+#include "tpy/tree/ASTCache.h"
+#include "tpy/tree/FlatAST.h"
+#include "tpy/utility/ArenaAllocator.h"
+
+using namespace tpy;
+
+int main() {
+    auto path = Benchmark::write_temp_source("tpy_bench_cache.py",
+                                             Benchmark::generate_module(5000));
+
+    Source::SourceManager src_mgr;
+    auto *src_file = src_mgr.open_py_src_file(path.data());
+
+    auto cache_dir = std::filesystem::temp_directory_path() / "tpy_bench_cache";
+    std::filesystem::remove_all(cache_dir);
+    Tree::ASTCache cache{cache_dir.string()};
+
+    size_t num_nodes = 0;
+    {
+        Parse::Lexer lexer{src_file};
+        Utility::ArenaAllocator arena{1 << 20};
+        Parse::Parser parser{lexer, arena};
+        auto flat = Tree::FlatAST::from_tree(parser.parse_py_module());
+        num_nodes = flat.size();
+
+        if (!cache.store(src_file, flat)) {
+            fprintf(stderr, "%s: unable to write the cache.\n",
+                    cache_dir.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto reparse = Benchmark::time_best_of(5, [&]() {
+        Parse::Lexer lexer{src_file};
+        Utility::ArenaAllocator arena{1 << 20};
+        Parse::Parser parser{lexer, arena};
+        parser.parse_py_module();
+    });
+
+    auto load = Benchmark::time_best_of(5, [&]() { cache.load(src_file); });
+
+    // The walk reads every column, so that the pages of the entry are
+    // actually touched.
+    size_t checksum = 0;
+    auto load_and_walk = Benchmark::time_best_of(5, [&]() {
+        auto cached = cache.load(src_file);
+        auto tree = cached->view();
+        for (Tree::FlatAST::NodeIndex i = 0; i < tree.size(); i++) {
+            checksum += static_cast<size_t>(tree.kind(i)) + tree.payload(i) +
+                        tree.loc(i).len;
+        }
+    });
+
+    auto load_and_rebuild = Benchmark::time_best_of(5, [&]() {
+        auto cached = cache.load(src_file);
+        Utility::ArenaAllocator arena{1 << 20};
+        cached->view().to_tree(arena);
+    });
+
+    printf("%zu nodes (checksum %zu)\n", num_nodes, checksum);
+    printf("%-20s %12s %10s\n", "method", "time (ms)", "speedup");
+
+    auto row = [&](const char *name, double seconds) {
+        printf("%-20s %12.3f %9.1fx\n", name, seconds * 1000,
+               reparse / seconds);
+    };
+
+    row("reparse", reparse);
+    row("load", load);
+    row("load + walk", load_and_walk);
+    row("load + rebuild", load_and_rebuild);
+
+    std::filesystem::remove_all(cache_dir);
+
+    return EXIT_SUCCESS;
+}
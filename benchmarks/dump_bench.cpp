@@ -0,0 +1,97 @@
+/*
+    This benchmark measures the time of dumping the tree of a large module with
+   'pretty_print' and with the buffered writer in both of its formats. The
+   output goes to '/dev/null', so only the formatting and the system calls are
+   timed.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "BenchmarkSupport.h"
+#include "tpy/parse/Lexer.h"
+#include "tpy/parse/Parser.h"
+#include "tpy/source/SourceManager.h"
+#include "tpy/tree/ASTWriter.h"
+#include "tpy/utility/ArenaAllocator.h"
+#include "tpy/utility/OutputBuffer.h"
+
+using namespace tpy;
+
+int main() {
+    auto path = Benchmark::write_temp_source("tpy_bench_dump.py",
+                                             Benchmark::generate_module(5000));
+
+    Source::SourceManager src_mgr;
+    auto *src_file = src_mgr.open_py_src_file(path.data());
+
+    Parse::Lexer lexer{src_file};
+    Utility::ArenaAllocator arena{1 << 20};
+    Parse::Parser parser{lexer, arena};
+    auto *module = parser.parse_py_module();
+
+    if (!module) {
+        fprintf(stderr, "%s: failed to parse.\n", path.c_str());
+        return EXIT_FAILURE;
+    }
+
+    FILE *null_file = fopen("/dev/null", "w");
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (!null_file || null_fd < 0) {
+        fprintf(stderr, "unable to open /dev/null.\n");
+        return EXIT_FAILURE;
+    }
+
+    // The sizes of the outputs are measured once, apart from the timed runs.
+    auto pretty_size = [&]() {
+        FILE *file = tmpfile();
+        module->pretty_print(file, 0);
+        auto size = static_cast<size_t>(ftell(file));
+        fclose(file);
+        return size;
+    };
+
+    auto output_size = [&](Tree::ASTFormat format) {
+        std::string result;
+        {
+            Utility::OutputBuffer out{result};
+            Tree::ASTWriter{out, format}.write(module);
+        }
+        return result.size();
+    };
+
+    auto pretty = Benchmark::time_best_of(
+        5, [&]() { module->pretty_print(null_file, 0); });
+
+    auto write_with = [&](Tree::ASTFormat format) {
+        return Benchmark::time_best_of(5, [&]() {
+            Utility::OutputBuffer out{null_fd};
+            Tree::ASTWriter{out, format}.write(module);
+            out.flush();
+        });
+    };
+
+    auto json = write_with(Tree::ASTFormat::JSON);
+    auto sexpr = write_with(Tree::ASTFormat::SExpr);
+
+    printf("%zu nodes\n", Benchmark::count_nodes(module));
+    printf("%-16s %12s %12s %10s\n", "output", "MB", "time (ms)", "MB/s");
+
+    auto row = [](const char *name, size_t bytes, double seconds) {
+        printf("%-16s %12.1f %12.3f %10.1f\n", name, bytes / 1e6,
+               seconds * 1000, bytes / seconds / 1e6);
+    };
+
+    row("pretty_print", pretty_size(), pretty);
+    row("json", output_size(Tree::ASTFormat::JSON), json);
+    row("sexpr", output_size(Tree::ASTFormat::SExpr), sexpr);
+
+    fclose(null_file);
+    close(null_fd);
+
+    return EXIT_SUCCESS;
+}
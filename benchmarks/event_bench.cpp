@@ -0,0 +1,84 @@
+/*
+    This benchmark measures the throughput of reporting the structure of a large
+   module as events, compared with parsing it into a tree. Both start from the
+   same token stream, so only the parsers are timed. Additional Python files can
+   be passed on the command line.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BenchmarkSupport.h"
+#include "tpy/parse/EventParser.h"
+#include "tpy/parse/Lexer.h"
+#include "tpy/parse/Parser.h"
+#include "tpy/parse/TokenStream.h"
+#include "tpy/source/SourceManager.h"
+#include "tpy/utility/ArenaAllocator.h"
+
+using namespace tpy;
+
+// This sink counts the calls and names of a module, like a simple metrics tool.
+class CountingSink : public Parse::EventSink {
+  public:
+    size_t calls = 0, names = 0;
+
+    auto enter_group(Parse::GroupKind kind, Source::Span) -> void {
+        calls += kind == Parse::GroupKind::Call;
+    }
+
+    auto visit_name(Source::Span) -> void { ++names; }
+};
+
+int main(int argc, char *argv[]) {
+    std::vector<std::pair<std::string, std::string>> inputs;
+    inputs.emplace_back("module", Benchmark::write_temp_source(
+                                      "tpy_bench_events.py",
+                                      Benchmark::generate_module(40000)));
+
+    for (int i = 1; i < argc; i++) {
+        inputs.emplace_back(argv[i], argv[i]);
+    }
+
+    Source::SourceManager src_mgr;
+
+    printf("%-12s %10s %10s %12s %14s %10s\n", "input", "tokens", "parser",
+           "time (ms)", "Mtokens/s", "speedup");
+
+    for (auto &[name, path] : inputs) {
+        auto *src_file = src_mgr.open_py_src_file(path.data());
+
+        Parse::Lexer lexer{src_file};
+        auto stream = Parse::TokenStream::lex_all(lexer);
+        auto view = stream.view();
+
+        bool failed = false;
+        auto tree = Benchmark::time_best_of(5, [&]() {
+            Utility::ArenaAllocator arena{1 << 20};
+            Parse::Parser parser{view, src_file, arena};
+            failed |= !parser.parse_py_module();
+        });
+
+        if (failed) {
+            fprintf(stderr, "%s: failed to parse.\n", name.c_str());
+            return EXIT_FAILURE;
+        }
+
+        CountingSink sink;
+        auto events = Benchmark::time_best_of(5, [&]() {
+            Parse::EventParser<CountingSink> parser{view, src_file, sink};
+            parser.parse_py_module();
+        });
+
+        printf("%-12s %10zu %10s %12.3f %14.1f %10.2f\n", name.c_str(),
+               view.size, "tree", tree * 1000, view.size / tree / 1e6, 1.0);
+        printf("%-12s %10zu %10s %12.3f %14.1f %10.2f\n", name.c_str(),
+               view.size, "events", events * 1000, view.size / events / 1e6,
+               tree / events);
+    }
+
+    return EXIT_SUCCESS;
+}
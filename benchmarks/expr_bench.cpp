@@ -0,0 +1,249 @@
+/*
+    This benchmark measures the expression parser on expression-heavy inputs. It
+   reports the throughput in AST nodes per second and the deepest native stack
+   usage of a single parse. Additional Python files can be passed on the
+   command line, and each of them must contain a single expression.
+
+    It also parses a pathologically deep expression in every expression parse
+   mode, to compare the cost of the explicit stack with recursive descent.
+*/
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BenchmarkSupport.h"
+#include "tpy/parse/Parser.h"
+#include "tpy/parse/TokenStream.h"
+#include "tpy/source/SourceManager.h"
+#include "tpy/utility/ArenaAllocator.h"
+
+using namespace tpy;
+
+// Every heap allocation is counted so that the allocations made by a parse can
+// be reported.
+static std::atomic<size_t> heap_allocations{0};
+
+auto operator new(size_t size) -> void * {
+    ++heap_allocations;
+
+    if (auto *mem = malloc(size ? size : 1)) {
+        return mem;
+    }
+
+    throw std::bad_alloc{};
+}
+
+auto operator delete(void *mem) noexcept -> void { free(mem); }
+
+auto operator delete(void *mem, size_t) noexcept -> void { free(mem); }
+
+// This generates a long flat expression that cycles through every binary
+// operator, with unary operators sprinkled in.
+static auto generate_flat_expr(size_t terms) -> std::string {
+    static const char *ops[] = {"+",  "*",  "-",     "/",      "**", "%",
+                                "<<", "&",  ">>",    "^",      "|",  "<",
+                                "and", "==", "or",   "is not", "in", ">=",
+                                "or", "not in"};
+    constexpr size_t num_ops = sizeof(ops) / sizeof(ops[0]);
+
+    std::string result;
+    for (size_t i = 0; i < terms; i++) {
+        if (i) {
+            const char *op = ops[(i - 1) % num_ops];
+            result += ' ';
+            result += op;
+            result += ' ';
+
+            // 'not' is only valid as an operand of the logical operators.
+            if (op[0] == 'a' || op[0] == 'o') {
+                result += "not ";
+            }
+        }
+
+        if (i % 7 == 3) {
+            result += '-';
+        } else if (i % 11 == 5) {
+            result += '~';
+        }
+
+        if (i % 3) {
+            result += "v" + std::to_string(i % 97);
+        } else {
+            result += std::to_string(i);
+        }
+    }
+
+    return result;
+}
+
+// This generates a sum of deeply parenthesized groups.
+static auto generate_nested_expr(size_t groups, size_t depth) -> std::string {
+    static const char *ops[] = {" + ", " * ", " - ", " | ", " and ", " < "};
+    constexpr size_t num_ops = sizeof(ops) / sizeof(ops[0]);
+
+    std::string result;
+    for (size_t g = 0; g < groups; g++) {
+        if (g) {
+            result += " + ";
+        }
+
+        for (size_t d = 0; d < depth; d++) {
+            result += "(a";
+            result += std::to_string(d);
+            result += ops[d % num_ops];
+        }
+
+        result += "z";
+        result.append(depth, ')');
+    }
+
+    return result;
+}
+
+// This generates a sum of calls, attribute references, and subscripts.
+static auto generate_call_expr(size_t calls) -> std::string {
+    std::string result;
+    for (size_t i = 0; i < calls; i++) {
+        if (i) {
+            result += " + ";
+        }
+
+        result += "f(a + b * c, g(d ** -e), x[i + 1], y[1:n - 1]) * obj.k";
+        result += std::to_string(i % 13);
+    }
+
+    return result;
+}
+
+// This generates a single expression that is nested the given number of times,
+// cycling through every kind of bracket and a prefix operator.
+static auto generate_deep_expr(size_t depth) -> std::string {
+    static const char *openers[] = {"(", "[", "{", "-", "f(", "a["};
+    static const char *closers[] = {")", "]", "}", "", ")", "]"};
+    constexpr size_t num_openers = sizeof(openers) / sizeof(openers[0]);
+
+    std::string result;
+    for (size_t i = 0; i < depth; i++) {
+        result += openers[i % num_openers];
+    }
+
+    result += "z";
+    for (size_t i = depth; i-- > 0;) {
+        result += closers[i % num_openers];
+    }
+
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<std::pair<std::string, std::string>> inputs;
+    inputs.emplace_back(
+        "flat", Benchmark::write_temp_source("tpy_bench_flat.py",
+                                             generate_flat_expr(200000)));
+    inputs.emplace_back(
+        "nested", Benchmark::write_temp_source("tpy_bench_nested.py",
+                                               generate_nested_expr(2000, 64)));
+    inputs.emplace_back(
+        "calls", Benchmark::write_temp_source("tpy_bench_calls.py",
+                                              generate_call_expr(20000)));
+
+    for (int i = 1; i < argc; i++) {
+        inputs.emplace_back(argv[i], argv[i]);
+    }
+
+    Source::SourceManager src_mgr;
+
+    printf("%-12s %10s %10s %12s %14s %14s %8s\n", "input", "tokens",
+           "nodes", "parse (ms)", "nodes/s", "stack (bytes)", "allocs");
+
+    for (auto &[name, path] : inputs) {
+        auto *src_file = src_mgr.open_py_src_file(path.data());
+
+        // The input is lexed once up front so that only the parser is timed.
+        Parse::Lexer lexer{src_file};
+        auto stream = Parse::TokenStream::lex_all(lexer);
+        auto view = stream.view();
+
+        // The arena is created within the timed region, as freeing the tree is
+        // part of the cost of parsing it.
+        auto parse_once = [&]() {
+            Utility::ArenaAllocator arena{1 << 20};
+            Parse::Parser parser{view, src_file, arena};
+            parser.parse_py_compilation_unit();
+        };
+
+        size_t nodes = 0;
+        {
+            Utility::ArenaAllocator arena{1 << 20};
+            Parse::Parser parser{view, src_file, arena};
+            auto *tree = parser.parse_py_compilation_unit();
+
+            if (!tree) {
+                fprintf(stderr, "%s: failed to parse.\n", name.c_str());
+                return EXIT_FAILURE;
+            }
+
+            nodes = Benchmark::count_nodes(tree);
+        }
+
+        auto allocations = heap_allocations.load();
+        parse_once();
+        allocations = heap_allocations.load() - allocations;
+
+        auto seconds = Benchmark::time_best_of(5, parse_once);
+        auto stack = Benchmark::measure_stack_usage(parse_once);
+
+        printf("%-12s %10zu %10zu %12.3f %14.0f %14zu %8zu\n", name.c_str(),
+               view.size, nodes, seconds * 1000, nodes / seconds, stack,
+               allocations);
+    }
+
+    constexpr size_t deep_depth = 100000;
+    auto deep_path = Benchmark::write_temp_source(
+        "tpy_bench_deep.py", generate_deep_expr(deep_depth));
+    auto *deep_file = src_mgr.open_py_src_file(deep_path.data());
+
+    Parse::Lexer deep_lexer{deep_file};
+    auto deep_stream = Parse::TokenStream::lex_all(deep_lexer);
+    auto deep_view = deep_stream.view();
+
+    printf("\n%-12s %10s %10s %12s %14s\n", "deep mode", "depth", "tokens",
+           "parse (ms)", "stack (bytes)");
+
+    std::pair<const char *, Parse::ExprParseMode> modes[] = {
+        {"recursive", Parse::ExprParseMode::Recursive},
+        {"iterative", Parse::ExprParseMode::Iterative},
+        {"adaptive", Parse::ExprParseMode::Adaptive}};
+
+    for (auto &[name, mode] : modes) {
+        bool parsed = true;
+        auto parse_once = [&]() {
+            Utility::ArenaAllocator arena{1 << 20};
+            Parse::Parser parser{deep_view, deep_file, arena};
+            parser.set_expr_parse_mode(mode);
+            parser.set_max_nesting_depth(2 * deep_depth);
+            parsed = parser.parse_py_compilation_unit() != nullptr;
+        };
+
+        // The recursive mode needs a far larger stack than the main thread
+        // has, so every run happens on the measured thread.
+        double seconds = 0;
+        auto stack = Benchmark::measure_stack_usage(
+            [&]() { seconds = Benchmark::time_best_of(5, parse_once); });
+
+        if (!parsed) {
+            fprintf(stderr, "%s: failed to parse the deep input.\n", name);
+            return EXIT_FAILURE;
+        }
+
+        printf("%-12s %10zu %10zu %12.3f %14zu\n", name, deep_depth,
+               deep_view.size, seconds * 1000, stack);
+    }
+
+    return EXIT_SUCCESS;
+}
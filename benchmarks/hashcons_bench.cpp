@@ -0,0 +1,88 @@
+/*
+    This benchmark measures the cost of hashing the tree of a large generated
+   module and of sharing its identical subtrees, and reports how many nodes
+   and bytes are shared. Both are timed together with the parse, as interning
+   changes the tree, and the time of the parse alone is subtracted. Each is
+   timed with a walk of the finished tree and with the hashes computed by the
+   parser as it makes the nodes.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "BenchmarkSupport.h"
+#include "tpy/parse/Lexer.h"
+#include "tpy/parse/Parser.h"
+#include "tpy/source/SourceManager.h"
+#include "tpy/tree/StructuralHash.h"
+#include "tpy/utility/ArenaAllocator.h"
+
+using namespace tpy;
+
+int main() {
+    auto path = Benchmark::write_temp_source("tpy_bench_hashcons.py",
+                                             Benchmark::generate_module(5000));
+
+    Source::SourceManager src_mgr;
+    auto *src_file = src_mgr.open_py_src_file(path.data());
+
+    // When 'hash_while_parsing' is set, the parser hashes every node as it is
+    // made.
+    auto parse_then = [&](bool hash_while_parsing, auto &&fn) {
+        return Benchmark::time_best_of(5, [&]() {
+            Parse::Lexer lexer{src_file};
+            Utility::ArenaAllocator arena{1 << 20};
+            Parse::Parser parser{lexer, arena};
+            Tree::StructuralHasher hasher{src_file};
+            if (hash_while_parsing) {
+                parser.attach_hasher(&hasher);
+            }
+            fn(parser.parse_py_module());
+        });
+    };
+
+    auto parse = parse_then(false, [](Tree::ASTNode *) {});
+    auto hash = parse_then(false, [&](Tree::ASTNode *module) {
+        Tree::StructuralHasher{src_file}.hash_tree(module);
+    });
+    auto parse_hashed = parse_then(true, [](Tree::ASTNode *) {});
+    auto intern = parse_then(false, [&](Tree::ASTNode *module) {
+        Tree::HashConser{src_file}.intern(module);
+    });
+    auto intern_hashed = parse_then(true, [&](Tree::ASTNode *module) {
+        Tree::HashConser{src_file}.intern(module, true);
+    });
+
+    // The sharing is measured once, apart from the timed runs.
+    Parse::Lexer lexer{src_file};
+    Utility::ArenaAllocator arena{1 << 20};
+    Parse::Parser parser{lexer, arena};
+    auto *module = parser.parse_py_module();
+
+    Tree::HashConser conser{src_file};
+    module = conser.intern(module);
+
+    auto copy = Benchmark::time_best_of(5, [&]() {
+        Utility::ArenaAllocator arena{1 << 20};
+        Tree::copy_tree(module, arena);
+    });
+
+    printf("%zu nodes\n", conser.node_count());
+    conser.print_report(stdout);
+    printf("%-20s %12s %14s\n", "step", "time (ms)", "% of parse");
+
+    auto row = [&](const char *name, double seconds) {
+        printf("%-20s %12.3f %13.1f%%\n", name, seconds * 1000,
+               seconds * 100 / parse);
+    };
+
+    row("parse", parse);
+    row("hash", hash - parse);
+    row("hash while parsing", parse_hashed - parse);
+    row("intern", intern - parse);
+    row("intern while parsing", intern_hashed - parse);
+    row("copy interned tree", copy);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,110 @@
+/*
+    This benchmark measures the latency of keeping the tree of a large module up
+   to date while a line is typed into it, one keystroke at a time, and compares
+   it with parsing the whole module again after every keystroke. The keystrokes
+   that leave a syntax error behind report it as usual, so the error output is
+   best redirected.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "BenchmarkSupport.h"
+#include "tpy/parse/IncrementalParser.h"
+#include "tpy/parse/Lexer.h"
+#include "tpy/parse/Parser.h"
+#include "tpy/parse/TokenStream.h"
+#include "tpy/source/SourceManager.h"
+#include "tpy/utility/ArenaAllocator.h"
+
+using namespace tpy;
+
+// This generates a module of about 10 lines per function.
+static auto generate_module(size_t defs) -> std::string {
+    std::string result = "import os.path as osp, sys\n\n";
+
+    for (size_t i = 0; i < defs; i++) {
+        auto n = std::to_string(i);
+        result += "@decorator(" + n + ")\n";
+        result +=
+            "def func_" + n + "(a, b: int = 1, *args, **kwargs) -> int:\n";
+        result += "    total = a + b * " + n + "\n";
+        result += "    for i, item in enumerate(args):\n";
+        result += "        if item is None or i > len(kwargs):\n";
+        result += "            continue\n";
+        result += "        elif item < 0:\n";
+        result += "            total -= item\n";
+        result += "        else:\n";
+        result += "            total += item[i:] * osp.join(a, b)\n";
+        result += "    return total\n\n";
+    }
+
+    return result;
+}
+
+// This is the line that is typed into the middle of the module. It opens and
+// closes brackets along the way, so some of the keystrokes leave the module
+// with a syntax error.
+static const std::string TYPED_LINE =
+    "    total = osp.join(total, [item * 2 for item in args], key=b)\n";
+
+int main() {
+    auto path = Benchmark::write_temp_source("tpy_bench_incremental.py",
+                                             generate_module(1000));
+
+    Source::SourceManager src_mgr;
+    auto *src_file = src_mgr.open_py_src_file(path.data());
+    auto lines = src_file->line_map.size();
+
+    Parse::IncrementalParser parser{src_file};
+    auto insert_at = std::string{src_file->start(), src_file->size()}.find(
+        "    return total\n", src_file->size() / 2);
+
+    double total = 0, worst = 0;
+    size_t reparsed = 0;
+
+    // The line is typed in, and then deleted again with backspace.
+    auto keystroke = [&](size_t pos, size_t old_len, std::string_view text) {
+        auto start = std::chrono::steady_clock::now();
+        parser.edit(pos, old_len, text);
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        total += elapsed.count();
+        worst = std::max(worst, elapsed.count());
+        reparsed += parser.reparsed_segments();
+    };
+
+    for (size_t i = 0; i < TYPED_LINE.size(); i++) {
+        keystroke(insert_at + i, 0, std::string_view{TYPED_LINE}.substr(i, 1));
+    }
+
+    for (size_t i = TYPED_LINE.size(); i-- > 0;) {
+        keystroke(insert_at + i, 1, "");
+    }
+
+    auto keystrokes = TYPED_LINE.size() * 2;
+
+    // A full parse lexes and parses the edited text from scratch.
+    auto full = Benchmark::time_best_of(5, [&]() {
+        Parse::Lexer lexer{parser.source()};
+        auto stream = Parse::TokenStream::lex_all(lexer);
+        Utility::ArenaAllocator arena{1 << 20};
+        Parse::Parser full_parser{stream.view(), parser.source(), arena};
+        full_parser.parse_py_module();
+    });
+
+    printf("%zu lines, %zu top-level statements, %zu keystrokes\n", lines,
+           parser.segment_count(), keystrokes);
+    printf("%-24s %12s %12s %12s\n", "", "avg (ms)", "max (ms)", "stmts");
+    printf("%-24s %12.4f %12.4f %12.1f\n", "incremental",
+           total / keystrokes * 1000, worst * 1000,
+           static_cast<double>(reparsed) / keystrokes);
+    printf("%-24s %12.4f %12.4f %12zu\n", "full reparse", full * 1000,
+           full * 1000, parser.segment_count());
+
+    return EXIT_SUCCESS;
+}
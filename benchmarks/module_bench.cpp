@@ -0,0 +1,79 @@
+/*
+    This benchmark measures the latency of parsing a large module as the number
+   of threads grows. The top-level statements of the module are split between
+   the threads, so the latency should fall with every core that is added.
+   Additional Python files can be passed on the command line.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "BenchmarkSupport.h"
+#include "tpy/parse/Lexer.h"
+#include "tpy/parse/ParallelParser.h"
+#include "tpy/parse/TokenStream.h"
+#include "tpy/source/SourceManager.h"
+#include "tpy/utility/ArenaAllocator.h"
+
+using namespace tpy;
+
+int main(int argc, char *argv[]) {
+    std::vector<std::pair<std::string, std::string>> inputs;
+    inputs.emplace_back("module", Benchmark::write_temp_source(
+                                      "tpy_bench_module.py",
+                                      Benchmark::generate_module(40000)));
+
+    for (int i = 1; i < argc; i++) {
+        inputs.emplace_back(argv[i], argv[i]);
+    }
+
+    size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    Source::SourceManager src_mgr;
+
+    printf("%-12s %10s %10s %8s %12s %10s\n", "input", "tokens", "stmts",
+           "threads", "parse (ms)", "speedup");
+
+    for (auto &[name, path] : inputs) {
+        auto *src_file = src_mgr.open_py_src_file(path.data());
+
+        // The input is lexed once up front so that only the parser is timed.
+        Parse::Lexer lexer{src_file};
+        auto stream = Parse::TokenStream::lex_all(lexer);
+        auto view = stream.view();
+
+        auto stmts = Parse::ParallelParser::find_top_level_stmts(view).size();
+
+        double single_thread = 0;
+
+        for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+            bool failed = false;
+
+            auto parse_once = [&]() {
+                Utility::ArenaAllocator arena{1 << 20};
+                Parse::ParallelParser parser{view, src_file, arena};
+                failed |= !parser.parse_py_module(threads);
+            };
+
+            auto seconds = Benchmark::time_best_of(5, parse_once);
+            if (failed) {
+                fprintf(stderr, "%s: failed to parse.\n", name.c_str());
+                return EXIT_FAILURE;
+            }
+
+            if (threads == 1) {
+                single_thread = seconds;
+            }
+
+            printf("%-12s %10zu %10zu %8zu %12.3f %10.2f\n", name.c_str(),
+                   view.size, stmts, threads, seconds * 1000,
+                   single_thread / seconds);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,169 @@
+/*
+    This benchmark measures the time of running several analyses over a large
+   module, first with one walk of the tree per analysis, then with all of them
+   fused into a single walk, and then with the thread-safe ones running on the
+   subtrees in parallel. The number of threads can be passed on the command
+   line.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BenchmarkSupport.h"
+#include "tpy/parse/Lexer.h"
+#include "tpy/parse/Parser.h"
+#include "tpy/source/SourceManager.h"
+#include "tpy/tree/ASTVisitor.h"
+#include "tpy/tree/PassManager.h"
+#include "tpy/utility/ArenaAllocator.h"
+
+using namespace tpy;
+using namespace tpy::Tree;
+
+// This pass collects the spans of the names, like an indexer would.
+class NamePass : public ASTPass {
+  public:
+    static constexpr const char *NAME = "names";
+
+    std::vector<Source::Span> names;
+
+    auto enter(ASTNode *node) -> void {
+        if (node->kind == ASTNodeKind::NameExpr) {
+            names.push_back(node->loc);
+        }
+    }
+};
+
+// This pass finds the deepest nesting of the nodes.
+class DepthPass : public ASTPass {
+  public:
+    static constexpr const char *NAME = "depth";
+
+    size_t depth = 0, max_depth = 0;
+
+    auto enter(ASTNode *) -> void {
+        max_depth = std::max(max_depth, ++depth);
+    }
+
+    auto leave(ASTNode *) -> void { --depth; }
+};
+
+// This pass counts the branches of the functions, like a complexity lint.
+class BranchPass : public ASTPass, public ASTVisitor<BranchPass> {
+  public:
+    static constexpr const char *NAME = "branches";
+    static constexpr bool THREAD_SAFE = true;
+
+    using ASTVisitor::visit;
+
+    std::atomic<size_t> branches = 0;
+
+    auto enter(ASTNode *node) -> void { visit_node(node); }
+
+    auto visit(ASTIfStmtNode *) -> void { ++branches; }
+
+    auto visit(ASTForStmtNode *) -> void { ++branches; }
+
+    auto visit(ASTWhileStmtNode *) -> void { ++branches; }
+
+    auto visit(ASTExceptHandlerNode *) -> void { ++branches; }
+
+    auto visit(ASTTernaryOpExprNode *) -> void { ++branches; }
+};
+
+// This pass sums the lengths of the literals.
+class LiteralPass : public ASTPass {
+  public:
+    static constexpr const char *NAME = "literals";
+    static constexpr bool THREAD_SAFE = true;
+
+    std::atomic<size_t> bytes = 0;
+
+    auto enter(ASTNode *node) -> void {
+        if (node->kind <= ASTNodeKind::EllipsisLiteral) {
+            bytes += node->loc.len;
+        }
+    }
+};
+
+int main(int argc, char *argv[]) {
+    size_t num_threads = argc > 1 ? std::stoul(argv[1])
+                                  : std::thread::hardware_concurrency();
+
+    auto path = Benchmark::write_temp_source("tpy_bench_passes.py",
+                                             Benchmark::generate_module(20000));
+
+    Source::SourceManager src_mgr;
+    auto *src_file = src_mgr.open_py_src_file(path.data());
+
+    Parse::Lexer lexer{src_file};
+    Utility::ArenaAllocator arena{1 << 20};
+    Parse::Parser parser{lexer, arena};
+    auto *module = parser.parse_py_module();
+
+    if (!module) {
+        fprintf(stderr, "%s: failed to parse.\n", path.c_str());
+        return EXIT_FAILURE;
+    }
+
+    NamePass names;
+    DepthPass depth;
+    BranchPass branches;
+    LiteralPass literals;
+
+    auto reset = [&]() {
+        names.names.clear();
+        depth.max_depth = 0;
+        branches.branches = 0;
+        literals.bytes = 0;
+    };
+
+    auto separate = Benchmark::time_best_of(10, [&]() {
+        reset();
+        PassManager{names}.run(module);
+        PassManager{depth}.run(module);
+        PassManager{branches}.run(module);
+        PassManager{literals}.run(module);
+    });
+
+    PassManager fused{names, depth, branches, literals};
+    auto fused_time = Benchmark::time_best_of(10, [&]() {
+        reset();
+        fused.run(module);
+    });
+
+    fused.set_num_threads(num_threads);
+    auto parallel_time = Benchmark::time_best_of(10, [&]() {
+        reset();
+        fused.run(module);
+    });
+
+    printf("%zu nodes, %zu names, depth %zu, %zu branches, %zu literal "
+           "bytes\n",
+           Benchmark::count_nodes(module), names.names.size(), depth.max_depth,
+           branches.branches.load(), literals.bytes.load());
+    printf("%-24s %12s %10s\n", "walk", "time (ms)", "speedup");
+    printf("%-24s %12.3f %10.2f\n", "one walk per pass", separate * 1000,
+           1.0);
+    printf("%-24s %12.3f %10.2f\n", "fused", fused_time * 1000,
+           separate / fused_time);
+    printf("%-24s %12.3f %10.2f\n",
+           ("fused, " + std::to_string(num_threads) + " threads").c_str(),
+           parallel_time * 1000, separate / parallel_time);
+
+    // The timed run reads the clock around every hook, so it is slower than
+    // the runs above, but it shows where the time goes.
+    printf("\n");
+    reset();
+    fused.set_num_threads(1);
+    fused.set_timed(true);
+    fused.run(module);
+    fused.print_report(stdout);
+
+    return EXIT_SUCCESS;
+}
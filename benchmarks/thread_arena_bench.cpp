@@ -0,0 +1,98 @@
+/*
+    This benchmark measures how fast threads allocate from arenas. Every
+   thread allocates the same number of objects, either from one arena that is
+   shared behind a mutex, or from an arena of its own that is spliced into the
+   shared one when the thread is done. The time to splice is part of the
+   second run, and is also shown on its own.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BenchmarkSupport.h"
+#include "tpy/tree/ASTExpr.h"
+#include "tpy/utility/ArenaAllocator.h"
+
+using namespace tpy;
+
+namespace {
+constexpr size_t NUM_OBJECTS_PER_THREAD = 100000;
+
+constexpr size_t OBJECT_SIZE = sizeof(Tree::ASTNameExprNode);
+
+// Every object is touched, so that the cost of faulting the slabs in is part
+// of both runs.
+auto allocate_objects(Utility::ArenaAllocator &arena, std::mutex *mutex)
+    -> void {
+    for (size_t i = 0; i < NUM_OBJECTS_PER_THREAD; i++) {
+        if (mutex) {
+            std::lock_guard<std::mutex> lock{*mutex};
+            *static_cast<char *>(arena.allocate_bytes(OBJECT_SIZE, 8)) = 0;
+        } else {
+            *static_cast<char *>(arena.allocate_bytes(OBJECT_SIZE, 8)) = 0;
+        }
+    }
+}
+} // namespace
+
+int main() {
+    printf("%zu objects of %zu bytes per thread on %u cores\n",
+           NUM_OBJECTS_PER_THREAD, OBJECT_SIZE,
+           std::thread::hardware_concurrency());
+    printf("%-8s %16s %18s %12s\n", "threads", "shared (M/s)",
+           "per-thread (M/s)", "splice (us)");
+
+    for (size_t num_threads : {1, 2, 4, 8, 16, 32, 64}) {
+        auto total = static_cast<double>(num_threads * NUM_OBJECTS_PER_THREAD);
+
+        auto shared_time = Benchmark::time_best_of(5, [&]() {
+            Utility::ArenaAllocator arena;
+            std::mutex mutex;
+
+            std::vector<std::thread> threads;
+            for (size_t k = 0; k < num_threads; k++) {
+                threads.emplace_back(
+                    [&arena, &mutex]() { allocate_objects(arena, &mutex); });
+            }
+
+            for (auto &thread : threads) {
+                thread.join();
+            }
+        });
+
+        double splice_time = 0;
+        auto local_time = Benchmark::time_best_of(5, [&]() {
+            Utility::ArenaAllocator arena;
+            std::vector<Utility::ArenaAllocator> worker_arenas(num_threads);
+
+            std::vector<std::thread> threads;
+            for (size_t k = 0; k < num_threads; k++) {
+                threads.emplace_back([&worker_arenas, k]() {
+                    allocate_objects(worker_arenas[k], nullptr);
+                });
+            }
+
+            for (auto &thread : threads) {
+                thread.join();
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            for (auto &worker_arena : worker_arenas) {
+                arena.splice(std::move(worker_arena));
+            }
+            std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now() - start;
+            splice_time = elapsed.count();
+        });
+
+        printf("%-8zu %16.1f %18.1f %12.2f\n", num_threads,
+               total / shared_time / 1e6, total / local_time / 1e6,
+               splice_time * 1e6);
+    }
+
+    return EXIT_SUCCESS;
+}
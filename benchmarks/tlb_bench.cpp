@@ -0,0 +1,171 @@
+/*
+    This benchmark parses a large generated module into an arena of regular
+   slabs and into an arena of huge-page slabs, and then walks the tree. Both
+   steps are timed, and the misses of the data TLB are counted with
+   'perf_event_open' where the kernel allows it. The amount of memory that is
+   backed by huge pages shows whether the kernel gave the arena any.
+*/
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "BenchmarkSupport.h"
+#include "tpy/parse/Lexer.h"
+#include "tpy/parse/Parser.h"
+#include "tpy/source/SourceManager.h"
+#include "tpy/utility/ArenaAllocator.h"
+#include "tpy/utility/HugePages.h"
+
+using namespace tpy;
+
+namespace {
+/*
+    This counts the load misses of the data TLB of this thread, while it is
+   enabled. The counter is not available in most containers and virtual
+   machines, in which case it reads as -1.
+*/
+class TLBMissCounter {
+    int fd;
+
+  public:
+    TLBMissCounter() {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                      (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        fd = static_cast<int>(
+            syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    TLBMissCounter(const TLBMissCounter &) = delete;
+
+    auto operator=(const TLBMissCounter &) -> TLBMissCounter & = delete;
+
+    ~TLBMissCounter() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    auto start() -> void {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    auto stop() -> int64_t {
+        if (fd < 0) {
+            return -1;
+        }
+
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+        uint64_t count = 0;
+        if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+            return -1;
+        }
+        return static_cast<int64_t>(count);
+    }
+};
+
+// This reads the amount of anonymous memory of the process that is backed by
+// huge pages, in KiB.
+auto anon_huge_kib() -> long {
+    std::ifstream file{"/proc/self/smaps_rollup"};
+    std::string line;
+
+    while (std::getline(file, line)) {
+        if (line.rfind("AnonHugePages:", 0) == 0) {
+            return std::stol(line.substr(14));
+        }
+    }
+
+    return -1;
+}
+
+constexpr int NUM_WALKS = 10;
+} // namespace
+
+int main() {
+    auto path = Benchmark::write_temp_source(
+        "tpy_bench_tlb.py", Benchmark::generate_module(50000));
+
+    Source::SourceManager src_mgr;
+    auto *src_file = src_mgr.open_py_src_file(path.data());
+
+    printf("huge pages %s\n", Utility::huge_pages_available()
+                                  ? "available"
+                                  : "not available, falling back");
+    printf("%-10s %8s %10s %14s %10s %14s %12s\n", "slabs", "MiB",
+           "parse (ms)", "parse misses", "walk (ms)", "walk misses",
+           "huge (MiB)");
+
+    using SlabPages = Utility::ArenaAllocator::SlabPages;
+
+    auto run = [&](const char *name, SlabPages pages) {
+        auto huge_before = anon_huge_kib();
+        TLBMissCounter counter;
+
+        Parse::Lexer lexer{src_file};
+        Utility::ArenaAllocator arena{1 << 20, nullptr, pages};
+        Parse::Parser parser{lexer, arena};
+
+        counter.start();
+        auto start = std::chrono::steady_clock::now();
+        auto *module = parser.parse_py_module();
+        std::chrono::duration<double> parse_time =
+            std::chrono::steady_clock::now() - start;
+        auto parse_misses = counter.stop();
+
+        size_t nodes = 0;
+        counter.start();
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < NUM_WALKS; i++) {
+            nodes += Benchmark::count_nodes(module);
+        }
+        std::chrono::duration<double> walk_time =
+            std::chrono::steady_clock::now() - start;
+        auto walk_misses = counter.stop();
+        if (walk_misses > 0) {
+            walk_misses /= NUM_WALKS;
+        }
+
+        auto huge_after = anon_huge_kib();
+
+        printf("%-10s %8zu %10.3f %14lld %10.3f %14lld %12ld\n", name,
+               arena.capacity() >> 20, parse_time.count() * 1000,
+               static_cast<long long>(parse_misses),
+               walk_time.count() * 1000 / NUM_WALKS,
+               static_cast<long long>(walk_misses),
+               (huge_after - huge_before) >> 10);
+
+        return nodes;
+    };
+
+    // Each kind is run twice, and the second run is the one that counts, so
+    // that the first run warms up the source and the heap.
+    run("regular", SlabPages::Regular);
+    run("regular", SlabPages::Regular);
+    run("huge", SlabPages::Huge);
+    run("huge", SlabPages::Huge);
+
+    return EXIT_SUCCESS;
+}
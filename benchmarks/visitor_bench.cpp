@@ -0,0 +1,215 @@
+/*
+    This benchmark measures the cost of dispatching on the nodes of a large
+   tree. The same metrics are collected by walking the tree with a chain of
+   'dynamic_cast', with a virtual call per node, and with the visitor that
+   switches on the kind of the node. The walk itself is the same for all three,
+   so only the dispatch differs.
+*/
+
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "BenchmarkSupport.h"
+#include "tpy/parse/Lexer.h"
+#include "tpy/parse/Parser.h"
+#include "tpy/source/SourceManager.h"
+#include "tpy/tree/ASTVisitor.h"
+#include "tpy/utility/ArenaAllocator.h"
+
+using namespace tpy;
+using namespace tpy::Tree;
+
+// These are the metrics of a module, like the ones a simple lint tool reports.
+struct Metrics {
+    size_t names = 0, calls = 0, operators = 0, literal_bytes = 0;
+
+    auto operator==(const Metrics &other) const -> bool {
+        return names == other.names && calls == other.calls &&
+               operators == other.operators &&
+               literal_bytes == other.literal_bytes;
+    }
+};
+
+// This function calls the callback on every node of the tree in pre-order.
+template <class F> static auto walk(ASTNode *root, F &&fn) -> void {
+    std::vector<ASTNode *> stack{root};
+
+    while (!stack.empty()) {
+        auto *node = stack.back();
+        stack.pop_back();
+
+        fn(node);
+        for_each_child(node, [&](ASTNode *child) { stack.push_back(child); });
+    }
+}
+
+// This collects the metrics by matching the type of every node in turn.
+static auto metrics_by_cast(ASTNode *root) -> Metrics {
+    Metrics metrics;
+
+    walk(root, [&](ASTNode *node) {
+        if (dynamic_cast<ASTNameExprNode *>(node)) {
+            ++metrics.names;
+        } else if (dynamic_cast<ASTCallExprNode *>(node)) {
+            ++metrics.calls;
+        } else if (dynamic_cast<ASTBinaryOpExprNode *>(node) ||
+                   dynamic_cast<ASTUnaryOpExprNode *>(node)) {
+            ++metrics.operators;
+        } else if (dynamic_cast<ASTIntLiteralNode *>(node) ||
+                   dynamic_cast<ASTStringLiteralNode *>(node)) {
+            metrics.literal_bytes += node->loc.len;
+        }
+    });
+
+    return metrics;
+}
+
+/*
+    This is the handler of a single node class, which is called through a
+   virtual method, like the 'accept' method of a classic visitor would be.
+*/
+class VirtualHandler {
+  public:
+    virtual ~VirtualHandler() = default;
+
+    virtual auto visit(ASTNode *, Metrics &) -> void {}
+};
+
+class NameHandler : public VirtualHandler {
+  public:
+    auto visit(ASTNode *, Metrics &metrics) -> void override {
+        ++metrics.names;
+    }
+};
+
+class CallHandler : public VirtualHandler {
+  public:
+    auto visit(ASTNode *, Metrics &metrics) -> void override {
+        ++metrics.calls;
+    }
+};
+
+class OperatorHandler : public VirtualHandler {
+  public:
+    auto visit(ASTNode *, Metrics &metrics) -> void override {
+        ++metrics.operators;
+    }
+};
+
+class LiteralHandler : public VirtualHandler {
+  public:
+    auto visit(ASTNode *node, Metrics &metrics) -> void override {
+        metrics.literal_bytes += node->loc.len;
+    }
+};
+
+// This collects the metrics with a virtual call for every node.
+static auto metrics_by_virtual(
+    ASTNode *root,
+    const std::array<VirtualHandler *, NUM_AST_NODE_KINDS> &handlers)
+    -> Metrics {
+    Metrics metrics;
+
+    walk(root, [&](ASTNode *node) {
+        handlers[static_cast<size_t>(node->kind)]->visit(node, metrics);
+    });
+
+    return metrics;
+}
+
+// This collects the metrics with the visitor that switches on the kind.
+class MetricsVisitor : public ASTVisitor<MetricsVisitor> {
+  public:
+    using ASTVisitor::visit;
+
+    Metrics metrics;
+
+    auto visit(ASTNameExprNode *) -> void { ++metrics.names; }
+
+    auto visit(ASTCallExprNode *) -> void { ++metrics.calls; }
+
+    auto visit(ASTBinaryOpExprNode *) -> void { ++metrics.operators; }
+
+    auto visit(ASTUnaryOpExprNode *) -> void { ++metrics.operators; }
+
+    auto visit(ASTIntLiteralNode *node) -> void {
+        metrics.literal_bytes += node->loc.len;
+    }
+
+    auto visit(ASTStringLiteralNode *node) -> void {
+        metrics.literal_bytes += node->loc.len;
+    }
+};
+
+static auto metrics_by_visitor(ASTNode *root) -> Metrics {
+    MetricsVisitor visitor;
+    walk(root, [&](ASTNode *node) { visitor.visit_node(node); });
+
+    return visitor.metrics;
+}
+
+int main() {
+    auto path = Benchmark::write_temp_source("tpy_bench_visitor.py",
+                                             Benchmark::generate_module(20000));
+
+    Source::SourceManager src_mgr;
+    auto *src_file = src_mgr.open_py_src_file(path.data());
+
+    Parse::Lexer lexer{src_file};
+    Utility::ArenaAllocator arena{1 << 20};
+    Parse::Parser parser{lexer, arena};
+    auto *module = parser.parse_py_module();
+
+    if (!module) {
+        fprintf(stderr, "%s: failed to parse.\n", path.c_str());
+        return EXIT_FAILURE;
+    }
+
+    auto nodes = Benchmark::count_nodes(module);
+
+    VirtualHandler ignore;
+    NameHandler name;
+    CallHandler call;
+    OperatorHandler op;
+    LiteralHandler literal;
+
+    std::array<VirtualHandler *, NUM_AST_NODE_KINDS> handlers;
+    handlers.fill(&ignore);
+    handlers[static_cast<size_t>(ASTNodeKind::NameExpr)] = &name;
+    handlers[static_cast<size_t>(ASTNodeKind::CallExpr)] = &call;
+    handlers[static_cast<size_t>(ASTNodeKind::BinaryOpExpr)] = &op;
+    handlers[static_cast<size_t>(ASTNodeKind::UnaryOpExpr)] = &op;
+    handlers[static_cast<size_t>(ASTNodeKind::IntLiteral)] = &literal;
+    handlers[static_cast<size_t>(ASTNodeKind::StringLiteral)] = &literal;
+
+    Metrics by_cast, by_virtual, by_visitor;
+    auto cast_time = Benchmark::time_best_of(
+        10, [&]() { by_cast = metrics_by_cast(module); });
+    auto virtual_time = Benchmark::time_best_of(
+        10, [&]() { by_virtual = metrics_by_virtual(module, handlers); });
+    auto visitor_time = Benchmark::time_best_of(
+        10, [&]() { by_visitor = metrics_by_visitor(module); });
+
+    if (!(by_cast == by_virtual) || !(by_cast == by_visitor)) {
+        fprintf(stderr, "the walks do not agree on the metrics.\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("%zu nodes, %zu names, %zu calls, %zu operators\n", nodes,
+           by_cast.names, by_cast.calls, by_cast.operators);
+    printf("%-16s %12s %12s %10s\n", "dispatch", "time (ms)", "ns/node",
+           "speedup");
+
+    auto row = [&](const char *name, double seconds) {
+        printf("%-16s %12.3f %12.2f %10.2f\n", name, seconds * 1000,
+               seconds / nodes * 1e9, cast_time / seconds);
+    };
+
+    row("dynamic_cast", cast_time);
+    row("virtual", virtual_time);
+    row("visitor", visitor_time);
+
+    return EXIT_SUCCESS;
+}
@@ -6,6 +6,8 @@
 #ifndef TPY_COMPILER_FRONTENDERRORHANDLER_H
 #define TPY_COMPILER_FRONTENDERRORHANDLER_H
 
+#include <atomic>
+
 #include "tpy/source/SourceFile.h"
 
 namespace tpy::Compiler {
@@ -15,7 +17,13 @@ class FrontendErrorHandler {
     // at all during the entire phase. If errors have been encountered,
     // compilation will stop at the end of each phase.
 
-    static inline bool has_seen_error = false;
+    // Both members are atomic, as files and statements can be parsed on
+    // several threads at once.
+    static inline std::atomic<bool> has_seen_error = false;
+
+    // This member counts the errors that have been reported. It allows callers
+    // to check whether a single step of the frontend reported errors.
+    static inline std::atomic<size_t> num_errors = 0;
 
   public:
     static auto
@@ -24,6 +32,8 @@ class FrontendErrorHandler {
                                 const char *msg) -> void;
 
     static auto error() -> bool { return has_seen_error; }
+
+    static auto error_count() -> size_t { return num_errors; }
 };
 } // namespace tpy::Compiler
 
@@ -0,0 +1,259 @@
+/*
+    This file defines the event parser, which reports the structure of a module
+   to a sink as a stream of events instead of building a tree.
+*/
+
+#ifndef TPY_PARSE_EVENTPARSER_H
+#define TPY_PARSE_EVENTPARSER_H
+
+#include <utility>
+#include <vector>
+
+#include "tpy/parse/Token.h"
+#include "tpy/parse/TokenStream.h"
+#include "tpy/source/SourceFile.h"
+
+namespace tpy::Parse {
+// This is the kind of a group of tokens within brackets. Whether a '(' or a
+// '[' begins a call or a subscript depends on the token before it. The 'Params'
+// group holds the parameters of a 'def' or the bases of a 'class'.
+enum class GroupKind { Paren, Call, Params, List, Subscript, Braces };
+
+/*
+    This is the base of the event sinks. It ignores every event, so a sink only
+   needs to define the events that it is interested in. The events are called on
+   the type of the sink itself, rather than through virtual methods, so that
+   they can be inlined into the event parser.
+*/
+class EventSink {
+  public:
+    // These events surround every logical line, and every statement of a line
+    // that is separated by ';'. The kind is the kind of the first token, which
+    // tells the statements apart by their keyword.
+    auto enter_stmt(TokenKind, Source::Span) -> void {}
+    auto leave_stmt(Source::Span) -> void {}
+
+    // These events surround an indented block.
+    auto enter_block(Source::Span) -> void {}
+    auto leave_block(Source::Span) -> void {}
+
+    // These events surround a group, and are given the span of its brackets.
+    auto enter_group(GroupKind, Source::Span) -> void {}
+    auto leave_group(GroupKind, Source::Span) -> void {}
+
+    // This event is given every name that is not an attribute or a definition.
+    auto visit_name(Source::Span) -> void {}
+
+    // This event is given the name after a '.'.
+    auto visit_attribute(Source::Span) -> void {}
+
+    // This event is given the name after 'def' or 'class'.
+    auto visit_definition(TokenKind, Source::Span) -> void {}
+
+    // This event is given every literal, including 'None', 'True', 'False' and
+    // '...'.
+    auto visit_literal(TokenKind, Source::Span) -> void {}
+
+    // This event is given every other keyword, such as 'if' or 'and'.
+    auto visit_keyword(TokenKind, Source::Span) -> void {}
+};
+
+/*
+    The event parser is for tools that only need to know where the statements,
+   groups and names of a module are, such as indexers and import scanners. It
+   makes a single pass over the token stream and never allocates a node. The
+   brackets, indentation and newlines of the token stream already give the
+   structure of the module, so the event parser does not check the grammar,
+   and it reports no errors. A module with syntax errors simply produces the
+   events of the tokens that it has, so invalid input is accepted silently.
+   A tool that has to know whether a module is valid must still run the full
+   parser on it; the events alone never tell it so.
+
+    The sink is a template parameter, so that every event is a direct call that
+   can be inlined. Groups are tracked with a stack that grows with the nesting
+   depth, so deeply nested groups never use any native stack.
+*/
+template <class Sink> class EventParser {
+    TokenStreamView token_stream;
+    Source::SourceFile *src_file;
+    Sink &sink;
+
+    // These are the groups that are open at the current token.
+    std::vector<GroupKind> groups;
+
+    // This is set right after the name of a definition, so that the '(' after
+    // it is not mistaken for a call.
+    bool after_definition = false;
+
+    auto span(size_t i) const -> Source::Span {
+        size_t offset = token_stream.offsets[i];
+        return Source::Span{offset, offset + src_file->offset,
+                            token_stream.lens[i]};
+    }
+
+    // A '(' or a '[' after one of these tokens is a call or a subscript.
+    static auto ends_primary(TokenKind kind) -> bool {
+        switch (kind) {
+        case TokenKind::Identifier:
+        case TokenKind::RightParen:
+        case TokenKind::RightSquare:
+        case TokenKind::RightCurly:
+        case TokenKind::StringLiteral:
+        case TokenKind::BytesLiteral:
+        case TokenKind::FStringLiteral:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    static auto is_literal(TokenKind kind) -> bool {
+        return (kind >= TokenKind::IntLiteral &&
+                kind <= TokenKind::FStringLiteral) ||
+               kind == TokenKind::Ellipsis || kind == TokenKind::KeywordFalse ||
+               kind == TokenKind::KeywordNone ||
+               kind == TokenKind::KeywordTrue;
+    }
+
+    static auto is_keyword(TokenKind kind) -> bool {
+        return (kind >= TokenKind::KeywordAnd &&
+                kind <= TokenKind::KeywordYield) ||
+               kind == TokenKind::NotInOp || kind == TokenKind::IsNotOp;
+    }
+
+    auto open_group(GroupKind kind, Source::Span loc) -> void {
+        groups.push_back(kind);
+        sink.enter_group(kind, loc);
+    }
+
+    // A closing bracket without an open group is ignored.
+    auto close_group(Source::Span loc) -> void {
+        if (!groups.empty()) {
+            auto kind = groups.back();
+            groups.pop_back();
+            sink.leave_group(kind, loc);
+        }
+    }
+
+    auto visit_tok(TokenKind kind, TokenKind prev_kind, Source::Span loc)
+        -> void {
+        auto is_params = std::exchange(after_definition, false);
+
+        switch (kind) {
+        case TokenKind::LeftParen: {
+            if (is_params) {
+                open_group(GroupKind::Params, loc);
+            } else {
+                open_group(ends_primary(prev_kind) ? GroupKind::Call
+                                                   : GroupKind::Paren,
+                           loc);
+            }
+            break;
+        }
+        case TokenKind::LeftSquare: {
+            open_group(ends_primary(prev_kind) ? GroupKind::Subscript
+                                               : GroupKind::List,
+                       loc);
+            break;
+        }
+        case TokenKind::LeftCurly: {
+            open_group(GroupKind::Braces, loc);
+            break;
+        }
+        case TokenKind::RightParen:
+        case TokenKind::RightSquare:
+        case TokenKind::RightCurly: {
+            close_group(loc);
+            break;
+        }
+        case TokenKind::Identifier: {
+            if (prev_kind == TokenKind::Dot) {
+                sink.visit_attribute(loc);
+            } else if (prev_kind == TokenKind::KeywordDef ||
+                       prev_kind == TokenKind::KeywordClass) {
+                sink.visit_definition(prev_kind, loc);
+                after_definition = true;
+            } else {
+                sink.visit_name(loc);
+            }
+            break;
+        }
+        default: {
+            if (is_literal(kind)) {
+                sink.visit_literal(kind, loc);
+            } else if (is_keyword(kind)) {
+                sink.visit_keyword(kind, loc);
+            }
+            break;
+        }
+        }
+    }
+
+  public:
+    EventParser(const TokenStreamView &token_stream,
+                Source::SourceFile *src_file, Sink &sink)
+        : token_stream{token_stream}, src_file{src_file}, sink{sink} {}
+
+    /*
+        This method reports the events of the whole token stream. The groups
+       and the statement that are still open at the end of the stream are
+       closed at the 'End' token, so every enter event is always matched by a
+       leave event.
+    */
+    auto parse_py_module() -> void {
+        groups.clear();
+        after_definition = false;
+
+        bool in_stmt = false;
+        auto prev_kind = TokenKind::Newline;
+
+        for (size_t i = 0; i < token_stream.size; i++) {
+            auto kind = token_stream.kind(i);
+            auto loc = span(i);
+
+            switch (kind) {
+            case TokenKind::Newline:
+            case TokenKind::Semicolon: {
+                if (in_stmt) {
+                    sink.leave_stmt(loc);
+                    in_stmt = false;
+                }
+                break;
+            }
+            case TokenKind::Indent: {
+                sink.enter_block(loc);
+                break;
+            }
+            case TokenKind::Dedent: {
+                sink.leave_block(loc);
+                break;
+            }
+            case TokenKind::End: {
+                while (!groups.empty()) {
+                    close_group(loc);
+                }
+
+                if (in_stmt) {
+                    sink.leave_stmt(loc);
+                    in_stmt = false;
+                }
+                break;
+            }
+            default: {
+                if (!in_stmt) {
+                    sink.enter_stmt(kind, loc);
+                    in_stmt = true;
+                }
+
+                visit_tok(kind, prev_kind, loc);
+                break;
+            }
+            }
+
+            prev_kind = kind;
+        }
+    }
+};
+} // namespace tpy::Parse
+
+#endif
@@ -0,0 +1,108 @@
+/*
+    This file defines the segment index for f-strings. While the lexer scans an
+   f-string, it splits it into literal runs and replacement fields, so that the
+   parser and any later tools never have to scan the literal again.
+*/
+
+#ifndef TPY_PARSE_FSTRINGINDEX_H
+#define TPY_PARSE_FSTRINGINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace tpy::Parse {
+// These are the kinds of segments that an f-string is split into.
+enum class FStringSegmentKind : uint8_t {
+    // A run of literal text. Escaped braces are part of a literal run.
+    Literal,
+    // The expression of a replacement field, without the braces.
+    Expression,
+    // The conversion of a replacement field, without the '!'.
+    Conversion,
+    // The format spec of a replacement field, without the ':'. Replacement
+    // fields nested within the format spec follow it with a greater depth.
+    FormatSpec,
+};
+
+/*
+    This object represents a single segment of an f-string.
+*/
+class FStringSegment {
+  public:
+    // This is the local position of the segment within the source file.
+    uint32_t offset;
+
+    uint32_t len;
+
+    FStringSegmentKind kind;
+
+    // This is the nesting depth of the segment. Segments that belong to a
+    // replacement field inside of a format spec have a depth of 1.
+    uint8_t depth;
+
+    FStringSegment(uint32_t offset, uint32_t len, FStringSegmentKind kind,
+                   uint8_t depth)
+        : offset{offset}, len{len}, kind{kind}, depth{depth} {}
+};
+
+/*
+    This is a read-only view of an f-string index. Each f-string is identified
+   by the local position of its token, and its segments are the ones from its
+   first segment up to the first segment of the next f-string.
+*/
+class FStringIndexView {
+  public:
+    const uint32_t *token_offsets = nullptr;
+    const uint32_t *first_segments = nullptr;
+    size_t num_fstrings = 0;
+
+    const FStringSegment *segments = nullptr;
+    size_t num_segments = 0;
+
+    // This method returns the range of segment indices for the f-string token
+    // at the given position. The range is empty if there is no such f-string.
+    auto find(uint32_t tok_offset) const -> std::pair<uint32_t, uint32_t>;
+};
+
+/*
+    This object owns the f-string index of a source file. Every lexer fills an
+   index of its own, unless another one is attached to it.
+*/
+class FStringIndex {
+    std::vector<uint32_t> token_offsets;
+    std::vector<uint32_t> first_segments;
+    std::vector<FStringSegment> segments;
+
+  public:
+    // This method marks the start of a new f-string token.
+    auto begin_fstring(uint32_t tok_offset) -> void {
+        token_offsets.push_back(tok_offset);
+        first_segments.push_back(static_cast<uint32_t>(segments.size()));
+    }
+
+    // This method adds a segment to the current f-string and returns its
+    // index.
+    auto add_segment(FStringSegment segment) -> size_t {
+        segments.push_back(segment);
+        return segments.size() - 1;
+    }
+
+    auto operator[](size_t i) -> FStringSegment & { return segments[i]; }
+
+    auto operator[](size_t i) const -> const FStringSegment & {
+        return segments[i];
+    }
+
+    auto size() const -> size_t { return segments.size(); }
+
+    auto view() const -> FStringIndexView {
+        return FStringIndexView{token_offsets.data(), first_segments.data(),
+                                token_offsets.size(), segments.data(),
+                                segments.size()};
+    }
+};
+} // namespace tpy::Parse
+
+#endif
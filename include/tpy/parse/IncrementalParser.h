@@ -0,0 +1,125 @@
+/*
+    This file defines the incremental parser, which keeps the tree of a module
+   up to date as the module is edited, such as in an editor.
+*/
+
+#ifndef TPY_PARSE_INCREMENTALPARSER_H
+#define TPY_PARSE_INCREMENTALPARSER_H
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "tpy/parse/TokenStream.h"
+#include "tpy/source/SourceFile.h"
+#include "tpy/tree/ASTNode.h"
+#include "tpy/utility/ArenaAllocator.h"
+#include "tpy/utility/ArenaArray.h"
+
+namespace tpy::Parse {
+/*
+    The module is held as a list of segments, one for every top-level statement,
+   and every segment owns the tokens and the tree of its statement. The tokens
+   and the tree are positioned relative to the start of the segment, and the
+   segment only records its width, so none of them depend on where the segment
+   is within the file. These are the "green" nodes of the module. An edit only
+   moves the segments after it, and since their contents do not change, they
+   are reused as they are.
+
+    An edit relexes and reparses the segments that it touches, beginning at the
+   start of the first of them. The lexer keeps going until it reaches the start
+   of an old segment that begins a top-level statement again, which is usually
+   the one right after the edit. An edit that opens a bracket runs on until the
+   bracket is closed, or until the lexer gives up on it at the next line that
+   begins with a statement keyword, such as 'def' at the start of a line. Only
+   an unclosed string can run up to the end of the file. The result is always
+   the same as parsing the edited file from scratch.
+
+    The absolute position of a node is the start of its segment plus its own
+   position. Errors are reported at their absolute positions. The f-strings of
+   a segment are indexed within its token stream, relative to the segment just
+   like the tokens, so the segment range of an f-string node refers to the
+   index of its own segment.
+*/
+class IncrementalParser {
+  public:
+    /*
+        This object is a single segment of the module. It covers the text from
+       the start of its statement up to the start of the next one. The first
+       segment also holds the blank lines and comments at the start of the
+       file, and the last one holds the 'End' token.
+    */
+    class Segment {
+      public:
+        // This is the length of the text of the segment.
+        size_t width = 0;
+
+        // These are the tokens of the segment, along with the index of its
+        // f-strings.
+        TokenStream tokens;
+
+        // This is the arena that holds the tree of the segment. Each segment
+        // has its own, so that the tree is freed once the segment is replaced.
+        std::unique_ptr<Utility::ArenaAllocator> arena;
+
+        // These are the statements of the segment. There is usually a single
+        // one, unless it is a line of statements that are separated by ';'.
+        Utility::ArenaArray<Tree::ASTNode *> body;
+    };
+
+  private:
+    // This is the source file that holds the current text of the module. It is
+    // replaced on every edit.
+    std::unique_ptr<Source::SourceFile> src_file;
+
+    // These are the segments of the module, in order.
+    std::vector<Segment> segments;
+
+    // These are the number of segments that were parsed by the last edit, and
+    // the number that were reused.
+    size_t last_reparsed = 0;
+    size_t last_reused = 0;
+
+    // This method relexes the text from the given position, which is the start
+    // of the segment 'first', and replaces the segments from 'first' up to the
+    // one where the lexer is back in step with the old segments. The lexer can
+    // only resync at the segment 'resync' or after it, and 'resync_start' is
+    // the position of that segment within the edited text.
+    auto reparse(size_t start, size_t first, size_t resync, size_t resync_start)
+        -> void;
+
+    // This method replaces the text of the source file.
+    auto replace_text(size_t pos, size_t old_len, std::string_view new_text)
+        -> void;
+
+  public:
+    // This constructor parses the source file from scratch. The parser works
+    // on its own copy of the text, so the source file is not changed by edits.
+    explicit IncrementalParser(Source::SourceFile *src_file);
+
+    /*
+        This method replaces 'old_len' bytes at the given position with the new
+       text, and updates the segments of the module. Positions are local to the
+       source file, just like the positions of tokens.
+    */
+    auto edit(size_t pos, size_t old_len, std::string_view new_text) -> void;
+
+    // This method returns the source file with the current text.
+    auto source() const -> Source::SourceFile * { return src_file.get(); }
+
+    auto segment_count() const -> size_t { return segments.size(); }
+
+    auto segment(size_t i) const -> const Segment & { return segments[i]; }
+
+    // This method returns the position of the given segment within the file.
+    // It adds up the widths of the segments before it.
+    auto segment_start(size_t i) const -> size_t;
+
+    auto reparsed_segments() const -> size_t { return last_reparsed; }
+
+    auto reused_segments() const -> size_t { return last_reused; }
+};
+} // namespace tpy::Parse
+
+#endif
@@ -145,7 +145,7 @@ struct Keyword *KeywordLookup::is_keyword(const char *str, unsigned int len) {
 #line 52 "Keywords.gperf"
         {"return", TokenKind::KeywordReturn},
 #line 46 "Keywords.gperf"
-        {"labmda", TokenKind::KeywordLambda},
+        {"lambda", TokenKind::KeywordLambda},
 #line 31 "Keywords.gperf"
         {"class", TokenKind::KeywordClass},
 #line 47 "Keywords.gperf"
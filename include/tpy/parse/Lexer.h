@@ -3,9 +3,15 @@
    source files.
 */
 
+#ifndef TPY_PARSE_LEXER_H
+#define TPY_PARSE_LEXER_H
+
+#include <algorithm>
 #include <stack>
 
+#include "tpy/parse/FStringIndex.h"
 #include "tpy/parse/Token.h"
+#include "tpy/parse/Trivia.h"
 #include "tpy/source/SourceFile.h"
 
 namespace tpy::Parse {
@@ -39,10 +45,30 @@ class Lexer {
     // indentation for the first token.
     bool was_last_tok_newline = true;
 
-    // There are certain places in Python source code where we want to ignore
-    // newline characters. Therefore, we need to track if we are currently
-    // accepting them.
-    bool accept_newlines = true;
+    // Newline characters are ignored inside of parentheses, brackets, and
+    // braces. Therefore, we need to track how deeply nested we currently are.
+    // Since this only depends on the source, the token stream never depends on
+    // the state of the parser. Brackets that are never closed are given up on
+    // at the next line that must begin a statement.
+    int bracket_depth = 0;
+
+    // This is the optional table that trivia will be recorded into. When it is
+    // null, trivia are simply skipped.
+    TriviaTable *trivia_table = nullptr;
+
+    // This is the index that the segments of f-strings are recorded into. It is
+    // the lexer's own index unless another one has been attached, so the
+    // segments of every f-string are always known.
+    FStringIndex own_fstring_index;
+    FStringIndex *fstring_index = &own_fstring_index;
+
+    // When a line closes several indentation levels at once, this is the number
+    // of dedent tokens that still have to be produced after the first one.
+    int pending_dedents = 0;
+
+    // This is the number of tokens that have been produced so far. It is the
+    // key under which trivia are recorded.
+    uint32_t tok_count = 0;
 
     /*
         The following methods are utility methods that are part of the lexer
@@ -53,6 +79,13 @@ class Lexer {
 
     static auto is_binary_digit(char c) -> bool { return c == '0' || c == '1'; }
 
+    // This method checks whether the rest of the line after the indentation is
+    // blank or a comment, in which case the line does not affect indentation.
+    auto is_blank_line_start(const char *p) const -> bool {
+        return *p == '\n' || *p == '\r' || *p == '#' ||
+               (*p == '\0' && p == end_ptr);
+    }
+
     auto create_token(Token &tok, TokenKind kind, char *start, size_t len,
                       bool is_newline_tok = false) -> void {
         // First, we need to compute the local start position by subtracting the
@@ -64,12 +97,36 @@ class Lexer {
                    Source::Span{local_pos, local_pos + src_file->offset, len});
 
         was_last_tok_newline = is_newline_tok;
+        ++tok_count;
+    }
+
+    // This method records a piece of trivia if a trivia table is attached. It
+    // is only called from the paths that skip over trivia, so the token paths
+    // never pay for it.
+    auto record_trivia(TriviaKind kind, char *start, size_t len) -> void {
+        if (trivia_table) {
+            trivia_table->add(
+                tok_count,
+                Trivia{static_cast<uint32_t>(start - abs_buffer_start),
+                       static_cast<uint32_t>(len), kind});
+        }
+    }
+
+    // This method records a segment of the f-string that is currently being
+    // scanned, and returns the index of the segment.
+    auto record_fstring_segment(FStringSegmentKind kind, char *start,
+                                size_t len, uint8_t depth) -> size_t {
+        return fstring_index->add_segment(FStringSegment{
+            static_cast<uint32_t>(start - abs_buffer_start),
+            static_cast<uint32_t>(len), kind, depth});
     }
 
     auto report_error(char *start, size_t len, const char *msg) -> void;
 
     auto consume_horizontal_whitespace() -> int;
 
+    auto starts_new_statement(const char *p) const -> bool;
+
     auto lex_decimal_integer_literal(Token &tok, char *start) -> void;
 
     auto lex_floating_point_literal(Token &tok, char *start) -> void;
@@ -83,15 +140,25 @@ class Lexer {
 
     auto lex_binary_integer_literal(Token &tok, char *start) -> void;
 
-    auto lex_single_quote_string_literal(Token &tok, char *start) -> void;
+    auto lex_prefixed_string_literal(Token &tok, char *start) -> bool;
 
-    auto lex_double_quote_string_literal(Token &tok, char *start) -> void;
+    auto lex_string_literal(Token &tok, char *start, TokenKind kind) -> void;
+
+    auto lex_fstring_replacement_field(char quote, bool is_triple,
+                                       uint8_t depth) -> bool;
+
+    auto skip_fstring_nested_string_literal(char quote, bool is_triple) -> bool;
 
     auto lex_keyword_or_identifier(Token &tok, char *start) -> void;
 
     auto lex_comment(Token &tok) -> bool;
 
   public:
+    // This is the version of the token stream that the lexer produces. It must
+    // be incremented whenever a change to the lexer changes its output, as it
+    // is used to invalidate cached token streams.
+    static constexpr uint32_t VERSION = 6;
+
     explicit Lexer(Source::SourceFile * src_file)
         : src_file{src_file} {
         ptr = src_file->start();
@@ -102,15 +169,49 @@ class Lexer {
         whitespace_stack.push(0);
     }
 
-    auto skip_newlines() -> void { accept_newlines = false; }
+    // A copy would record the segments of f-strings into the index of the
+    // lexer it was copied from.
+    Lexer(const Lexer &) = delete;
+
+    auto operator=(const Lexer &) -> Lexer & = delete;
+
+    // This method enables the trivia channel. Passing null disables it again.
+    auto attach_trivia_table(TriviaTable *table) -> void {
+        trivia_table = table;
+    }
+
+    // This method makes the lexer record the segments of f-strings into the
+    // given index instead of its own. Passing null switches back to its own.
+    auto attach_fstring_index(FStringIndex *index) -> void {
+        fstring_index = index ? index : &own_fstring_index;
+    }
 
-    auto allow_newlines() -> void { accept_newlines = true; }
+    // This method returns the index that the segments of f-strings are being
+    // recorded into. The segment ranges of the f-string nodes that a parser
+    // makes from this lexer refer to it.
+    auto fstrings() const -> const FStringIndex & { return *fstring_index; }
 
     // This is the main lexer routine that will scan tokens from the Python
     // source.
     auto lex_next_tok(Token &tok) -> void;
 
+    // This method restarts the lexer at the given position, which must be the
+    // start of a line that is neither indented nor within brackets, such as
+    // the start of a top-level statement. The lexer is in the same state there
+    // as it is at the start of the file.
+    auto restart_at(size_t local_pos) -> void {
+        ptr = std::max(src_file->start(), abs_buffer_start + local_pos);
+        whitespace_stack = {};
+        whitespace_stack.push(0);
+        was_last_tok_newline = true;
+        bracket_depth = 0;
+        pending_dedents = 0;
+    }
+
     // It is OK if parser instances access private members in the lexer class.
     friend class Parser;
+    friend class TokenStream;
 };
-} // namespace tpy::Parse
\ No newline at end of file
+} // namespace tpy::Parse
+
+#endif
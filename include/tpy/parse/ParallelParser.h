@@ -0,0 +1,80 @@
+/*
+    This file defines the parser that parses the top-level statements of a
+   module on several threads at once.
+*/
+
+#ifndef TPY_PARSE_PARALLELPARSER_H
+#define TPY_PARSE_PARALLELPARSER_H
+
+#include <cstddef>
+#include <vector>
+
+#include "tpy/parse/Token.h"
+#include "tpy/parse/TokenStream.h"
+#include "tpy/source/SourceFile.h"
+#include "tpy/tree/ASTNode.h"
+#include "tpy/utility/ArenaAllocator.h"
+
+namespace tpy::Parse {
+/*
+    This object follows the tokens of a module one at a time, and tells which of
+   them begin a top-level statement. Brackets never matter, as the lexer does
+   not produce any indentation or newline tokens inside them.
+*/
+class TopLevelStmtScanner {
+    // This is the indentation depth of the current token.
+    size_t depth = 0;
+
+    // A statement can only begin right after the end of a line.
+    bool at_line_start = true;
+
+    // The definition that follows a decorator belongs to the same statement.
+    bool after_decorator = false;
+
+  public:
+    // This method takes the next token, and returns whether it begins a
+    // top-level statement.
+    auto starts_stmt(TokenKind kind) -> bool;
+};
+
+/*
+    The top-level statements of a module do not depend on each other, and each
+   of them begins at a line that is not indented. Since the lexer has already
+   turned the indentation into 'Indent' and 'Dedent' tokens, these lines can be
+   found by scanning the token stream, without parsing it.
+
+    The module is split into one chunk of whole statements per thread, and every
+   chunk is parsed by its own parser into its own arena, so the threads never
+   share any state. The statements of the chunks are then gathered into a
+   single module node, and the arenas of the workers are spliced into the
+   arena of the module, so the whole tree lives as long as that arena.
+*/
+class ParallelParser {
+    TokenStreamView token_stream;
+    Source::SourceFile *src_file;
+
+    // This is the arena that the module node is allocated in.
+    Utility::ArenaAllocator &arena;
+
+  public:
+    ParallelParser(const TokenStreamView &token_stream,
+                   Source::SourceFile *src_file, Utility::ArenaAllocator &arena)
+        : token_stream{token_stream}, src_file{src_file}, arena{arena} {}
+
+    /*
+        This method returns the position of the first token of every top-level
+       statement. A decorated definition is a single statement, and the clauses
+       of compound statements such as 'else' are part of the statement that
+       they follow, even though they are not indented either.
+    */
+    static auto find_top_level_stmts(const TokenStreamView &token_stream)
+        -> std::vector<size_t>;
+
+    // This method parses the module on up to the given number of threads.
+    // Statements with syntax errors are replaced by error nodes, just like in
+    // 'Parser::parse_py_module'.
+    auto parse_py_module(size_t num_threads) -> Tree::ASTNode *;
+};
+} // namespace tpy::Parse
+
+#endif
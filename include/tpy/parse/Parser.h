@@ -6,21 +6,57 @@
 #ifndef TPY_parse_py_PARSER_H
 #define TPY_parse_py_PARSER_H
 
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
 #include "Lexer.h"
+#include "tpy/parse/Precedence.h"
 #include "tpy/parse/Token.h"
+#include "tpy/parse/TokenStream.h"
 #include "tpy/source/Span.h"
 #include "tpy/tree/ASTNode.h"
+#include "tpy/tree/StructuralHash.h"
 #include "tpy/utility/ArenaAllocator.h"
 
 namespace tpy::Parse {
+// These are the ways in which the parser can parse expressions.
+enum class ExprParseMode : uint8_t {
+    // Expressions are parsed by recursive descent. The native stack grows with
+    // the nesting depth of the expression.
+    Recursive,
+    // Expressions are parsed with an explicit stack of frames on the heap, so
+    // the native stack stays the same size however deep the nesting is.
+    Iterative,
+    // Expressions are parsed by recursive descent until they are nested deeper
+    // than 'Parser::MAX_RECURSION_DEPTH', and the explicit stack takes over
+    // from there. Ordinary code never reaches that depth, so it is parsed as
+    // fast as in the recursive mode.
+    Adaptive,
+};
+
 /*
     The parser will be implemented using a standard Recursive descent parser and
    will built an AST of the source.
 */
 class Parser {
-    // This member is a reference to the lexer instance that will be used to
-    // tokenize the source code.
-    Lexer &lexer;
+    // This member is the lexer instance that will be used to tokenize the
+    // source code. It is null when the parser reads from a token stream that
+    // has already been lexed, such as one loaded from the token cache.
+    Lexer *lexer;
+
+    // This member is the token stream that the parser reads from when there is
+    // no lexer, along with the position of the next token within it.
+    TokenStreamView token_stream;
+    size_t token_stream_pos = 0;
+
+    // This member is the source file that is being parsed.
+    Source::SourceFile *src_file;
+
+    // This is added to the positions of errors. It is only needed when the
+    // token stream is positioned relative to a statement rather than the file.
+    size_t error_offset = 0;
 
     // This member is the token instance that will be used for determining the
     // next step to take within the parser.
@@ -30,11 +66,155 @@ class Parser {
     // from other expressions.
     Token tok_2 = Token::dummy();
 
+    // These are the kind and location of the token before the lookahead.
+    // Error recovery uses them to tell whether the parser stopped at the start
+    // of a line, and where the statement that failed ends.
+    TokenKind prev_kind = TokenKind::Dummy;
+    Source::Span prev_span = Source::Span::empty();
+
     // This member represents the arena allocator that will be used to quickly
     // allocate the AST nodes as they can all eventually be deallocated
     // together.
     Utility::ArenaAllocator &arena;
 
+    // This is the optional hasher that gives every node its structural hash as
+    // soon as the node is made. A node is always made after its children, so
+    // the tree is hashed bottom-up without a walk of its own.
+    Tree::StructuralHasher *hasher = nullptr;
+
+    // This is the way in which expressions are parsed.
+    ExprParseMode expr_parse_mode = ExprParseMode::Adaptive;
+
+    // This is the maximum nesting depth of an expression, and the current
+    // depth. The depth is the number of binary expressions and lambdas that
+    // are being parsed at once, which grows by one for every bracket or prefix
+    // operator that an expression is nested within.
+    size_t max_nesting_depth = DEFAULT_MAX_NESTING_DEPTH;
+    size_t nesting_depth = 0;
+
+    // These are the kinds of frames on the explicit stack of the iterative
+    // expression parser. Each of them stands for the recursive method of the
+    // same name.
+    enum class ExprFrameKind : uint8_t {
+        Expr,
+        Ternary,
+        Binary,
+        Prefix,
+        Primary,
+        Paren,
+        ParenTuple,
+        List,
+        SetOrDict,
+        Dict,
+        Call,
+        CallArg,
+        Slice,
+        ProperSlice,
+        StarOrExpr,
+        ExprList,
+        Yield,
+        Lambda,
+        Comprehension,
+        ComprehensionClause,
+    };
+
+    // This is the value of 'ExprFrame::mark' when the frame has not collected
+    // any children on a scratch stack.
+    static constexpr size_t NO_MARK = ~size_t{0};
+
+    /*
+        This object holds the local state of one method of the recursive parser
+       while the expression that it is waiting for is being parsed. The state is
+       the point at which the method resumes once that expression is done.
+    */
+    struct ExprFrame {
+        ExprFrameKind kind;
+        uint8_t state = 0;
+
+        // This is the minimum precedence of binary, prefix, and starred
+        // expressions.
+        Precedence prec = Precedence::None;
+
+        // This is the pending operator.
+        TokenKind op = TokenKind::Dummy;
+
+        // These are the location of the opening token of the construct and the
+        // location of the child that is being parsed, for error messages.
+        Source::Span loc = Source::Span::empty();
+        Source::Span child_loc = Source::Span::empty();
+
+        // These are the nodes that have been parsed so far, such as the left
+        // hand side of a binary expression, the key of a dict entry, and the
+        // bounds of a slice.
+        Tree::ASTNode *node = nullptr;
+        Tree::ASTNode *node_2 = nullptr;
+        Tree::ASTNode *node_3 = nullptr;
+
+        // This is the pending binary operator.
+        const BinaryOpInfo *info = nullptr;
+
+        // This is the size of the scratch stack when the frame began to collect
+        // children on it.
+        size_t mark = NO_MARK;
+
+        ExprFrame(ExprFrameKind kind, Precedence prec)
+            : kind{kind}, prec{prec} {}
+    };
+
+    // This is the explicit stack of the iterative expression parser. It is
+    // reused for every expression.
+    std::vector<ExprFrame> expr_frames;
+
+    // These are the scratch stacks that the children of list, set, dict, and
+    // call expressions are collected on. Once all of the children of a node are
+    // known, they are copied into a right-sized array within the arena. The
+    // stacks are reused for every node, so they stop allocating once they have
+    // grown large enough.
+    std::vector<Tree::ASTNode *> node_scratch;
+    std::vector<std::pair<Tree::ASTNode *, Tree::ASTNode *>> pair_scratch;
+
+    /*
+        This object collects elements on top of a scratch stack. Since nodes can
+       be nested, every node only owns the elements above the mark that was set
+       when it began, and they are popped when the object goes out of scope.
+    */
+    template <class T> class ScratchScope {
+        std::vector<T> &stack;
+        size_t mark;
+
+      public:
+        explicit ScratchScope(std::vector<T> &stack)
+            : stack{stack}, mark{stack.size()} {}
+
+        ScratchScope(const ScratchScope &) = delete;
+        auto operator=(const ScratchScope &) -> ScratchScope & = delete;
+
+        ~ScratchScope() { stack.erase(stack.begin() + mark, stack.end()); }
+
+        auto push(T element) -> void { stack.push_back(element); }
+
+        auto size() const -> size_t { return stack.size() - mark; }
+
+        auto empty() const -> bool { return stack.size() == mark; }
+
+        auto pop() -> T {
+            auto element = stack.back();
+            stack.pop_back();
+            return element;
+        }
+
+        // This method pops the elements above the given number of them.
+        auto pop_to(size_t size) -> void {
+            stack.erase(stack.begin() + mark + size, stack.end());
+        }
+
+        // This method copies the collected elements into the arena.
+        auto copy_to(Utility::ArenaAllocator &arena) -> Utility::ArenaArray<T> {
+            return arena.allocate_array(stack.data() + mark,
+                                        stack.size() - mark);
+        }
+    };
+
     // This is the return type of most Parser methods. It contains the Node
     // field and a boolean field representing whether any errors have been
     // previously reported. If an error has been reported, we will not report
@@ -42,17 +222,88 @@ class Parser {
     // issue.
     using ReturnType = std::pair<Tree::ASTNode *, bool>;
 
-    // This method will advance in the input by getting the next token from
-    // the lexer.
+    // This method will get the next token from either the lexer or the token
+    // stream.
+    auto next_tok(Token &next) -> void {
+        if (lexer) {
+            lexer->lex_next_tok(next);
+            return;
+        }
+
+        // A whole token stream always ends with the 'End' token, so once we
+        // reach it, we will keep returning it.
+        auto i = token_stream_pos;
+        if (i < token_stream.size) {
+            ++token_stream_pos;
+
+            size_t offset = token_stream.offsets[i];
+            next.update(token_stream.kind(i),
+                        Source::Span{offset, offset + src_file->offset,
+                                     token_stream.lens[i]});
+            return;
+        }
+
+        // A slice of a stream may stop before the 'End' token, in which case
+        // one is made up right after its last token.
+        auto last = token_stream.size - 1;
+        size_t offset = token_stream.offsets[last];
+        size_t len = token_stream.lens[last];
+        if (token_stream.kind(last) != TokenKind::End) {
+            offset += len;
+            len = 0;
+        }
+
+        next.update(TokenKind::End,
+                    Source::Span{offset, offset + src_file->offset, len});
+    }
+
+    // This method returns the 2nd lookahead token, getting it first if needed.
+    auto peek() -> Token & {
+        if (tok_2.kind == TokenKind::Dummy) {
+            next_tok(tok_2);
+        }
+
+        return tok_2;
+    }
+
+    // This method will advance in the input by getting the next token.
     auto advance() -> void {
         // If the 2nd lookahead token is not a dummy, then that is the token we
         // need.
+        prev_kind = tok.kind;
+        prev_span = tok.span;
+
         if (tok_2.kind != TokenKind::Dummy) {
             tok = std::move(tok_2);
             tok_2 = Token::dummy();
         } else {
-            lexer.lex_next_tok(tok);
+            next_tok(tok);
+        }
+    }
+
+    // This method returns the range of f-string segments for the f-string
+    // token at the given position, within the index of the lexer or of the
+    // token stream. Both of them always index every f-string.
+    auto fstring_segments(const Source::Span &loc)
+        -> std::pair<uint32_t, uint32_t> {
+        auto offset = static_cast<uint32_t>(loc.local_pos);
+
+        if (!lexer) {
+            return token_stream.fstrings.find(offset);
+        }
+
+        return lexer->fstrings().view().find(offset);
+    }
+
+    // This method allocates a node within the arena, and hashes it if a hasher
+    // is attached. Every node of the tree is made through it.
+    template <class T, class... Args> auto make_node(Args &&...args) -> T * {
+        auto *node = arena.allocate<T>(std::forward<Args>(args)...);
+        if (hasher) {
+            hasher->hash_node(node);
         }
+
+        return node;
     }
 
     // This method will report errors.
@@ -70,8 +321,13 @@ class Parser {
 
     auto parse_py_atom_and_primary_expr() -> ReturnType;
 
+    auto parse_py_string_literals() -> Tree::ASTNode *;
+
     auto parse_py_paren_expr() -> ReturnType;
 
+    auto parse_py_paren_tuple_expr(Tree::ASTNode *first_expr,
+                                   Source::Span lparen_loc) -> ReturnType;
+
     auto parse_py_list_expr() -> ReturnType;
 
     auto parse_py_set_or_dict_expr() -> ReturnType;
@@ -79,51 +335,172 @@ class Parser {
     auto parse_py_dict_expr(Tree::ASTNode *first_expr,
                             Source::Span start) -> ReturnType;
 
+    auto parse_py_comprehension(Tree::ASTNode *element, Tree::ASTNode *value,
+                                Source::Span start,
+                                TokenKind closer) -> ReturnType;
+
+    auto parse_py_comprehension_clause() -> ReturnType;
+
     auto parse_py_attr_ref_expr(Tree::ASTNode *expr) -> ReturnType;
 
     auto parse_py_call_expr(Tree::ASTNode *callee) -> ReturnType;
 
+    auto parse_py_call_arg() -> ReturnType;
+
     auto parse_py_slice_expr(Tree::ASTNode *slicee) -> ReturnType;
 
     auto parse_py_proper_slice_expr(Tree::ASTNode *slicee,
                                     Tree::ASTNode *lower_bound) -> ReturnType;
 
-    auto parse_py_exponentiation_expr() -> ReturnType;
+    auto parse_py_prefix_expr(Precedence min_prec) -> ReturnType;
 
-    auto parse_py_unary_op_expr() -> ReturnType;
+    auto parse_py_binary_expr(Precedence min_prec) -> ReturnType;
 
-    auto parse_py_multiplication_expr() -> ReturnType;
+    auto parse_py_assignment_expr() -> ReturnType;
 
-    auto parse_py_addition_expr() -> ReturnType;
+    auto parse_py_lambda_expr() -> ReturnType;
 
-    auto parse_py_bitshift_expr() -> ReturnType;
+    auto parse_py_yield_expr() -> ReturnType;
 
-    auto parse_py_bitwise_and_expr() -> ReturnType;
+    auto parse_py_expr_iteratively(ExprFrameKind kind,
+                                   Precedence prec) -> ReturnType;
 
-    auto parse_py_bitwise_xor_expr() -> ReturnType;
+    auto pop_expr_frame() -> void;
 
-    auto parse_py_bitwise_or_expr() -> ReturnType;
+    // This method checks whether the nesting depth has reached its limit, and
+    // reports the error if it has.
+    auto check_nesting_depth() -> bool;
 
-    auto parse_py_comparison_expr() -> ReturnType;
+    // This method recovers from an error within a bracketed expression that
+    // began at the given location. See Parser.cpp.
+    auto recover_in_brackets(ReturnType failed, Source::Span start,
+                             TokenKind closer) -> ReturnType;
 
-    auto parse_py_unary_not_expr() -> ReturnType;
+    auto starts_py_expr() -> bool;
 
-    auto parse_py_logical_and_expr() -> ReturnType;
+    auto parse_py_star_or_expr(Precedence min_prec = Precedence::None)
+        -> ReturnType;
 
-    auto parse_py_logical_or_expr() -> ReturnType;
+    auto parse_py_expr_list(Precedence min_prec = Precedence::None)
+        -> ReturnType;
 
-    auto parse_py_ternary_op_expr() -> ReturnType;
+    auto parse_py_expr_list_or_yield() -> ReturnType;
 
-    auto parse_py_assignment_expr() -> ReturnType;
+    /*
+        These are the parser methods for statements, which are implemented in
+       ParserStmt.cpp. The statements of a block are collected on the node
+       scratch stack, and the methods return false once an error has been
+       reported.
+    */
+
+    using StmtScope = ScratchScope<Tree::ASTNode *>;
+
+    auto parse_py_statement(StmtScope &stmts) -> bool;
+
+    auto parse_py_simple_stmt_line(StmtScope &stmts) -> bool;
+
+    auto parse_py_simple_stmt() -> ReturnType;
+
+    auto parse_py_expr_stmt() -> ReturnType;
+
+    auto parse_py_name_list(StmtScope &names, const char *error) -> bool;
+
+    auto parse_py_dotted_name() -> ReturnType;
+
+    auto parse_py_import_alias(bool dotted) -> ReturnType;
+
+    auto parse_py_import_stmt() -> ReturnType;
+
+    auto parse_py_import_from_stmt() -> ReturnType;
+
+    auto parse_py_suite(Utility::ArenaArray<Tree::ASTNode *> &body,
+                        const char *colon_error) -> bool;
+
+    auto parse_py_else_suite(Utility::ArenaArray<Tree::ASTNode *> &orelse)
+        -> bool;
+
+    auto parse_py_if_stmt() -> ReturnType;
+
+    auto parse_py_while_stmt() -> ReturnType;
+
+    auto parse_py_for_stmt(Source::Span start, bool is_async) -> ReturnType;
+
+    auto parse_py_try_stmt() -> ReturnType;
+
+    auto parse_py_with_stmt(Source::Span start, bool is_async) -> ReturnType;
+
+    auto parse_py_async_stmt() -> ReturnType;
+
+    auto parse_py_param(Source::Span &end_loc, bool annotated) -> ReturnType;
+
+    auto parse_py_function_def(Utility::ArenaArray<Tree::ASTNode *> decorators,
+                               Source::Span start,
+                               bool is_async) -> ReturnType;
+
+    auto parse_py_class_def(Utility::ArenaArray<Tree::ASTNode *> decorators,
+                            Source::Span start) -> ReturnType;
+
+    auto parse_py_decorated() -> ReturnType;
+
+    // These methods recover from an error within a statement by skipping to the
+    // start of the next one. See ParserStmt.cpp.
+    auto skip_indented_block() -> Source::Span;
+
+    auto synchronize(StmtScope &stmts, Source::Span start) -> void;
 
   public:
+    // This is the version of the tree that the parser builds. It must be
+    // incremented whenever a change to the parser changes its output, as it is
+    // used to invalidate cached trees.
+    static constexpr uint32_t VERSION = 2;
+
+    // This is the default limit of the nesting depth of expressions.
+    static constexpr size_t DEFAULT_MAX_NESTING_DEPTH = 1000;
+
+    // This is the nesting depth at which the adaptive mode switches from
+    // recursive descent to the explicit stack.
+    static constexpr size_t MAX_RECURSION_DEPTH = 256;
+
     Parser(Lexer &lexer, Utility::ArenaAllocator &arena)
-        : lexer{lexer}, arena{arena} {}
+        : lexer{&lexer}, src_file{lexer.src_file}, arena{arena} {}
+
+    // This constructor creates a parser that reads from a token stream instead
+    // of running the lexer. The stream must belong to the given source file.
+    Parser(const TokenStreamView &token_stream, Source::SourceFile *src_file,
+           Utility::ArenaAllocator &arena)
+        : lexer{nullptr}, token_stream{token_stream}, src_file{src_file},
+          arena{arena} {}
+
+    // This method sets the way in which expressions are parsed.
+    auto set_expr_parse_mode(ExprParseMode mode) -> void {
+        expr_parse_mode = mode;
+    }
+
+    // This method sets the position of the token stream within the file, for
+    // token streams that are positioned relative to a statement.
+    auto set_error_offset(size_t offset) -> void { error_offset = offset; }
+
+    // This method makes the parser hash every node as it is made. The hasher
+    // must be for the same source file. Passing null disables it again.
+    auto attach_hasher(Tree::StructuralHasher *new_hasher) -> void {
+        hasher = new_hasher;
+    }
+
+    // This method sets the maximum nesting depth of expressions. Deeper
+    // expressions are reported as an error as soon as the limit is reached.
+    auto set_max_nesting_depth(size_t depth) -> void {
+        max_nesting_depth = depth;
+    }
 
     auto parse_py_compilation_unit() -> Tree::ASTNode * {
         advance();
         return parse_py_expr().first;
     }
+
+    // This method parses a whole module. Syntax errors are reported as they are
+    // found, and the statements that contain them are replaced by error nodes,
+    // so that every independent error is reported by a single parse.
+    auto parse_py_module() -> Tree::ASTNode *;
 };
 } // namespace tpy::Parse
 
@@ -0,0 +1,133 @@
+/*
+    This file defines the precedence levels of Python expressions and the table
+   of binary operators that drives the precedence-climbing expression parser.
+*/
+
+#ifndef TPY_PARSE_PRECEDENCE_H
+#define TPY_PARSE_PRECEDENCE_H
+
+#include <array>
+#include <cstdint>
+
+#include "tpy/parse/Token.h"
+
+namespace tpy::Parse {
+// These are the precedence levels of Python expressions from the loosest to
+// the tightest binding. Higher levels bind tighter.
+enum class Precedence : uint8_t {
+    // This level is used for tokens that are not binary operators.
+    None,
+    LogicalOr,
+    LogicalAnd,
+    // This is the level of the prefix operator 'not'.
+    LogicalNot,
+    // This includes the membership and identity tests.
+    Comparison,
+    BitwiseOr,
+    BitwiseXor,
+    BitwiseAnd,
+    Shift,
+    Additive,
+    Multiplicative,
+    // This is the level of the prefix operators '+', '-', and '~'.
+    Unary,
+    Exponentiation,
+};
+
+/*
+    This object describes a single binary operator.
+*/
+class BinaryOpInfo {
+  public:
+    Precedence prec = Precedence::None;
+
+    // This is the minimum precedence of the right hand side. It is one level
+    // above the operator itself for left associative operators. The right
+    // hand side of '**' may be a unary expression, so its level is lower.
+    Precedence rhs_prec = Precedence::None;
+
+    // This is the message that is reported when the right hand side is
+    // missing.
+    const char *rhs_error = nullptr;
+};
+
+/*
+    This function builds the operator table at compile time. Every token kind
+   that is not a binary operator keeps the 'None' precedence, so the parser can
+   look up any token without checking it first.
+*/
+constexpr auto make_binary_op_table()
+    -> std::array<BinaryOpInfo, NUM_TOKEN_KINDS> {
+    std::array<BinaryOpInfo, NUM_TOKEN_KINDS> table{};
+
+    auto set = [&table](TokenKind kind, Precedence prec, Precedence rhs_prec,
+                        const char *rhs_error) {
+        auto &info = table[static_cast<size_t>(kind)];
+        info.prec = prec;
+        info.rhs_prec = rhs_prec;
+        info.rhs_error = rhs_error;
+    };
+
+    constexpr const char *generic_error =
+        "expected expression on the right hand side of a binary operator.";
+
+    set(TokenKind::KeywordOr, Precedence::LogicalOr, Precedence::LogicalAnd,
+        "expected expression on the right hand side of the binary operator "
+        "'or'.");
+    set(TokenKind::KeywordAnd, Precedence::LogicalAnd, Precedence::LogicalNot,
+        "expected expression on the right hand side of the binary operator "
+        "'and'.");
+
+    // 'not' is only a binary operator as the first half of 'not in'.
+    for (auto kind :
+         {TokenKind::Less, TokenKind::LessEquals, TokenKind::Greater,
+          TokenKind::GreaterEquals, TokenKind::EqualsEquals,
+          TokenKind::ExclamationEquals, TokenKind::KeywordIs,
+          TokenKind::KeywordNot}) {
+        set(kind, Precedence::Comparison, Precedence::BitwiseOr, generic_error);
+    }
+    set(TokenKind::KeywordIn, Precedence::Comparison, Precedence::BitwiseOr,
+        "expected expression on the right hand side of the binary operator "
+        "'in'.");
+
+    set(TokenKind::Bar, Precedence::BitwiseOr, Precedence::BitwiseXor,
+        "expected expression on the right hand side of the binary operator "
+        "'|'.");
+    set(TokenKind::Caret, Precedence::BitwiseXor, Precedence::BitwiseAnd,
+        "expected expression on the right hand side of the binary operator "
+        "'^'.");
+    set(TokenKind::Ampersand, Precedence::BitwiseAnd, Precedence::Shift,
+        "expected expression on the right hand side of the binary operator "
+        "'&'.");
+
+    for (auto kind : {TokenKind::LessLess, TokenKind::GreaterGreater}) {
+        set(kind, Precedence::Shift, Precedence::Additive, generic_error);
+    }
+
+    for (auto kind : {TokenKind::Plus, TokenKind::Minus}) {
+        set(kind, Precedence::Additive, Precedence::Multiplicative,
+            generic_error);
+    }
+
+    for (auto kind :
+         {TokenKind::Asterisk, TokenKind::Slash, TokenKind::SlashSlash,
+          TokenKind::Percent, TokenKind::At}) {
+        set(kind, Precedence::Multiplicative, Precedence::Unary, generic_error);
+    }
+
+    set(TokenKind::AsteriskAsterisk, Precedence::Exponentiation,
+        Precedence::Unary,
+        "expected expression on right hand size of the binary operator '**'.");
+
+    return table;
+}
+
+inline constexpr auto BINARY_OP_TABLE = make_binary_op_table();
+
+// This function returns the binary operator information for a token kind.
+constexpr auto binary_op_info(TokenKind kind) -> const BinaryOpInfo & {
+    return BINARY_OP_TABLE[static_cast<size_t>(kind)];
+}
+} // namespace tpy::Parse
+
+#endif
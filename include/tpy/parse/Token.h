@@ -6,6 +6,8 @@
 #ifndef TPY_PARSE_TOKEN_H
 #define TPY_PARSE_TOKEN_H
 
+#include <cstddef>
+
 #include "tpy/source/Span.h"
 
 namespace tpy::Parse {
@@ -27,6 +29,7 @@ namespace tpy::Parse {
     X(RightCurly)                                                              \
     X(Comma)                                                                   \
     X(Dot)                                                                     \
+    X(Ellipsis)                                                                \
     X(At)                                                                      \
     X(Equals)                                                                  \
     X(Arrow)                                                                   \
@@ -68,6 +71,8 @@ namespace tpy::Parse {
     X(BinaryIntLiteral)                                                        \
     X(OctalIntLiteral)                                                         \
     X(StringLiteral)                                                           \
+    X(BytesLiteral)                                                            \
+    X(FStringLiteral)                                                          \
     X(KeywordFalse)                                                            \
     X(KeywordNone)                                                             \
     X(KeywordTrue)                                                             \
@@ -116,6 +121,12 @@ namespace tpy::Parse {
 enum class TokenKind { TOKEN_LIST(F) };
 #undef F
 
+// This is the number of token kinds, which is the size of tables that are
+// indexed by the kind.
+#define F(x) +1
+constexpr size_t NUM_TOKEN_KINDS = 0 TOKEN_LIST(F);
+#undef F
+
 /*
     Ideally, we will only have one token instance that will be updated with new
    information. This will avoid constantly running a constructor and destructor.
@@ -0,0 +1,86 @@
+/*
+    This file defines the on-disk token cache. When the same unchanged files are
+   analyzed repeatedly, the token stream of each file can be stored in a cache
+   directory and mapped back in, which skips the lexer entirely.
+*/
+
+#ifndef TPY_PARSE_TOKENCACHE_H
+#define TPY_PARSE_TOKENCACHE_H
+
+#include <memory>
+#include <string>
+
+#include "tpy/parse/TokenStream.h"
+#include "tpy/source/SourceFile.h"
+#include "tpy/utility/MemoryBuffer.h"
+
+namespace tpy::Parse {
+/*
+    This is the header at the start of every cache file. It is followed by the
+   offset array, the length array, and the kind array of the token stream, in
+   that order, so that every array is naturally aligned. After the kind array,
+   which is padded to a multiple of four bytes, come the f-string offset array,
+   the first segment array, and the segment array of the f-string index.
+*/
+class TokenCacheHeader {
+  public:
+    char magic[4];
+    uint32_t format_version;
+    uint32_t lexer_version;
+    uint32_t token_count;
+    uint64_t content_hash;
+    uint64_t content_size;
+    uint32_t num_fstrings;
+    uint32_t num_segments;
+};
+
+/*
+    This is a token stream that has been loaded from the cache. It keeps the
+   backing buffer alive for as long as the view is in use.
+*/
+class CachedTokenStream {
+    std::unique_ptr<Utility::MemoryBuffer> buffer;
+
+    TokenStreamView tokens;
+
+  public:
+    CachedTokenStream(std::unique_ptr<Utility::MemoryBuffer> buffer,
+                      TokenStreamView tokens)
+        : buffer{std::move(buffer)}, tokens{tokens} {}
+
+    auto view() const -> TokenStreamView { return tokens; }
+};
+
+/*
+    This is the cache itself. Entries are keyed by a hash of the file contents
+   and the version of the lexer that produced them, so that stale entries are
+   never used.
+*/
+class TokenCache {
+    std::string cache_dir;
+
+    auto entry_path(uint64_t content_hash) const -> std::string;
+
+  public:
+    // This must be incremented whenever the layout of a cache file changes.
+    static constexpr uint32_t FORMAT_VERSION = 2;
+
+    explicit TokenCache(std::string cache_dir)
+        : cache_dir{std::move(cache_dir)} {}
+
+    // This method computes the 64-bit FNV-1a hash of a file's contents.
+    static auto hash_contents(const std::byte *data, size_t len) -> uint64_t;
+
+    // This method returns the cached token stream for the source file, or
+    // null if there is no valid entry.
+    auto load(Source::SourceFile *src_file) -> std::unique_ptr<CachedTokenStream>;
+
+    // This method writes the token stream of the source file into the cache.
+    // It returns false if the entry could not be written. Lexer errors are not
+    // replayed from the cache, so streams that reported errors should not be
+    // stored.
+    auto store(Source::SourceFile *src_file, const TokenStream &tokens) -> bool;
+};
+} // namespace tpy::Parse
+
+#endif
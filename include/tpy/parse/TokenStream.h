@@ -0,0 +1,76 @@
+/*
+    This file defines a fully lexed stream of tokens. Unlike the lexer, which
+   produces one token at a time, a token stream holds every token of a source
+   file so that it can be stored, reloaded, and replayed into the parser.
+*/
+
+#ifndef TPY_PARSE_TOKENSTREAM_H
+#define TPY_PARSE_TOKENSTREAM_H
+
+#include <cstdint>
+#include <vector>
+
+#include "tpy/parse/FStringIndex.h"
+#include "tpy/parse/Token.h"
+
+namespace tpy::Parse {
+class Lexer;
+
+/*
+    This is a read-only view of a token stream. The tokens are stored as
+   parallel arrays of kinds, local positions, and lengths so that the view can
+   point directly into a memory mapped cache file.
+*/
+class TokenStreamView {
+  public:
+    const uint8_t *kinds = nullptr;
+    const uint32_t *offsets = nullptr;
+    const uint32_t *lens = nullptr;
+    size_t size = 0;
+
+    // This is the segment index of the f-strings within the stream.
+    FStringIndexView fstrings;
+
+    auto kind(size_t i) const -> TokenKind {
+        return static_cast<TokenKind>(kinds[i]);
+    }
+
+    // This method returns the view of the tokens in [begin, end). The f-string
+    // index is shared, as it is looked up by source position.
+    auto slice(size_t begin, size_t end) const -> TokenStreamView {
+        return TokenStreamView{kinds + begin, offsets + begin, lens + begin,
+                               end - begin, fstrings};
+    }
+};
+
+/*
+    This object owns a token stream that has been produced by the lexer.
+*/
+class TokenStream {
+    std::vector<uint8_t> kinds;
+    std::vector<uint32_t> offsets, lens;
+
+  public:
+    FStringIndex fstrings;
+
+    auto push(const Token &tok) -> void {
+        kinds.push_back(static_cast<uint8_t>(tok.kind));
+        offsets.push_back(static_cast<uint32_t>(tok.span.local_pos));
+        lens.push_back(static_cast<uint32_t>(tok.span.len));
+    }
+
+    auto size() const -> size_t { return kinds.size(); }
+
+    auto view() const -> TokenStreamView {
+        return TokenStreamView{kinds.data(), offsets.data(), lens.data(),
+                               kinds.size(), fstrings.view()};
+    }
+
+    // This method will run the lexer over the whole source file. The stream
+    // always ends with the 'End' token, and the segments of its f-strings are
+    // indexed along the way.
+    static auto lex_all(Lexer &lexer) -> TokenStream;
+};
+} // namespace tpy::Parse
+
+#endif
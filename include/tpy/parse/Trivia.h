@@ -0,0 +1,79 @@
+/*
+    This file defines the trivia side-table. Trivia are the parts of the source
+   that the lexer does not turn into tokens, such as comments. Tools like
+   formatters need them, so the lexer can optionally record them here instead
+   of throwing them away.
+*/
+
+#ifndef TPY_PARSE_TRIVIA_H
+#define TPY_PARSE_TRIVIA_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace tpy::Parse {
+// These are the kinds of trivia that the lexer will record.
+enum class TriviaKind : uint8_t {
+    // A '#' comment, not including the line terminator.
+    Comment,
+    // The terminator of a line that held no tokens.
+    BlankLine,
+    // A '\' that joins two physical lines, including the line terminator.
+    Continuation,
+};
+
+/*
+    This object represents a single piece of trivia. It is kept compact as
+   there can be one for every line of the source file.
+*/
+class Trivia {
+  public:
+    // This is the local position of the trivia within the source file.
+    uint32_t offset;
+
+    uint32_t len;
+
+    TriviaKind kind;
+
+    Trivia(uint32_t offset, uint32_t len, TriviaKind kind)
+        : offset{offset}, len{len}, kind{kind} {}
+};
+
+/*
+    This is the table of trivia for a single source file. Each entry is keyed by
+   the index of the token that the lexer produces after it. The keys are stored
+   in a parallel array so that lookups by token only touch the keys.
+*/
+class TriviaTable {
+    std::vector<Trivia> entries;
+
+    // This is the parallel array of token indices. Since the lexer only moves
+    // forward, it is always sorted.
+    std::vector<uint32_t> token_indices;
+
+  public:
+    auto add(uint32_t tok_index, Trivia trivia) -> void {
+        entries.push_back(trivia);
+        token_indices.push_back(tok_index);
+    }
+
+    auto size() const -> size_t { return entries.size(); }
+
+    auto operator[](size_t i) const -> const Trivia & { return entries[i]; }
+
+    auto token_index(size_t i) const -> uint32_t { return token_indices[i]; }
+
+    // This method returns the range of trivia that precede the token at the
+    // given index.
+    auto trivia_before(uint32_t tok_index) const
+        -> std::pair<const Trivia *, const Trivia *>;
+
+    auto clear() -> void {
+        entries.clear();
+        token_indices.clear();
+    }
+};
+} // namespace tpy::Parse
+
+#endif
@@ -32,7 +32,7 @@ class SourceFile {
 
     std::vector<NewLineChar> line_map;
 
-    SourceFile(char *path, size_t offset,
+    SourceFile(const char *path, size_t offset,
                std::unique_ptr<Utility::MemoryBuffer> buffer,
                std::vector<NewLineChar> line_map)
         : path{path}, offset{offset}, buffer{std::move(buffer)},
@@ -22,7 +22,7 @@ class SourceManager {
                                  &mem_buffer) -> std::vector<NewLineChar>;
 
   public:
-    auto open_py_src_file(char *path) -> SourceFile *;
+    auto open_py_src_file(const char *path) -> SourceFile *;
 
     auto get_loc_from_pos(size_t pos) -> SourceLocation;
 
@@ -25,12 +25,17 @@ class Span {
 
     static auto empty() -> Span { return Span{0, 0, 0}; }
 
-    // For constructing the AST, we need to be able to combine spans that
-    // represent regions.
-    auto operator+(const Span &rhs) -> Source::Span &{
-        len = (rhs.absolute_pos + len) - absolute_pos;
-        return *this;
+    // This method creates the span that covers everything from the start of
+    // the first span to the end of the last span.
+    static auto merge(const Span &first, const Span &last) -> Span {
+        return Span{first.local_pos, first.absolute_pos,
+                    last.absolute_pos + last.len - first.absolute_pos};
     }
+
+    // For constructing the AST, we need to be able to combine spans that
+    // represent regions. This is the same as 'merge', so neither span is
+    // modified, as the left one is often the span of a child node.
+    auto operator+(const Span &rhs) const -> Span { return merge(*this, rhs); }
 };
 } // namespace tpy::Source
 
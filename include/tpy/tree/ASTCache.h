@@ -0,0 +1,119 @@
+/*
+    This file defines the on-disk AST cache. When the same unchanged files are
+   analyzed repeatedly, the flat tree of each file can be stored in a cache
+   directory and mapped back in, which skips both the lexer and the parser.
+*/
+
+#ifndef TPY_TREE_ASTCACHE_H
+#define TPY_TREE_ASTCACHE_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "tpy/source/SourceFile.h"
+#include "tpy/tree/FlatAST.h"
+#include "tpy/utility/MemoryBuffer.h"
+
+namespace tpy::Tree {
+/*
+    This is the header at the start of every cache file. It is followed by the
+   columns of the flat tree: the positions, the lengths, the payloads, the
+   fields, the shared array of children, the f-string segment ranges, and the
+   words of the folded constants. After them come the string table, as an
+   array of 'num_strings + 1' offsets into its characters, then the kinds, and
+   finally the characters. The 32-bit arrays come first and the byte arrays
+   last, so that every array is naturally aligned without any padding.
+
+    Every reference within the file is an index or an offset rather than a
+   pointer, so the file can be mapped at any address. The absolute positions
+   of the spans are not stored either, as they depend on the order in which
+   files are opened, and are taken from the source file when it is loaded.
+*/
+class ASTCacheHeader {
+  public:
+    char magic[4];
+    uint32_t format_version;
+    uint32_t lexer_version;
+    uint32_t parser_version;
+    uint64_t content_hash;
+    uint64_t content_size;
+    uint32_t num_nodes;
+    uint32_t num_children;
+    uint32_t num_fstrings;
+    uint32_t num_strings;
+    uint32_t string_data_size;
+    uint32_t num_constant_words;
+};
+
+/*
+    This is a tree that has been loaded from the cache. It keeps the backing
+   buffer alive for as long as the view is in use, and the view points
+   straight into it, so nothing is decoded when a tree is loaded.
+
+    The names in the tree are interned in the string table of the file, and the
+   payload of every 'NameExpr' node is the index of its name, so the names can
+   be looked up without the source.
+*/
+class CachedAST {
+    std::unique_ptr<Utility::MemoryBuffer> buffer;
+
+    FlatASTView tree;
+
+    const uint32_t *string_offsets;
+    const char *string_data;
+    size_t num_strings;
+
+  public:
+    CachedAST(std::unique_ptr<Utility::MemoryBuffer> buffer, FlatASTView tree,
+              const uint32_t *string_offsets, const char *string_data,
+              size_t num_strings)
+        : buffer{std::move(buffer)}, tree{tree},
+          string_offsets{string_offsets}, string_data{string_data},
+          num_strings{num_strings} {}
+
+    auto view() const -> FlatASTView { return tree; }
+
+    auto string_count() const -> size_t { return num_strings; }
+
+    auto string(uint32_t index) const -> std::string_view {
+        return std::string_view(string_data + string_offsets[index],
+                                string_offsets[index + 1] -
+                                    string_offsets[index]);
+    }
+
+    // This method returns the text of a 'NameExpr' node.
+    auto name(FlatASTView::NodeIndex node) const -> std::string_view {
+        return string(tree.payload(node));
+    }
+};
+
+/*
+    This is the cache itself. Entries are keyed by a hash of the file contents
+   and the versions of the lexer and the parser that produced them, so that
+   stale entries are never used.
+*/
+class ASTCache {
+    std::string cache_dir;
+
+    auto entry_path(uint64_t content_hash) const -> std::string;
+
+  public:
+    // This must be incremented whenever the layout of a cache file changes.
+    static constexpr uint32_t FORMAT_VERSION = 2;
+
+    explicit ASTCache(std::string cache_dir)
+        : cache_dir{std::move(cache_dir)} {}
+
+    // This method returns the cached tree of the source file, or null if there
+    // is no valid entry.
+    auto load(Source::SourceFile *src_file) -> std::unique_ptr<CachedAST>;
+
+    // This method writes the tree of the source file into the cache. It returns
+    // false if the entry could not be written. Syntax errors are not replayed
+    // from the cache, so trees that reported errors should not be stored.
+    auto store(Source::SourceFile *src_file, const FlatAST &tree) -> bool;
+};
+} // namespace tpy::Tree
+
+#endif
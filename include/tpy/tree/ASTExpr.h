@@ -8,8 +8,11 @@
 #include "ASTNode.h"
 #include "tpy/parse/Token.h"
 #include "tpy/source/Span.h"
+#include "tpy/utility/ArenaArray.h"
 
-#include <vector>
+#include <cstdint>
+#include <string>
+#include <utility>
 
 namespace tpy::Tree {
 // This class defines the AST Node that will represent an integer literal in the
@@ -21,7 +24,8 @@ class ASTIntLiteralNode : public ASTNode {
     // same node.
     int base;
 
-    ASTIntLiteralNode(int base, Source::Span loc) : ASTNode{loc}, base{base} {}
+    ASTIntLiteralNode(int base, Source::Span loc)
+        : ASTNode{ASTNodeKind::IntLiteral, loc}, base{base} {}
 
     virtual auto pretty_print(FILE *result_file, int level) -> void override;
 };
@@ -30,7 +34,8 @@ class ASTIntLiteralNode : public ASTNode {
 // input.
 class ASTFloatLiteralNode : public ASTNode {
   public:
-    explicit ASTFloatLiteralNode(Source::Span loc) : ASTNode{loc} {}
+    explicit ASTFloatLiteralNode(Source::Span loc)
+        : ASTNode{ASTNodeKind::FloatLiteral, loc} {}
 
     virtual auto pretty_print(FILE *result_file, int level) -> void override;
 };
@@ -39,7 +44,34 @@ class ASTFloatLiteralNode : public ASTNode {
 // input.
 class ASTStringLiteralNode : public ASTNode {
   public:
-    explicit ASTStringLiteralNode(Source::Span loc) : ASTNode{loc} {}
+    explicit ASTStringLiteralNode(Source::Span loc)
+        : ASTNode{ASTNodeKind::StringLiteral, loc} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent a bytes literal in the
+// input.
+class ASTBytesLiteralNode : public ASTNode {
+  public:
+    explicit ASTBytesLiteralNode(Source::Span loc)
+        : ASTNode{ASTNodeKind::BytesLiteral, loc} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent an f-string literal in
+// the input.
+class ASTFStringLiteralNode : public ASTNode {
+  public:
+    // These fields represent the range of segments of the f-string within the
+    // f-string index that was built by the lexer.
+    uint32_t segment_begin, segment_end;
+
+    ASTFStringLiteralNode(uint32_t segment_begin, uint32_t segment_end,
+                          Source::Span loc)
+        : ASTNode{ASTNodeKind::FStringLiteral, loc},
+          segment_begin{segment_begin}, segment_end{segment_end} {}
 
     virtual auto pretty_print(FILE *result_file, int level) -> void override;
 };
@@ -52,7 +84,81 @@ class ASTBoolLiteralNode : public ASTNode {
     // derived from the 'True' and 'False' keywords.
     bool val;
 
-    ASTBoolLiteralNode(bool val, Source::Span loc) : ASTNode{loc}, val{val} {}
+    ASTBoolLiteralNode(bool val, Source::Span loc)
+        : ASTNode{ASTNodeKind::BoolLiteral, loc}, val{val} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent the 'None' literal in
+// the input.
+class ASTNoneLiteralNode : public ASTNode {
+  public:
+    explicit ASTNoneLiteralNode(Source::Span loc)
+        : ASTNode{ASTNodeKind::NoneLiteral, loc} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent the '...' literal in the
+// input.
+class ASTEllipsisLiteralNode : public ASTNode {
+  public:
+    explicit ASTEllipsisLiteralNode(Source::Span loc)
+        : ASTNode{ASTNodeKind::EllipsisLiteral, loc} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// These are the types of the values that constant folding computes. Booleans
+// and 'None' are folded into their literal nodes instead.
+enum class ConstantKind : uint8_t { Int, Float, String, Bytes };
+
+// This function returns the name of a type of constant, as Python calls it.
+auto constant_kind_name(ConstantKind kind) -> const char *;
+
+// This class defines the AST Node that will hold a value that has been computed
+// from literals by constant folding, such as the '86400' of '60 * 60 * 24'. Its
+// span covers the whole expression that it stands for, so unlike a literal, its
+// value cannot be read back from the source.
+class ASTConstantExprNode : public ASTNode {
+  public:
+    ConstantKind constant_kind;
+
+    // This is the sign of an integer.
+    bool negative;
+
+    // These are the digits of the magnitude of an integer, in base 2^32 with
+    // the least significant first, as in 'Utility::BigInt'.
+    Utility::ArenaArray<uint32_t> digits;
+
+    // This is the value of a float.
+    double float_value;
+
+    // This is the UTF-8 text of a string, or the contents of a bytes object.
+    Utility::ArenaArray<char> text;
+
+    ASTConstantExprNode(ConstantKind constant_kind, bool negative,
+                        Utility::ArenaArray<uint32_t> digits,
+                        double float_value, Utility::ArenaArray<char> text,
+                        Source::Span loc)
+        : ASTNode{ASTNodeKind::ConstantExpr, loc},
+          constant_kind{constant_kind}, negative{negative}, digits{digits},
+          float_value{float_value}, text{text} {}
+
+    // This method returns the value as Python's 'repr' would write it.
+    auto repr() const -> std::string;
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will stand in for an expression or a
+// statement that could not be parsed. The parser reports the error, skips the
+// tokens up to a point where it can resume, and leaves this node in their place.
+class ASTErrorNode : public ASTNode {
+  public:
+    explicit ASTErrorNode(Source::Span loc)
+        : ASTNode{ASTNodeKind::Error, loc} {}
 
     virtual auto pretty_print(FILE *result_file, int level) -> void override;
 };
@@ -65,7 +171,7 @@ class ASTParenExprNode : public ASTNode {
     ASTNode *inner_expr;
 
     ASTParenExprNode(ASTNode *inner_expr, Source::Span loc)
-        : ASTNode{loc}, inner_expr{inner_expr} {}
+        : ASTNode{ASTNodeKind::ParenExpr, loc}, inner_expr{inner_expr} {}
 
     virtual auto pretty_print(FILE *result_file, int level) -> void override;
 };
@@ -75,12 +181,12 @@ class ASTParenExprNode : public ASTNode {
 class ASTListExprNode : public ASTNode {
   public:
     // This member is the list of expressions within the node.
-    std::vector<ASTNode *> list;
+    Utility::ArenaArray<ASTNode *> list;
 
-    ASTListExprNode(std::vector<ASTNode *> list, Source::Span loc)
-        : ASTNode{loc}, list{std::move(list)} {}
+    ASTListExprNode(Utility::ArenaArray<ASTNode *> list, Source::Span loc)
+        : ASTNode{ASTNodeKind::ListExpr, loc}, list{list} {}
 
-    ASTListExprNode(Source::Span loc) : ASTNode{loc} {}
+    ASTListExprNode(Source::Span loc) : ASTNode{ASTNodeKind::ListExpr, loc} {}
 
     virtual auto pretty_print(FILE *result_file, int level) -> void override;
 };
@@ -90,10 +196,10 @@ class ASTListExprNode : public ASTNode {
 class ASTSetExprNode : public ASTNode {
   public:
     // This member contains all of the expressions to be put into the set.
-    std::vector<ASTNode *> contents;
+    Utility::ArenaArray<ASTNode *> contents;
 
-    ASTSetExprNode(std::vector<ASTNode *> contents, Source::Span loc)
-        : ASTNode{loc}, contents{std::move(contents)} {}
+    ASTSetExprNode(Utility::ArenaArray<ASTNode *> contents, Source::Span loc)
+        : ASTNode{ASTNodeKind::SetExpr, loc}, contents{contents} {}
 
     virtual auto pretty_print(FILE *result_file, int level) -> void override;
 };
@@ -103,13 +209,27 @@ class ASTSetExprNode : public ASTNode {
 class ASTDictExprNode : public ASTNode {
   public:
     // This member contains the key value pairs to be put into the dict.
-    std::vector<std::pair<ASTNode *, ASTNode *>> contents;
+    Utility::ArenaArray<std::pair<ASTNode *, ASTNode *>> contents;
 
-    ASTDictExprNode(std::vector<std::pair<ASTNode *, ASTNode *>> contents,
-                    Source::Span loc)
-        : ASTNode{loc}, contents{std::move(contents)} {}
+    ASTDictExprNode(
+        Utility::ArenaArray<std::pair<ASTNode *, ASTNode *>> contents,
+        Source::Span loc)
+        : ASTNode{ASTNodeKind::DictExpr, loc}, contents{contents} {}
 
-    ASTDictExprNode(Source::Span loc) : ASTNode{loc} {}
+    ASTDictExprNode(Source::Span loc) : ASTNode{ASTNodeKind::DictExpr, loc} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent a tuple that is formed by
+// a list of expressions separated by commas, as in 'a, b = b, a'.
+class ASTTupleExprNode : public ASTNode {
+  public:
+    // This member contains the elements of the tuple.
+    Utility::ArenaArray<ASTNode *> elements;
+
+    ASTTupleExprNode(Utility::ArenaArray<ASTNode *> elements, Source::Span loc)
+        : ASTNode{ASTNodeKind::TupleExpr, loc}, elements{elements} {}
 
     virtual auto pretty_print(FILE *result_file, int level) -> void override;
 };
@@ -118,7 +238,8 @@ class ASTDictExprNode : public ASTNode {
 // identifiers that act as names.
 class ASTNameExprNode : public ASTNode {
   public:
-    explicit ASTNameExprNode(Source::Span loc) : ASTNode{loc} {}
+    explicit ASTNameExprNode(Source::Span loc)
+        : ASTNode{ASTNodeKind::NameExpr, loc} {}
 
     virtual auto pretty_print(FILE *result_file, int level) -> void override;
 };
@@ -134,7 +255,35 @@ class ASTAttrRefExprNode : public ASTNode {
     ASTNameExprNode *rhs;
 
     ASTAttrRefExprNode(ASTNode *lhs, ASTNameExprNode *rhs, Source::Span loc)
-        : ASTNode{loc}, lhs{lhs}, rhs{rhs} {}
+        : ASTNode{ASTNodeKind::AttrRefExpr, loc}, lhs{lhs}, rhs{rhs} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the ASTNode that will hold a keyword argument of the form
+// 'name=value' within a call expression.
+class ASTKeywordArgNode : public ASTNode {
+  public:
+    ASTNameExprNode *name;
+    ASTNode *value;
+
+    ASTKeywordArgNode(ASTNameExprNode *name, ASTNode *value, Source::Span loc)
+        : ASTNode{ASTNodeKind::KeywordArg, loc}, name{name}, value{value} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the ASTNode that will hold an expression that is unpacked
+// with '*' or '**', as in 'f(*args, **kwargs)'.
+class ASTStarredExprNode : public ASTNode {
+  public:
+    ASTNode *expr;
+
+    // This member is either 'Asterisk' or 'AsteriskAsterisk'.
+    Parse::TokenKind op;
+
+    ASTStarredExprNode(ASTNode *expr, Parse::TokenKind op, Source::Span loc)
+        : ASTNode{ASTNodeKind::StarredExpr, loc}, expr{expr}, op{op} {}
 
     virtual auto pretty_print(FILE *result_file, int level) -> void override;
 };
@@ -146,14 +295,14 @@ class ASTCallExprNode : public ASTNode {
     ASTNode *callee;
 
     // This member is a list of all of the arguments in the call expression.
-    std::vector<ASTNode *> args;
+    Utility::ArenaArray<ASTNode *> args;
 
-    ASTCallExprNode(ASTNode *callee, std::vector<ASTNode *> args,
+    ASTCallExprNode(ASTNode *callee, Utility::ArenaArray<ASTNode *> args,
                     Source::Span loc)
-        : ASTNode{loc}, callee{callee}, args{std::move(args)} {}
+        : ASTNode{ASTNodeKind::CallExpr, loc}, callee{callee}, args{args} {}
 
     ASTCallExprNode(ASTNode *callee, Source::Span loc)
-        : ASTNode{loc}, callee{callee} {}
+        : ASTNode{ASTNodeKind::CallExpr, loc}, callee{callee} {}
 
     virtual auto pretty_print(FILE *result_file, int level) -> void override;
 };
@@ -169,7 +318,8 @@ class ASTIndexSliceExprNode : public ASTNode {
 
     ASTIndexSliceExprNode(ASTNode *slicee, ASTNode *index_expr,
                           Source::Span loc)
-        : ASTNode{loc}, slicee{slicee}, index_expr{index_expr} {}
+        : ASTNode{ASTNodeKind::IndexSliceExpr, loc}, slicee{slicee},
+          index_expr{index_expr} {}
 
     virtual auto pretty_print(FILE *result_file, int level) -> void override;
 };
@@ -178,12 +328,14 @@ class ASTProperSliceExprNode : public ASTNode {
   public:
     ASTNode *slicee;
 
-    ASTNode *lower_bound, *upper_bound;
+    // Any of these may be missing, as in 'a[::2]'.
+    ASTNode *lower_bound, *upper_bound, *step;
 
     ASTProperSliceExprNode(ASTNode *slicee, ASTNode *lower_bound,
-                           ASTNode *upper_bound, Source::Span loc)
-        : ASTNode{loc}, slicee{slicee}, lower_bound{lower_bound},
-          upper_bound{upper_bound} {}
+                           ASTNode *upper_bound, ASTNode *step,
+                           Source::Span loc)
+        : ASTNode{ASTNodeKind::ProperSliceExpr, loc}, slicee{slicee},
+          lower_bound{lower_bound}, upper_bound{upper_bound}, step{step} {}
 
     virtual auto pretty_print(FILE *result_file, int level) -> void override;
 };
@@ -195,7 +347,7 @@ class ASTBinaryOpExprNode : public ASTNode {
 
     ASTBinaryOpExprNode(ASTNode *lhs, ASTNode *rhs, Parse::TokenKind op,
                         Source::Span loc)
-        : ASTNode{loc}, lhs{lhs}, rhs{rhs}, op{op} {}
+        : ASTNode{ASTNodeKind::BinaryOpExpr, loc}, lhs{lhs}, rhs{rhs}, op{op} {}
 
     virtual auto pretty_print(FILE *result_file, int level) -> void override;
 };
@@ -206,7 +358,7 @@ class ASTUnaryOpExprNode : public ASTNode {
     Parse::TokenKind op;
 
     ASTUnaryOpExprNode(ASTNode *expr, Parse::TokenKind op, Source::Span loc)
-        : ASTNode{loc}, expr{expr}, op{op} {}
+        : ASTNode{ASTNodeKind::UnaryOpExpr, loc}, expr{expr}, op{op} {}
 
     virtual auto pretty_print(FILE *result_file, int level) -> void override;
 };
@@ -217,8 +369,108 @@ class ASTTernaryOpExprNode : public ASTNode {
 
     ASTTernaryOpExprNode(ASTNode *condition, ASTNode *true_case,
                          ASTNode *false_case, Source::Span loc)
-        : ASTNode{loc}, condition{condition}, true_case{true_case},
-          false_case{false_case} {}
+        : ASTNode{ASTNodeKind::TernaryOpExpr, loc}, condition{condition},
+          true_case{true_case}, false_case{false_case} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the ASTNode that will hold string literals that are
+// written next to each other, as in '"a" "b"', which Python joins into one.
+// The parts are string, f-string, or bytes literals.
+class ASTStringConcatExprNode : public ASTNode {
+  public:
+    Utility::ArenaArray<ASTNode *> parts;
+
+    ASTStringConcatExprNode(Utility::ArenaArray<ASTNode *> parts,
+                            Source::Span loc)
+        : ASTNode{ASTNodeKind::StringConcatExpr, loc}, parts{parts} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the ASTNode that will hold an 'await' expression.
+class ASTAwaitExprNode : public ASTNode {
+  public:
+    ASTNode *expr;
+
+    ASTAwaitExprNode(ASTNode *expr, Source::Span loc)
+        : ASTNode{ASTNodeKind::AwaitExpr, loc}, expr{expr} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the ASTNode that will hold a 'yield' or 'yield from'
+// expression.
+class ASTYieldExprNode : public ASTNode {
+  public:
+    // This member is missing for a bare 'yield'.
+    ASTNode *value;
+
+    // This member is set for 'yield from'.
+    bool is_from;
+
+    ASTYieldExprNode(ASTNode *value, bool is_from, Source::Span loc)
+        : ASTNode{ASTNodeKind::YieldExpr, loc}, value{value},
+          is_from{is_from} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the ASTNode that will hold a lambda expression. Its
+// parameters are parameter nodes without annotations.
+class ASTLambdaExprNode : public ASTNode {
+  public:
+    Utility::ArenaArray<ASTNode *> params;
+    ASTNode *body;
+
+    ASTLambdaExprNode(Utility::ArenaArray<ASTNode *> params, ASTNode *body,
+                      Source::Span loc)
+        : ASTNode{ASTNodeKind::LambdaExpr, loc}, params{params}, body{body} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the ASTNode that will hold one 'for' clause of a
+// comprehension, with the 'if' clauses that follow it.
+class ASTComprehensionClauseNode : public ASTNode {
+  public:
+    // This member is set for 'async for'.
+    bool is_async;
+
+    ASTNode *target, *iter;
+    Utility::ArenaArray<ASTNode *> ifs;
+
+    ASTComprehensionClauseNode(bool is_async, ASTNode *target, ASTNode *iter,
+                               Utility::ArenaArray<ASTNode *> ifs,
+                               Source::Span loc)
+        : ASTNode{ASTNodeKind::ComprehensionClause, loc}, is_async{is_async},
+          target{target}, iter{iter}, ifs{ifs} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the ASTNode that will hold a comprehension or a generator
+// expression, such as '[x * 2 for x in a if x]'.
+class ASTComprehensionExprNode : public ASTNode {
+  public:
+    // This member is 'LeftSquare' for a list, 'LeftCurly' for a set or a dict,
+    // and 'LeftParen' for a generator, which includes the bare generator that
+    // is the only argument of a call, as in 'f(x for x in a)'.
+    Parse::TokenKind bracket;
+
+    // The element is the key of a dict comprehension, whose value is the
+    // second member. The value is missing for any other comprehension.
+    ASTNode *element, *value;
+
+    Utility::ArenaArray<ASTNode *> generators;
+
+    ASTComprehensionExprNode(Parse::TokenKind bracket, ASTNode *element,
+                             ASTNode *value,
+                             Utility::ArenaArray<ASTNode *> generators,
+                             Source::Span loc)
+        : ASTNode{ASTNodeKind::ComprehensionExpr, loc}, bracket{bracket},
+          element{element}, value{value}, generators{generators} {}
 
     virtual auto pretty_print(FILE *result_file, int level) -> void override;
 };
@@ -0,0 +1,135 @@
+/*
+    This file defines the description of the members of an AST node, which is
+   shared by the code that handles every kind of node the same way.
+*/
+
+#ifndef TPY_TREE_ASTMEMBERS_H
+#define TPY_TREE_ASTMEMBERS_H
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "tpy/parse/Token.h"
+#include "tpy/tree/ASTNode.h"
+#include "tpy/utility/ArenaArray.h"
+
+namespace tpy::Tree {
+/*
+    This object lists the members of a single node, in the order of its node
+   class. No node has more than two scalar members or five children, so the
+   members are held in fixed arrays. The children refer to the members
+   themselves, so they can be replaced as well as read.
+*/
+class NodeMembers {
+  public:
+    // This is a scalar member, which is written as a number, a name, a
+    // boolean, or a text that must be escaped. The text itself is held in
+    // 'text_value', as there is at most one within a node.
+    struct Scalar {
+        enum class Kind : uint8_t { Number, Name, Bool, Text } kind;
+        const char *label;
+        uint64_t number;
+        const char *name;
+    };
+
+    // This is a child, a list of children, or the entries of a dict. The slot
+    // of a single child may hold null.
+    struct Child {
+        enum class Kind : uint8_t { Node, List, Pairs } kind;
+        const char *label;
+        ASTNode **slot;
+        Utility::ArenaArray<ASTNode *> *list;
+        Utility::ArenaArray<std::pair<ASTNode *, ASTNode *>> *pairs;
+    };
+
+    Scalar scalars[2];
+    size_t num_scalars = 0;
+
+    Child children[5];
+    size_t num_children = 0;
+
+    std::string text_value;
+
+    auto number(const char *label, uint64_t value) -> void {
+        scalars[num_scalars++] = Scalar{Scalar::Kind::Number, label, value, ""};
+    }
+
+    auto name(const char *label, const char *name) -> void {
+        scalars[num_scalars++] = Scalar{Scalar::Kind::Name, label, 0, name};
+    }
+
+    auto boolean(const char *label, bool value) -> void {
+        scalars[num_scalars++] = Scalar{Scalar::Kind::Bool, label, value, ""};
+    }
+
+    auto text(const char *label, std::string value) -> void {
+        text_value = std::move(value);
+        scalars[num_scalars++] = Scalar{Scalar::Kind::Text, label, 0, ""};
+    }
+
+    auto op(Parse::TokenKind op) -> void {
+        name("op", Parse::token_names[static_cast<int>(op)]);
+    }
+
+    // Some members point to a particular node class, such as a name. Every
+    // node class derives from 'ASTNode' alone, so such a member holds the same
+    // address as a pointer to the base would. Only a node of the same class
+    // may be stored through the slot.
+    template <class T> auto node(const char *label, T *&node) -> void {
+        static_assert(std::is_base_of_v<ASTNode, T>);
+        children[num_children++] =
+            Child{Child::Kind::Node, label, reinterpret_cast<ASTNode **>(&node),
+                  nullptr, nullptr};
+    }
+
+    auto list(const char *label, Utility::ArenaArray<ASTNode *> &list)
+        -> void {
+        children[num_children++] =
+            Child{Child::Kind::List, label, nullptr, &list, nullptr};
+    }
+
+    auto pairs(const char *label,
+               Utility::ArenaArray<std::pair<ASTNode *, ASTNode *>> &pairs)
+        -> void {
+        children[num_children++] =
+            Child{Child::Kind::Pairs, label, nullptr, nullptr, &pairs};
+    }
+};
+
+// This function lists the members of the node. The labels are the names of
+// the members within the node classes.
+auto describe_members(ASTNode *node, NodeMembers &members) -> void;
+
+// This function calls the callback with the slot of every child that is
+// present, in the order of the members. The slots of a dict entry give its key
+// and then its value.
+template <class F>
+auto for_each_child_slot(const NodeMembers &members, F &&fn) -> void {
+    auto one = [&](ASTNode **slot) {
+        if (*slot) {
+            fn(slot);
+        }
+    };
+
+    for (size_t i = 0; i < members.num_children; i++) {
+        auto &child = members.children[i];
+
+        if (child.slot) {
+            one(child.slot);
+        } else if (child.list) {
+            for (auto &element : *child.list) {
+                one(&element);
+            }
+        } else {
+            for (auto &[key, value] : *child.pairs) {
+                one(&key);
+                one(&value);
+            }
+        }
+    }
+}
+} // namespace tpy::Tree
+
+#endif
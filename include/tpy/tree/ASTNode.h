@@ -6,29 +6,53 @@
 #ifndef TPY_TREE_ASTNODE_H
 #define TPY_TREE_ASTNODE_H
 
+#include <cstdint>
 #include <cstdio>
 
 #include "tpy/source/Span.h"
+#include "tpy/tree/ASTNodeKind.h"
+
+namespace tpy::Utility {
+class ArenaAllocator;
+} // namespace tpy::Utility
 
 namespace tpy::Tree {
 /*
     This object represents a node of the AST. It is the base class for all other
-   AST nodes and contains only the basic information, which is a source
-   location. The constructor is protected as this object should not be able to
-   be instantiated by itself.
+   AST nodes and contains only the basic information, which is its kind and a
+   source location. The kind is set by the constructor of every node class, so
+   the type of a node can be found without a virtual call or a 'dynamic_cast'.
+   The constructor is protected as this object should not be able to be
+   instantiated by itself.
+
+    Nodes live in an arena and are never deleted, so the destructor is not
+   virtual. This keeps every node trivially destructible, and the arena does
+   not have to record its destructor.
 */
 class ASTNode {
   public:
-    Source::Span loc;
+    ASTNodeKind kind;
+
+    // This is the structural hash of the node, which is set by the structural
+    // hasher and is zero until then. It fits within the padding after the
+    // kind, so it does not make any node larger.
+    uint32_t hash = 0;
 
-    virtual ~ASTNode() {};
+    Source::Span loc;
 
     // This method will "pretty-print" the AST in a human-readable format.
     virtual auto pretty_print(FILE *result_file, int level) -> void = 0;
 
   protected:
-    explicit ASTNode(Source::Span loc) : loc{loc} {}
+    ASTNode(ASTNodeKind kind, Source::Span loc) : kind{kind}, loc{loc} {}
+
+    ~ASTNode() = default;
 };
+
+// This function gives the memory of a node back to the arena that it was
+// allocated in, by the size of its own class, so that a later node can take
+// its place. Its children and lists are left alone, as they may be shared.
+auto deallocate_node(ASTNode *node, Utility::ArenaAllocator &arena) -> void;
 } // namespace tpy::Tree
 
 #endif
\ No newline at end of file
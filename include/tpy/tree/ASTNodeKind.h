@@ -0,0 +1,105 @@
+/*
+    This file defines the kinds of the nodes of the AST.
+*/
+
+#ifndef TPY_TREE_ASTNODEKIND_H
+#define TPY_TREE_ASTNODEKIND_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tpy::Tree {
+
+// Every kind is named after its node class without the 'AST' prefix and the
+// 'Node' suffix, so 'X(IntLiteral, ...)' stands for 'ASTIntLiteralNode'.
+//
+// The second argument lists the children of the kind, in the order of the
+// members of its node class. 'AST_CHILD' is a single child that may be
+// missing, 'AST_CHILD_LIST' is a list of children, and 'AST_CHILD_PAIRS' is a
+// list of pairs of children, such as the entries of a dict. Code that walks
+// the children of every kind defines these three macros before it expands the
+// list, and code that only needs the kinds ignores the argument.
+#define AST_NODE_LIST(X)                                                       \
+    X(IntLiteral, )                                                            \
+    X(FloatLiteral, )                                                          \
+    X(StringLiteral, )                                                         \
+    X(BytesLiteral, )                                                          \
+    X(FStringLiteral, )                                                        \
+    X(BoolLiteral, )                                                           \
+    X(NoneLiteral, )                                                           \
+    X(EllipsisLiteral, )                                                       \
+    X(ConstantExpr, )                                                          \
+    X(Error, )                                                                 \
+    X(ParenExpr, AST_CHILD(inner_expr))                                        \
+    X(ListExpr, AST_CHILD_LIST(list))                                          \
+    X(SetExpr, AST_CHILD_LIST(contents))                                       \
+    X(DictExpr, AST_CHILD_PAIRS(contents))                                     \
+    X(TupleExpr, AST_CHILD_LIST(elements))                                     \
+    X(NameExpr, )                                                              \
+    X(AttrRefExpr, AST_CHILD(lhs) AST_CHILD(rhs))                              \
+    X(KeywordArg, AST_CHILD(name) AST_CHILD(value))                            \
+    X(StarredExpr, AST_CHILD(expr))                                            \
+    X(CallExpr, AST_CHILD(callee) AST_CHILD_LIST(args))                        \
+    X(IndexSliceExpr, AST_CHILD(slicee) AST_CHILD(index_expr))                 \
+    X(ProperSliceExpr, AST_CHILD(slicee) AST_CHILD(lower_bound)                \
+      AST_CHILD(upper_bound) AST_CHILD(step))                                  \
+    X(BinaryOpExpr, AST_CHILD(lhs) AST_CHILD(rhs))                             \
+    X(UnaryOpExpr, AST_CHILD(expr))                                            \
+    X(TernaryOpExpr, AST_CHILD(condition) AST_CHILD(true_case)                 \
+      AST_CHILD(false_case))                                                   \
+    X(StringConcatExpr, AST_CHILD_LIST(parts))                                 \
+    X(AwaitExpr, AST_CHILD(expr))                                              \
+    X(YieldExpr, AST_CHILD(value))                                             \
+    X(LambdaExpr, AST_CHILD_LIST(params) AST_CHILD(body))                      \
+    X(ComprehensionClause, AST_CHILD(target) AST_CHILD(iter)                   \
+      AST_CHILD_LIST(ifs))                                                     \
+    X(ComprehensionExpr, AST_CHILD(element) AST_CHILD(value)                   \
+      AST_CHILD_LIST(generators))                                              \
+    X(Module, AST_CHILD_LIST(body))                                            \
+    X(ExprStmt, AST_CHILD(expr))                                               \
+    X(AssignStmt, AST_CHILD_LIST(targets) AST_CHILD(value))                    \
+    X(AugAssignStmt, AST_CHILD(target) AST_CHILD(value))                       \
+    X(AnnAssignStmt, AST_CHILD(target) AST_CHILD(annotation)                   \
+      AST_CHILD(value))                                                        \
+    X(PassStmt, )                                                              \
+    X(BreakStmt, )                                                             \
+    X(ContinueStmt, )                                                          \
+    X(ReturnStmt, AST_CHILD(value))                                            \
+    X(DelStmt, AST_CHILD_LIST(targets))                                        \
+    X(GlobalStmt, AST_CHILD_LIST(names))                                       \
+    X(NonlocalStmt, AST_CHILD_LIST(names))                                     \
+    X(AssertStmt, AST_CHILD(test) AST_CHILD(msg))                              \
+    X(RaiseStmt, AST_CHILD(exc) AST_CHILD(cause))                              \
+    X(ImportAlias, AST_CHILD(name) AST_CHILD(as_name))                         \
+    X(ImportStmt, AST_CHILD_LIST(names))                                       \
+    X(ImportFromStmt, AST_CHILD(module) AST_CHILD_LIST(names))                 \
+    X(IfStmt, AST_CHILD(test) AST_CHILD_LIST(body) AST_CHILD_LIST(orelse))     \
+    X(WhileStmt, AST_CHILD(test) AST_CHILD_LIST(body) AST_CHILD_LIST(orelse))  \
+    X(ForStmt, AST_CHILD(target) AST_CHILD(iter) AST_CHILD_LIST(body)          \
+      AST_CHILD_LIST(orelse))                                                  \
+    X(ExceptHandler, AST_CHILD(type) AST_CHILD(name) AST_CHILD_LIST(body))     \
+    X(TryStmt, AST_CHILD_LIST(body) AST_CHILD_LIST(handlers)                   \
+      AST_CHILD_LIST(orelse) AST_CHILD_LIST(finalbody))                        \
+    X(WithItem, AST_CHILD(context_expr) AST_CHILD(target))                     \
+    X(WithStmt, AST_CHILD_LIST(items) AST_CHILD_LIST(body))                    \
+    X(Param, AST_CHILD(name) AST_CHILD(annotation) AST_CHILD(default_value))   \
+    X(FunctionDef, AST_CHILD_LIST(decorators) AST_CHILD(name)                  \
+      AST_CHILD_LIST(params) AST_CHILD(returns) AST_CHILD_LIST(body))          \
+    X(ClassDef, AST_CHILD_LIST(decorators) AST_CHILD(name)                     \
+      AST_CHILD_LIST(bases) AST_CHILD_LIST(body))
+
+#define F(x, children) x,
+enum class ASTNodeKind : uint8_t { AST_NODE_LIST(F) };
+#undef F
+
+// This is the number of node kinds, which is the size of tables that are
+// indexed by the kind.
+#define F(x, children) +1
+constexpr size_t NUM_AST_NODE_KINDS = 0 AST_NODE_LIST(F);
+#undef F
+
+// These are the names of the kinds, indexed by the kind.
+extern const char *ast_node_kind_names[];
+} // namespace tpy::Tree
+
+#endif
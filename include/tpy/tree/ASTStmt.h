@@ -0,0 +1,430 @@
+/*
+    This file defines the AST nodes for Python statements and modules.
+*/
+
+#ifndef TPY_TREE_ASTSTMT_H
+#define TPY_TREE_ASTSTMT_H
+
+#include "ASTNode.h"
+#include "tpy/parse/Token.h"
+#include "tpy/source/Span.h"
+#include "tpy/utility/ArenaArray.h"
+
+#include <cstdint>
+
+namespace tpy::Tree {
+// This class defines the AST Node that will represent a whole module, which is
+// the list of statements of a source file.
+class ASTModuleNode : public ASTNode {
+  public:
+    Utility::ArenaArray<ASTNode *> body;
+
+    ASTModuleNode(Utility::ArenaArray<ASTNode *> body, Source::Span loc)
+        : ASTNode{ASTNodeKind::Module, loc}, body{body} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent an expression that is
+// used as a statement, such as a call whose result is discarded.
+class ASTExprStmtNode : public ASTNode {
+  public:
+    ASTNode *expr;
+
+    ASTExprStmtNode(ASTNode *expr, Source::Span loc)
+        : ASTNode{ASTNodeKind::ExprStmt, loc}, expr{expr} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent an assignment. Chained
+// assignments such as 'a = b = 0' have several targets.
+class ASTAssignStmtNode : public ASTNode {
+  public:
+    Utility::ArenaArray<ASTNode *> targets;
+    ASTNode *value;
+
+    ASTAssignStmtNode(Utility::ArenaArray<ASTNode *> targets, ASTNode *value,
+                      Source::Span loc)
+        : ASTNode{ASTNodeKind::AssignStmt, loc}, targets{targets},
+          value{value} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent an augmented assignment
+// such as 'a += 1'.
+class ASTAugAssignStmtNode : public ASTNode {
+  public:
+    ASTNode *target;
+
+    // This member is the augmented assignment operator, such as 'PlusEquals'.
+    Parse::TokenKind op;
+
+    ASTNode *value;
+
+    ASTAugAssignStmtNode(ASTNode *target, Parse::TokenKind op, ASTNode *value,
+                         Source::Span loc)
+        : ASTNode{ASTNodeKind::AugAssignStmt, loc}, target{target}, op{op},
+          value{value} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent an annotated assignment
+// such as 'a: int = 1'. The value is optional.
+class ASTAnnAssignStmtNode : public ASTNode {
+  public:
+    ASTNode *target;
+    ASTNode *annotation;
+    ASTNode *value;
+
+    ASTAnnAssignStmtNode(ASTNode *target, ASTNode *annotation, ASTNode *value,
+                         Source::Span loc)
+        : ASTNode{ASTNodeKind::AnnAssignStmt, loc}, target{target},
+          annotation{annotation}, value{value} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent the 'pass' statement.
+class ASTPassStmtNode : public ASTNode {
+  public:
+    explicit ASTPassStmtNode(Source::Span loc)
+        : ASTNode{ASTNodeKind::PassStmt, loc} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent the 'break' statement.
+class ASTBreakStmtNode : public ASTNode {
+  public:
+    explicit ASTBreakStmtNode(Source::Span loc)
+        : ASTNode{ASTNodeKind::BreakStmt, loc} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent the 'continue'
+// statement.
+class ASTContinueStmtNode : public ASTNode {
+  public:
+    explicit ASTContinueStmtNode(Source::Span loc)
+        : ASTNode{ASTNodeKind::ContinueStmt, loc} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent the 'return' statement.
+// The value is optional.
+class ASTReturnStmtNode : public ASTNode {
+  public:
+    ASTNode *value;
+
+    ASTReturnStmtNode(ASTNode *value, Source::Span loc)
+        : ASTNode{ASTNodeKind::ReturnStmt, loc}, value{value} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent the 'del' statement.
+class ASTDelStmtNode : public ASTNode {
+  public:
+    Utility::ArenaArray<ASTNode *> targets;
+
+    ASTDelStmtNode(Utility::ArenaArray<ASTNode *> targets, Source::Span loc)
+        : ASTNode{ASTNodeKind::DelStmt, loc}, targets{targets} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent the 'global' statement.
+class ASTGlobalStmtNode : public ASTNode {
+  public:
+    Utility::ArenaArray<ASTNode *> names;
+
+    ASTGlobalStmtNode(Utility::ArenaArray<ASTNode *> names, Source::Span loc)
+        : ASTNode{ASTNodeKind::GlobalStmt, loc}, names{names} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent the 'nonlocal'
+// statement.
+class ASTNonlocalStmtNode : public ASTNode {
+  public:
+    Utility::ArenaArray<ASTNode *> names;
+
+    ASTNonlocalStmtNode(Utility::ArenaArray<ASTNode *> names, Source::Span loc)
+        : ASTNode{ASTNodeKind::NonlocalStmt, loc}, names{names} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent the 'assert' statement.
+// The message is optional.
+class ASTAssertStmtNode : public ASTNode {
+  public:
+    ASTNode *test;
+    ASTNode *msg;
+
+    ASTAssertStmtNode(ASTNode *test, ASTNode *msg, Source::Span loc)
+        : ASTNode{ASTNodeKind::AssertStmt, loc}, test{test}, msg{msg} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent the 'raise' statement.
+// Both the exception and the cause are optional.
+class ASTRaiseStmtNode : public ASTNode {
+  public:
+    ASTNode *exc;
+    ASTNode *cause;
+
+    ASTRaiseStmtNode(ASTNode *exc, ASTNode *cause, Source::Span loc)
+        : ASTNode{ASTNodeKind::RaiseStmt, loc}, exc{exc}, cause{cause} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent a single imported name
+// along with the optional name it is bound to, as in 'import a.b as c'.
+class ASTImportAliasNode : public ASTNode {
+  public:
+    // This member is a name or an attribute reference for dotted names.
+    ASTNode *name;
+    ASTNode *as_name;
+
+    ASTImportAliasNode(ASTNode *name, ASTNode *as_name, Source::Span loc)
+        : ASTNode{ASTNodeKind::ImportAlias, loc}, name{name},
+          as_name{as_name} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent the 'import' statement.
+class ASTImportStmtNode : public ASTNode {
+  public:
+    Utility::ArenaArray<ASTNode *> names;
+
+    ASTImportStmtNode(Utility::ArenaArray<ASTNode *> names, Source::Span loc)
+        : ASTNode{ASTNodeKind::ImportStmt, loc}, names{names} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent the 'from ... import'
+// statement.
+class ASTImportFromStmtNode : public ASTNode {
+  public:
+    // This member is the number of leading dots of a relative import.
+    uint32_t level;
+
+    // This member is null for imports such as 'from . import a'.
+    ASTNode *module;
+
+    // This member is empty for 'from a import *'.
+    Utility::ArenaArray<ASTNode *> names;
+
+    ASTImportFromStmtNode(uint32_t level, ASTNode *module,
+                          Utility::ArenaArray<ASTNode *> names,
+                          Source::Span loc)
+        : ASTNode{ASTNodeKind::ImportFromStmt, loc}, level{level},
+          module{module}, names{names} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent the 'if' statement. An
+// 'elif' clause is represented as a nested 'if' statement in the else branch.
+class ASTIfStmtNode : public ASTNode {
+  public:
+    ASTNode *test;
+    Utility::ArenaArray<ASTNode *> body;
+    Utility::ArenaArray<ASTNode *> orelse;
+
+    ASTIfStmtNode(ASTNode *test, Utility::ArenaArray<ASTNode *> body,
+                  Utility::ArenaArray<ASTNode *> orelse, Source::Span loc)
+        : ASTNode{ASTNodeKind::IfStmt, loc}, test{test}, body{body},
+          orelse{orelse} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent the 'while' statement.
+class ASTWhileStmtNode : public ASTNode {
+  public:
+    ASTNode *test;
+    Utility::ArenaArray<ASTNode *> body;
+    Utility::ArenaArray<ASTNode *> orelse;
+
+    ASTWhileStmtNode(ASTNode *test, Utility::ArenaArray<ASTNode *> body,
+                     Utility::ArenaArray<ASTNode *> orelse, Source::Span loc)
+        : ASTNode{ASTNodeKind::WhileStmt, loc}, test{test}, body{body},
+          orelse{orelse} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent the 'for' statement,
+// including 'async for'.
+class ASTForStmtNode : public ASTNode {
+  public:
+    bool is_async;
+    ASTNode *target;
+    ASTNode *iter;
+    Utility::ArenaArray<ASTNode *> body;
+    Utility::ArenaArray<ASTNode *> orelse;
+
+    ASTForStmtNode(bool is_async, ASTNode *target, ASTNode *iter,
+                   Utility::ArenaArray<ASTNode *> body,
+                   Utility::ArenaArray<ASTNode *> orelse, Source::Span loc)
+        : ASTNode{ASTNodeKind::ForStmt, loc}, is_async{is_async},
+          target{target}, iter{iter}, body{body}, orelse{orelse} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent an 'except' clause of a
+// 'try' statement. Both the type and the name are optional.
+class ASTExceptHandlerNode : public ASTNode {
+  public:
+    ASTNode *type;
+    ASTNode *name;
+    Utility::ArenaArray<ASTNode *> body;
+
+    ASTExceptHandlerNode(ASTNode *type, ASTNode *name,
+                         Utility::ArenaArray<ASTNode *> body, Source::Span loc)
+        : ASTNode{ASTNodeKind::ExceptHandler, loc}, type{type}, name{name},
+          body{body} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent the 'try' statement.
+class ASTTryStmtNode : public ASTNode {
+  public:
+    Utility::ArenaArray<ASTNode *> body;
+    Utility::ArenaArray<ASTNode *> handlers;
+    Utility::ArenaArray<ASTNode *> orelse;
+    Utility::ArenaArray<ASTNode *> finalbody;
+
+    ASTTryStmtNode(Utility::ArenaArray<ASTNode *> body,
+                   Utility::ArenaArray<ASTNode *> handlers,
+                   Utility::ArenaArray<ASTNode *> orelse,
+                   Utility::ArenaArray<ASTNode *> finalbody, Source::Span loc)
+        : ASTNode{ASTNodeKind::TryStmt, loc}, body{body}, handlers{handlers},
+          orelse{orelse}, finalbody{finalbody} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent a single context manager
+// of a 'with' statement, as in 'open(path) as f'. The target is optional.
+class ASTWithItemNode : public ASTNode {
+  public:
+    ASTNode *context_expr;
+    ASTNode *target;
+
+    ASTWithItemNode(ASTNode *context_expr, ASTNode *target, Source::Span loc)
+        : ASTNode{ASTNodeKind::WithItem, loc}, context_expr{context_expr},
+          target{target} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent the 'with' statement,
+// including 'async with'.
+class ASTWithStmtNode : public ASTNode {
+  public:
+    bool is_async;
+    Utility::ArenaArray<ASTNode *> items;
+    Utility::ArenaArray<ASTNode *> body;
+
+    ASTWithStmtNode(bool is_async, Utility::ArenaArray<ASTNode *> items,
+                    Utility::ArenaArray<ASTNode *> body, Source::Span loc)
+        : ASTNode{ASTNodeKind::WithStmt, loc}, is_async{is_async},
+          items{items}, body{body} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// These are the kinds of entries within the parameter list of a function or a
+// lambda.
+enum class ParamKind : uint8_t {
+    // This is an ordinary parameter, which may have a default value.
+    Normal,
+    // This is the '/' marker that ends the positional-only parameters.
+    PositionalOnlyMarker,
+    // This is the bare '*' marker that begins the keyword-only parameters.
+    KeywordOnlyMarker,
+    // This is a parameter of the form '*args'.
+    VarPositional,
+    // This is a parameter of the form '**kwargs'.
+    VarKeyword,
+};
+
+// This function returns the name of a parameter kind.
+auto param_kind_name(ParamKind kind) -> const char *;
+
+// This class defines the AST Node that will represent a single entry within
+// the parameter list of a function or a lambda. The markers do not have a name,
+// and the annotation and default value are optional. The parameters of a lambda
+// never have an annotation.
+class ASTParamNode : public ASTNode {
+  public:
+    ParamKind param_kind;
+    ASTNode *name;
+    ASTNode *annotation;
+    ASTNode *default_value;
+
+    ASTParamNode(ParamKind param_kind, ASTNode *name, ASTNode *annotation,
+                 ASTNode *default_value, Source::Span loc)
+        : ASTNode{ASTNodeKind::Param, loc}, param_kind{param_kind}, name{name},
+          annotation{annotation}, default_value{default_value} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent a function definition,
+// including 'async def'. The return annotation is optional.
+class ASTFunctionDefNode : public ASTNode {
+  public:
+    bool is_async;
+    Utility::ArenaArray<ASTNode *> decorators;
+    ASTNode *name;
+    Utility::ArenaArray<ASTNode *> params;
+    ASTNode *returns;
+    Utility::ArenaArray<ASTNode *> body;
+
+    ASTFunctionDefNode(bool is_async,
+                       Utility::ArenaArray<ASTNode *> decorators, ASTNode *name,
+                       Utility::ArenaArray<ASTNode *> params, ASTNode *returns,
+                       Utility::ArenaArray<ASTNode *> body, Source::Span loc)
+        : ASTNode{ASTNodeKind::FunctionDef, loc}, is_async{is_async},
+          decorators{decorators}, name{name}, params{params},
+          returns{returns}, body{body} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+
+// This class defines the AST Node that will represent a class definition. The
+// bases may contain keyword arguments such as 'metaclass=M'.
+class ASTClassDefNode : public ASTNode {
+  public:
+    Utility::ArenaArray<ASTNode *> decorators;
+    ASTNode *name;
+    Utility::ArenaArray<ASTNode *> bases;
+    Utility::ArenaArray<ASTNode *> body;
+
+    ASTClassDefNode(Utility::ArenaArray<ASTNode *> decorators, ASTNode *name,
+                    Utility::ArenaArray<ASTNode *> bases,
+                    Utility::ArenaArray<ASTNode *> body, Source::Span loc)
+        : ASTNode{ASTNodeKind::ClassDef, loc}, decorators{decorators},
+          name{name}, bases{bases}, body{body} {}
+
+    virtual auto pretty_print(FILE *result_file, int level) -> void override;
+};
+} // namespace tpy::Tree
+
+#endif
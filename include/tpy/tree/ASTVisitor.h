@@ -0,0 +1,145 @@
+/*
+    This file defines the visitor of the AST, which dispatches on the kind of a
+   node instead of through virtual methods.
+*/
+
+#ifndef TPY_TREE_ASTVISITOR_H
+#define TPY_TREE_ASTVISITOR_H
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "tpy/tree/ASTExpr.h"
+#include "tpy/tree/ASTNode.h"
+#include "tpy/tree/ASTNodeKind.h"
+#include "tpy/tree/ASTStmt.h"
+#include "tpy/utility/ArenaArray.h"
+
+namespace tpy::Tree {
+/*
+    This function calls the callback on every child of the node, in the order of
+   the members of its node class. The missing children are skipped, and the
+   entries of a dict give their key and then their value. The children of every
+   kind come from 'AST_NODE_LIST'.
+*/
+template <class F> auto for_each_child(ASTNode *node, F &&fn) -> void {
+    auto one = [&](ASTNode *child) {
+        if (child) {
+            fn(child);
+        }
+    };
+
+    auto all = [&](const Utility::ArenaArray<ASTNode *> &children) {
+        for (auto *child : children) {
+            one(child);
+        }
+    };
+
+    auto pairs = [&](const Utility::ArenaArray<std::pair<ASTNode *, ASTNode *>>
+                         &entries) {
+        for (auto &[key, value] : entries) {
+            one(key);
+            one(value);
+        }
+    };
+
+    switch (node->kind) {
+#define AST_CHILD(member) one(typed->member);
+#define AST_CHILD_LIST(member) all(typed->member);
+#define AST_CHILD_PAIRS(member) pairs(typed->member);
+#define F(x, children)                                                         \
+    case ASTNodeKind::x: {                                                     \
+        [[maybe_unused]] auto *typed = static_cast<AST##x##Node *>(node);      \
+        children break;                                                        \
+    }
+        AST_NODE_LIST(F)
+#undef F
+#undef AST_CHILD_PAIRS
+#undef AST_CHILD_LIST
+#undef AST_CHILD
+    }
+}
+
+/*
+    This is the base of the visitors of the AST. A visitor derives from it with
+   its own type as the first argument, and defines a 'visit' method for every
+   node class that it is interested in:
+
+        class NameCounter : public ASTVisitor<NameCounter> {
+          public:
+            using ASTVisitor::visit;
+
+            size_t names = 0;
+
+            auto visit(ASTNameExprNode *node) -> void { ++names; }
+        };
+
+    The 'using' declaration keeps the methods of the base for the other node
+   classes, which all call 'visit_default'. The 'visit_node' method switches on
+   the kind of the node and calls the 'visit' method for its class directly on
+   the derived type, so the handlers can be inlined into the switch and no
+   virtual call is made.
+*/
+template <class Derived, class Ret = void> class ASTVisitor {
+    auto derived() -> Derived & { return static_cast<Derived &>(*this); }
+
+  public:
+    // This method calls the handler for the class of the node.
+    auto visit_node(ASTNode *node) -> Ret {
+        switch (node->kind) {
+#define F(x, children)                                                         \
+    case ASTNodeKind::x:                                                       \
+        return derived().visit(static_cast<AST##x##Node *>(node));
+            AST_NODE_LIST(F)
+#undef F
+        }
+
+        return derived().visit_default(node);
+    }
+
+    // This method handles the nodes that the visitor has no handler for. It
+    // returns a value-initialized result, and may be redefined by the visitor.
+    auto visit_default(ASTNode *) -> Ret {
+        if constexpr (!std::is_void_v<Ret>) {
+            return Ret{};
+        }
+    }
+
+#define F(x, children)                                                         \
+    auto visit(AST##x##Node *node) -> Ret {                                    \
+        return derived().visit_default(node);                                  \
+    }
+    AST_NODE_LIST(F)
+#undef F
+
+    /*
+        This method visits every node of the tree with the given root in
+       pre-order, so a node is visited before its children and the children in
+       the order of 'for_each_child'. An explicit stack is used, as the trees of
+       long operator chains are far too deep for recursion.
+    */
+    auto traverse(ASTNode *root) -> void {
+        std::vector<ASTNode *> stack;
+        if (root) {
+            stack.push_back(root);
+        }
+
+        while (!stack.empty()) {
+            auto *node = stack.back();
+            stack.pop_back();
+
+            visit_node(node);
+
+            // The children are pushed in reverse, so the first one is on top.
+            auto first = stack.size();
+            for_each_child(node,
+                           [&](ASTNode *child) { stack.push_back(child); });
+            std::reverse(stack.begin() + first, stack.end());
+        }
+    }
+};
+} // namespace tpy::Tree
+
+#endif
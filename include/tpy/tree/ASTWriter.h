@@ -0,0 +1,89 @@
+/*
+    This file defines the writer that dumps the AST as JSON or as compact
+   S-expressions.
+*/
+
+#ifndef TPY_TREE_ASTWRITER_H
+#define TPY_TREE_ASTWRITER_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "tpy/tree/ASTNode.h"
+#include "tpy/utility/OutputBuffer.h"
+
+namespace tpy::Tree {
+// These are the output formats of the writer.
+enum class ASTFormat {
+    // Every node is an object with its kind, its span, its scalar members, and
+    // its children, indented by two spaces per level. Missing children are
+    // 'null', and empty lists are '[]'.
+    JSON,
+    // Every node is a list of its kind, its start and end, and then its
+    // members as ':name value' pairs, all on one line. Lists of children are
+    // within '[]', and missing children and empty lists are left out.
+    SExpr,
+};
+
+/*
+    The writer prints the same information as 'pretty_print', but gathers its
+   output in an 'OutputBuffer', so a whole tree is written with one system
+   call per chunk instead of a library call per character. Indentation is
+   copied from a run of spaces, and integers are formatted without the locale.
+
+    The tree is walked with an explicit stack of pending pieces of output,
+   so it can be arbitrarily deep.
+*/
+class ASTWriter {
+    Utility::OutputBuffer &out;
+    ASTFormat format;
+
+    // This is what comes before a piece of output.
+    enum class Separator : uint8_t {
+        // Nothing comes before the piece.
+        None,
+        // This is the first piece within a node or a list.
+        First,
+        // This is any other piece within a node or a list.
+        Next,
+        // The piece closes a node or a list.
+        Close,
+    };
+
+    // This is a piece of output that has yet to be written.
+    struct Item {
+        enum class Kind : uint8_t { Node, Label, Text } kind;
+        Separator separator;
+        uint32_t depth;
+
+        // This is the node of a 'Node' item, which may be null.
+        ASTNode *node;
+
+        // This is the text of a 'Label' or a 'Text' item.
+        const char *text;
+    };
+
+    std::vector<Item> stack;
+
+    auto write_separator(Separator separator, uint32_t depth) -> void;
+
+    // This method writes the text as a JSON string, with the quotes and the
+    // control characters escaped.
+    auto write_json_string(std::string_view text) -> void;
+
+    // This method writes the kind, the span, and the scalar members of the
+    // node, and pushes the pieces of its children.
+    auto write_node(ASTNode *node, uint32_t depth) -> void;
+
+  public:
+    ASTWriter(Utility::OutputBuffer &out, ASTFormat format)
+        : out{out}, format{format} {}
+
+    // This method writes the tree with the given root, followed by a newline.
+    // A null root is written as 'null' or 'nil'.
+    auto write(ASTNode *root) -> void;
+};
+} // namespace tpy::Tree
+
+#endif
@@ -0,0 +1,65 @@
+/*
+    This file defines the constant folding pass, which evaluates the operators
+   whose operands are all literals while the program is being analyzed.
+*/
+
+#ifndef TPY_TREE_CONSTANTFOLDER_H
+#define TPY_TREE_CONSTANTFOLDER_H
+
+#include <cstddef>
+
+#include "tpy/source/SourceFile.h"
+#include "tpy/tree/ASTNode.h"
+#include "tpy/utility/ArenaAllocator.h"
+
+namespace tpy::Tree {
+/*
+    The constant folder replaces every unary and binary operator whose operands
+   are constants by a node that holds its value, so that '60 * 60 * 24' becomes
+   a single 'ASTConstantExprNode' for 86400. Adjacent string or bytes literals
+   are joined into one constant in the same way. The operands are folded
+   first, so nested operators are folded all the way up, and the parentheses
+   around a constant are looked through.
+
+    The values follow Python exactly: integers have arbitrary precision, floats
+   are IEEE doubles, and booleans act as integers. An operator is never folded
+   if evaluating it would raise, as in '1 / 0' or '1 << -1', so the error
+   still happens when the program runs. The folded values are bounded in the
+   same way as in CPython, so an expression such as "'a' * 10**9" is kept as it
+   is rather than materialized. Comparisons are not folded, as the parser does
+   not tell a chained comparison apart from a parenthesized one.
+
+    The tree is modified in place, and the new nodes are allocated within the
+   given arena. Each new node has the span of the expression that it replaces.
+*/
+class ConstantFolder {
+    Source::SourceFile *src_file;
+    Utility::ArenaAllocator &arena;
+
+    size_t num_folded = 0;
+
+    // This method returns the folded node for a node whose children have
+    // already been folded, or null if it cannot be folded.
+    auto fold_node(ASTNode *node) -> ASTNode *;
+
+  public:
+    // These are the largest results that are folded: integers of up to 128
+    // bits, and strings and bytes of up to 4096 bytes.
+    static constexpr size_t MAX_INT_BITS = 128;
+    static constexpr size_t MAX_TEXT_SIZE = 4096;
+
+    ConstantFolder(Source::SourceFile *src_file, Utility::ArenaAllocator &arena)
+        : src_file{src_file}, arena{arena} {}
+
+    // This method folds the tree with the given root, and returns the new
+    // root, which is a different node if the root itself was folded. The tree
+    // is walked with an explicit stack, so it can be arbitrarily deep.
+    auto fold(ASTNode *root) -> ASTNode *;
+
+    // This is the number of operators and adjacent literals that have been
+    // folded.
+    auto folded_count() const -> size_t { return num_folded; }
+};
+} // namespace tpy::Tree
+
+#endif
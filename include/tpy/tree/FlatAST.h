@@ -0,0 +1,230 @@
+/*
+    This file defines the flat representation of the AST, which stores the nodes
+   in columns and refers to them by index.
+*/
+
+#ifndef TPY_TREE_FLATAST_H
+#define TPY_TREE_FLATAST_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "tpy/source/Span.h"
+#include "tpy/tree/ASTNode.h"
+#include "tpy/tree/ASTNodeKind.h"
+#include "tpy/utility/ArenaAllocator.h"
+
+namespace tpy::Tree {
+/*
+    This is a read-only view of the columns of a flat AST. It does not own the
+   columns, so it can look at a tree that is held by a 'FlatAST' as well as one
+   that has been mapped in from a cache file.
+*/
+class FlatASTView {
+  public:
+    using NodeIndex = uint32_t;
+
+    static constexpr NodeIndex NO_NODE = UINT32_MAX;
+
+    /*
+        This is a view of a list of child nodes within the shared array.
+    */
+    class NodeList {
+        const NodeIndex *elements = nullptr;
+        uint32_t count = 0;
+
+      public:
+        NodeList(const NodeIndex *elements, uint32_t count)
+            : elements{elements}, count{count} {}
+
+        auto begin() const -> const NodeIndex * { return elements; }
+
+        auto end() const -> const NodeIndex * { return elements + count; }
+
+        auto size() const -> size_t { return count; }
+
+        auto operator[](size_t i) const -> NodeIndex { return elements[i]; }
+    };
+
+    const ASTNodeKind *kinds = nullptr;
+    const uint32_t *positions = nullptr;
+    const uint32_t *lens = nullptr;
+    const uint32_t *payloads = nullptr;
+    const uint32_t *fields = nullptr;
+    const NodeIndex *children = nullptr;
+    const std::pair<uint32_t, uint32_t> *fstring_segments = nullptr;
+    const uint32_t *constants = nullptr;
+    size_t num_nodes = 0;
+    size_t num_children = 0;
+    size_t num_fstrings = 0;
+    size_t num_constant_words = 0;
+    size_t absolute_offset = 0;
+
+    auto size() const -> size_t { return num_nodes; }
+
+    auto root() const -> NodeIndex { return num_nodes == 0 ? NO_NODE : 0; }
+
+    auto kind(NodeIndex node) const -> ASTNodeKind { return kinds[node]; }
+
+    auto loc(NodeIndex node) const -> Source::Span {
+        return Source::Span{positions[node], positions[node] + absolute_offset,
+                            lens[node]};
+    }
+
+    auto payload(NodeIndex node) const -> uint32_t { return payloads[node]; }
+
+    auto child(NodeIndex node, size_t field) const -> NodeIndex {
+        return children[fields[node] + field];
+    }
+
+    auto list(NodeIndex node, size_t field) const -> NodeList {
+        auto pos = children[fields[node] + field];
+        return NodeList{children + pos + 1, children[pos]};
+    }
+
+    auto fstring_segment_range(NodeIndex node) const
+        -> std::pair<uint32_t, uint32_t> {
+        return fstring_segments[payloads[node]];
+    }
+
+    // This method returns the words of the value of a constant node, starting
+    // with the word of its type and its sign.
+    auto constant_words(NodeIndex node) const -> const uint32_t * {
+        return constants + payloads[node];
+    }
+
+    // This method rebuilds the 'ASTNode' objects of the tree within the given
+    // arena, and returns the root. It returns null if the tree is empty.
+    auto to_tree(Utility::ArenaAllocator &arena) const -> ASTNode *;
+};
+
+/*
+    The flat AST holds the same tree as the 'ASTNode' objects, but every node is
+   a 32-bit index into a set of columns instead of an object of its own. The
+   columns are plain arrays without any pointers, so the tree can be copied,
+   moved or written out byte for byte.
+
+    Each node has a kind, a span, a payload, and a run of fields within the
+   shared 'children' array. The fields of a kind are in the same order as the
+   members of its node class, and each one is a single 32-bit slot:
+
+    - A child node is the index of the child, or 'NO_NODE' if it is missing.
+    - A list of child nodes is the position within 'children' of its length,
+      which is followed by its elements. The entries of a dict are stored as a
+      list with the key and the value of each entry one after the other.
+
+    The payload holds the scalar member of the node: the base of an integer,
+   the value of a boolean, the operator of an expression or an augmented
+   assignment, the bracket of a comprehension, the flag of a 'yield from' or of
+   an 'async' statement or clause, the level of a 'from ... import', or the
+   kind of a parameter.
+   For an f-string, it is the index of its range of segments within a column
+   of its own. For a folded constant, it is the position of its value within
+   the column of constants, where a word with the type and the sign and a word
+   with the length are followed by the digits of an integer, the two words of
+   the bits of a float, or the bytes of a string packed four to a word. The
+   length counts the digits, the words of the float, or the bytes. The nodes
+   are numbered in pre-order, so the root is always 0 and every child comes
+   after its parent.
+*/
+class FlatAST {
+  public:
+    using NodeIndex = FlatASTView::NodeIndex;
+    using NodeList = FlatASTView::NodeList;
+
+    static constexpr NodeIndex NO_NODE = FlatASTView::NO_NODE;
+
+  private:
+    // These columns hold one entry for every node.
+    std::vector<ASTNodeKind> kinds;
+    std::vector<uint32_t> positions, lens;
+    std::vector<uint32_t> payloads;
+
+    // This is the position of the first field of every node within the shared
+    // array.
+    std::vector<uint32_t> fields;
+
+    // This is the shared array of fields, lists, and their elements.
+    std::vector<NodeIndex> children;
+
+    // These are the ranges of segments of the f-strings.
+    std::vector<std::pair<uint32_t, uint32_t>> fstring_segments;
+
+    // These are the values of the folded constants.
+    std::vector<uint32_t> constants;
+
+    // The spans only store the local position. The absolute position is the
+    // same distance from it for every node of a tree.
+    size_t absolute_offset = 0;
+
+    // This method adds a node to the columns, and returns its index. Its
+    // children are added to the pending list, along with the slots that their
+    // indices go into.
+    auto add_node(ASTNode *node,
+                  std::vector<std::pair<ASTNode *, uint32_t>> &pending)
+        -> NodeIndex;
+
+  public:
+    // This method flattens the tree with the given root. The tree is walked
+    // with an explicit stack, so it can be arbitrarily deep.
+    static auto from_tree(ASTNode *root) -> FlatAST;
+
+    // This method rebuilds the 'ASTNode' objects of the tree within the given
+    // arena, and returns the root. It returns null if the tree is empty.
+    auto to_tree(Utility::ArenaAllocator &arena) const -> ASTNode * {
+        return view().to_tree(arena);
+    }
+
+    auto view() const -> FlatASTView {
+        return FlatASTView{kinds.data(),
+                           positions.data(),
+                           lens.data(),
+                           payloads.data(),
+                           fields.data(),
+                           children.data(),
+                           fstring_segments.data(),
+                           constants.data(),
+                           kinds.size(),
+                           children.size(),
+                           fstring_segments.size(),
+                           constants.size(),
+                           absolute_offset};
+    }
+
+    auto size() const -> size_t { return kinds.size(); }
+
+    auto root() const -> NodeIndex { return kinds.empty() ? NO_NODE : 0; }
+
+    auto kind(NodeIndex node) const -> ASTNodeKind { return kinds[node]; }
+
+    auto loc(NodeIndex node) const -> Source::Span {
+        return Source::Span{positions[node], positions[node] + absolute_offset,
+                            lens[node]};
+    }
+
+    auto payload(NodeIndex node) const -> uint32_t { return payloads[node]; }
+
+    // This method returns the child in the given field of the node.
+    auto child(NodeIndex node, size_t field) const -> NodeIndex {
+        return children[fields[node] + field];
+    }
+
+    // This method returns the list of children in the given field of the node.
+    auto list(NodeIndex node, size_t field) const -> NodeList {
+        auto pos = children[fields[node] + field];
+        return NodeList{children.data() + pos + 1, children[pos]};
+    }
+
+    // This method returns the range of segments of an f-string node.
+    auto fstring_segment_range(NodeIndex node) const
+        -> std::pair<uint32_t, uint32_t> {
+        return fstring_segments[payloads[node]];
+    }
+
+    // This method returns the number of bytes that the columns take up.
+    auto memory_size() const -> size_t;
+};
+} // namespace tpy::Tree
+
+#endif
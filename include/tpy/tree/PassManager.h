@@ -0,0 +1,270 @@
+/*
+    This file defines the pass manager, which runs several passes over the AST
+   in a single traversal.
+*/
+
+#ifndef TPY_TREE_PASSMANAGER_H
+#define TPY_TREE_PASSMANAGER_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "tpy/tree/ASTNode.h"
+#include "tpy/tree/ASTVisitor.h"
+
+namespace tpy::Tree {
+/*
+    This is the base of the passes. It ignores every node, so a pass only needs
+   to define the hooks that it is interested in. A pass usually dispatches on
+   the kind of the node with an 'ASTVisitor'. The hooks are called on the type
+   of the pass itself, so that they can be inlined into the traversal.
+*/
+class ASTPass {
+  public:
+    // This is the name of the pass within the timing report.
+    static constexpr const char *NAME = "pass";
+
+    // A pass that sets this may have its hooks called for different subtrees
+    // on several threads at once, so it must guard its own state.
+    static constexpr bool THREAD_SAFE = false;
+
+    // This hook is called before the children of the node are visited.
+    auto enter(ASTNode *) -> void {}
+
+    // This hook is called after the children of the node have been visited.
+    auto leave(ASTNode *) -> void {}
+};
+
+/*
+    Every analysis that walks the whole tree by itself brings the whole tree
+   through the cache again. The pass manager instead walks the tree once, and
+   calls the hooks of every pass at each node, in the order that the passes
+   were given in. Each pass still sees the nodes in pre-order for 'enter' and
+   post-order for 'leave', exactly as if it ran on its own.
+
+    With more than one thread, the passes that are marked as thread-safe run on
+   the subtrees of the children of the root in parallel. The calling thread
+   takes part as well, and runs the other passes over the whole tree in order.
+   A thread-safe pass then sees the subtrees in no particular order, but the
+   root is still entered before and left after all of them.
+
+    The time that is spent within the hooks of every pass can be measured as
+   well. This reads the clock around every hook, so it is off by default. The
+   times of the thread-safe passes are summed over all threads.
+*/
+template <class... Passes> class PassManager {
+    static constexpr size_t NUM_PASSES = sizeof...(Passes);
+
+    using Times = std::array<double, NUM_PASSES>;
+    using Clock = std::chrono::steady_clock;
+
+    // These are the passes that a traversal calls the hooks of.
+    enum class Selection { All, ThreadSafe, NotThreadSafe };
+
+    std::tuple<Passes &...> passes;
+    size_t num_threads = 1;
+    bool timed = false;
+
+    // These are the times of the last run, in seconds.
+    Times pass_times{};
+    double total_time = 0;
+
+    template <Selection S, class Pass> static constexpr auto selects() -> bool {
+        if constexpr (S == Selection::All) {
+            return true;
+        } else {
+            return Pass::THREAD_SAFE == (S == Selection::ThreadSafe);
+        }
+    }
+
+    template <Selection S, bool Enter, size_t I>
+    auto call_hook(ASTNode *node, Times &times) -> void {
+        auto &pass = std::get<I>(passes);
+
+        if constexpr (selects<S, std::remove_reference_t<decltype(pass)>>()) {
+            auto hook = [&]() {
+                if constexpr (Enter) {
+                    pass.enter(node);
+                } else {
+                    pass.leave(node);
+                }
+            };
+
+            if (!timed) {
+                hook();
+                return;
+            }
+
+            auto start = Clock::now();
+            hook();
+            times[I] += std::chrono::duration<double>(Clock::now() - start)
+                            .count();
+        }
+    }
+
+    template <Selection S, bool Enter, size_t... I>
+    auto call_hooks(ASTNode *node, Times &times, std::index_sequence<I...>)
+        -> void {
+        (call_hook<S, Enter, I>(node, times), ...);
+    }
+
+    template <Selection S, bool Enter>
+    auto call_hooks(ASTNode *node, Times &times) -> void {
+        call_hooks<S, Enter>(node, times, std::index_sequence_for<Passes...>{});
+    }
+
+    // This method walks the tree with the given root with an explicit stack,
+    // as the trees of long operator chains are far too deep for recursion.
+    template <Selection S> auto walk(ASTNode *root, Times &times) -> void {
+        // The second member tells whether the node is being left.
+        std::vector<std::pair<ASTNode *, bool>> stack{{root, false}};
+
+        while (!stack.empty()) {
+            auto [node, leaving] = stack.back();
+            stack.pop_back();
+
+            if (leaving) {
+                call_hooks<S, false>(node, times);
+                continue;
+            }
+
+            call_hooks<S, true>(node, times);
+            stack.emplace_back(node, true);
+
+            // The children are pushed in reverse, so the first one is on top.
+            auto first = stack.size();
+            for_each_child(node, [&](ASTNode *child) {
+                stack.emplace_back(child, false);
+            });
+            std::reverse(stack.begin() + first, stack.end());
+        }
+    }
+
+    auto run_parallel(ASTNode *root) -> void {
+        constexpr bool has_serial_passes = (!Passes::THREAD_SAFE || ...);
+
+        std::vector<ASTNode *> subtrees;
+        for_each_child(root,
+                       [&](ASTNode *child) { subtrees.push_back(child); });
+
+        // Every subtree is claimed by exactly one thread, which runs the
+        // thread-safe passes over it. The calling thread claims them from the
+        // front, in order, and the workers claim them from the back, one at a
+        // time, so that a few large definitions do not leave anyone idle.
+        std::vector<std::atomic<bool>> claimed(subtrees.size());
+        std::atomic<size_t> next_from_back = 0;
+        std::vector<Times> worker_times(num_threads, Times{});
+
+        auto work = [this, &subtrees, &claimed, &next_from_back](Times &times) {
+            for (auto k = next_from_back++; k < subtrees.size();
+                 k = next_from_back++) {
+                auto i = subtrees.size() - 1 - k;
+
+                // The calling thread has reached this subtree, and so it has
+                // claimed every one before it as well.
+                if (claimed[i].exchange(true)) {
+                    break;
+                }
+
+                walk<Selection::ThreadSafe>(subtrees[i], times);
+            }
+        };
+
+        call_hooks<Selection::All, true>(root, pass_times);
+
+        std::vector<std::thread> workers;
+        for (size_t k = 1; k < num_threads; k++) {
+            workers.emplace_back(work, std::ref(worker_times[k]));
+        }
+
+        // The calling thread runs every pass over the subtrees that it claims
+        // in a single walk. The passes that are not thread-safe must still
+        // see every subtree in order, so it walks the subtrees that a worker
+        // has claimed a second time for those passes alone.
+        for (size_t i = 0; i < subtrees.size(); i++) {
+            if (!claimed[i].exchange(true)) {
+                walk<Selection::All>(subtrees[i], pass_times);
+            } else if constexpr (has_serial_passes) {
+                walk<Selection::NotThreadSafe>(subtrees[i], pass_times);
+            }
+        }
+
+        for (auto &worker : workers) {
+            worker.join();
+        }
+
+        call_hooks<Selection::All, false>(root, pass_times);
+
+        for (auto &times : worker_times) {
+            for (size_t i = 0; i < NUM_PASSES; i++) {
+                pass_times[i] += times[i];
+            }
+        }
+    }
+
+  public:
+    explicit PassManager(Passes &...passes) : passes{passes...} {}
+
+    // This method sets the number of threads that the thread-safe passes may
+    // run on. The passes are run on the calling thread alone by default. When
+    // some of the passes are not thread-safe, the subtrees that other threads
+    // take are walked twice, once by their thread for the thread-safe passes
+    // and once by the calling thread for the rest. This only pays off when the
+    // thread-safe passes are the costly ones.
+    auto set_num_threads(size_t num_threads) -> void {
+        this->num_threads = std::max<size_t>(1, num_threads);
+    }
+
+    // This method sets whether the time within the hooks of every pass is
+    // measured.
+    auto set_timed(bool timed) -> void { this->timed = timed; }
+
+    // This method runs all of the passes over the tree with the given root.
+    auto run(ASTNode *root) -> void {
+        constexpr bool has_parallel_passes = (Passes::THREAD_SAFE || ...);
+
+        auto start = Clock::now();
+        pass_times.fill(0);
+
+        if (root) {
+            if (has_parallel_passes && num_threads > 1) {
+                run_parallel(root);
+            } else {
+                walk<Selection::All>(root, pass_times);
+            }
+        }
+
+        total_time =
+            std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // This method returns the time that the last run spent within the hooks
+    // of the pass with the given index, in seconds. It is zero unless the
+    // passes are timed.
+    auto pass_time(size_t i) const -> double { return pass_times[i]; }
+
+    // This method returns the time that the last run took, in seconds.
+    auto run_time() const -> double { return total_time; }
+
+    // This method prints the times of the last run, one line per pass.
+    auto print_report(FILE *result_file) const -> void {
+        const char *names[] = {Passes::NAME...};
+
+        fprintf(result_file, "%-24s %12s\n", "pass", "time (ms)");
+        for (size_t i = 0; i < NUM_PASSES; i++) {
+            fprintf(result_file, "%-24s %12.3f\n", names[i],
+                    pass_times[i] * 1000);
+        }
+        fprintf(result_file, "%-24s %12.3f\n", "total", total_time * 1000);
+    }
+};
+} // namespace tpy::Tree
+
+#endif
@@ -0,0 +1,127 @@
+/*
+    This file defines the structural hash of the AST and the hash-consing of
+   identical subtrees.
+*/
+
+#ifndef TPY_TREE_STRUCTURALHASH_H
+#define TPY_TREE_STRUCTURALHASH_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+#include <vector>
+
+#include "tpy/source/SourceFile.h"
+#include "tpy/tree/ASTNode.h"
+#include "tpy/utility/ArenaAllocator.h"
+
+namespace tpy::Tree {
+/*
+    The structural hash of a node covers its kind, its scalar members, the
+   source text of names and literals, and the hashes of its children, but not
+   its span. Two subtrees that are written the same way therefore have the
+   same hash wherever they are within the file.
+
+    The hash of a node is built from the hashes of its children, so the nodes
+   are hashed bottom-up. The result is stored in the 'hash' member of every
+   node. The parser builds the tree bottom-up as well, so a hasher that is
+   attached to it hashes every node as it is made, and the tree never has to be
+   walked for it.
+*/
+class StructuralHasher {
+    Source::SourceFile *src_file;
+
+    // This method returns the source text of a name or a literal, or an empty
+    // view for any other node.
+    auto text_of(ASTNode *node) const -> std::string_view;
+
+  public:
+    explicit StructuralHasher(Source::SourceFile *src_file)
+        : src_file{src_file} {}
+
+    // This method hashes every node of the tree with the given root, and
+    // returns the hash of the root. The tree is walked with an explicit stack,
+    // so it can be arbitrarily deep.
+    auto hash_tree(ASTNode *root) -> uint32_t;
+
+    // This method hashes a single node, whose children must have been hashed
+    // already.
+    auto hash_node(ASTNode *node) -> uint32_t;
+
+    // This method tells whether two nodes are identical, given that identical
+    // children have already been replaced by the same node. The children are
+    // therefore compared by address, so the check does not descend.
+    auto same_node(ASTNode *lhs, ASTNode *rhs) const -> bool;
+};
+
+/*
+    The hash-conser shares identical subtrees within the trees of a file. Every
+   subtree that is identical to one that has been seen before is replaced by
+   that one, so the tree becomes a DAG in which each distinct subtree appears
+   once. Nothing within the AST is modified after parsing, so the shared
+   subtrees can be used from all of their parents.
+
+    A shared subtree keeps the span of its first occurrence, so passes that
+   report locations should use the span of the parent where it matters. Error
+   nodes are never shared.
+*/
+class HashConser {
+    StructuralHasher hasher;
+
+    // This is an open-addressing table of the distinct nodes, keyed by their
+    // hash. Its size is always a power of two.
+    std::vector<ASTNode *> table;
+    size_t num_distinct = 0;
+
+    size_t num_nodes = 0;
+    size_t num_shared = 0;
+    size_t bytes_total = 0;
+    size_t bytes_shared = 0;
+
+    // This method returns the node that is identical to the given one, which
+    // is added to the table if there is none.
+    auto find_or_insert(ASTNode *node) -> ASTNode *;
+
+    auto grow() -> void;
+
+  public:
+    explicit HashConser(Source::SourceFile *src_file)
+        : hasher{src_file}, table(1024, nullptr) {}
+
+    // This method hashes the tree with the given root and shares its identical
+    // subtrees with each other and with the trees that have been interned
+    // before. It returns the new root, which is the root itself unless an
+    // identical tree has been interned before. A tree that was hashed while it
+    // was parsed is not hashed again.
+    auto intern(ASTNode *root, bool is_hashed = false) -> ASTNode *;
+
+    // This is the number of nodes that have been interned.
+    auto node_count() const -> size_t { return num_nodes; }
+
+    // This is the number of nodes that were replaced by an identical one.
+    auto shared_count() const -> size_t { return num_shared; }
+
+    // This is the fraction of the nodes that were replaced.
+    auto dedup_ratio() const -> double {
+        return num_nodes == 0 ? 0.0
+                              : static_cast<double>(num_shared) / num_nodes;
+    }
+
+    // These are the bytes of the nodes and their lists before interning, and
+    // the bytes of those that were replaced.
+    auto total_bytes() const -> size_t { return bytes_total; }
+
+    auto shared_bytes() const -> size_t { return bytes_shared; }
+
+    // This method prints the numbers above.
+    auto print_report(FILE *file) const -> void;
+};
+
+// This function copies the tree with the given root into the arena. A subtree
+// that is shared by several parents is copied once and stays shared, so an
+// interned tree takes up only the memory of its distinct nodes once the arena
+// that it was parsed into is released.
+auto copy_tree(ASTNode *root, Utility::ArenaAllocator &arena) -> ASTNode *;
+} // namespace tpy::Tree
+
+#endif
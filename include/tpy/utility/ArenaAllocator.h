@@ -5,45 +5,285 @@
 #ifndef TPY_UTILITY_ARENAALLOCATOR
 #define TPY_UTILITY_ARENAALLOCATOR
 
-#include <forward_list>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
 #include <memory>
 #include <new>
+#include <type_traits>
+#include <utility>
+
+#include "tpy/utility/ArenaArray.h"
+#include "tpy/utility/SlabPool.h"
+
+#ifdef TPY_ARENA_STATS
+#include "tpy/utility/ArenaStats.h"
+#endif
 
 namespace tpy::Utility {
 /*
     This is a simple arena allocator that uses the default C++ allocator under
    the hood.
+
+    The memory is handed out from slabs by bumping a pointer, which is first
+   rounded up to the alignment of the allocation. The first slab has the size
+   that the arena was created with, and every later slab is twice as large as
+   the one before it, up to a cap, so a big file needs only a few dozen calls
+   to the system allocator. An allocation that would take up more than half of
+   a slab gets a slab of its own instead, which is placed behind the current
+   slab so that the free space of the current slab is not lost.
+
+    No slab is allocated until the first allocation, so an arena that is never
+   used costs nothing.
+
+    A long-lived arena can give its memory back without being destroyed. A
+   mark taken with 'mark' can be rewound to with 'release_to', which frees
+   everything allocated after it, and 'reset' frees everything but keeps a
+   few slabs to be used again. The slabs that are freed go to the slab pool
+   of the arena if it has one, which other arenas take their slabs from.
+
+    Objects that are trivially destructible are never destroyed, as their
+   memory is simply given back. The destructor of any other object is recorded
+   within the arena when it is allocated, and the recorded destructors are run
+   in the reverse order of construction when the arena is rewound past them,
+   reset or destroyed.
+
+    An arena is not shared between threads. Instead, every thread allocates
+   from an arena of its own, and the arenas of the threads are spliced into
+   the arena that outlives them once they are done. Splicing hands over all of
+   the slabs and the recorded destructors at once, without copying or walking
+   any of them.
+
+    An arena that holds a large tree can take its slabs from huge pages, which
+   cuts down on the misses of the TLB when the tree is walked. Every slab then
+   takes up whole huge pages, so this is only worth it for large files. Where
+   huge pages are not available, the arena falls back to regular memory.
+
+    When tpy is built with 'TPY_ARENA_STATS', every arena counts where its
+   memory goes, down to the types of the objects within it.
+
+    A pass that replaces nodes can give the memory of the old ones back with
+   'deallocate'. The freed blocks are kept in lists by their size, and a later
+   object of the same size takes the place of one of them instead of being
+   bumped, so a pipeline of passes stays close to the size of the live tree.
+   Rewinding or resetting the arena drops these lists.
 */
 class ArenaAllocator {
-    using ArenaSlab = std::unique_ptr<std::byte[]>;
+    // This is the header at the start of every slab. The slabs form singly
+    // linked lists: the regular slabs with the current slab first, the
+    // dedicated slabs of large allocations, and the spare slabs that were kept
+    // by a reset. A slab that is mapped from huge pages is unmapped rather
+    // than freed.
+    struct Slab {
+        Slab *next;
+        size_t size;
+        bool huge;
+    };
+
+    // This is the record of an object whose destructor has to be run. The
+    // records are allocated within the arena and form a list with the newest
+    // object first.
+    struct DestructorRecord {
+        DestructorRecord *next;
+        void (*destroy)(void *);
+        void *object;
+    };
+
+    // This is a block that was given back. Its first bytes link it to the
+    // next free block of the same size class.
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    // The free blocks are sorted into classes by their size, in steps of the
+    // size of a pointer, up to the size of the largest nodes. Every block is
+    // aligned to at least a step.
+    static constexpr size_t SIZE_CLASS_STEP = sizeof(FreeBlock);
+    static constexpr size_t NUM_SIZE_CLASSES = 32;
+
+    // An object takes a block from the class of its size rounded up, and a
+    // freed block goes into the class of its size rounded down, so every block
+    // is large enough for everything that takes it.
+    static constexpr auto class_to_take(size_t size) -> size_t {
+        return (size + SIZE_CLASS_STEP - 1) / SIZE_CLASS_STEP - 1;
+    }
+
+    static constexpr auto class_to_free(size_t size) -> size_t {
+        return size / SIZE_CLASS_STEP - 1;
+    }
+
+  public:
+    // These are the kinds of pages that an arena can take its slabs from.
+    enum class SlabPages : uint8_t { Regular, Huge };
+
+    /*
+        This is a point within the arena that it can be rewound to. It is
+       only valid until the arena is rewound to an earlier point or reset.
+    */
+    class Mark {
+        friend class ArenaAllocator;
+
+        Slab *slab;
+        std::byte *pos;
+        Slab *large_slab;
+        DestructorRecord *destructor;
+
+        Mark(Slab *slab, std::byte *pos, Slab *large_slab,
+             DestructorRecord *destructor)
+            : slab{slab}, pos{pos}, large_slab{large_slab},
+              destructor{destructor} {}
+    };
 
-    // In order to allow easily expanding the amount of slabs, we will use a
-    // singly linked list.
-    std::forward_list<ArenaSlab> slabs;
+  private:
+    // This is the offset of the usable memory within a slab, which keeps the
+    // memory of a new slab aligned for any fundamental type.
+    static constexpr size_t SLAB_HEADER_SIZE =
+        (sizeof(Slab) + alignof(std::max_align_t) - 1) &
+        ~(alignof(std::max_align_t) - 1);
+
+    Slab *slabs = nullptr;
+    Slab *large_slabs = nullptr;
+    Slab *spare_slabs = nullptr;
+
+    DestructorRecord *destructors = nullptr;
+
+    // These are the last entries of the lists above, which are the oldest
+    // ones. They are kept so that the lists can be spliced into another arena
+    // without walking them.
+    Slab *oldest_slab = nullptr;
+    Slab *oldest_large_slab = nullptr;
+    DestructorRecord *oldest_destructor = nullptr;
+
+    // This is where the slabs come from and go to, if it is not null.
+    SlabPool *pool;
+
+    SlabPages pages;
 
     // We also need 2 pointers: one to the current point in the current slab,
     // and one to the end of the current slab.
-    std::byte *current_pos, *end_of_current_slab;
+    std::byte *current_pos = nullptr, *end_of_current_slab = nullptr;
 
-    // This is the size of each slab in the allocator.
+    // This is the size of the next regular slab, which doubles every time
+    // that a regular slab is created until it reaches the cap.
     size_t slab_size;
 
+    size_t num_slabs = 0;
+    size_t total_capacity = 0;
+
+    // This is the list of free blocks of every size class, where class 'i'
+    // holds blocks of at least '(i + 1) * SIZE_CLASS_STEP' bytes.
+    std::array<FreeBlock *, NUM_SIZE_CLASSES> free_blocks{};
+
+#ifdef TPY_ARENA_STATS
+    ArenaStats stats;
+#endif
+
     /*
-        This method will allocate a new slab of memory and add it to the list of
-       slabs.
+        This method will allocate a new slab of memory, from the pool if it
+       can. It returns the slab, whose memory starts 'SLAB_HEADER_SIZE' bytes
+       after it. The slab is not linked into any list yet.
     */
-    auto create_new_slab() -> void;
+    auto create_new_slab(size_t size) -> Slab *;
+
+    // This method gives a slab back to the pool, or to the system.
+    auto free_slab(Slab *slab) -> void;
+
+    // This method frees the slabs of a list up to the given one.
+    auto free_slabs(Slab *&list, Slab *until) -> void;
+
+    // This method allocates memory when it does not fit into the current slab,
+    // either from a new regular slab or from a dedicated one.
+    auto allocate_slow(size_t size, size_t align) -> void *;
+
+    // This method runs the recorded destructors up to the given record, the
+    // newest first.
+    auto run_destructors(DestructorRecord *until) -> void;
+
+    auto release_slabs() -> void;
 
     // This method provides the default size of a memory slab.
     static constexpr auto GET_DEFAULT_SLAB_SIZE() -> size_t { return 4096; }
 
   public:
-    explicit ArenaAllocator(size_t slab_size) : slab_size{slab_size} {
-        create_new_slab();
-    }
+    // This is the largest size that the regular slabs grow to. An arena that
+    // is created with larger slabs keeps their size.
+    static constexpr auto GET_MAX_SLAB_SIZE() -> size_t { return 1 << 20; }
+
+    // This is true for the types whose destructors are recorded, which makes
+    // their allocation slower and takes up more memory. A type that is meant
+    // to be allocated in bulk can assert that this is false.
+    template <class T>
+    static constexpr bool NEEDS_DESTRUCTOR =
+        !std::is_trivially_destructible_v<T>;
+
+    // This is true for the types whose freed objects are reused. A type that
+    // is smaller than a pointer, larger than the largest size class, or more
+    // aligned than a pointer is always bumped.
+    template <class T>
+    static constexpr bool REUSES_MEMORY =
+        !NEEDS_DESTRUCTOR<T> && sizeof(T) >= SIZE_CLASS_STEP &&
+        sizeof(T) <= SIZE_CLASS_STEP * NUM_SIZE_CLASSES &&
+        alignof(T) <= SIZE_CLASS_STEP;
+
+    explicit ArenaAllocator(size_t slab_size, SlabPool *pool = nullptr,
+                            SlabPages pages = SlabPages::Regular)
+        : pool{pool}, pages{pages}, slab_size{slab_size} {}
 
     ArenaAllocator() : ArenaAllocator(GET_DEFAULT_SLAB_SIZE()) {}
 
+    ArenaAllocator(const ArenaAllocator &) = delete;
+
+    auto operator=(const ArenaAllocator &) -> ArenaAllocator & = delete;
+
+    ArenaAllocator(ArenaAllocator &&other) noexcept
+        : slabs{std::exchange(other.slabs, nullptr)},
+          large_slabs{std::exchange(other.large_slabs, nullptr)},
+          spare_slabs{std::exchange(other.spare_slabs, nullptr)},
+          destructors{std::exchange(other.destructors, nullptr)},
+          oldest_slab{std::exchange(other.oldest_slab, nullptr)},
+          oldest_large_slab{std::exchange(other.oldest_large_slab, nullptr)},
+          oldest_destructor{std::exchange(other.oldest_destructor, nullptr)},
+          pool{other.pool}, pages{other.pages},
+          current_pos{std::exchange(other.current_pos, nullptr)},
+          end_of_current_slab{
+              std::exchange(other.end_of_current_slab, nullptr)},
+          slab_size{other.slab_size},
+          num_slabs{std::exchange(other.num_slabs, 0)},
+          total_capacity{std::exchange(other.total_capacity, 0)},
+          free_blocks{std::exchange(other.free_blocks, {})} {
+#ifdef TPY_ARENA_STATS
+        stats = std::exchange(other.stats, {});
+#endif
+    }
+
+    auto operator=(ArenaAllocator &&other) noexcept -> ArenaAllocator &;
+
+    ~ArenaAllocator() { release_slabs(); }
+
+    /*
+        This method returns a block of the given size, aligned to the given
+       power of two. The common case only rounds and bumps the pointer, so it
+       is kept in the header to be inlined.
+    */
+    auto allocate_bytes(size_t size, size_t align) -> void * {
+        auto pos = (reinterpret_cast<uintptr_t>(current_pos) + align - 1) &
+                   ~static_cast<uintptr_t>(align - 1);
+
+        if (pos + size <= reinterpret_cast<uintptr_t>(end_of_current_slab) &&
+            current_pos) {
+#ifdef TPY_ARENA_STATS
+            stats.requested_bytes += size;
+            stats.padding_bytes +=
+                pos - reinterpret_cast<uintptr_t>(current_pos);
+#endif
+            current_pos = reinterpret_cast<std::byte *>(pos + size);
+            return reinterpret_cast<void *>(pos);
+        }
+
+        return allocate_slow(size, align);
+    }
+
     /*
         This method will instantiate the given object within the arena. This
        needs to have the function body in the header file to resolve linker
@@ -52,19 +292,161 @@ class ArenaAllocator {
        'ArenaAllocator.cpp' file.
     */
     template <class T, typename... Args> auto allocate(Args &&...args) -> T * {
-        // First, we need to obtain the memory.
-        // If the current slab doesn't have enough, we need to allocate another
-        // one.
-        if (end_of_current_slab - current_pos < sizeof(T)) {
-            create_new_slab();
+#ifdef TPY_ARENA_STATS
+        stats.record(typeid(T), sizeof(T));
+#endif
+
+        if constexpr (NEEDS_DESTRUCTOR<T>) {
+            // The record is allocated first, so that the object is never left
+            // without one. It is only linked in once the object exists.
+            auto *record = static_cast<DestructorRecord *>(allocate_bytes(
+                sizeof(DestructorRecord), alignof(DestructorRecord)));
+            auto *object = new (allocate_bytes(sizeof(T), alignof(T)))
+                T(std::forward<Args>(args)...);
+
+            record->next = destructors;
+            record->destroy = [](void *object) {
+                static_cast<T *>(object)->~T();
+            };
+            record->object = object;
+            if (!destructors) {
+                oldest_destructor = record;
+            }
+            destructors = record;
+
+            return object;
+        } else {
+            // A freed block of the same size class is used first.
+            if constexpr (REUSES_MEMORY<T>) {
+                auto &head = free_blocks[class_to_take(sizeof(T))];
+                if (head) {
+                    auto *block = head;
+                    head = block->next;
+#ifdef TPY_ARENA_STATS
+                    stats.reused_bytes += sizeof(T);
+#endif
+                    return new (block) T(std::forward<Args>(args)...);
+                }
+            }
+
+            // First, we need to obtain the memory, which is aligned for the
+            // type.
+            auto mem = allocate_bytes(sizeof(T), alignof(T));
+
+            // Now, we can instantiate the object at that memory location.
+            return new (mem) T(std::forward<Args>(args)...);
         }
-        auto mem = current_pos;
-        current_pos += sizeof(T);
+    }
+
+    /*
+        This method gives a block of the given size back to the arena, to be
+       reused by a later object of the same size class. A block that is too
+       small, too large or not aligned to a pointer is left as it is. The
+       block must not be used afterwards.
+    */
+    auto deallocate_bytes(void *memory, size_t size) -> void {
+        if (!memory || size < SIZE_CLASS_STEP ||
+            size > SIZE_CLASS_STEP * NUM_SIZE_CLASSES ||
+            reinterpret_cast<uintptr_t>(memory) % SIZE_CLASS_STEP != 0) {
+            return;
+        }
+
+        auto &head = free_blocks[class_to_free(size)];
+        head = new (memory) FreeBlock{head};
 
-        // Now, we can instantiate the object at that memory location.
-        return new (mem) T(std::forward<Args>(args)...);
+#ifdef TPY_ARENA_STATS
+        stats.freed_bytes += size;
+#endif
+    }
+
+    /*
+        This method gives the memory of an object back to the arena. It must
+       be called with the type that the object was allocated as, as the size
+       of that type is what is given back. Objects with recorded destructors
+       are destroyed by the arena, so they cannot be given back early.
+    */
+    template <class T> auto deallocate(T *object) -> void {
+        static_assert(!NEEDS_DESTRUCTOR<T>,
+                      "objects with recorded destructors cannot be freed.");
+
+        if constexpr (REUSES_MEMORY<T>) {
+            deallocate_bytes(object, sizeof(T));
+        }
     }
+
+    /*
+        This method will copy the given elements into a right-sized block within
+       the arena. The destructors of the elements are not recorded, so only
+       trivially destructible elements can be stored this way.
+    */
+    template <class T>
+    auto allocate_array(const T *elements, size_t count) -> ArenaArray<T> {
+        static_assert(std::is_trivially_destructible_v<T>,
+                      "arena arrays are never destroyed.");
+
+        if (count == 0) {
+            return ArenaArray<T>{};
+        }
+
+#ifdef TPY_ARENA_STATS
+        stats.record(typeid(T[]), count * sizeof(T));
+#endif
+
+        auto *result = static_cast<T *>(
+            allocate_bytes(count * sizeof(T), alignof(T)));
+        std::uninitialized_copy_n(elements, count, result);
+
+        return ArenaArray<T>{result, count};
+    }
+
+    // This method gives the memory of an array back to the arena, like
+    // 'deallocate'.
+    template <class T> auto deallocate_array(ArenaArray<T> array) -> void {
+        if constexpr (alignof(T) <= SIZE_CLASS_STEP) {
+            deallocate_bytes(array.data(), array.size() * sizeof(T));
+        }
+    }
+
+    // This method returns the current point within the arena.
+    auto mark() const -> Mark {
+        return Mark{slabs, current_pos, large_slabs, destructors};
+    }
+
+    // This method destroys and frees everything that was allocated after the
+    // mark was taken. The memory before the mark is kept as it is.
+    auto release_to(const Mark &mark) -> void;
+
+    // This method destroys and frees everything within the arena. Up to the
+    // given number of slabs are kept to be used again, the largest first, and
+    // the rest are given back.
+    auto reset(size_t keep_slabs = 1) -> void;
+
+    /*
+        This method takes over everything that the other arena holds, which
+       is left empty. The objects of the other arena live until this arena
+       frees them, so a tree that was built by several threads has a single
+       owner. The slabs of the other arena are never allocated from again,
+       and the current slab of this arena stays the current one. A mark that
+       was taken before the splice frees everything that was spliced in.
+    */
+    auto splice(ArenaAllocator &&other) -> void;
+
+    // This is the number of slabs that the arena holds, including the
+    // dedicated and the spare ones.
+    auto slab_count() const -> size_t { return num_slabs; }
+
+    // This is the number of bytes that the slabs take up, including their
+    // headers.
+    auto capacity() const -> size_t { return total_capacity; }
+
+#ifdef TPY_ARENA_STATS
+    auto get_stats() const -> const ArenaStats & { return stats; }
+#endif
+
+    // This method prints the size of the arena, and its statistics if they
+    // are collected.
+    auto print_stats(FILE *file) const -> void;
 };
 } // namespace tpy::Utility
 
-#endif
\ No newline at end of file
+#endif
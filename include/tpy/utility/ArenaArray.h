@@ -0,0 +1,39 @@
+/*
+    This file defines a fixed-size array that lives within an arena allocator.
+*/
+#ifndef TPY_UTILITY_ARENAARRAY
+#define TPY_UTILITY_ARENAARRAY
+
+#include <cstddef>
+
+namespace tpy::Utility {
+/*
+    This is a view of a contiguous array of elements that has been allocated
+   within an arena. It does not own the elements, as they are released together
+   with the rest of the arena, so it can be stored within arena allocated
+   objects without ever being destroyed.
+*/
+template <class T> class ArenaArray {
+    T *elements = nullptr;
+    size_t count = 0;
+
+  public:
+    ArenaArray() = default;
+
+    ArenaArray(T *elements, size_t count) : elements{elements}, count{count} {}
+
+    auto begin() const -> T * { return elements; }
+
+    auto end() const -> T * { return elements + count; }
+
+    auto data() const -> T * { return elements; }
+
+    auto size() const -> size_t { return count; }
+
+    auto empty() const -> bool { return count == 0; }
+
+    auto operator[](size_t i) const -> T & { return elements[i]; }
+};
+} // namespace tpy::Utility
+
+#endif
@@ -0,0 +1,71 @@
+/*
+    This file defines the memory resources that let the standard containers
+   allocate from an arena or from the stack.
+*/
+#ifndef TPY_UTILITY_ARENARESOURCE
+#define TPY_UTILITY_ARENARESOURCE
+
+#include <cstddef>
+#include <memory_resource>
+
+#include "tpy/utility/ArenaAllocator.h"
+
+namespace tpy::Utility {
+/*
+    This is a memory resource that allocates from an arena, so that a
+   'std::pmr' container can live in the same slabs as the tree that it
+   describes. Deallocation does nothing, as the memory is given back together
+   with the rest of the arena. A container that grows leaves its old buffers
+   behind, so it should be reserved up front if it grows a lot.
+
+    The arena does not run the destructors of the containers, so a container
+   must either be destroyed before the arena is, or be allocated within the
+   arena itself.
+*/
+class ArenaResource : public std::pmr::memory_resource {
+    ArenaAllocator &arena;
+
+  public:
+    explicit ArenaResource(ArenaAllocator &arena) : arena{arena} {}
+
+    auto get_arena() const -> ArenaAllocator & { return arena; }
+
+  private:
+    auto do_allocate(size_t bytes, size_t alignment) -> void * override;
+
+    auto do_deallocate(void *memory, size_t bytes, size_t alignment)
+        -> void override;
+
+    auto do_is_equal(const std::pmr::memory_resource &other) const noexcept
+        -> bool override;
+};
+
+// This is the buffer of a scratch resource. It is a base class so that it
+// exists before the resource that points into it.
+template <size_t N> struct ScratchBuffer {
+    alignas(std::max_align_t) std::byte buffer[N];
+};
+
+/*
+    This is a monotonic resource for short-lived scratch containers, which
+   first hands out the memory of a buffer within itself. It is meant to live
+   on the stack, so a container that stays small never allocates from the
+   heap at all. Once the buffer is used up, the memory comes from the upstream
+   resource, which is the heap unless an arena resource is given.
+*/
+template <size_t N>
+class ScratchResource : private ScratchBuffer<N>,
+                        public std::pmr::monotonic_buffer_resource {
+  public:
+    explicit ScratchResource(
+        std::pmr::memory_resource *upstream = std::pmr::get_default_resource())
+        : std::pmr::monotonic_buffer_resource{ScratchBuffer<N>::buffer, N,
+                                              upstream} {}
+
+    ScratchResource(const ScratchResource &) = delete;
+
+    auto operator=(const ScratchResource &) -> ScratchResource & = delete;
+};
+} // namespace tpy::Utility
+
+#endif
@@ -0,0 +1,65 @@
+/*
+    This file defines the statistics that an arena allocator can collect about
+   its memory.
+*/
+#ifndef TPY_UTILITY_ARENASTATS
+#define TPY_UTILITY_ARENASTATS
+
+#include <cstddef>
+#include <cstdio>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+
+namespace tpy::Utility {
+/*
+    These are the statistics of an arena, which are counted since it was
+   created. They are only collected when tpy is built with 'TPY_ARENA_STATS',
+   as they slow down every allocation. Otherwise, an arena does not even hold
+   them.
+
+    Every byte that the slabs hold is either requested, padding that aligns
+   an allocation, left over at the tail of a slab that was full, or still
+   free. An object that takes the place of a freed block is not counted as
+   requested again.
+*/
+struct ArenaStats {
+    // These are the number of objects and the bytes of a single type. An array
+    // is counted under the type of an array of its elements.
+    struct TypeStats {
+        size_t count = 0;
+        size_t bytes = 0;
+    };
+
+    size_t requested_bytes = 0;
+    size_t padding_bytes = 0;
+    size_t tail_bytes = 0;
+
+    // These are the bytes of the blocks that were given back, and of the
+    // objects that took the place of one of them instead of being bumped.
+    size_t freed_bytes = 0;
+    size_t reused_bytes = 0;
+
+    // This is the largest number of bytes that the slabs ever took up.
+    size_t peak_capacity = 0;
+
+    std::unordered_map<std::type_index, TypeStats> types;
+
+    auto record(const std::type_info &type, size_t bytes) -> void {
+        auto &entry = types[type];
+        entry.count++;
+        entry.bytes += bytes;
+    }
+
+    // This method adds the statistics of another arena, whose memory has been
+    // handed over to this one. The peak is left to the arena, as the peaks of
+    // the two arenas were not reached at the same time.
+    auto merge(const ArenaStats &other) -> void;
+
+    // This method prints the statistics, with the types that take up the most
+    // bytes first.
+    auto print_report(FILE *file) const -> void;
+};
+} // namespace tpy::Utility
+
+#endif
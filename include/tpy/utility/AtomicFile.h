@@ -0,0 +1,54 @@
+/*
+    This file defines a file that is written under a temporary name and only
+   renamed into place once all of it has been written.
+*/
+
+#ifndef TPY_UTILITY_ATOMICFILE_H
+#define TPY_UTILITY_ATOMICFILE_H
+
+#include <cstdio>
+#include <string>
+
+namespace tpy::Utility {
+/*
+    The file is written next to its final path, under a name that is suffixed
+   with the id of the process, so that several processes can write the same
+   path at once. Concurrent readers of the final path never see a partially
+   written file: they either see the old one or the complete new one. If the
+   file is not committed, the temporary file is removed when the object is
+   destroyed.
+*/
+class AtomicFile {
+    std::string path;
+    std::string tmp_path;
+    FILE *file = nullptr;
+
+  public:
+    explicit AtomicFile(std::string path);
+
+    AtomicFile(const AtomicFile &) = delete;
+
+    auto operator=(const AtomicFile &) -> AtomicFile & = delete;
+
+    ~AtomicFile();
+
+    // This is the stream of the temporary file, or null if it could not be
+    // created.
+    auto get() const -> FILE * { return file; }
+
+    // This method writes an array of objects to the file, and returns false if
+    // not all of it could be written. An empty array may be null.
+    auto write(const void *data, size_t size, size_t count) -> bool {
+        return count == 0 || fwrite(data, size, count, file) == count;
+    }
+
+    /*
+        This method closes the temporary file and renames it into place if the
+       writes succeeded, as given by 'ok'. Otherwise, the temporary file is
+       removed. It returns false if the file is not in place afterwards.
+    */
+    auto commit(bool ok) -> bool;
+};
+} // namespace tpy::Utility
+
+#endif
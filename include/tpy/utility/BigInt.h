@@ -0,0 +1,102 @@
+/*
+    This file defines an arbitrary-precision integer with the semantics of the
+   Python 'int' type.
+*/
+
+#ifndef TPY_UTILITY_BIGINT_H
+#define TPY_UTILITY_BIGINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tpy::Utility {
+/*
+    This is a signed integer of any size. The magnitude is held as base 2^32
+   digits with the least significant first and without leading zero digits, so
+   zero has no digits at all, and zero is never negative.
+
+    Division and shifts round towards negative infinity, and the bitwise
+   operators act as if the numbers were in two's complement with an infinite
+   number of sign bits, just like in Python.
+*/
+class BigInt {
+    std::vector<uint32_t> digits;
+    bool negative = false;
+
+    // This method removes the leading zero digits, and clears the sign of
+    // zero.
+    auto normalize() -> void;
+
+  public:
+    BigInt() = default;
+
+    BigInt(int64_t value);
+
+    BigInt(std::vector<uint32_t> digits, bool negative);
+
+    // This method parses the digits of an integer literal in the given base,
+    // which may be separated by underscores. The prefix of the base must
+    // already have been removed. It returns false if there is an invalid digit.
+    static auto parse(std::string_view text, int base, BigInt &result) -> bool;
+
+    auto get_digits() const -> const std::vector<uint32_t> & { return digits; }
+
+    auto is_negative() const -> bool { return negative; }
+
+    auto is_zero() const -> bool { return digits.empty(); }
+
+    // This method returns the number of bits of the magnitude.
+    auto bit_length() const -> size_t;
+
+    // This method stores the value in 'result' if it fits into 64 bits.
+    auto to_int64(int64_t &result) const -> bool;
+
+    // This method converts the value to the nearest double, rounding ties to
+    // even. It returns false if the value is too large for a double.
+    auto to_double(double &result) const -> bool;
+
+    // This method returns the value in decimal, with a leading '-' if it is
+    // negative.
+    auto to_decimal() const -> std::string;
+
+    // This method returns a negative number, zero, or a positive number if the
+    // value is less than, equal to, or greater than the other one.
+    auto compare(const BigInt &rhs) const -> int;
+
+    auto operator==(const BigInt &rhs) const -> bool {
+        return negative == rhs.negative && digits == rhs.digits;
+    }
+
+    auto operator-() const -> BigInt;
+
+    auto operator~() const -> BigInt;
+
+    auto operator+(const BigInt &rhs) const -> BigInt;
+
+    auto operator-(const BigInt &rhs) const -> BigInt;
+
+    auto operator*(const BigInt &rhs) const -> BigInt;
+
+    auto operator&(const BigInt &rhs) const -> BigInt;
+
+    auto operator|(const BigInt &rhs) const -> BigInt;
+
+    auto operator^(const BigInt &rhs) const -> BigInt;
+
+    auto shift_left(size_t bits) const -> BigInt;
+
+    auto shift_right(size_t bits) const -> BigInt;
+
+    auto pow(uint64_t exponent) const -> BigInt;
+
+    // This method divides the numbers, rounding the quotient down, so that the
+    // remainder has the sign of the divisor. The divisor must not be zero.
+    static auto floor_divmod(const BigInt &lhs, const BigInt &rhs,
+                             BigInt &quotient, BigInt &remainder) -> void;
+};
+} // namespace tpy::Utility
+
+#endif
@@ -0,0 +1,31 @@
+/*
+    This file defines the mapping of memory that is backed by huge pages.
+*/
+#ifndef TPY_UTILITY_HUGEPAGES
+#define TPY_UTILITY_HUGEPAGES
+
+#include <cstddef>
+
+namespace tpy::Utility {
+// This is the size of a huge page, which is also the alignment and the unit
+// of the size of every mapping.
+constexpr size_t HUGE_PAGE_SIZE = 2 << 20;
+
+// This function tells whether transparent huge pages can be asked for, which
+// is only the case on Linux when they are not disabled. It checks once.
+auto huge_pages_available() -> bool;
+
+/*
+    This function maps a block of the given size, rounded up to a whole number
+   of huge pages, at an address that is aligned to a huge page. It advises the
+   kernel to back the block with huge pages. It returns null if huge pages are
+   not available or the mapping fails, in which case the caller should fall
+   back to regular memory.
+*/
+auto map_huge_pages(size_t size) -> void *;
+
+// This function unmaps a block that was mapped with the given size.
+auto unmap_huge_pages(void *memory, size_t size) -> void;
+} // namespace tpy::Utility
+
+#endif
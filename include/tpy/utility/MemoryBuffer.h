@@ -53,7 +53,7 @@ class MemoryBuffer {
     }
 
     static auto
-    create_buffer_from_file(char *) -> std::unique_ptr<MemoryBuffer>;
+    create_buffer_from_file(const char *) -> std::unique_ptr<MemoryBuffer>;
 
     auto data() const -> std::byte * { return buffer; }
 
@@ -63,6 +63,12 @@ class MemoryBuffer {
 
     auto buffer_size() const -> size_t { return size; }
 
+    // This is the number of bytes that can be read from the string start,
+    // which includes the byte past the contents.
+    auto str_size() const -> size_t {
+        return size - (str_start - reinterpret_cast<char *>(buffer));
+    }
+
     auto end() const -> std::byte * { return data() + contents_length; }
 
     auto abs_end() const -> std::byte * { return data() + size; }
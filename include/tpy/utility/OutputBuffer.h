@@ -0,0 +1,88 @@
+/*
+    This file defines the buffer that text output is gathered in before it is
+   written out in large chunks.
+*/
+
+#ifndef TPY_UTILITY_OUTPUTBUFFER_H
+#define TPY_UTILITY_OUTPUTBUFFER_H
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace tpy::Utility {
+/*
+    This object gathers text in memory and hands it to its target only when the
+   buffer is full or flushed, so writing a large amount of small pieces costs
+   one system call per chunk rather than one library call per piece. The target
+   is either a file descriptor or a string. The buffer is flushed when it is
+   destroyed.
+*/
+class OutputBuffer {
+    int fd = -1;
+    std::string *target = nullptr;
+
+    std::unique_ptr<char[]> buffer;
+    size_t capacity;
+    size_t size = 0;
+
+    // This method makes room for at least the given number of bytes.
+    auto reserve(size_t len) -> void {
+        if (capacity - size < len) {
+            flush();
+        }
+    }
+
+  public:
+    // This is the default size of the buffer.
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 16;
+
+    explicit OutputBuffer(int fd, size_t capacity = DEFAULT_CAPACITY)
+        : fd{fd}, buffer{new char[capacity]}, capacity{capacity} {}
+
+    explicit OutputBuffer(std::string &target,
+                          size_t capacity = DEFAULT_CAPACITY)
+        : target{&target}, buffer{new char[capacity]}, capacity{capacity} {}
+
+    OutputBuffer(const OutputBuffer &) = delete;
+    auto operator=(const OutputBuffer &) -> OutputBuffer & = delete;
+
+    ~OutputBuffer();
+
+    auto put(char c) -> void {
+        reserve(1);
+        buffer[size++] = c;
+    }
+
+    // Text that is larger than the whole buffer is handed to the target
+    // directly.
+    auto write(std::string_view text) -> void {
+        if (text.size() > capacity) {
+            flush();
+            write_out(text.data(), text.size());
+            return;
+        }
+
+        reserve(text.size());
+        memcpy(buffer.get() + size, text.data(), text.size());
+        size += text.size();
+    }
+
+    // This method writes an unsigned integer in decimal.
+    auto write_uint(uint64_t value) -> void;
+
+    // This method writes the given number of spaces.
+    auto write_indent(size_t spaces) -> void;
+
+    // This method hands the gathered text to the target. It throws if the
+    // text could not be written.
+    auto flush() -> void;
+
+  private:
+    auto write_out(const char *data, size_t len) -> void;
+};
+} // namespace tpy::Utility
+
+#endif
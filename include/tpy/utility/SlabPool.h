@@ -0,0 +1,79 @@
+/*
+    This file defines the pool of free slabs that arena allocators can share.
+*/
+#ifndef TPY_UTILITY_SLABPOOL
+#define TPY_UTILITY_SLABPOOL
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace tpy::Utility {
+/*
+    This is a pool of free memory slabs, which arenas return their slabs to
+   instead of freeing them, and take their new slabs from before asking the
+   system. A server that parses files one after the other with arenas of the
+   same configuration therefore reaches a steady state where no slab is ever
+   allocated or freed.
+
+    The slabs are kept by their exact size, as the slabs of arenas that are
+   created alike have the same sizes. The pool holds at most a fixed number of
+   bytes, and a slab that would go over it is freed instead. The pool can be
+   shared between threads.
+*/
+class SlabPool {
+    // This is a free slab. Its first bytes are reused to link it to the next
+    // free slab of the same size.
+    struct FreeSlab {
+        FreeSlab *next;
+    };
+
+    struct Bucket {
+        size_t size;
+        FreeSlab *head;
+    };
+
+    std::mutex mutex;
+
+    std::vector<Bucket> buckets;
+
+    size_t max_bytes;
+    size_t pooled_bytes = 0;
+
+    size_t num_hits = 0;
+    size_t num_misses = 0;
+
+  public:
+    explicit SlabPool(size_t max_bytes) : max_bytes{max_bytes} {}
+
+    SlabPool(const SlabPool &) = delete;
+
+    auto operator=(const SlabPool &) -> SlabPool & = delete;
+
+    ~SlabPool();
+
+    // This is the pool that is shared by the whole process. It holds up to
+    // 256 MiB.
+    static auto global() -> SlabPool &;
+
+    // This method returns a free slab of exactly the given size, or null if
+    // there is none.
+    auto acquire(size_t size) -> void *;
+
+    // This method takes a slab that was allocated with 'operator new'. It
+    // returns false if the pool is full, in which case the caller still owns
+    // the slab.
+    auto release(void *slab, size_t size) -> bool;
+
+    // These are the numbers of requests that were and were not served from
+    // the pool.
+    auto hit_count() -> size_t;
+
+    auto miss_count() -> size_t;
+
+    // This is the number of bytes of the slabs that the pool holds.
+    auto size() -> size_t;
+};
+} // namespace tpy::Utility
+
+#endif
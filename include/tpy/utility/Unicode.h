@@ -6,6 +6,7 @@
 #define TPY_UTILITY_UNICODE
 
 #include <cstdint>
+#include <string>
 
 namespace tpy::Utility {
 class Unicode {
@@ -14,6 +15,11 @@ class Unicode {
     // UTF-32 codepoint.
     static auto decode_utf8_sequence(uint8_t **start, uint8_t *end) -> uint32_t;
 
+    // This method will append the UTF-8 encoding of a codepoint to a string.
+    // The codepoint must be a scalar value, so it is neither a surrogate nor
+    // above U+10FFFF.
+    static auto encode_utf8(uint32_t cp, std::string &result) -> void;
+
     // This method will check whether a given codepoint has the property
     // XID_START. This is used when scanning identifiers.
     static auto is_xid_start(uint32_t cp) -> bool;
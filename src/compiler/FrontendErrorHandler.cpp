@@ -17,13 +17,14 @@ auto FrontendErrorHandler::report_error_with_local_pos(
     const char *msg) -> void {
     // Tell the frontend that we have seen errors.
     has_seen_error = true;
+    ++num_errors;
 
     // First, we must get the source location of the desired position.
     auto src_loc = src_file->get_loc_from_pos(pos);
 
-    fprintf(stderr, "error: %s\n --> %s at line %llu, col %llu\n", msg,
+    // The blank line after each error goes to the same stream, so that the
+    // output on stdout, such as a dump of the tree, is left alone.
+    fprintf(stderr, "error: %s\n --> %s at line %zu, col %zu\n\n", msg,
             src_file->path.c_str(), src_loc.line, src_loc.col);
-
-    putchar('\n');
 }
 } // namespace tpy::Compiler
\ No newline at end of file
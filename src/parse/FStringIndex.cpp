@@ -0,0 +1,29 @@
+/*
+    This file implements the segment index for f-strings.
+*/
+#include <algorithm>
+
+#include "tpy/parse/FStringIndex.h"
+
+namespace tpy::Parse {
+/*
+    This method will find the segments of the f-string token at the given
+   position. Since the lexer only moves forward, the token positions are sorted
+   and we can use a binary search.
+*/
+auto FStringIndexView::find(uint32_t tok_offset) const
+    -> std::pair<uint32_t, uint32_t> {
+    auto *end = token_offsets + num_fstrings;
+    auto *it = std::lower_bound(token_offsets, end, tok_offset);
+
+    if (it == end || *it != tok_offset) {
+        return std::make_pair(0, 0);
+    }
+
+    size_t i = it - token_offsets;
+    auto last = i + 1 < num_fstrings ? first_segments[i + 1]
+                                     : static_cast<uint32_t>(num_segments);
+
+    return std::make_pair(first_segments[i], last);
+}
+} // namespace tpy::Parse
@@ -0,0 +1,269 @@
+/*
+    This file implements the incremental parser, which keeps the tree of a
+   module up to date as the module is edited.
+*/
+
+#include "tpy/parse/IncrementalParser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "tpy/parse/Lexer.h"
+#include "tpy/parse/ParallelParser.h"
+#include "tpy/parse/Parser.h"
+#include "tpy/tree/ASTStmt.h"
+
+namespace tpy::Parse {
+// This is the size of the slabs of the segment arenas. Most segments hold a
+// single statement, so a small slab is usually all that they need. The slabs
+// of the segments that are replaced by an edit go to the global slab pool, so
+// the segments that are parsed again take them from there.
+static constexpr size_t SEGMENT_SLAB_SIZE = 1 << 12;
+
+/*
+    This function will add the newline characters of the text within [begin,
+   end) to the line map, just like the source manager does for a whole file. A
+   '\r' at the end of the range is paired with the '\n' after it, which is
+   always within the buffer thanks to the null terminator.
+*/
+static auto scan_newlines(const char *text, size_t begin, size_t end,
+                          std::vector<Source::NewLineChar> &newline_chars)
+    -> void {
+    for (auto pos = begin; pos < end; pos++) {
+        if (text[pos] == '\n') {
+            newline_chars.emplace_back(pos, 1);
+        } else if (text[pos] == '\r') {
+            if (text[pos + 1] == '\n') {
+                newline_chars.emplace_back(pos, 2);
+                ++pos;
+            } else {
+                newline_chars.emplace_back(pos, 1);
+            }
+        }
+    }
+}
+
+/*
+    This function will copy the f-strings of the index whose tokens are within
+   [begin, end) into the index of a segment that starts at 'begin'. The token
+   and segment positions are made relative to the segment, and the segment
+   ranges to its own index, so the index moves along with the segment. The
+   f-strings are visited in order, and 'next' is the first one not copied yet.
+*/
+static auto rebase_fstrings(const FStringIndexView &index, size_t &next,
+                            size_t begin, size_t end, FStringIndex &into)
+    -> void {
+    auto base = static_cast<uint32_t>(begin);
+
+    for (; next < index.num_fstrings && index.token_offsets[next] < end;
+         next++) {
+        into.begin_fstring(index.token_offsets[next] - base);
+
+        auto [first, last] = index.find(index.token_offsets[next]);
+        for (auto i = first; i < last; i++) {
+            auto segment = index.segments[i];
+            segment.offset -= base;
+            into.add_segment(segment);
+        }
+    }
+}
+
+IncrementalParser::IncrementalParser(Source::SourceFile *src_file) {
+    auto *old_buffer = src_file->buffer.get();
+    auto size = old_buffer->buffer_size();
+
+    auto *bytes = new std::byte[size];
+    memcpy(bytes, old_buffer->data(), size);
+
+    this->src_file = std::make_unique<Source::SourceFile>(
+        src_file->path.data(), src_file->offset,
+        std::make_unique<Utility::MemoryBuffer>(bytes, size, false),
+        src_file->line_map);
+
+    reparse(0, 0, 0, 0);
+}
+
+auto IncrementalParser::segment_start(size_t i) const -> size_t {
+    size_t start = 0;
+    for (size_t k = 0; k < i; k++) {
+        start += segments[k].width;
+    }
+
+    return start;
+}
+
+/*
+    This method replaces the buffer of the source file with the edited text. The
+   line map is only rescanned around the edit, as the newline characters
+   everywhere else are the same, only shifted. One character is rescanned on
+   either side, since a '\r' and a '\n' may be joined or split by the edit.
+*/
+auto IncrementalParser::replace_text(size_t pos, size_t old_len,
+                                     std::string_view new_text) -> void {
+    auto *old_bytes = src_file->buffer->data();
+    auto old_size = src_file->buffer->get_size();
+    auto new_len = new_text.size();
+    auto new_size = old_size - old_len + new_len;
+
+    auto *bytes = new std::byte[new_size + 1];
+    memcpy(bytes, old_bytes, pos);
+    memcpy(bytes + pos, new_text.data(), new_len);
+    memcpy(bytes + pos + new_len, old_bytes + pos + old_len,
+           old_size - pos - old_len);
+    bytes[new_size] = std::byte{0};
+
+    auto &line_map = src_file->line_map;
+    auto by_pos = [](const Source::NewLineChar &newline_char, size_t pos) {
+        return newline_char.pos < pos;
+    };
+
+    auto scan_begin = pos > 0 ? pos - 1 : 0;
+    auto first = std::lower_bound(line_map.begin(), line_map.end(),
+                                  scan_begin, by_pos);
+    auto last =
+        std::lower_bound(first, line_map.end(), pos + old_len + 1, by_pos);
+
+    // A '\r\n' right before the rescanned range is kept as it is.
+    if (first != line_map.begin() &&
+        std::prev(first)->pos + std::prev(first)->len > scan_begin) {
+        ++scan_begin;
+    }
+
+    for (auto it = last; it != line_map.end(); ++it) {
+        it->pos = it->pos - old_len + new_len;
+    }
+
+    std::vector<Source::NewLineChar> window;
+    scan_newlines(reinterpret_cast<char *>(bytes), scan_begin,
+                  std::min(pos + new_len + 1, new_size), window);
+
+    auto index = first - line_map.begin();
+    line_map.erase(first, last);
+    line_map.insert(line_map.begin() + index, window.begin(), window.end());
+
+    src_file->buffer =
+        std::make_unique<Utility::MemoryBuffer>(bytes, new_size + 1, false);
+}
+
+/*
+    The lexer is restarted at the start of the first segment to replace, which
+   always begins a top-level statement, so the lexer is in the same state there
+   as it is at the start of the file. The new segments are cut at every
+   top-level statement that it finds. Once it finds one at the start of an old
+   segment that is not affected by the edit, the text from there on is the same
+   as before, and so are its tokens and its trees.
+*/
+auto IncrementalParser::reparse(size_t start, size_t first, size_t resync,
+                                size_t resync_start) -> void {
+    Lexer lexer{src_file.get()};
+    lexer.restart_at(start);
+
+    TopLevelStmtScanner scanner;
+    bool seen_stmt = false;
+
+    std::vector<Segment> fresh(1);
+    std::vector<size_t> starts{start};
+    auto end = src_file->buffer->get_size();
+
+    auto tok = Token::dummy();
+    auto relative_tok = Token::dummy();
+
+    do {
+        lexer.lex_next_tok(tok);
+        auto tok_pos = tok.span.local_pos;
+
+        if (scanner.starts_stmt(tok.kind) && std::exchange(seen_stmt, true)) {
+            while (resync < segments.size() && resync_start < tok_pos) {
+                resync_start += segments[resync].width;
+                ++resync;
+            }
+
+            if (resync < segments.size() && resync_start == tok_pos) {
+                end = tok_pos;
+                break;
+            }
+
+            fresh.emplace_back();
+            starts.push_back(tok_pos);
+        }
+
+        auto relative_pos = tok_pos - starts.back();
+        relative_tok.update(tok.kind, Source::Span{relative_pos, relative_pos,
+                                                   tok.span.len});
+        fresh.back().tokens.push(relative_tok);
+    } while (tok.kind != TokenKind::End);
+
+    // Without a point to resync at, the lexer has reached the end of the file
+    // and every old segment after the first one has been replaced.
+    if (tok.kind == TokenKind::End) {
+        resync = segments.size();
+    }
+
+    starts.push_back(end);
+
+    auto fstrings = lexer.fstrings().view();
+    size_t next_fstring = 0;
+
+    for (size_t k = 0; k < fresh.size(); k++) {
+        auto &segment = fresh[k];
+        segment.width = starts[k + 1] - starts[k];
+        rebase_fstrings(fstrings, next_fstring, starts[k], starts[k + 1],
+                        segment.tokens.fstrings);
+        segment.arena = std::make_unique<Utility::ArenaAllocator>(
+            SEGMENT_SLAB_SIZE, &Utility::SlabPool::global());
+
+        Parser parser{segment.tokens.view(), src_file.get(), *segment.arena};
+        parser.set_error_offset(starts[k]);
+
+        // The parser recovers from syntax errors, so the module always has a
+        // body.
+        segment.body =
+            static_cast<Tree::ASTModuleNode *>(parser.parse_py_module())->body;
+    }
+
+    last_reparsed = fresh.size();
+    last_reused = segments.size() - (resync - first);
+
+    segments.erase(segments.begin() + first, segments.begin() + resync);
+    segments.insert(segments.begin() + first,
+                    std::make_move_iterator(fresh.begin()),
+                    std::make_move_iterator(fresh.end()));
+}
+
+/*
+    The segments to reparse begin with the one that holds the edit. The segment
+   before it is reparsed as well if the edit touches the first token of the
+   segment, since the statement may then no longer begin there, or the edit may
+   change the end of the statement before it.
+*/
+auto IncrementalParser::edit(size_t pos, size_t old_len,
+                             std::string_view new_text) -> void {
+    size_t first = 0;
+    size_t start = 0;
+
+    while (first + 1 < segments.size() &&
+           start + segments[first].width <= pos) {
+        start += segments[first].width;
+        ++first;
+    }
+
+    if (first > 0 && pos <= start + segments[first].tokens.view().lens[0]) {
+        --first;
+        start -= segments[first].width;
+    }
+
+    // The old segments that begin after the edit are the ones that the lexer
+    // can resync at.
+    auto resync = first + 1;
+    auto resync_start = start + segments[first].width;
+
+    while (resync < segments.size() && resync_start < pos + old_len) {
+        resync_start += segments[resync].width;
+        ++resync;
+    }
+
+    replace_text(pos, old_len, new_text);
+    reparse(start, first, resync, resync_start - old_len + new_text.size());
+}
+} // namespace tpy::Parse
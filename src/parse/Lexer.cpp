@@ -22,18 +22,27 @@ auto Lexer::report_error(char *start, size_t len, const char *msg) -> void {
 */
 auto Lexer::lex_next_tok(Token &tok) -> void {
 lexer_start:
+    // If an earlier line closed several indentation levels at once, we still
+    // owe the parser a dedent token for each of them.
+    if (pending_dedents) {
+        --pending_dedents;
+        create_token(tok, TokenKind::Dedent, ptr, 0);
+        return;
+    }
+
     // First, we need to mark the start of a potential token.
     char *tok_start = ptr;
 
     // Next, we need to consume horizontal whitespace and then check for an
     // indent/dedent token. We will only do that if the previous token was a
-    // newline token.
+    // newline token. Lines that are blank or only hold a comment do not
+    // change the indentation.
     int whitespace_count = consume_horizontal_whitespace();
 
-    if (was_last_tok_newline) {
+    if (was_last_tok_newline && !is_blank_line_start(ptr)) {
         // If the current whitespace count is greater than what is at the top of
         // the stack, we must add an indent token. If it is less, we must add a
-        // dedent token.
+        // dedent token for every level that is closed.
         if (whitespace_count > whitespace_stack.top()) {
             was_last_tok_newline = false;
             whitespace_stack.push(whitespace_count);
@@ -46,6 +55,17 @@ lexer_start:
             was_last_tok_newline = false;
             whitespace_stack.pop();
 
+            while (whitespace_count < whitespace_stack.top()) {
+                whitespace_stack.pop();
+                ++pending_dedents;
+            }
+
+            if (whitespace_count != whitespace_stack.top()) {
+                report_error(tok_start, whitespace_count,
+                             "unindent does not match any outer indentation "
+                             "level.");
+            }
+
             create_token(tok, TokenKind::Dedent, tok_start, whitespace_count);
             return;
         }
@@ -64,6 +84,19 @@ lexer_start:
         // is, we can generate an end token. Otherwise, we must consume the null
         // character and restart the lexer.
         if (ptr == end_ptr) {
+            // Before the end of the file, every open indentation level must be
+            // closed.
+            if (whitespace_stack.size() > 1) {
+                whitespace_stack.pop();
+                while (whitespace_stack.size() > 1) {
+                    whitespace_stack.pop();
+                    ++pending_dedents;
+                }
+
+                create_token(tok, TokenKind::Dedent, tok_start, 0);
+                return;
+            }
+
             create_token(tok, TokenKind::End, tok_start, 1);
             return;
         }
@@ -72,12 +105,18 @@ lexer_start:
         goto lexer_start;
     }
 
-    // Now, we must handle newline characters. If the parser is accepting
-    // newline tokens, then we must return one. Otherwise, we just consume it
-    // and keep going.
+    // Now, we must handle newline characters. If we are not inside of any
+    // brackets, then we must return a newline token. Otherwise, we just consume
+    // it and keep going, unless the next line shows that the brackets were
+    // never closed.
     case '\n': {
+        if (was_last_tok_newline) {
+            record_trivia(TriviaKind::BlankLine, ptr, 1);
+        }
+
         ++ptr;
-        if (accept_newlines) {
+        if (!bracket_depth || starts_new_statement(ptr)) {
+            bracket_depth = 0;
             create_token(tok, TokenKind::Newline, tok_start, 1, true);
             return;
         }
@@ -87,8 +126,13 @@ lexer_start:
     // Python allows for the CRLF return token, so we need to check for that.
     case '\r': {
         if (ptr[1] == '\n') {
+            if (was_last_tok_newline) {
+                record_trivia(TriviaKind::BlankLine, ptr, 2);
+            }
+
             ptr += 2;
-            if (accept_newlines) {
+            if (!bracket_depth || starts_new_statement(ptr)) {
+                bracket_depth = 0;
                 create_token(tok, TokenKind::Newline, tok_start, 2, true);
                 return;
             }
@@ -96,8 +140,13 @@ lexer_start:
             goto lexer_start;
         }
 
+        if (was_last_tok_newline) {
+            record_trivia(TriviaKind::BlankLine, ptr, 1);
+        }
+
         ++ptr;
-        if (accept_newlines) {
+        if (!bracket_depth || starts_new_statement(ptr)) {
+            bracket_depth = 0;
             create_token(tok, TokenKind::Newline, tok_start, 1, true);
             return;
         }
@@ -105,6 +154,29 @@ lexer_start:
         goto lexer_start;
     }
 
+    // A backslash at the end of a line joins it with the next one. The
+    // backslash and the line terminator are skipped together.
+    case '\\': {
+        int continuation_len = 0;
+        if (ptr[1] == '\n') {
+            continuation_len = 2;
+        } else if (ptr[1] == '\r') {
+            continuation_len = ptr[2] == '\n' ? 3 : 2;
+        }
+
+        if (!continuation_len) {
+            ++ptr;
+            report_error(tok_start, 1,
+                         "unexpected character after line continuation "
+                         "character.");
+            goto lexer_start;
+        }
+
+        record_trivia(TriviaKind::Continuation, ptr, continuation_len);
+        ptr += continuation_len;
+        goto lexer_start;
+    }
+
     // Now, we will begin with delimiters.
     case ';': {
         ++ptr;
@@ -113,31 +185,43 @@ lexer_start:
     }
     case '(': {
         ++ptr;
+        ++bracket_depth;
         create_token(tok, TokenKind::LeftParen, tok_start, 1);
         return;
     }
     case ')': {
         ++ptr;
+        if (bracket_depth) {
+            --bracket_depth;
+        }
         create_token(tok, TokenKind::RightParen, tok_start, 1);
         return;
     }
     case '[': {
         ++ptr;
+        ++bracket_depth;
         create_token(tok, TokenKind::LeftSquare, tok_start, 1);
         return;
     }
     case ']': {
         ++ptr;
+        if (bracket_depth) {
+            --bracket_depth;
+        }
         create_token(tok, TokenKind::RightSquare, tok_start, 1);
         return;
     }
     case '{': {
         ++ptr;
+        ++bracket_depth;
         create_token(tok, TokenKind::LeftCurly, tok_start, 1);
         return;
     }
     case '}': {
         ++ptr;
+        if (bracket_depth) {
+            --bracket_depth;
+        }
         create_token(tok, TokenKind::RightCurly, tok_start, 1);
         return;
     }
@@ -146,6 +230,17 @@ lexer_start:
         create_token(tok, TokenKind::Comma, tok_start, 1);
         return;
     }
+    case '@': {
+        if (ptr[1] == '=') {
+            ptr += 2;
+            create_token(tok, TokenKind::AtEquals, tok_start, 2);
+            return;
+        }
+
+        ++ptr;
+        create_token(tok, TokenKind::At, tok_start, 1);
+        return;
+    }
     case '~': {
         ++ptr;
         create_token(tok, TokenKind::Tilda, tok_start, 1);
@@ -168,6 +263,11 @@ lexer_start:
             create_token(tok, TokenKind::MinusEquals, tok_start, 2);
             return;
         }
+        if (ptr[1] == '>') {
+            ptr += 2;
+            create_token(tok, TokenKind::Arrow, tok_start, 2);
+            return;
+        }
 
         ++ptr;
         create_token(tok, TokenKind::Minus, tok_start, 1);
@@ -176,7 +276,7 @@ lexer_start:
     case '*': {
         if (ptr[1] == '=') {
             ptr += 2;
-            create_token(tok, TokenKind::Asterisk, tok_start, 2);
+            create_token(tok, TokenKind::AsteriskEquals, tok_start, 2);
             return;
         }
         if (ptr[1] == '*') {
@@ -409,7 +509,8 @@ lexer_start:
     }
 
     // In order to handle the dot token, we must check for the next character
-    // being a digit, because we can have float literals start with a dot.
+    // being a digit, because we can have float literals start with a dot. Three
+    // dots in a row are the ellipsis.
     case '.': {
         switch (ptr[1]) {
         case '0':
@@ -424,6 +525,17 @@ lexer_start:
         case '9': {
             return lex_floating_point_literal(tok, tok_start);
         }
+        case '.': {
+            if (ptr[2] == '.') {
+                ptr += 3;
+                create_token(tok, TokenKind::Ellipsis, tok_start, 3);
+                return;
+            }
+
+            ++ptr;
+            create_token(tok, TokenKind::Dot, tok_start, 1);
+            return;
+        }
         default: {
             ++ptr;
             create_token(tok, TokenKind::Dot, tok_start, 1);
@@ -434,23 +546,36 @@ lexer_start:
 
     // Python supports string literals that are enclosed in both a single and
     // double quote.
-    case '\'': {
-        lex_single_quote_string_literal(tok, tok_start);
+    case '\'':
+    case '"': {
+        lex_string_literal(tok, tok_start, TokenKind::StringLiteral);
         return;
     }
 
-    case '"': {
-        lex_double_quote_string_literal(tok, tok_start);
+    // These letters can either start an identifier or be the prefix of a
+    // string literal, such as b'...', f"...", or rb'''...'''.
+    case 'b':
+    case 'f':
+    case 'r':
+    case 'u':
+    case 'B':
+    case 'F':
+    case 'R':
+    case 'U': {
+        if (lex_prefixed_string_literal(tok, tok_start)) {
+            return;
+        }
+
+        ++ptr;
+        lex_keyword_or_identifier(tok, tok_start);
         return;
     }
 
     // Now, we can begin scanning identifiers.
     case 'a':
-    case 'b':
     case 'c':
     case 'd':
     case 'e':
-    case 'f':
     case 'g':
     case 'h':
     case 'i':
@@ -462,21 +587,17 @@ lexer_start:
     case 'o':
     case 'p':
     case 'q':
-    case 'r':
     case 's':
     case 't':
-    case 'u':
     case 'v':
     case 'w':
     case 'x':
     case 'y':
     case 'z':
     case 'A':
-    case 'B':
     case 'C':
     case 'D':
     case 'E':
-    case 'F':
     case 'G':
     case 'H':
     case 'I':
@@ -488,10 +609,8 @@ lexer_start:
     case 'O':
     case 'P':
     case 'Q':
-    case 'R':
     case 'S':
     case 'T':
-    case 'U':
     case 'V':
     case 'W':
     case 'X':
@@ -574,6 +693,106 @@ auto Lexer::consume_horizontal_whitespace() -> int {
     }
 }
 
+/*
+    This method checks whether the next non-blank line, which begins at the
+   given position, must be a new statement even though brackets are still open.
+   Without it, a single bracket that is never closed would hide the newlines and
+   the indentation of the rest of the file from the parser, so every statement
+   after it would be reported as part of one long expression.
+
+    A line begins a new statement if it is indented less than the statement
+   with the open bracket, or if it is indented no more than that statement and
+   begins with a keyword that only ever begins a statement. Continuation lines
+   of valid code are rarely laid out like that, and they are never affected
+   when the brackets are closed.
+*/
+auto Lexer::starts_new_statement(const char *p) const -> bool {
+    int whitespace_count = 0;
+
+    while (true) {
+        if (*p == ' ') {
+            ++whitespace_count;
+        } else if (*p == '\t') {
+            whitespace_count += 4;
+        } else if (*p == '\f') {
+            // A form feed does not count towards the indentation.
+        } else if (*p == '#' || *p == '\n' || *p == '\r') {
+            // Blank lines and comments are skipped.
+            while (*p != '\n' && *p != '\r' && p != end_ptr) {
+                ++p;
+            }
+
+            if (p == end_ptr) {
+                return true;
+            }
+
+            whitespace_count = 0;
+        } else if (p == end_ptr) {
+            return true;
+        } else {
+            break;
+        }
+
+        ++p;
+    }
+
+    auto stmt_indent = whitespace_stack.top();
+    if (whitespace_count < stmt_indent) {
+        return true;
+    }
+
+    if (whitespace_count > stmt_indent) {
+        return false;
+    }
+
+    // Keywords are made up of lowercase letters, so the word is only a keyword
+    // if it is not followed by any other character of an identifier.
+    auto *word_end = p;
+    while (*word_end >= 'a' && *word_end <= 'z') {
+        ++word_end;
+    }
+
+    auto next = static_cast<unsigned char>(*word_end);
+    if (word_end == p || (next >= 'A' && next <= 'Z') ||
+        (next >= '0' && next <= '9') || next == '_' || next >= 0x80) {
+        return false;
+    }
+
+    auto *keyword = KeywordLookup::is_keyword(
+        p, static_cast<unsigned int>(word_end - p));
+    if (!keyword) {
+        return false;
+    }
+
+    switch (keyword->kind) {
+    case TokenKind::KeywordAssert:
+    case TokenKind::KeywordAsync:
+    case TokenKind::KeywordBreak:
+    case TokenKind::KeywordClass:
+    case TokenKind::KeywordContinue:
+    case TokenKind::KeywordDef:
+    case TokenKind::KeywordDel:
+    case TokenKind::KeywordElif:
+    case TokenKind::KeywordExcept:
+    case TokenKind::KeywordFinally:
+    case TokenKind::KeywordFor:
+    case TokenKind::KeywordFrom:
+    case TokenKind::KeywordGlobal:
+    case TokenKind::KeywordIf:
+    case TokenKind::KeywordImport:
+    case TokenKind::KeywordNonlocal:
+    case TokenKind::KeywordPass:
+    case TokenKind::KeywordRaise:
+    case TokenKind::KeywordReturn:
+    case TokenKind::KeywordTry:
+    case TokenKind::KeywordWhile:
+    case TokenKind::KeywordWith:
+        return true;
+    default:
+        return false;
+    }
+}
+
 auto Lexer::lex_decimal_integer_literal(Token &tok, char *start) -> void {
     // We know that the first character is a digit, so we can consume it.
     ++ptr;
@@ -1052,23 +1271,143 @@ auto Lexer::lex_binary_integer_literal(Token &tok, char *start) -> void {
     }
 }
 
-auto Lexer::lex_single_quote_string_literal(Token &tok, char *start) -> void {
-    // Consume the starting single quote.
-    ++ptr;
+/*
+    This method will try to scan a string literal with a prefix, such as
+   'rb"..."' or 'f"..."'. A prefix is at most two characters long and must be
+   directly followed by a quote. If it is not, the pointer is left untouched and
+   false is returned so that the caller can scan an identifier instead.
+*/
+auto Lexer::lex_prefixed_string_literal(Token &tok, char *start) -> bool {
+    bool is_raw = false, is_bytes = false, is_format = false,
+         is_unicode = false;
+
+    char *prefix_end = ptr;
+    while (prefix_end - ptr < 2) {
+        bool *flag;
+        switch (*prefix_end) {
+        case 'r':
+        case 'R': {
+            flag = &is_raw;
+            break;
+        }
+        case 'b':
+        case 'B': {
+            flag = &is_bytes;
+            break;
+        }
+        case 'f':
+        case 'F': {
+            flag = &is_format;
+            break;
+        }
+        case 'u':
+        case 'U': {
+            flag = &is_unicode;
+            break;
+        }
+        default: {
+            flag = nullptr;
+            break;
+        }
+        }
+
+        // Each prefix character can only appear once.
+        if (!flag || *flag) {
+            break;
+        }
+
+        *flag = true;
+        ++prefix_end;
+    }
+
+    if (*prefix_end != '\'' && *prefix_end != '"') {
+        return false;
+    }
+
+    // The 'u' prefix cannot be combined with any other, and a literal cannot
+    // be both bytes and formatted.
+    if ((is_unicode && prefix_end - ptr != 1) || (is_bytes && is_format)) {
+        return false;
+    }
+
+    // Raw strings are scanned exactly like regular strings, as a backslash
+    // still prevents the following quote from closing the literal.
+    ptr = prefix_end;
+    if (is_bytes) {
+        lex_string_literal(tok, start, TokenKind::BytesLiteral);
+    } else if (is_format) {
+        lex_string_literal(tok, start, TokenKind::FStringLiteral);
+    } else {
+        lex_string_literal(tok, start, TokenKind::StringLiteral);
+    }
+
+    return true;
+}
+
+/*
+    This method will scan a string, bytes, or f-string literal. The pointer must
+   be at the opening quote, which can be tripled. We will not process escapes
+   here as that is expensive and can be left for after parsing. For f-strings,
+   the replacement fields are recorded into the f-string index as we go.
+*/
+auto Lexer::lex_string_literal(Token &tok, char *start,
+                               TokenKind kind) -> void {
+    char quote = *ptr;
+    bool is_triple = ptr[1] == quote && ptr[2] == quote;
+    bool is_bytes = kind == TokenKind::BytesLiteral;
+    bool is_format = kind == TokenKind::FStringLiteral;
+
+    // Consume the opening quote.
+    ptr += is_triple ? 3 : 1;
+
+    if (is_format) {
+        fstring_index->begin_fstring(
+            static_cast<uint32_t>(start - abs_buffer_start));
+    }
+
+    // For f-strings, we need to track the start of the current literal run.
+    char *run_start = ptr;
+    auto flush_literal_run = [&]() {
+        if (is_format && ptr > run_start) {
+            record_fstring_segment(FStringSegmentKind::Literal, run_start,
+                                   ptr - run_start, 0);
+        }
+    };
 
-    // Now, we need to consume characters until we either hit the end of the
-    // string or encounter an EOF. Because these strings support escape
-    // characters, we need to check the character after a backslash. We will not
-    // process escapes here as that is expensive and can be left for after
-    // parsing.
     while (true) {
         switch (*ptr) {
-        case '\'': {
+        case '\'':
+        case '"': {
+            // A quote only ends the literal if it matches the opening one.
+            if (*ptr != quote ||
+                (is_triple && (ptr[1] != quote || ptr[2] != quote))) {
+                ++ptr;
+                continue;
+            }
+
             // This is the end of the string.
-            // Consume the closing single quote.
-            ++ptr;
+            flush_literal_run();
+
+            // Consume the closing quote.
+            ptr += is_triple ? 3 : 1;
 
-            create_token(tok, TokenKind::StringLiteral, start, ptr - start);
+            create_token(tok, kind, start, ptr - start);
+            return;
+        }
+        case '\r':
+        case '\n': {
+            // Only triple quoted strings can span multiple lines.
+            if (is_triple) {
+                ++ptr;
+                continue;
+            }
+
+            report_error(ptr, 1,
+                         "expected closing quote in string literal, but "
+                         "encountered the end of the line instead.");
+
+            flush_literal_run();
+            create_token(tok, kind, start, ptr - start);
             return;
         }
         case '\0': {
@@ -1077,10 +1416,11 @@ auto Lexer::lex_single_quote_string_literal(Token &tok, char *start) -> void {
             // string literals must be terminated.
             if (ptr == end_ptr) {
                 report_error(ptr, 1,
-                             "expected closing '\'' in string literal, but "
+                             "expected closing quote in string literal, but "
                              "encountered file end instead.");
 
-                create_token(tok, TokenKind::StringLiteral, start, ptr - start);
+                flush_literal_run();
+                create_token(tok, kind, start, ptr - start);
                 return;
             }
 
@@ -1095,19 +1435,22 @@ auto Lexer::lex_single_quote_string_literal(Token &tok, char *start) -> void {
             // file.
             ++ptr;
 
-            if (*ptr == 0) {
+            if (*ptr == 0 && ptr == end_ptr) {
                 report_error(
                     ptr, 1,
                     "expected character after '\\' in string literal, but "
                     "encountered file end instead.");
 
-                create_token(tok, TokenKind::StringLiteral, start, ptr - start);
+                flush_literal_run();
+                create_token(tok, kind, start, ptr - start);
                 return;
             }
 
             // Otherwise, we can accept either an ASCII character or a unicode
-            // codepoint here.
-            if (*ptr > 0) {
+            // codepoint here. An escaped CRLF is consumed as a whole.
+            if (*ptr == '\r' && ptr[1] == '\n') {
+                ptr += 2;
+            } else if (*ptr >= 0) {
                 ++ptr;
             } else {
                 Utility::Unicode::decode_utf8_sequence(
@@ -1117,88 +1460,193 @@ auto Lexer::lex_single_quote_string_literal(Token &tok, char *start) -> void {
 
             continue;
         }
+        case '{': {
+            if (!is_format) {
+                ++ptr;
+                continue;
+            }
+
+            // A doubled brace is an escaped brace and part of the literal run.
+            if (ptr[1] == '{') {
+                ptr += 2;
+                continue;
+            }
+
+            flush_literal_run();
+
+            // If the replacement field ran into the closing quote, we still
+            // want it to be handled by this loop. Otherwise, the field ran into
+            // the end of the line or file, which has already been reported.
+            if (!lex_fstring_replacement_field(quote, is_triple, 0) &&
+                *ptr != quote) {
+                create_token(tok, kind, start, ptr - start);
+                return;
+            }
+
+            run_start = ptr;
+            continue;
+        }
+        case '}': {
+            if (!is_format) {
+                ++ptr;
+                continue;
+            }
+
+            if (ptr[1] == '}') {
+                ptr += 2;
+                continue;
+            }
+
+            report_error(ptr, 1,
+                         "a single '}' is not allowed in an f-string. Did you "
+                         "mean '}}' instead?");
+            ++ptr;
+            continue;
+        }
         default: {
             // All other source characters are valid within a Python string.
+            // However, bytes literals may only contain ASCII characters.
             if (*ptr > 0) {
                 ++ptr;
-            } else {
-                Utility::Unicode::decode_utf8_sequence(
-                    reinterpret_cast<uint8_t **>(&ptr),
-                    reinterpret_cast<uint8_t *>(end_ptr));
+                continue;
+            }
+
+            char *cp_start = ptr;
+            Utility::Unicode::decode_utf8_sequence(
+                reinterpret_cast<uint8_t **>(&ptr),
+                reinterpret_cast<uint8_t *>(end_ptr));
+
+            if (is_bytes) {
+                report_error(cp_start, ptr - cp_start,
+                             "bytes literals can only contain ASCII "
+                             "characters.");
             }
+
             continue;
         }
         }
     }
 }
 
-auto Lexer::lex_double_quote_string_literal(Token &tok, char *start) -> void {
-    // Consume the starting double quote.
+/*
+    This method will scan a replacement field of the form '{expr!conv:spec}'
+   within an f-string and record its parts into the f-string index. The pointer
+   must be at the opening brace. It returns false if the field was not closed,
+   in which case the pointer is left at the character that ended it.
+*/
+auto Lexer::lex_fstring_replacement_field(char quote, bool is_triple,
+                                          uint8_t depth) -> bool {
+    // Consume the '{'.
     ++ptr;
 
-    // Now, we need to consume characters until we either hit the end of the
-    // string or encounter an EOF. Because these strings support escape
-    // characters, we need to check the character after a backslash. We will not
-    // process escapes here as that is expensive and can be left for after
-    // parsing.
-    while (true) {
+    // First, we need to find the end of the expression. The expression ends at
+    // a '!', ':', or '}' that is not nested within brackets.
+    char *expr_start = ptr;
+    int nesting = 0;
+    char *expr_end = nullptr;
+
+    while (!expr_end) {
         switch (*ptr) {
-        case '"': {
-            // This is the end of the string.
-            // Consume the closing double quote.
+        case '(':
+        case '[':
+        case '{': {
+            ++nesting;
+            ++ptr;
+            continue;
+        }
+        case ')':
+        case ']': {
+            if (nesting) {
+                --nesting;
+            }
+
             ++ptr;
+            continue;
+        }
+        case '}': {
+            if (nesting) {
+                --nesting;
+                ++ptr;
+                continue;
+            }
 
-            create_token(tok, TokenKind::StringLiteral, start, ptr - start);
-            return;
+            expr_end = ptr;
+            continue;
         }
-        case '\0': {
-            // This is possibly the end of the file, and we need to check for
-            // that. If it is the end of the file, we must report an error as
-            // string literals must be terminated.
-            if (ptr == end_ptr) {
-                report_error(ptr, 1,
-                             "expected closing '\"' in string literal, but "
-                             "encountered file end instead.");
+        case '!': {
+            // The '!=' operator is part of the expression.
+            if (ptr[1] == '=') {
+                ptr += 2;
+                continue;
+            }
 
-                create_token(tok, TokenKind::StringLiteral, start, ptr - start);
-                return;
+            if (nesting) {
+                ++ptr;
+                continue;
             }
 
-            // Otherwise, null characters are accepted, so we must consume it
-            // and keep going.
-            ++ptr;
+            expr_end = ptr;
             continue;
         }
-        case '\\': {
-            // If we encounter a backslash, it must be followed by a valid
-            // source character. Essentially, it cannot be followed by an end of
-            // file.
-            ++ptr;
+        case ':': {
+            if (nesting) {
+                ++ptr;
+                continue;
+            }
 
-            if (*ptr == 0) {
-                report_error(
-                    ptr, 1,
-                    "expected character after '\\' in string literal, but "
-                    "encountered file end instead.");
+            expr_end = ptr;
+            continue;
+        }
+        case '=': {
+            // A trailing '=' makes the field self-documenting, as in '{x=}'. It
+            // is not part of the expression.
+            if (!nesting && (ptr[1] == '}' || ptr[1] == '!' || ptr[1] == ':') &&
+                ptr > expr_start && ptr[-1] != '=' && ptr[-1] != '!' &&
+                ptr[-1] != '<' && ptr[-1] != '>') {
+                expr_end = ptr;
+                ++ptr;
+                continue;
+            }
 
-                create_token(tok, TokenKind::StringLiteral, start, ptr - start);
-                return;
+            ++ptr;
+            continue;
+        }
+        case '\'':
+        case '"': {
+            // A nested string literal must use a different quote than the
+            // f-string itself.
+            if (!skip_fstring_nested_string_literal(quote, is_triple)) {
+                report_error(ptr, 1,
+                             "expected '}' before the end of the f-string.");
+                return false;
             }
 
-            // Otherwise, we can accept either an ASCII character or a unicode
-            // codepoint here.
-            if (*ptr > 0) {
+            continue;
+        }
+        case '\r':
+        case '\n': {
+            if (is_triple) {
                 ++ptr;
-            } else {
-                Utility::Unicode::decode_utf8_sequence(
-                    reinterpret_cast<uint8_t **>(&ptr),
-                    reinterpret_cast<uint8_t *>(end_ptr));
+                continue;
+            }
+
+            report_error(ptr, 1,
+                         "expected '}' before the end of the line in "
+                         "f-string.");
+            return false;
+        }
+        case '\0': {
+            if (ptr == end_ptr) {
+                report_error(ptr, 1,
+                             "expected '}' before the end of the file in "
+                             "f-string.");
+                return false;
             }
 
+            ++ptr;
             continue;
         }
         default: {
-            // All other source characters are valid within a Python string.
             if (*ptr > 0) {
                 ++ptr;
             } else {
@@ -1206,10 +1654,123 @@ auto Lexer::lex_double_quote_string_literal(Token &tok, char *start) -> void {
                     reinterpret_cast<uint8_t **>(&ptr),
                     reinterpret_cast<uint8_t *>(end_ptr));
             }
+
             continue;
         }
         }
     }
+
+    if (expr_end == expr_start) {
+        report_error(expr_start, 1, "f-string expressions cannot be empty.");
+    }
+
+    record_fstring_segment(FStringSegmentKind::Expression, expr_start,
+                           expr_end - expr_start, depth);
+
+    // Now, we may have a conversion, which is a single character.
+    if (*ptr == '!') {
+        ++ptr;
+
+        if (*ptr != 's' && *ptr != 'r' && *ptr != 'a') {
+            report_error(ptr, 1,
+                         "f-string conversions must be 's', 'r', or 'a'.");
+
+            // We will skip the invalid conversion to avoid further errors.
+            if (*ptr != '}' && *ptr != ':' && *ptr != quote) {
+                ++ptr;
+            }
+        } else {
+            record_fstring_segment(FStringSegmentKind::Conversion, ptr, 1,
+                                   depth);
+            ++ptr;
+        }
+    }
+
+    // Next, we may have a format spec. It is literal text that can contain
+    // replacement fields of its own.
+    if (*ptr == ':') {
+        ++ptr;
+
+        char *spec_start = ptr;
+        auto spec_segment = record_fstring_segment(
+            FStringSegmentKind::FormatSpec, spec_start, 0, depth);
+
+        while (*ptr != '}') {
+            if (*ptr == '{') {
+                if (depth > 0) {
+                    report_error(ptr, 1,
+                                 "f-string format specs can only be nested "
+                                 "one level deep.");
+                }
+
+                if (!lex_fstring_replacement_field(quote, is_triple,
+                                                   depth + 1)) {
+                    return false;
+                }
+
+                continue;
+            }
+
+            // The format spec cannot run past the end of the literal. A single
+            // quote of the same kind only ends a triple-quoted f-string if it
+            // is the start of the closing delimiter.
+            bool at_closing_quote =
+                *ptr == quote &&
+                (!is_triple || (ptr[1] == quote && ptr[2] == quote));
+            if (at_closing_quote || (*ptr == '\0' && ptr == end_ptr) ||
+                (!is_triple && (*ptr == '\n' || *ptr == '\r'))) {
+                break;
+            }
+
+            ++ptr;
+        }
+
+        (*fstring_index)[spec_segment].len =
+            static_cast<uint32_t>(ptr - spec_start);
+    }
+
+    // Finally, we need the closing '}'.
+    if (*ptr != '}') {
+        report_error(ptr, 1,
+                     "expected '}' to close the replacement field in "
+                     "f-string.");
+        return false;
+    }
+
+    ++ptr;
+    return true;
+}
+
+/*
+    This method will skip over a string literal that is nested within a
+   replacement field of an f-string. It returns false without consuming
+   anything if the quote would end the f-string instead.
+*/
+auto Lexer::skip_fstring_nested_string_literal(char quote,
+                                               bool is_triple) -> bool {
+    char nested_quote = *ptr;
+
+    if (nested_quote == quote &&
+        (!is_triple || (ptr[1] == quote && ptr[2] == quote))) {
+        return false;
+    }
+
+    ++ptr;
+    while (*ptr != nested_quote) {
+        if ((*ptr == '\0' && ptr == end_ptr) || *ptr == '\n' || *ptr == '\r') {
+            return true;
+        }
+
+        if (*ptr == '\\' && ptr[1] != '\0') {
+            ++ptr;
+        }
+
+        ++ptr;
+    }
+
+    // Consume the closing quote of the nested literal.
+    ++ptr;
+    return true;
 }
 
 auto Lexer::lex_keyword_or_identifier(Token &tok, char *start) -> void {
@@ -1331,7 +1892,9 @@ auto Lexer::lex_keyword_or_identifier(Token &tok, char *start) -> void {
 }
 
 auto Lexer::lex_comment(Token &tok) -> bool {
-    // Consume the '#'.
+    // Mark the start of the comment in case it needs to be recorded as trivia,
+    // and then consume the '#'.
+    char *comment_start = ptr;
     ++ptr;
 
     // Now, we need to keep consuming characters until we find a newline or EOF.
@@ -1341,6 +1904,8 @@ auto Lexer::lex_comment(Token &tok) -> bool {
         // lexer to scan it.
         case '\r':
         case '\n': {
+            record_trivia(TriviaKind::Comment, comment_start,
+                          ptr - comment_start);
             return true;
         }
 
@@ -1349,6 +1914,8 @@ auto Lexer::lex_comment(Token &tok) -> bool {
         // keep going.
         case '\0': {
             if (ptr == end_ptr) {
+                record_trivia(TriviaKind::Comment, comment_start,
+                              ptr - comment_start);
                 create_token(tok, TokenKind::End, ptr, 1);
                 return false;
             }
@@ -0,0 +1,130 @@
+/*
+    This file implements the parser that parses the top-level statements of a
+   module on several threads at once.
+*/
+
+#include "tpy/parse/ParallelParser.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "tpy/parse/Parser.h"
+#include "tpy/parse/Token.h"
+#include "tpy/tree/ASTStmt.h"
+
+namespace tpy::Parse {
+auto TopLevelStmtScanner::starts_stmt(TokenKind kind) -> bool {
+    switch (kind) {
+    case TokenKind::Indent: {
+        ++depth;
+        return false;
+    }
+    case TokenKind::Dedent: {
+        --depth;
+        return false;
+    }
+    case TokenKind::Newline: {
+        at_line_start = true;
+        return false;
+    }
+    case TokenKind::End:
+    case TokenKind::KeywordElse:
+    case TokenKind::KeywordElif:
+    case TokenKind::KeywordExcept:
+    case TokenKind::KeywordFinally: {
+        at_line_start = false;
+        return false;
+    }
+    default: {
+        break;
+    }
+    }
+
+    bool result = false;
+    if (at_line_start && depth == 0) {
+        result = !after_decorator;
+        after_decorator = kind == TokenKind::At;
+    }
+
+    at_line_start = false;
+    return result;
+}
+
+auto ParallelParser::find_top_level_stmts(const TokenStreamView &token_stream)
+    -> std::vector<size_t> {
+    std::vector<size_t> starts;
+    TopLevelStmtScanner scanner;
+
+    for (size_t i = 0; i < token_stream.size; i++) {
+        if (scanner.starts_stmt(token_stream.kind(i))) {
+            starts.push_back(i);
+        }
+    }
+
+    return starts;
+}
+
+auto ParallelParser::parse_py_module(size_t num_threads) -> Tree::ASTNode * {
+    auto starts = find_top_level_stmts(token_stream);
+
+    // The chunks are cut at the statements that are closest to an equal share
+    // of the tokens. The first chunk also holds any blank lines before the
+    // first statement.
+    std::vector<size_t> cuts{0};
+    auto num_chunks = std::max<size_t>(1, std::min(num_threads, starts.size()));
+
+    for (size_t k = 1; k < num_chunks; k++) {
+        auto target = token_stream.size * k / num_chunks;
+        auto it = std::lower_bound(starts.begin(), starts.end(), target);
+
+        if (it != starts.end() && *it > cuts.back()) {
+            cuts.push_back(*it);
+        }
+    }
+
+    cuts.push_back(token_stream.size);
+    num_chunks = cuts.size() - 1;
+
+    // The arenas must not move once the workers have started.
+    std::vector<Utility::ArenaAllocator> worker_arenas;
+    worker_arenas.reserve(num_chunks);
+    for (size_t k = 0; k < num_chunks; k++) {
+        worker_arenas.emplace_back(1 << 16);
+    }
+
+    std::vector<Tree::ASTNode *> chunks(num_chunks, nullptr);
+
+    auto parse_chunk = [this, &cuts, &chunks, &worker_arenas](size_t k) {
+        Parser parser{token_stream.slice(cuts[k], cuts[k + 1]), src_file,
+                      worker_arenas[k]};
+        chunks[k] = parser.parse_py_module();
+    };
+
+    // The calling thread parses the first chunk itself.
+    std::vector<std::thread> workers;
+    for (size_t k = 1; k < num_chunks; k++) {
+        workers.emplace_back(parse_chunk, k);
+    }
+
+    parse_chunk(0);
+
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    for (auto &worker_arena : worker_arenas) {
+        arena.splice(std::move(worker_arena));
+    }
+
+    // Every chunk recovers from its own errors, so they always have a body.
+    std::vector<Tree::ASTNode *> body;
+    for (auto *chunk : chunks) {
+        auto &chunk_body = static_cast<Tree::ASTModuleNode *>(chunk)->body;
+        body.insert(body.end(), chunk_body.begin(), chunk_body.end());
+    }
+
+    return arena.allocate<Tree::ASTModuleNode>(
+        arena.allocate_array(body.data(), body.size()),
+        Source::Span::merge(chunks.front()->loc, chunks.back()->loc));
+}
+} // namespace tpy::Parse
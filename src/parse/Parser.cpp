@@ -8,6 +8,7 @@
 #include "tpy/source/Span.h"
 #include "tpy/tree/ASTExpr.h"
 #include "tpy/tree/ASTNode.h"
+#include "tpy/tree/ASTStmt.h"
 
 // A shorthand to avoid having to write the whole thing out all the time.
 namespace tpy::Parse {
@@ -17,10 +18,93 @@ namespace tpy::Parse {
 */
 auto Parser::report_error(Source::Span &loc, const char *msg) -> void {
     Compiler::FrontendErrorHandler::report_error_with_local_pos(
-        lexer.src_file, loc.local_pos, loc.len, msg);
+        src_file, loc.local_pos + error_offset, loc.len, msg);
+}
+
+/*
+    This method will check the nesting depth before a binary expression is
+   parsed. Reporting the error at the limit, rather than when the whole
+   expression has been read, keeps pathological inputs from costing any more
+   time or memory.
+*/
+auto Parser::check_nesting_depth() -> bool {
+    if (nesting_depth < max_nesting_depth) {
+        return true;
+    }
+
+    report_error(tok.span, "expression is nested too deeply.");
+    return false;
+}
+
+/*
+    This method recovers from an error within a bracketed expression, such as a
+   list, a call, or a parenthesized expression, that began at the given
+   location. The lexer does not produce newlines within brackets, so the rest of
+   the expression is skipped up to the closing bracket that matches the opening
+   one, and an error node takes the place of the whole expression. The parser
+   can then carry on after it and report the errors that follow.
+
+    If there is no closing bracket before the end of the line, the error is
+   passed on to the statement, which recovers instead. A closing bracket of the
+   wrong kind is left for the enclosing expression, which it most likely
+   belongs to.
+*/
+auto Parser::recover_in_brackets(ReturnType failed, Source::Span start,
+                                 TokenKind closer) -> ReturnType {
+    // There is only something to recover from once an error has been reported.
+    if (failed.first || !failed.second) {
+        return failed;
+    }
+
+    auto end_loc = start;
+    size_t depth = 0;
+
+    while (true) {
+        switch (tok.kind) {
+        case TokenKind::LeftParen:
+        case TokenKind::LeftSquare:
+        case TokenKind::LeftCurly: {
+            ++depth;
+            break;
+        }
+        case TokenKind::RightParen:
+        case TokenKind::RightSquare:
+        case TokenKind::RightCurly: {
+            if (depth) {
+                --depth;
+                break;
+            }
+
+            if (tok.kind == closer) {
+                end_loc = tok.span;
+                advance();
+            }
+
+            return std::make_pair(make_node<Tree::ASTErrorNode>(
+                                      Source::Span::merge(start, end_loc)),
+                                  false);
+        }
+        case TokenKind::Newline:
+        case TokenKind::Indent:
+        case TokenKind::Dedent:
+        case TokenKind::End: {
+            return failed;
+        }
+        default: {
+            break;
+        }
+        }
+
+        end_loc = tok.span;
+        advance();
+    }
 }
 
 auto Parser::parse_py_expr() -> ReturnType {
+    if (expr_parse_mode == ExprParseMode::Iterative) {
+        return parse_py_expr_iteratively(ExprFrameKind::Expr, Precedence::None);
+    }
+
     return parse_py_assignment_expr();
 }
 
@@ -32,54 +116,66 @@ auto Parser::parse_py_atom_and_primary_expr() -> ReturnType {
 
     switch (tok.kind) {
     case TokenKind::IntLiteral: {
-        result = arena.allocate<Tree::ASTIntLiteralNode>(10, tok.span);
+        result = make_node<Tree::ASTIntLiteralNode>(10, tok.span);
         advance();
         break;
     }
     case TokenKind::HexIntLiteral: {
-        result = arena.allocate<Tree::ASTIntLiteralNode>(16, tok.span);
+        result = make_node<Tree::ASTIntLiteralNode>(16, tok.span);
         advance();
         break;
     }
     case TokenKind::BinaryIntLiteral: {
-        result = arena.allocate<Tree::ASTIntLiteralNode>(2, tok.span);
+        result = make_node<Tree::ASTIntLiteralNode>(2, tok.span);
         advance();
         break;
     }
     case TokenKind::OctalIntLiteral: {
-        result = arena.allocate<Tree::ASTIntLiteralNode>(8, tok.span);
+        result = make_node<Tree::ASTIntLiteralNode>(8, tok.span);
         advance();
         break;
     }
     case TokenKind::FloatLiteral: {
-        result = arena.allocate<Tree::ASTFloatLiteralNode>(tok.span);
+        result = make_node<Tree::ASTFloatLiteralNode>(tok.span);
         advance();
         break;
     }
-    case TokenKind::StringLiteral: {
-        result = arena.allocate<Tree::ASTStringLiteralNode>(tok.span);
-        advance();
+    case TokenKind::StringLiteral:
+    case TokenKind::BytesLiteral:
+    case TokenKind::FStringLiteral: {
+        result = parse_py_string_literals();
         break;
     }
     case TokenKind::KeywordTrue: {
-        result = arena.allocate<Tree::ASTBoolLiteralNode>(true, tok.span);
+        result = make_node<Tree::ASTBoolLiteralNode>(true, tok.span);
         advance();
         break;
     }
     case TokenKind::KeywordFalse: {
-        result = arena.allocate<Tree::ASTBoolLiteralNode>(false, tok.span);
+        result = make_node<Tree::ASTBoolLiteralNode>(false, tok.span);
+        advance();
+        break;
+    }
+    case TokenKind::KeywordNone: {
+        result = make_node<Tree::ASTNoneLiteralNode>(tok.span);
+        advance();
+        break;
+    }
+    case TokenKind::Ellipsis: {
+        result = make_node<Tree::ASTEllipsisLiteralNode>(tok.span);
         advance();
         break;
     }
     case TokenKind::Identifier: {
-        result = arena.allocate<Tree::ASTNameExprNode>(tok.span);
+        result = make_node<Tree::ASTNameExprNode>(tok.span);
         advance();
         break;
     }
     case TokenKind::LeftParen: {
-        auto inner_expr = parse_py_paren_expr();
-        // Since the parse_py_paren_expr method will report all errors, we don't
-        // have to check for that.
+        // The method reports all errors, and we recover from them here.
+        auto start = tok.span;
+        auto inner_expr = recover_in_brackets(parse_py_paren_expr(), start,
+                                              TokenKind::RightParen);
         if (!inner_expr.first) {
             return inner_expr;
         }
@@ -88,9 +184,10 @@ auto Parser::parse_py_atom_and_primary_expr() -> ReturnType {
         break;
     }
     case TokenKind::LeftSquare: {
-        auto list_expr = parse_py_list_expr();
-        // Since the parse_py_list_expr method will report all errors, we don't
-        // have to check for that.
+        // The method reports all errors, and we recover from them here.
+        auto start = tok.span;
+        auto list_expr = recover_in_brackets(parse_py_list_expr(), start,
+                                             TokenKind::RightSquare);
         if (!list_expr.first) {
             return list_expr;
         }
@@ -99,9 +196,10 @@ auto Parser::parse_py_atom_and_primary_expr() -> ReturnType {
         break;
     }
     case TokenKind::LeftCurly: {
-        auto dict_or_set_expr = parse_py_set_or_dict_expr();
-        // Since the parse_py_set_or_dict_expr method will report all errors, we
-        // don't have to check for that.
+        // The method reports all errors, and we recover from them here.
+        auto start = tok.span;
+        auto dict_or_set_expr = recover_in_brackets(
+            parse_py_set_or_dict_expr(), start, TokenKind::RightCurly);
         if (!dict_or_set_expr.first) {
             return dict_or_set_expr;
         }
@@ -114,7 +212,7 @@ auto Parser::parse_py_atom_and_primary_expr() -> ReturnType {
         // of some kind, but the exact kind is unclear.
         // Therefore, we will return an integer literal with the span of the
         // token.
-        result = arena.allocate<Tree::ASTIntLiteralNode>(10, tok.span);
+        result = make_node<Tree::ASTIntLiteralNode>(10, tok.span);
         advance();
         break;
     }
@@ -128,34 +226,125 @@ auto Parser::parse_py_atom_and_primary_expr() -> ReturnType {
 
     // Now that we have parsed the initial expression, we need to parse the left
     // recursive portions of the primary expressions. Attribute references,
-    // slicing, and calls are part of this class of expressions.
-    switch (tok.kind) {
-    case TokenKind::Dot: {
-        return parse_py_attr_ref_expr(result);
-    }
-    case TokenKind::LeftParen: {
-        return parse_py_call_expr(result);
-    }
+    // slicing, and calls are part of this class of expressions, and they can be
+    // chained, as in 'a.b(c)[d]'.
+    while (true) {
+        ReturnType postfix;
 
-    case TokenKind::LeftSquare: {
-        return parse_py_slice_expr(result);
+        switch (tok.kind) {
+        case TokenKind::Dot: {
+            postfix = parse_py_attr_ref_expr(result);
+            break;
+        }
+        case TokenKind::LeftParen: {
+            auto start = result->loc;
+            postfix = recover_in_brackets(parse_py_call_expr(result), start,
+                                          TokenKind::RightParen);
+            break;
+        }
+        case TokenKind::LeftSquare: {
+            auto start = result->loc;
+            postfix = recover_in_brackets(parse_py_slice_expr(result), start,
+                                          TokenKind::RightSquare);
+            break;
+        }
+        default: {
+            return std::make_pair(result, false);
+        }
+        }
+
+        if (!postfix.first) {
+            return postfix;
+        }
+
+        result = postfix.first;
     }
+}
 
-    default: {
-        return std::make_pair(result, false);
+/*
+    This method will parse a string, bytes, or f-string literal, which is the
+   lookahead. Literals that are written next to each other are joined into one,
+   as in '"a" "b"', so any that follow it are parsed along with it. Bytes cannot
+   be joined with the other kinds, but the node is made anyway once the error is
+   reported, as nothing else depends on it.
+*/
+auto Parser::parse_py_string_literals() -> Tree::ASTNode * {
+    auto make_literal = [this]() -> Tree::ASTNode * {
+        Tree::ASTNode *literal;
+
+        switch (tok.kind) {
+        case TokenKind::StringLiteral: {
+            literal = make_node<Tree::ASTStringLiteralNode>(tok.span);
+            break;
+        }
+        case TokenKind::BytesLiteral: {
+            literal = make_node<Tree::ASTBytesLiteralNode>(tok.span);
+            break;
+        }
+        default: {
+            auto [segment_begin, segment_end] = fstring_segments(tok.span);
+            literal = make_node<Tree::ASTFStringLiteralNode>(
+                segment_begin, segment_end, tok.span);
+            break;
+        }
+        }
+
+        advance();
+        return literal;
+    };
+
+    auto is_literal = [this]() {
+        return expect(TokenKind::StringLiteral) ||
+               expect(TokenKind::BytesLiteral) ||
+               expect(TokenKind::FStringLiteral);
+    };
+
+    auto *first = make_literal();
+    if (!is_literal()) {
+        return first;
     }
+
+    ScratchScope parts{node_scratch};
+    parts.push(first);
+
+    bool is_bytes = first->kind == Tree::ASTNodeKind::BytesLiteral;
+
+    while (is_literal()) {
+        if (expect(TokenKind::BytesLiteral) != is_bytes) {
+            report_error(tok.span, "cannot mix bytes and nonbytes literals.");
+        }
+
+        parts.push(make_literal());
     }
+
+    auto part_list = parts.copy_to(arena);
+    return make_node<Tree::ASTStringConcatExprNode>(
+        part_list, Source::Span::merge(first->loc,
+                                       part_list[part_list.size() - 1]->loc));
 }
 
-// This method will parse expressions enclosed within parentheses.
+// This method will parse expressions enclosed within parentheses. If the
+// parentheses contain a comma, or nothing at all, they form a tuple instead.
+// They can also hold a 'yield' expression or a generator expression.
 auto Parser::parse_py_paren_expr() -> ReturnType {
     // Store the position of the left parenthesis and consume the parenthesis.
     auto lparen_loc = tok.span;
     advance();
 
+    // An empty pair of parentheses is the empty tuple.
+    if (expect(TokenKind::RightParen)) {
+        auto *node = make_node<Tree::ASTTupleExprNode>(
+            Utility::ArenaArray<Tree::ASTNode *>{},
+            Source::Span::merge(lparen_loc, tok.span));
+        advance();
+
+        return std::make_pair(node, false);
+    }
+
     // Now, we must have an expression inside.
     auto expr_start = tok.span;
-    auto expr = parse_py_expr();
+    auto expr = expect(TokenKind::KeywordYield) ? parse_py_yield_expr()
+                                                : parse_py_star_or_expr();
     if (!expr.first) {
         if (!expr.second) {
             report_error(expr_start, "expected expression after '('.");
@@ -165,6 +354,15 @@ auto Parser::parse_py_paren_expr() -> ReturnType {
         return expr;
     }
 
+    if (expect(TokenKind::Comma)) {
+        return parse_py_paren_tuple_expr(expr.first, lparen_loc);
+    }
+
+    if (expect(TokenKind::KeywordFor) || expect(TokenKind::KeywordAsync)) {
+        return parse_py_comprehension(expr.first, nullptr, lparen_loc,
+                                      TokenKind::RightParen);
+    }
+
     // Now, we need a closing ')'
     if (!expect(TokenKind::RightParen)) {
         report_error(tok.span, "expected closing ')' after expression.");
@@ -172,30 +370,73 @@ auto Parser::parse_py_paren_expr() -> ReturnType {
     }
 
     // Create the node, and then consume the ')'.
-    auto *node = arena.allocate<Tree::ASTParenExprNode>(expr.first,
+    auto *node = make_node<Tree::ASTParenExprNode>(expr.first,
                                                         lparen_loc + tok.span);
     advance();
 
     return std::make_pair(node, false);
 }
 
+/*
+    This method will continue parsing a parenthesized tuple after its first
+   element. Unlike a bare expression list, the elements are enclosed, so the
+   tuple ends at the closing parenthesis rather than at a token that cannot
+   start an expression.
+*/
+auto Parser::parse_py_paren_tuple_expr(Tree::ASTNode *first_expr,
+                                       Source::Span lparen_loc) -> ReturnType {
+    ScratchScope elements{node_scratch};
+    elements.push(first_expr);
+
+    while (expect(TokenKind::Comma)) {
+        // Consume the comma.
+        advance();
+
+        // The python spec allows trailing commas, so we must check for that.
+        if (expect(TokenKind::RightParen)) {
+            break;
+        }
+
+        auto expr_start = tok.span;
+        auto expr = parse_py_star_or_expr();
+
+        if (!expr.first) {
+            if (!expr.second) {
+                report_error(expr_start,
+                             "expected expression after ',' in tuple.");
+                return std::make_pair(nullptr, true);
+            }
+
+            return expr;
+        }
+
+        elements.push(expr.first);
+    }
+
+    if (!expect(TokenKind::RightParen)) {
+        report_error(tok.span, "expected closing ')' in tuple.");
+        return std::make_pair(nullptr, true);
+    }
+
+    auto *node = make_node<Tree::ASTTupleExprNode>(
+        elements.copy_to(arena), Source::Span::merge(lparen_loc, tok.span));
+    advance();
+
+    return std::make_pair(node, false);
+}
+
 // This method will parse list expressions. List expressions begin with a left
 // square bracket and contain a list of expressions. They must end with a right
 // square bracket.
 auto Parser::parse_py_list_expr() -> ReturnType {
-    // Mark the position of the left square bracket and consume it.
-    // Additionally, newline characters are allowed within list literals, so we
-    // must tell the lexer not to mark them.
+    // Mark the position of the left square bracket and consume it. The lexer
+    // will not produce newline tokens until the matching ']'.
     auto lsquare_loc = tok.span;
-    lexer.skip_newlines();
     advance();
 
     // Now, we have a special case where there is an empty list literal.
     if (expect(TokenKind::RightSquare)) {
-        auto *node =
-            arena.allocate<Tree::ASTListExprNode>(lsquare_loc + tok.span);
-        // Tell the lexer to start allowing newlines again.
-        lexer.allow_newlines();
+        auto *node = make_node<Tree::ASTListExprNode>(lsquare_loc + tok.span);
 
         // Consume the ']'
         advance();
@@ -206,7 +447,7 @@ auto Parser::parse_py_list_expr() -> ReturnType {
     // If we get here, it means the list is not empty. Therefore, we must have
     // an expression.
     auto first_expr_start = tok.span;
-    auto first_expr = parse_py_expr();
+    auto first_expr = parse_py_star_or_expr();
 
     if (!first_expr.first) {
         if (!first_expr.second) {
@@ -218,9 +459,15 @@ auto Parser::parse_py_list_expr() -> ReturnType {
         return first_expr;
     }
 
-    // Create the list of expressions and add the first expression.
-    std::vector<Tree::ASTNode *> list;
-    list.push_back(first_expr.first);
+    if (expect(TokenKind::KeywordFor) || expect(TokenKind::KeywordAsync)) {
+        return parse_py_comprehension(first_expr.first, nullptr, lsquare_loc,
+                                      TokenKind::RightSquare);
+    }
+
+    // Collect the list of expressions on the scratch stack and add the first
+    // expression.
+    ScratchScope list{node_scratch};
+    list.push(first_expr.first);
 
     // Now, while we have comments, we must have expressions.
     while (expect(TokenKind::Comma)) {
@@ -230,10 +477,8 @@ auto Parser::parse_py_list_expr() -> ReturnType {
         // The python spec allows trailing commas, so we must check for that.
         if (expect(TokenKind::RightSquare)) {
             // If we find the bracket, we can make the node and consume it.
-            auto *node = arena.allocate<Tree::ASTListExprNode>(
-                std::move(list), lsquare_loc + tok.span);
-            // We need to tell the lexer to start marking newlines again.
-            lexer.allow_newlines();
+            auto *node = make_node<Tree::ASTListExprNode>(
+                list.copy_to(arena), lsquare_loc + tok.span);
             advance();
 
             return std::make_pair(node, false);
@@ -241,7 +486,7 @@ auto Parser::parse_py_list_expr() -> ReturnType {
 
         // Now, we need an expression.
         auto expr_start = tok.span;
-        auto expr = parse_py_expr();
+        auto expr = parse_py_star_or_expr();
 
         if (!expr.first) {
             if (!expr.second) {
@@ -254,7 +499,7 @@ auto Parser::parse_py_list_expr() -> ReturnType {
         }
 
         // Add the expression to the list.
-        list.push_back(expr.first);
+        list.push(expr.first);
     }
 
     // Now, we need a right square bracket to end the list.
@@ -264,42 +509,39 @@ auto Parser::parse_py_list_expr() -> ReturnType {
     }
 
     // If we find the bracket, we can make the node and consume it.
-    auto *node = arena.allocate<Tree::ASTListExprNode>(std::move(list),
+    auto *node = make_node<Tree::ASTListExprNode>(list.copy_to(arena),
                                                        lsquare_loc + tok.span);
-    // We need to tell the lexer to start marking newlines again.
-    lexer.allow_newlines();
     advance();
 
     return std::make_pair(node, false);
 }
 
 // This method will parse set and dict expressions. We will begin by expecting a
-// set, but if a colon is encountered after the first expression, we will
-// transition to a dict.
+// set, but if a colon is encountered after the first expression, or the first
+// entry is unpacked with '**', we will transition to a dict.
 auto Parser::parse_py_set_or_dict_expr() -> ReturnType {
-    // Store the location of the opening curly brace and then consume it.
-    // Additionally, newline characters are allowed within list literals, so we
-    // must tell the lexer not to mark them.
+    // Store the location of the opening curly brace and then consume it. The
+    // lexer will not produce newline tokens until the matching '}'.
     auto lcurly_loc = tok.span;
-    lexer.skip_newlines();
     advance();
 
     // We need to handle the special case where we have an empty dict.
     if (expect(TokenKind::RightCurly)) {
         // Create the node and consume the right curly brace.
-        auto *node =
-            arena.allocate<Tree::ASTDictExprNode>(lcurly_loc + tok.span);
+        auto *node = make_node<Tree::ASTDictExprNode>(lcurly_loc + tok.span);
 
-        // Tell the lexer to start allowing newlines again.
-        lexer.allow_newlines();
         advance();
 
         return std::make_pair(node, false);
     }
 
+    if (expect(TokenKind::AsteriskAsterisk)) {
+        return parse_py_dict_expr(nullptr, lcurly_loc);
+    }
+
     // Now, we must have an expression.
     auto first_expr_start = tok.span;
-    auto first_expr = parse_py_expr();
+    auto first_expr = parse_py_star_or_expr();
 
     if (!first_expr.first) {
         if (!first_expr.second) {
@@ -312,14 +554,21 @@ auto Parser::parse_py_set_or_dict_expr() -> ReturnType {
     }
 
     // Now, if we have a colon, it becomes a dict. Otherwise, it remains a set.
-    if (expect(TokenKind::Colon)) {
+    // An unpacked element cannot be a key.
+    if (expect(TokenKind::Colon) &&
+        first_expr.first->kind != Tree::ASTNodeKind::StarredExpr) {
         return parse_py_dict_expr(first_expr.first, lcurly_loc);
     }
 
+    if (expect(TokenKind::KeywordFor) || expect(TokenKind::KeywordAsync)) {
+        return parse_py_comprehension(first_expr.first, nullptr, lcurly_loc,
+                                      TokenKind::RightCurly);
+    }
+
     // Now that we know that we have a set, we can keep consuming expressions
     // while we have a comma.
-    std::vector<Tree::ASTNode *> contents;
-    contents.push_back(first_expr.first);
+    ScratchScope contents{node_scratch};
+    contents.push(first_expr.first);
 
     while (expect(TokenKind::Comma)) {
         // Consume the comma and expect an expression.
@@ -328,18 +577,16 @@ auto Parser::parse_py_set_or_dict_expr() -> ReturnType {
         // However, the Python spec allows trailing commas.
         if (expect(TokenKind::RightCurly)) {
             // Make the node and consume the right curly brace.
-            auto *node = arena.allocate<Tree::ASTSetExprNode>(
-                std::move(contents), lcurly_loc + tok.span);
+            auto *node = make_node<Tree::ASTSetExprNode>(
+                contents.copy_to(arena), lcurly_loc + tok.span);
 
-            // Tell the lexer to start allowing newlines again.
-            lexer.allow_newlines();
             advance();
 
             return std::make_pair(node, false);
         }
 
         auto expr_start = tok.span;
-        auto expr = parse_py_expr();
+        auto expr = parse_py_star_or_expr();
 
         if (!expr.first) {
             if (!expr.second) {
@@ -351,7 +598,7 @@ auto Parser::parse_py_set_or_dict_expr() -> ReturnType {
             return expr;
         }
 
-        contents.push_back(expr.first);
+        contents.push(expr.first);
     }
 
     // Now, we need a right curly brace to close the set literal.
@@ -361,11 +608,9 @@ auto Parser::parse_py_set_or_dict_expr() -> ReturnType {
     }
 
     // Make the node and consume the right curly brace.
-    auto *node = arena.allocate<Tree::ASTSetExprNode>(std::move(contents),
+    auto *node = make_node<Tree::ASTSetExprNode>(contents.copy_to(arena),
                                                       lcurly_loc + tok.span);
 
-    // Tell the lexer to start allowing newlines again.
-    lexer.allow_newlines();
     advance();
 
     return std::make_pair(node, false);
@@ -373,48 +618,69 @@ auto Parser::parse_py_set_or_dict_expr() -> ReturnType {
 
 /*
     This method will continue parsing dict expressions after they have been
-   distinguished from set expressions.
+   distinguished from set expressions. It begins on the ':' after the first key,
+   or on the '**' of the first entry if there is no key. An entry that is
+   unpacked with '**', as in '{**a, "b": 1}', is stored without a key.
 */
 auto Parser::parse_py_dict_expr(Tree::ASTNode *first_expr,
                                 Source::Span start) -> ReturnType {
-    // We will begin parsing here on the colon.
-    advance();
+    // Collect the key value pairs on the scratch stack.
+    ScratchScope contents{pair_scratch};
+    auto *key = first_expr;
 
-    // Now, we need another expression for the value.
-    auto first_val_expr_start = tok.span;
-    auto first_val_expr = parse_py_expr();
+    while (true) {
+        // Consume the ':' after the key, or the '**'.
+        advance();
 
-    if (!first_val_expr.first) {
-        if (!first_val_expr.second) {
-            report_error(
-                first_val_expr_start,
-                "expected expression as value after ':' in dict literal");
+        // Now, we need another expression for the value. An unpacked value
+        // cannot be a comparison, just like a starred expression.
+        auto val_expr_start = tok.span;
+        auto val_expr = key ? parse_py_expr()
+                            : parse_py_binary_expr(Precedence::BitwiseOr);
 
-            return std::make_pair(nullptr, true);
+        if (!val_expr.first) {
+            if (!val_expr.second) {
+                report_error(val_expr_start,
+                             !key ? "expected expression after '**' in dict "
+                                    "literal."
+                             : contents.empty()
+                                 ? "expected expression as value after ':' in "
+                                   "dict literal"
+                                 : "expected expression as value for "
+                                   "key-value pair after ':' in dict literal.");
+                return std::make_pair(nullptr, true);
+            }
+
+            return val_expr;
         }
 
-        return first_val_expr;
-    }
+        // Only the first entry can be followed by a comprehension.
+        if (key && contents.empty() &&
+            (expect(TokenKind::KeywordFor) ||
+             expect(TokenKind::KeywordAsync))) {
+            return parse_py_comprehension(key, val_expr.first, start,
+                                          TokenKind::RightCurly);
+        }
+
+        // Now, we can add the key-value pair to the list.
+        contents.push({key, val_expr.first});
 
-    // Create the list of key value pairs and add the first one.
-    std::vector<std::pair<Tree::ASTNode *, Tree::ASTNode *>> contents;
-    contents.emplace_back(first_expr, first_val_expr.first);
+        // Now, while we have commas, we must keep having key value pairs.
+        if (!expect(TokenKind::Comma)) {
+            break;
+        }
 
-    // Now, while we have commas, we must keep having key value pairs.
-    while (expect(TokenKind::Comma)) {
         // Consume the comma.
         advance();
 
         // The python spec allows trailing commas, so we must check for that.
         if (expect(TokenKind::RightCurly)) {
-            // Create the node, then consume the curly brace.
-            auto *node = arena.allocate<Tree::ASTDictExprNode>(
-                std::move(contents), start + tok.span);
-            // Tell the lexer to start allowing newlines again.
-            lexer.allow_newlines();
-            advance();
+            break;
+        }
 
-            return std::make_pair(node, false);
+        if (expect(TokenKind::AsteriskAsterisk)) {
+            key = nullptr;
+            continue;
         }
 
         // Now, we need a key value pair.
@@ -439,40 +705,155 @@ auto Parser::parse_py_dict_expr(Tree::ASTNode *first_expr,
             return std::make_pair(nullptr, true);
         }
 
-        // Consume the colon.
+        key = key_expr.first;
+    }
+
+    // At the end, we must have a closing curly brace.
+    if (!expect(TokenKind::RightCurly)) {
+        report_error(tok.span, "expected closing '}' in dict literal.");
+    }
+
+    // Create the node, then consume the curly brace.
+    auto *node = make_node<Tree::ASTDictExprNode>(contents.copy_to(arena),
+                                                       start + tok.span);
+    advance();
+
+    return std::make_pair(node, false);
+}
+
+/*
+    This method will parse the clauses of a comprehension once its element has
+   been parsed, along with the closing bracket. The element of a dict
+   comprehension is its key, and the value is missing for any other kind. A
+   generator that is the argument of a call has no brackets of its own, so the
+   closer is 'Dummy' and the comprehension begins at the element.
+*/
+auto Parser::parse_py_comprehension(Tree::ASTNode *element,
+                                    Tree::ASTNode *value, Source::Span start,
+                                    TokenKind closer) -> ReturnType {
+    ScratchScope generators{node_scratch};
+
+    while (expect(TokenKind::KeywordFor) || expect(TokenKind::KeywordAsync)) {
+        auto clause = parse_py_comprehension_clause();
+
+        if (!clause.first) {
+            return clause;
+        }
+
+        generators.push(clause.first);
+    }
+
+    auto bracket = closer == TokenKind::RightSquare  ? TokenKind::LeftSquare
+                   : closer == TokenKind::RightCurly ? TokenKind::LeftCurly
+                                                     : TokenKind::LeftParen;
+    auto generator_list = generators.copy_to(arena);
+
+    if (closer == TokenKind::Dummy) {
+        auto *node = make_node<Tree::ASTComprehensionExprNode>(
+            bracket, element, value, generator_list,
+            Source::Span::merge(
+                start, generator_list[generator_list.size() - 1]->loc));
+
+        return std::make_pair(node, false);
+    }
+
+    if (!expect(closer)) {
+        report_error(tok.span, "expected closing bracket after comprehension.");
+        return std::make_pair(nullptr, true);
+    }
+
+    auto *node = make_node<Tree::ASTComprehensionExprNode>(
+        bracket, element, value, generator_list,
+        Source::Span::merge(start, tok.span));
+    advance();
+
+    return std::make_pair(node, false);
+}
+
+/*
+    This method will parse a single 'for' clause of a comprehension, along with
+   the 'if' clauses that follow it. Like the target of a 'for' statement, the
+   target cannot contain comparisons, and the iterable and the conditions cannot
+   be conditional expressions, since the 'if' would begin a condition.
+*/
+auto Parser::parse_py_comprehension_clause() -> ReturnType {
+    auto start = tok.span;
+    bool is_async = expect(TokenKind::KeywordAsync);
+
+    if (is_async) {
         advance();
 
-        // Now, we must have an expression as the value.
-        auto val_expr_start = tok.span;
-        auto val_expr = parse_py_expr();
+        if (!expect(TokenKind::KeywordFor)) {
+            report_error(tok.span,
+                         "expected 'for' after 'async' in comprehension.");
+            return std::make_pair(nullptr, true);
+        }
+    }
 
-        if (!val_expr.first) {
-            if (!val_expr.second) {
-                report_error(val_expr_start,
-                             "expected expression as value for key-value pair "
-                             "after ':' in dict literal.");
-                return std::make_pair(nullptr, true);
-            }
+    // Consume the 'for'.
+    advance();
 
-            return val_expr;
+    auto target_start = tok.span;
+    auto target = parse_py_expr_list(Precedence::BitwiseOr);
+
+    if (!target.first) {
+        if (!target.second) {
+            report_error(target_start,
+                         "expected target after 'for' in comprehension.");
+            return std::make_pair(nullptr, true);
         }
 
-        // Now, we can add the key-value pair to the list.
-        contents.emplace_back(key_expr.first, val_expr.first);
+        return target;
     }
 
-    // At the end, we must have a closing curly brace.
-    if (!expect(TokenKind::RightCurly)) {
-        report_error(tok.span, "expected closing '}' in dict literal.");
+    if (!expect(TokenKind::KeywordIn)) {
+        report_error(tok.span,
+                     "expected 'in' after target of 'for' in comprehension.");
+        return std::make_pair(nullptr, true);
     }
 
-    // Create the node, then consume the curly brace.
-    auto *node = arena.allocate<Tree::ASTDictExprNode>(std::move(contents),
-                                                       start + tok.span);
-    // Tell the lexer to start allowing newlines again.
-    lexer.allow_newlines();
     advance();
 
+    auto iter_start = tok.span;
+    auto iter = parse_py_binary_expr(Precedence::LogicalOr);
+
+    if (!iter.first) {
+        if (!iter.second) {
+            report_error(iter_start,
+                         "expected expression after 'in' in comprehension.");
+            return std::make_pair(nullptr, true);
+        }
+
+        return iter;
+    }
+
+    ScratchScope ifs{node_scratch};
+    auto end_loc = iter.first->loc;
+
+    while (expect(TokenKind::KeywordIf)) {
+        advance();
+
+        auto condition_start = tok.span;
+        auto condition = parse_py_binary_expr(Precedence::LogicalOr);
+
+        if (!condition.first) {
+            if (!condition.second) {
+                report_error(condition_start,
+                             "expected condition after 'if' in comprehension.");
+                return std::make_pair(nullptr, true);
+            }
+
+            return condition;
+        }
+
+        ifs.push(condition.first);
+        end_loc = condition.first->loc;
+    }
+
+    auto *node = make_node<Tree::ASTComprehensionClauseNode>(
+        is_async, target.first, iter.first, ifs.copy_to(arena),
+        Source::Span::merge(start, end_loc));
+
     return std::make_pair(node, false);
 }
 
@@ -496,8 +877,8 @@ auto Parser::parse_py_attr_ref_expr(Tree::ASTNode *expr) -> ReturnType {
 
         // Now that we have the identifier, we can create the node and replace
         // the existing node with the new one.
-        auto *name_expr = arena.allocate<Tree::ASTNameExprNode>(tok.span);
-        expr = arena.allocate<Tree::ASTAttrRefExprNode>(expr, name_expr,
+        auto *name_expr = make_node<Tree::ASTNameExprNode>(tok.span);
+        expr = make_node<Tree::ASTAttrRefExprNode>(expr, name_expr,
                                                         expr->loc + tok.span);
 
         // Now, we can consume the identifier.
@@ -521,7 +902,7 @@ auto Parser::parse_py_call_expr(Tree::ASTNode *callee) -> ReturnType {
     // we have no arguments.
     if (expect(TokenKind::RightParen)) {
         // We can create the node with no arguments.
-        auto *node = arena.allocate<Tree::ASTCallExprNode>(
+        auto *node = make_node<Tree::ASTCallExprNode>(
             callee, callee->loc + tok.span);
 
         // Now, we can consume the right parenthesis and return.
@@ -531,7 +912,7 @@ auto Parser::parse_py_call_expr(Tree::ASTNode *callee) -> ReturnType {
 
     // Now, we must have an expression as an argument.
     auto first_arg_start = tok.span;
-    auto first_arg = parse_py_expr();
+    auto first_arg = parse_py_call_arg();
 
     if (!first_arg.first) {
         if (!first_arg.second) {
@@ -545,15 +926,20 @@ auto Parser::parse_py_call_expr(Tree::ASTNode *callee) -> ReturnType {
         return first_arg;
     }
 
-    std::vector<Tree::ASTNode *> args;
-    args.push_back(first_arg.first);
+    ScratchScope args{node_scratch};
+    args.push(first_arg.first);
 
     // Now, while we still get commas, we need to check for arguments.
     while (expect(TokenKind::Comma)) {
         advance();
 
+        // The python spec allows trailing commas, so we must check for that.
+        if (expect(TokenKind::RightParen)) {
+            break;
+        }
+
         auto arg_start = tok.span;
-        auto arg = parse_py_expr();
+        auto arg = parse_py_call_arg();
 
         if (!arg.first) {
             if (!arg.second) {
@@ -567,7 +953,7 @@ auto Parser::parse_py_call_expr(Tree::ASTNode *callee) -> ReturnType {
 
         // If we get the argument as a valid expression, we can just add it to
         // the list.
-        args.push_back(arg.first);
+        args.push(arg.first);
     }
 
     // Now, we need a closing ')' at the end of the call expression.
@@ -577,8 +963,8 @@ auto Parser::parse_py_call_expr(Tree::ASTNode *callee) -> ReturnType {
     }
 
     // Once we have matched the whole expression, we can make the node.
-    auto *node = arena.allocate<Tree::ASTCallExprNode>(callee, std::move(args),
-                                                       callee->loc + tok.span);
+    auto *node = make_node<Tree::ASTCallExprNode>(
+        callee, args.copy_to(arena), callee->loc + tok.span);
     // Consume the ')'
     advance();
 
@@ -586,21 +972,90 @@ auto Parser::parse_py_call_expr(Tree::ASTNode *callee) -> ReturnType {
 }
 
 /*
-    This method will parse slice expressions. Python has two main types of slice
-   expressions - indexing and proper list slicing. Indexing is where a single
-   index is sliced, returning the element at that index. In proper list slicing,
-   a range is passed to the slicing operator and a new list is returned in those
-   bounds.
+    This method will parse a single argument of a call expression. Besides plain
+   expressions, arguments can be unpacked with '*' or '**', or be passed by
+   keyword, as in 'f(*args, key=value)'.
 */
-auto Parser::parse_py_slice_expr(Tree::ASTNode *slicee) -> ReturnType {
-    // First, we must consume the square bracket that opens the slice
-    // expression.
-    advance();
+auto Parser::parse_py_call_arg() -> ReturnType {
+    if (expect(TokenKind::Asterisk) || expect(TokenKind::AsteriskAsterisk)) {
+        auto op = tok;
+        advance();
 
-    // We have two possible cases here. We can have either an expression, or a
-    // colon.
-    if (expect(TokenKind::Colon)) {
-        // If we get a colon, we know that it is a proper slice expression.
+        auto expr_start = tok.span;
+        auto expr = parse_py_expr();
+
+        if (!expr.first) {
+            if (!expr.second) {
+                report_error(expr_start, "expected expression after '*' or "
+                                         "'**' in function call.");
+                return std::make_pair(nullptr, true);
+            }
+
+            return expr;
+        }
+
+        auto *node = make_node<Tree::ASTStarredExprNode>(
+            expr.first, op.kind, Source::Span::merge(op.span, expr.first->loc));
+
+        return std::make_pair(node, false);
+    }
+
+    // A keyword argument is an identifier followed by '=', which needs the 2nd
+    // lookahead to tell it apart from an expression. An expression may be the
+    // element of a generator, as in 'f(x for x in a)'.
+    if (!expect(TokenKind::Identifier) || peek().kind != TokenKind::Equals) {
+        auto expr = parse_py_expr();
+
+        if (!expr.first || (!expect(TokenKind::KeywordFor) &&
+                            !expect(TokenKind::KeywordAsync))) {
+            return expr;
+        }
+
+        return parse_py_comprehension(expr.first, nullptr, expr.first->loc,
+                                      TokenKind::Dummy);
+    }
+
+    auto *name = make_node<Tree::ASTNameExprNode>(tok.span);
+
+    // Consume both the identifier and the '='.
+    advance();
+    advance();
+
+    auto value_start = tok.span;
+    auto value = parse_py_expr();
+
+    if (!value.first) {
+        if (!value.second) {
+            report_error(value_start, "expected expression after '=' in "
+                                      "keyword argument.");
+            return std::make_pair(nullptr, true);
+        }
+
+        return value;
+    }
+
+    auto *node = make_node<Tree::ASTKeywordArgNode>(
+        name, value.first, Source::Span::merge(name->loc, value.first->loc));
+
+    return std::make_pair(node, false);
+}
+
+/*
+    This method will parse slice expressions. Python has two main types of slice
+   expressions - indexing and proper list slicing. Indexing is where a single
+   index is sliced, returning the element at that index. In proper list slicing,
+   a range is passed to the slicing operator and a new list is returned in those
+   bounds.
+*/
+auto Parser::parse_py_slice_expr(Tree::ASTNode *slicee) -> ReturnType {
+    // First, we must consume the square bracket that opens the slice
+    // expression.
+    advance();
+
+    // We have two possible cases here. We can have either an expression, or a
+    // colon.
+    if (expect(TokenKind::Colon)) {
+        // If we get a colon, we know that it is a proper slice expression.
         return parse_py_proper_slice_expr(slicee, nullptr);
     }
 
@@ -625,6 +1080,40 @@ auto Parser::parse_py_slice_expr(Tree::ASTNode *slicee) -> ReturnType {
         return parse_py_proper_slice_expr(slicee, index_expr.first);
     }
 
+    // Several indices separated by commas form a tuple, as in 'Dict[str, int]'.
+    if (expect(TokenKind::Comma)) {
+        ScratchScope indices{node_scratch};
+        indices.push(index_expr.first);
+
+        while (expect(TokenKind::Comma)) {
+            advance();
+
+            if (expect(TokenKind::RightSquare)) {
+                break;
+            }
+
+            auto expr_start = tok.span;
+            auto expr = parse_py_expr();
+
+            if (!expr.first) {
+                if (!expr.second) {
+                    report_error(expr_start, "expected expression after ',' "
+                                             "in slicing expression.");
+                    return std::make_pair(nullptr, true);
+                }
+
+                return expr;
+            }
+
+            indices.push(expr.first);
+        }
+
+        auto elements = indices.copy_to(arena);
+        index_expr.first = make_node<Tree::ASTTupleExprNode>(
+            elements, Source::Span::merge(elements[0]->loc,
+                                          elements[elements.size() - 1]->loc));
+    }
+
     // If we don't have a colon, we must have a square bracket.
     if (!expect(TokenKind::RightSquare)) {
         report_error(tok.span, "expected closing ']' after index expression in "
@@ -634,7 +1123,7 @@ auto Parser::parse_py_slice_expr(Tree::ASTNode *slicee) -> ReturnType {
     }
 
     // Otherwise, we can make the node.
-    auto *node = arena.allocate<Tree::ASTIndexSliceExprNode>(
+    auto *node = make_node<Tree::ASTIndexSliceExprNode>(
         slicee, index_expr.first, slicee->loc + tok.span);
 
     advance();
@@ -642,38 +1131,60 @@ auto Parser::parse_py_slice_expr(Tree::ASTNode *slicee) -> ReturnType {
     return std::make_pair(node, false);
 }
 
+// This method will parse proper slices, beginning on the first ':'. Any of the
+// lower bound, the upper bound, and the step may be missing, as in 'a[::2]'.
 auto Parser::parse_py_proper_slice_expr(
     Tree::ASTNode *slicee, Tree::ASTNode *lower_bound) -> ReturnType {
     // The first thing we must do here is consume the colon.
     advance();
 
-    // Now, we may or may not get an expression.
-    // We will first check for a square bracket. If we get one, it means we
-    // don't need an expression for the lower bound.
-    if (expect(TokenKind::RightSquare)) {
-        auto *node = arena.allocate<Tree::ASTProperSliceExprNode>(
-            slicee, lower_bound, nullptr, slicee->loc + tok.span);
+    // Now, we may or may not get an expression for the upper bound. If we get a
+    // square bracket or the colon before the step, it is missing.
+    Tree::ASTNode *upper_bound = nullptr;
 
-        // Consume the right square bracket.
-        advance();
+    if (!expect(TokenKind::RightSquare) && !expect(TokenKind::Colon)) {
+        auto upper_bound_start = tok.span;
+        auto upper_bound_expr = parse_py_expr();
 
-        return std::make_pair(node, false);
+        if (!upper_bound_expr.first) {
+            if (!upper_bound_expr.second) {
+                report_error(upper_bound_start,
+                             "expected expression as upper bound after ':' in "
+                             "proper slicing expression.");
+
+                return std::make_pair(nullptr, true);
+            }
+
+            return upper_bound_expr;
+        }
+
+        upper_bound = upper_bound_expr.first;
     }
 
-    // Otherwise, we must have an expression here.
-    auto upper_bound_start = tok.span;
-    auto upper_bound = parse_py_expr();
+    // A second colon may be followed by the step.
+    Tree::ASTNode *step = nullptr;
 
-    if (!upper_bound.first) {
-        if (!upper_bound.second) {
-            report_error(upper_bound_start,
-                         "expected expression as upper bound after ':' in "
-                         "proper slicing expression.");
+    if (expect(TokenKind::Colon)) {
+        advance();
 
-            return std::make_pair(nullptr, true);
-        }
+        if (!expect(TokenKind::RightSquare)) {
+            auto step_start = tok.span;
+            auto step_expr = parse_py_expr();
+
+            if (!step_expr.first) {
+                if (!step_expr.second) {
+                    report_error(step_start,
+                                 "expected expression as step after ':' in "
+                                 "proper slicing expression.");
+
+                    return std::make_pair(nullptr, true);
+                }
+
+                return step_expr;
+            }
 
-        return upper_bound;
+            step = step_expr.first;
+        }
     }
 
     // Now, we must have a right square bracket.
@@ -683,57 +1194,22 @@ auto Parser::parse_py_proper_slice_expr(
     }
 
     // Now, we can make the node and consume the ']'.
-    auto *node = arena.allocate<Tree::ASTProperSliceExprNode>(
-        slicee, lower_bound, upper_bound.first, slicee->loc + tok.span);
+    auto *node = make_node<Tree::ASTProperSliceExprNode>(
+        slicee, lower_bound, upper_bound, step, slicee->loc + tok.span);
 
     advance();
 
     return std::make_pair(node, false);
 }
 
-auto Parser::parse_py_exponentiation_expr() -> ReturnType {
-    // Since this is a binary expression, we need an LHS and RHS.
-    // For this case, the LHS will be a primary expression.
-    auto lhs = parse_py_atom_and_primary_expr();
-    if (!lhs.first) {
-        // In this case, we want to propagate the error up to the caller.
-        return lhs;
-    }
-
-    auto *lhs_node = lhs.first;
-
-    // Now, we need the operator.
-    while (expect(TokenKind::AsteriskAsterisk)) {
-        // Consume the operator.
-        advance();
-
-        // After the operator, we must have an RHS.
-        auto rhs_start = tok.span;
-        auto rhs = parse_py_unary_op_expr();
-
-        if (!rhs.first) {
-            if (!rhs.second) {
-                report_error(rhs_start, "expected expression on right hand "
-                                        "size of the binary operator '**'.");
-                return std::make_pair(nullptr, true);
-            }
-
-            return rhs;
-        }
-
-        // Now, that we have the RHS, we can create the node.
-        lhs_node = arena.allocate<Tree::ASTBinaryOpExprNode>(
-            lhs_node, rhs.first, TokenKind::AsteriskAsterisk,
-            lhs_node->loc + rhs.first->loc);
-    }
-
-    // At the end, we can simply return the node.
-    return std::make_pair(lhs_node, false);
-}
-
-auto Parser::parse_py_unary_op_expr() -> ReturnType {
-    // First, we need to check for a unary operator.
-    // If we don't have one, we can keep parsing expressions like normal.
+/*
+    This method will parse the operand of a binary operator, which is a primary
+   expression that may be preceded by prefix operators. The prefix 'not' binds
+   more loosely than the comparisons, so it is only accepted where the minimum
+   precedence allows it. For example, 'a < not b' is not valid. The operand of
+   'await' is a primary expression, so it binds more tightly than any operator.
+*/
+auto Parser::parse_py_prefix_expr(Precedence min_prec) -> ReturnType {
     switch (tok.kind) {
     case TokenKind::Plus:
     case TokenKind::Minus:
@@ -744,7 +1220,7 @@ auto Parser::parse_py_unary_op_expr() -> ReturnType {
         advance();
 
         auto expr_start = tok.span;
-        auto expr = parse_py_unary_op_expr();
+        auto expr = parse_py_binary_expr(Precedence::Unary);
 
         if (!expr.first) {
             if (!expr.second) {
@@ -757,270 +1233,146 @@ auto Parser::parse_py_unary_op_expr() -> ReturnType {
         }
 
         // Now, we can return the node.
-        auto *node = arena.allocate<Tree::ASTUnaryOpExprNode>(
+        auto *node = make_node<Tree::ASTUnaryOpExprNode>(
             expr.first, op.kind, op.span + expr.first->loc);
 
         return std::make_pair(node, false);
     }
-    default: {
-        // If we don't find a unary operator, we can just treat this like a
-        // regular exponentiation expression.
-        return parse_py_exponentiation_expr();
-    }
-    }
-}
-
-auto Parser::parse_py_multiplication_expr() -> ReturnType {
-    // First, we need to obtain an LHS.
-    auto lhs_start = tok.span;
-    auto lhs = parse_py_unary_op_expr();
-
-    if (!lhs.first) {
-        // Here, we just want to propagate the error upto the caller.
-        return lhs;
-    }
-
-    auto lhs_node = lhs.first;
-
-    // Now, while we have operators of this precedence - '*', '/', and '%', we
-    // want to consume the operator and get an RHS.
-    while (true) {
-        switch (tok.kind) {
-        case TokenKind::Asterisk:
-        case TokenKind::Slash:
-        case TokenKind::Percent: {
-            auto op = tok.kind;
-            advance();
+    case TokenKind::KeywordNot: {
+        // Where 'not' is not allowed, we let the primary expression fail so
+        // that the caller reports the missing operand.
+        if (min_prec > Precedence::LogicalNot) {
+            return parse_py_atom_and_primary_expr();
+        }
 
-            auto rhs_start = tok.span;
-            auto rhs = parse_py_unary_op_expr();
+        // Now that we know we have a 'not' operator, we must store its location
+        // and advance.
+        auto not_loc = tok.span;
+        advance();
 
-            if (!rhs.first) {
-                if (!rhs.second) {
-                    report_error(rhs_start, "expected expression on the right "
-                                            "hand side of a binary operator.");
+        // Following the 'not' keyword, we must have an expression.
+        auto expr = parse_py_binary_expr(Precedence::LogicalNot);
 
-                    return std::make_pair(nullptr, true);
-                }
+        if (!expr.first) {
+            if (!expr.second) {
+                report_error(
+                    not_loc,
+                    "expected expression after the unary operator '!'.");
 
-                return rhs;
+                return std::make_pair(nullptr, true);
             }
 
-            // Now, we can make the node.
-            lhs_node = arena.allocate<Tree::ASTBinaryOpExprNode>(
-                lhs_node, rhs.first, op, lhs_node->loc + rhs.first->loc);
-
-            break;
-        }
-        default: {
-            // If we don't find the operator, we want to return the LHS that we
-            // have.
-            return std::make_pair(lhs_node, false);
-        }
+            return expr;
         }
-    }
-}
 
-auto Parser::parse_py_addition_expr() -> ReturnType {
-    // First, we need to obtain an LHS.
-    auto lhs_start = tok.span;
-    auto lhs = parse_py_multiplication_expr();
+        // Otherwise, we have a valid expression and we can make the node.
+        auto *node = make_node<Tree::ASTUnaryOpExprNode>(
+            expr.first, TokenKind::KeywordNot, not_loc + expr.first->loc);
 
-    if (!lhs.first) {
-        // Here, we just want to propagate the error upto the caller.
-        return lhs;
+        return std::make_pair(node, false);
     }
+    case TokenKind::KeywordAwait: {
+        auto await_loc = tok.span;
+        advance();
 
-    auto lhs_node = lhs.first;
-
-    // Now, while we have operators of this precedence - '+' and '-', we
-    // want to consume the operator and get an RHS.
-    while (true) {
-        switch (tok.kind) {
-        case TokenKind::Plus:
-        case TokenKind::Minus: {
-            auto op = tok.kind;
-            advance();
-
-            auto rhs_start = tok.span;
-            auto rhs = parse_py_multiplication_expr();
-
-            if (!rhs.first) {
-                if (!rhs.second) {
-                    report_error(rhs_start, "expected expression on the right "
-                                            "hand side of a binary operator.");
-
-                    return std::make_pair(nullptr, true);
-                }
+        auto expr_start = tok.span;
+        auto expr = parse_py_atom_and_primary_expr();
 
-                return rhs;
+        if (!expr.first) {
+            if (!expr.second) {
+                report_error(expr_start, "expected expression after 'await'.");
+                return std::make_pair(nullptr, true);
             }
 
-            // Now, we can make the node.
-            lhs_node = arena.allocate<Tree::ASTBinaryOpExprNode>(
-                lhs_node, rhs.first, op, lhs_node->loc + rhs.first->loc);
-            break;
-        }
-        default: {
-            // If we don't find the operator, we want to return the LHS that we
-            // have.
-            return std::make_pair(lhs_node, false);
-        }
+            return expr;
         }
-    }
-}
 
-auto Parser::parse_py_bitshift_expr() -> ReturnType {
-    // First, we need to obtain an LHS.
-    auto lhs_start = tok.span;
-    auto lhs = parse_py_addition_expr();
+        auto *node = make_node<Tree::ASTAwaitExprNode>(
+            expr.first, await_loc + expr.first->loc);
 
-    if (!lhs.first) {
-        // Here, we just want to propagate the error upto the caller.
-        return lhs;
+        return std::make_pair(node, false);
+    }
+    default: {
+        return parse_py_atom_and_primary_expr();
     }
-
-    auto lhs_node = lhs.first;
-
-    // Now, while we have operators of this precedence - '<<' and '>>', we
-    // want to consume the operator and get an RHS.
-    while (true) {
-        switch (tok.kind) {
-        case TokenKind::GreaterGreater:
-        case TokenKind::LessLess: {
-            auto op = tok.kind;
-            advance();
-
-            auto rhs_start = tok.span;
-            auto rhs = parse_py_addition_expr();
-
-            if (!rhs.first) {
-                if (!rhs.second) {
-                    report_error(rhs_start, "expected expression on the right "
-                                            "hand side of a binary operator.");
-
-                    return std::make_pair(nullptr, true);
-                }
-
-                return rhs;
-            }
-
-            // Now, we can make the node.
-            lhs_node = arena.allocate<Tree::ASTBinaryOpExprNode>(
-                lhs_node, rhs.first, op, lhs_node->loc + rhs.first->loc);
-            break;
-        }
-        default: {
-            // If we don't find the operator, we want to return the LHS that we
-            // have.
-            return std::make_pair(lhs_node, false);
-        }
-        }
     }
 }
 
-auto Parser::parse_py_bitwise_and_expr() -> ReturnType {
-    // First, we need to obtain an LHS.
-    auto lhs_start = tok.span;
-    auto lhs = parse_py_bitshift_expr();
-
-    if (!lhs.first) {
-        // Here, we just want to propagate the error upto the caller.
-        return lhs;
+/*
+    This method will parse binary expressions by precedence climbing. Rather
+   than descending through one method per precedence level, it parses an operand
+   and then keeps folding operators into the left hand side for as long as they
+   bind at least as tightly as the minimum precedence. The right hand side is
+   parsed with the minimum precedence of the operator from the operator table,
+   so recursion only happens where the precedence actually increases.
+*/
+auto Parser::parse_py_binary_expr(Precedence min_prec) -> ReturnType {
+    // Every level of nesting goes through this method, so this is where the
+    // explicit stack takes over from the recursion.
+    if (expr_parse_mode == ExprParseMode::Iterative ||
+        (expr_parse_mode == ExprParseMode::Adaptive &&
+         nesting_depth >= MAX_RECURSION_DEPTH)) {
+        return parse_py_expr_iteratively(ExprFrameKind::Binary, min_prec);
     }
 
-    auto lhs_node = lhs.first;
-
-    // Now, while we have the '&' operator, we must keep getting an RHS.
-    while (expect(TokenKind::Ampersand)) {
-        advance();
-
-        auto rhs_start = tok.span;
-        auto rhs = parse_py_bitshift_expr();
-
-        if (!rhs.first) {
-            if (!rhs.second) {
-                report_error(rhs_start, "expected expression on the right hand "
-                                        "side of the binary operator '&'.");
-
-                return std::make_pair(nullptr, true);
-            }
-
-            return rhs;
-        }
-
-        // Now, we can make the node.
-        lhs_node = arena.allocate<Tree::ASTBinaryOpExprNode>(
-            lhs_node, rhs.first, TokenKind::Ampersand,
-            lhs_node->loc + rhs.first->loc);
+    if (!check_nesting_depth()) {
+        return std::make_pair(nullptr, true);
     }
 
-    return std::make_pair(lhs_node, false);
-}
+    // The depth is restored however this method returns.
+    struct DepthGuard {
+        size_t &depth;
+        ~DepthGuard() { --depth; }
+    } depth_guard{++nesting_depth};
 
-auto Parser::parse_py_bitwise_xor_expr() -> ReturnType {
     // First, we need to obtain an LHS.
-    auto lhs_start = tok.span;
-    auto lhs = parse_py_bitwise_and_expr();
+    auto lhs = parse_py_prefix_expr(min_prec);
 
     if (!lhs.first) {
         // Here, we just want to propagate the error upto the caller.
         return lhs;
     }
 
-    auto lhs_node = lhs.first;
-
-    // Now, while we have the '^' operator, we must keep getting an RHS.
-    while (expect(TokenKind::Caret)) {
-        advance();
+    auto *lhs_node = lhs.first;
 
-        auto rhs_start = tok.span;
-        auto rhs = parse_py_bitwise_and_expr();
+    while (true) {
+        // Tokens that are not binary operators have the lowest precedence, so
+        // they always end the loop.
+        auto &info = binary_op_info(tok.kind);
+        if (info.prec < min_prec || info.prec == Precedence::None) {
+            return std::make_pair(lhs_node, false);
+        }
 
-        if (!rhs.first) {
-            if (!rhs.second) {
-                report_error(rhs_start, "expected expression on the right hand "
-                                        "side of the binary operator '^'.");
+        auto op = tok.kind;
+        auto op_loc = tok.span;
+        advance();
 
-                return std::make_pair(nullptr, true);
+        // Now, we must handle the operators that are made up of two keywords.
+        if (op == TokenKind::KeywordIs) {
+            if (expect(TokenKind::KeywordNot)) {
+                op = TokenKind::IsNotOp;
+                advance();
+            }
+        } else if (op == TokenKind::KeywordNot) {
+            // This 'not' must be followed by an 'in' to form the complete
+            // operator 'not in'. However, for error recovery purposes, we will
+            // treat just 'not' as 'not in' as well.
+            if (!expect(TokenKind::KeywordIn)) {
+                report_error(op_loc, "'not' is not a valid operator. Did you "
+                                     "mean 'not in' instead?");
+            } else {
+                advance();
             }
 
-            return rhs;
+            op = TokenKind::NotInOp;
         }
 
-        // Now, we can make the node.
-        lhs_node = arena.allocate<Tree::ASTBinaryOpExprNode>(
-            lhs_node, rhs.first, TokenKind::Caret,
-            lhs_node->loc + rhs.first->loc);
-    }
-
-    return std::make_pair(lhs_node, false);
-}
-
-auto Parser::parse_py_bitwise_or_expr() -> ReturnType {
-    // First, we need to obtain an LHS.
-    auto lhs_start = tok.span;
-    auto lhs = parse_py_bitwise_xor_expr();
-
-    if (!lhs.first) {
-        // Here, we just want to propagate the error upto the caller.
-        return lhs;
-    }
-
-    auto lhs_node = lhs.first;
-
-    // Now, while we have the '|' operator, we must keep getting an RHS.
-    while (expect(TokenKind::Bar)) {
-        advance();
-
         auto rhs_start = tok.span;
-        auto rhs = parse_py_bitwise_xor_expr();
+        auto rhs = parse_py_binary_expr(info.rhs_prec);
 
         if (!rhs.first) {
             if (!rhs.second) {
-                report_error(rhs_start, "expected expression on the right hand "
-                                        "side of the binary operator '|'.");
-
+                report_error(rhs_start, info.rhs_error);
                 return std::make_pair(nullptr, true);
             }
 
@@ -1028,393 +1380,379 @@ auto Parser::parse_py_bitwise_or_expr() -> ReturnType {
         }
 
         // Now, we can make the node.
-        lhs_node = arena.allocate<Tree::ASTBinaryOpExprNode>(
-            lhs_node, rhs.first, TokenKind::Bar,
-            lhs_node->loc + rhs.first->loc);
+        lhs_node = make_node<Tree::ASTBinaryOpExprNode>(
+            lhs_node, rhs.first, op, lhs_node->loc + rhs.first->loc);
     }
-
-    return std::make_pair(lhs_node, false);
 }
 
-auto Parser::parse_py_comparison_expr() -> ReturnType {
-    // First, we need to obtain an LHS.
-    auto lhs_start = tok.span;
-    auto lhs = parse_py_bitwise_or_expr();
-
-    if (!lhs.first) {
-        // Here, we just want to propagate the error upto the caller.
-        return lhs;
-    }
+/*
+    This method will parse assignment expressions and conditional expressions.
+   The right hand side of ':=' and the false case of a conditional expression
+   are whole expressions, so chains of them nest to the right. Rather than
+   recursing once for every link, the links are parsed in a loop and kept on the
+   pair scratch stack until the innermost expression is known, and the nodes are
+   then made from the inside out. This way, a long chain uses neither the native
+   stack nor any of the nesting depth.
+*/
+auto Parser::parse_py_assignment_expr() -> ReturnType {
+    // The first element of each link is the name of an assignment expression or
+    // the condition of a conditional expression. The second element is null for
+    // an assignment expression, and the true case for a conditional one.
+    ScratchScope<std::pair<Tree::ASTNode *, Tree::ASTNode *>> links{
+        pair_scratch};
 
-    auto lhs_node = lhs.first;
+    // This is the error that is reported if the expression that ends the
+    // current link is missing, along with where that expression should start.
+    const char *rhs_error = nullptr;
+    auto rhs_start = tok.span;
 
-    // Now, while we have operators of this precedence - '>', '<', '>=', '<=',
-    // '!=', '==', 'is', 'is not', 'in', 'not in', and '%', we want to consume
-    // the operator and get an RHS.
     while (true) {
-        switch (tok.kind) {
-        case TokenKind::Less:
-        case TokenKind::LessEquals:
-        case TokenKind::Greater:
-        case TokenKind::GreaterEquals:
-        case TokenKind::EqualsEquals:
-        case TokenKind::ExclamationEquals: {
-            auto op = tok.kind;
+        // In order to determine if we have an assignment expression, we need
+        // two lookahead tokens. If the identifier is followed by the ':='
+        // operator, it is the name that is being assigned to.
+        if (expect(TokenKind::Identifier) &&
+            peek().kind == TokenKind::ColonEquals) {
+            links.push({make_node<Tree::ASTNameExprNode>(tok.span), nullptr});
+
+            // Now, we can consume both the identifier and the ':=' operator.
+            advance();
             advance();
 
-            auto rhs_start = tok.span;
-            auto rhs = parse_py_bitwise_or_expr();
-
-            if (!rhs.first) {
-                if (!rhs.second) {
-                    report_error(rhs_start, "expected expression on the right "
-                                            "hand side of a binary operator.");
-
-                    return std::make_pair(nullptr, true);
-                }
+            rhs_error = "expected expression on the right hand side of the "
+                        "binary operator ':='.";
+            rhs_start = tok.span;
+            continue;
+        }
 
-                return rhs;
+        // Otherwise, we must get an expression, which is the condition if it is
+        // followed by an if-else clause. The body of a lambda takes the rest of
+        // the expression, so a lambda is always the innermost expression.
+        auto condition = expect(TokenKind::KeywordLambda)
+                             ? parse_py_lambda_expr()
+                             : parse_py_binary_expr(Precedence::LogicalOr);
+        if (!condition.first) {
+            if (!condition.second && rhs_error) {
+                report_error(rhs_start, rhs_error);
+                return std::make_pair(nullptr, true);
             }
 
-            // Now, we can make the node.
-            lhs_node = arena.allocate<Tree::ASTBinaryOpExprNode>(
-                lhs_node, rhs.first, op, lhs_node->loc + rhs.first->loc);
-            break;
+            // Here, we will just propagate errors up to the caller.
+            return condition;
         }
 
-        case TokenKind::KeywordIs: {
-            // This branch allows for two possible operators: 'is' and 'is not'.
-            auto op = TokenKind::KeywordIs;
-            advance();
-
-            // Now, we must check for 'is not'.
-            if (expect(TokenKind::KeywordNot)) {
-                op = TokenKind::IsNotOp;
-                advance();
+        if (!expect(TokenKind::KeywordIf)) {
+            // This is the innermost expression, so the links can be made into
+            // nodes around it.
+            auto *node = condition.first;
+            while (!links.empty()) {
+                auto [first, true_expr] = links.pop();
+
+                if (!true_expr) {
+                    node = make_node<Tree::ASTBinaryOpExprNode>(
+                        first, node, TokenKind::ColonEquals,
+                        first->loc + node->loc);
+                } else {
+                    node = make_node<Tree::ASTTernaryOpExprNode>(
+                        first, true_expr, node, first->loc + node->loc);
+                }
             }
 
-            // Now, we just need an RHS.
-            auto rhs_start = tok.span;
-            auto rhs = parse_py_bitwise_or_expr();
+            return std::make_pair(node, false);
+        }
 
-            if (!rhs.first) {
-                if (!rhs.second) {
-                    report_error(rhs_start, "expected expression on the right "
-                                            "hand side of a binary operator.");
+        // Consume the if keyword.
+        advance();
 
-                    return std::make_pair(nullptr, true);
-                }
+        // Now, we need another expression for the true case.
+        auto true_expr_start = tok.span;
+        auto true_expr = parse_py_binary_expr(Precedence::LogicalOr);
+
+        if (!true_expr.first) {
+            if (!true_expr.second) {
+                report_error(true_expr_start, "expected expression after 'if' "
+                                              "in conditional expression.");
 
-                return rhs;
+                return std::make_pair(nullptr, true);
             }
 
-            // Now, we can make the node.
-            lhs_node = arena.allocate<Tree::ASTBinaryOpExprNode>(
-                lhs_node, rhs.first, op, lhs_node->loc + rhs.first->loc);
-            break;
+            return true_expr;
         }
 
-        case TokenKind::KeywordIn: {
-            advance();
+        // Now, we need an 'else' clause.
+        if (!expect(TokenKind::KeywordElse)) {
+            report_error(tok.span, "expected 'else' clause after expression "
+                                   "within conditional expression.");
 
-            // Now, we just need an RHS.
-            auto rhs_start = tok.span;
-            auto rhs = parse_py_bitwise_or_expr();
+            return std::make_pair(nullptr, true);
+        }
 
-            if (!rhs.first) {
-                if (!rhs.second) {
-                    report_error(rhs_start,
-                                 "expected expression on the right "
-                                 "hand side of the binary operator 'in'.");
+        // Consume 'else'. The expression for the false case is parsed by the
+        // next iteration.
+        advance();
 
-                    return std::make_pair(nullptr, true);
-                }
+        links.push({condition.first, true_expr.first});
+        rhs_error =
+            "expected expression after 'false' in conditional expression.";
+        rhs_start = tok.span;
+    }
+}
 
-                return rhs;
-            }
+/*
+    This method will parse a lambda. Its parameters are parsed like those of a
+   function, except that they cannot have annotations, and its body is a whole
+   expression. Lambdas can be nested within their own bodies and default values,
+   so they count towards the nesting depth just like binary expressions.
+*/
+auto Parser::parse_py_lambda_expr() -> ReturnType {
+    if (expr_parse_mode == ExprParseMode::Iterative ||
+        (expr_parse_mode == ExprParseMode::Adaptive &&
+         nesting_depth >= MAX_RECURSION_DEPTH)) {
+        return parse_py_expr_iteratively(ExprFrameKind::Lambda,
+                                         Precedence::None);
+    }
 
-            // Now, we can make the node.
-            lhs_node = arena.allocate<Tree::ASTBinaryOpExprNode>(
-                lhs_node, rhs.first, TokenKind::KeywordIn,
-                lhs_node->loc + rhs.first->loc);
-            break;
-        }
+    if (!check_nesting_depth()) {
+        return std::make_pair(nullptr, true);
+    }
 
-        case TokenKind::KeywordNot: {
-            // This is a tricky case. This 'not' must be followed by an 'in' to
-            // form the complete operator 'not in'. However, for error recovery
-            // purposes, we will treat just 'not' as 'not in' as well.
-            auto not_loc = tok.span;
-            advance();
+    // The depth is restored however this method returns.
+    struct DepthGuard {
+        size_t &depth;
+        ~DepthGuard() { --depth; }
+    } depth_guard{++nesting_depth};
 
-            if (!expect(TokenKind::KeywordIn)) {
-                report_error(not_loc, "'not' is not a valid operator. Did you "
-                                      "mean 'not in' instead?");
-            } else {
-                // If we do get the operator, we must consume it.
-                advance();
-            }
+    auto start = tok.span;
+    advance();
 
-            // Now, we just need an RHS.
-            auto rhs_start = tok.span;
-            auto rhs = parse_py_bitwise_or_expr();
+    ScratchScope params{node_scratch};
 
-            if (!rhs.first) {
-                if (!rhs.second) {
-                    report_error(rhs_start, "expected expression on the right "
-                                            "hand side of a binary operator.");
+    while (!expect(TokenKind::Colon)) {
+        Source::Span end_loc = tok.span;
+        auto param = parse_py_param(end_loc, false);
 
-                    return std::make_pair(nullptr, true);
-                }
+        if (!param.first) {
+            return param;
+        }
 
-                return rhs;
-            }
+        params.push(param.first);
 
-            // Now, we can make the node.
-            lhs_node = arena.allocate<Tree::ASTBinaryOpExprNode>(
-                lhs_node, rhs.first, TokenKind::NotInOp,
-                lhs_node->loc + rhs.first->loc);
+        if (!expect(TokenKind::Comma)) {
             break;
         }
 
-        default: {
-            // If we don't find the operator, we want to return the LHS that we
-            // have.
-            return std::make_pair(lhs_node, false);
-        }
-        }
+        advance();
     }
-}
 
-auto Parser::parse_py_unary_not_expr() -> ReturnType {
-    // Here we have two choices - we can either get a 'not' operator, or
-    // continue down to a comparison expression.
-    if (!expect(TokenKind::KeywordNot)) {
-        return parse_py_comparison_expr();
+    if (!expect(TokenKind::Colon)) {
+        report_error(tok.span, "expected ':' after parameters of lambda.");
+        return std::make_pair(nullptr, true);
     }
 
-    // Now that we know we have a 'not' operator, we must store its location and
-    // advance.
-    auto not_loc = tok.span;
+    auto param_list = params.copy_to(arena);
     advance();
 
-    // Following the 'not' keyword, we must have an expression.
-    auto expr_start = tok.span;
-    auto expr = parse_py_unary_not_expr();
-
-    if (!expr.first) {
-        if (!expr.second) {
-            report_error(not_loc,
-                         "expected expression after the unary operator '!'.");
+    auto body_start = tok.span;
+    auto body = parse_py_expr();
 
+    if (!body.first) {
+        if (!body.second) {
+            report_error(body_start,
+                         "expected expression after ':' in lambda.");
             return std::make_pair(nullptr, true);
         }
 
-        return expr;
+        return body;
     }
 
-    // Otherwise, we have a valid expression and we can make the node.
-    auto *node = arena.allocate<Tree::ASTUnaryOpExprNode>(
-        expr.first, TokenKind::KeywordNot, not_loc + expr.first->loc);
+    auto *node = make_node<Tree::ASTLambdaExprNode>(
+        param_list, body.first, Source::Span::merge(start, body.first->loc));
 
     return std::make_pair(node, false);
 }
 
-auto Parser::parse_py_logical_and_expr() -> ReturnType {
-    // First, we need to obtain an LHS.
-    auto lhs_start = tok.span;
-    auto lhs = parse_py_unary_not_expr();
-
-    if (!lhs.first) {
-        // Here, we just want to propagate the error upto the caller.
-        return lhs;
-    }
-
-    auto lhs_node = lhs.first;
+/*
+    This method will parse a 'yield' expression. The value of a plain 'yield'
+   is an optional expression list, and 'yield from' needs a single expression.
+   It can only appear within parentheses, or on its own on the right of an
+   assignment or as a statement.
+*/
+auto Parser::parse_py_yield_expr() -> ReturnType {
+    auto start = tok.span;
+    advance();
 
-    // Now, while we have the 'and' operator, we must keep getting an RHS.
-    while (expect(TokenKind::KeywordAnd)) {
+    if (expect(TokenKind::KeywordFrom)) {
         advance();
 
-        auto rhs_start = tok.span;
-        auto rhs = parse_py_unary_not_expr();
-
-        if (!rhs.first) {
-            if (!rhs.second) {
-                report_error(rhs_start, "expected expression on the right hand "
-                                        "side of the binary operator 'and'.");
+        auto value_start = tok.span;
+        auto value = parse_py_expr();
 
+        if (!value.first) {
+            if (!value.second) {
+                report_error(value_start,
+                             "expected expression after 'yield from'.");
                 return std::make_pair(nullptr, true);
             }
 
-            return rhs;
+            return value;
         }
 
-        // Now, we can make the node.
-        lhs_node = arena.allocate<Tree::ASTBinaryOpExprNode>(
-            lhs_node, rhs.first, TokenKind::KeywordAnd,
-            lhs_node->loc + rhs.first->loc);
-    }
+        auto *node = make_node<Tree::ASTYieldExprNode>(
+            value.first, true, Source::Span::merge(start, value.first->loc));
 
-    return std::make_pair(lhs_node, false);
-}
-
-auto Parser::parse_py_logical_or_expr() -> ReturnType {
-    // First, we need to obtain an LHS.
-    auto lhs_start = tok.span;
-    auto lhs = parse_py_logical_and_expr();
-
-    if (!lhs.first) {
-        // Here, we just want to propagate the error upto the caller.
-        return lhs;
+        return std::make_pair(node, false);
     }
 
-    auto lhs_node = lhs.first;
-
-    // Now, while we have the 'or' operator, we must keep getting an RHS.
-    while (expect(TokenKind::KeywordOr)) {
-        advance();
-
-        auto rhs_start = tok.span;
-        auto rhs = parse_py_logical_and_expr();
-
-        if (!rhs.first) {
-            if (!rhs.second) {
-                report_error(rhs_start, "expected expression on the right hand "
-                                        "side of the binary operator 'or'.");
+    if (!starts_py_expr()) {
+        auto *node = make_node<Tree::ASTYieldExprNode>(nullptr, false, start);
+        return std::make_pair(node, false);
+    }
 
-                return std::make_pair(nullptr, true);
-            }
+    auto value_start = tok.span;
+    auto value = parse_py_expr_list();
 
-            return rhs;
+    if (!value.first) {
+        if (!value.second) {
+            report_error(value_start, "expected expression after 'yield'.");
+            return std::make_pair(nullptr, true);
         }
 
-        // Now, we can make the node.
-        lhs_node = arena.allocate<Tree::ASTBinaryOpExprNode>(
-            lhs_node, rhs.first, TokenKind::KeywordOr,
-            lhs_node->loc + rhs.first->loc);
+        return value;
     }
 
-    return std::make_pair(lhs_node, false);
-}
+    auto *node = make_node<Tree::ASTYieldExprNode>(
+        value.first, false, Source::Span::merge(start, value.first->loc));
 
-auto Parser::parse_py_ternary_op_expr() -> ReturnType {
-    // First, we must get an expression.
-    auto condition = parse_py_logical_or_expr();
-    if (!condition.first) {
-        // Here, we will just propagate errors up to the caller.
-        return condition;
-    }
+    return std::make_pair(node, false);
+}
 
-    // After this, we must check for a possible if-else clause.
-    if (!expect(TokenKind::KeywordIf)) {
-        return condition;
+// This method checks if the lookahead can begin an expression. It is used to
+// tell a trailing comma apart from a comma that is followed by another element.
+auto Parser::starts_py_expr() -> bool {
+    switch (tok.kind) {
+    case TokenKind::IntLiteral:
+    case TokenKind::HexIntLiteral:
+    case TokenKind::BinaryIntLiteral:
+    case TokenKind::OctalIntLiteral:
+    case TokenKind::FloatLiteral:
+    case TokenKind::StringLiteral:
+    case TokenKind::BytesLiteral:
+    case TokenKind::FStringLiteral:
+    case TokenKind::KeywordTrue:
+    case TokenKind::KeywordFalse:
+    case TokenKind::KeywordNone:
+    case TokenKind::KeywordNot:
+    case TokenKind::KeywordAwait:
+    case TokenKind::KeywordLambda:
+    case TokenKind::Ellipsis:
+    case TokenKind::Identifier:
+    case TokenKind::LeftParen:
+    case TokenKind::LeftSquare:
+    case TokenKind::LeftCurly:
+    case TokenKind::Plus:
+    case TokenKind::Minus:
+    case TokenKind::Tilda:
+    case TokenKind::Asterisk:
+    case TokenKind::ErrorToken:
+        return true;
+    default:
+        return false;
     }
+}
 
-    // Consume the if keyword.
-    advance();
+/*
+    This method will parse an element of an expression list, which may be
+   unpacked with '*', as in 'a, *b = c'. If a minimum precedence is given, the
+   element is parsed as a binary expression of that precedence instead of a
+   whole expression, so that a 'for' target stops before the 'in' keyword.
+*/
+auto Parser::parse_py_star_or_expr(Precedence min_prec) -> ReturnType {
+    if (expect(TokenKind::Asterisk)) {
+        auto star_loc = tok.span;
+        advance();
 
-    // Now, we need another expression for the true case.
-    auto true_expr_start = tok.span;
-    auto true_expr = parse_py_logical_or_expr();
+        auto expr_start = tok.span;
+        auto expr = parse_py_binary_expr(Precedence::BitwiseOr);
 
-    if (!true_expr.first) {
-        if (!true_expr.second) {
-            report_error(
-                true_expr_start,
-                "expected expression after 'if' in conditional expression.");
+        if (!expr.first) {
+            if (!expr.second) {
+                report_error(expr_start, "expected expression after '*'.");
+                return std::make_pair(nullptr, true);
+            }
 
-            return std::make_pair(nullptr, true);
+            return expr;
         }
 
-        return true_expr;
-    }
+        auto *node = make_node<Tree::ASTStarredExprNode>(
+            expr.first, TokenKind::Asterisk,
+            Source::Span::merge(star_loc, expr.first->loc));
 
-    // Now, we need an 'else' clause.
-    if (!expect(TokenKind::KeywordElse)) {
-        report_error(tok.span, "expected 'else' clause after expression within "
-                               "conditional expression.");
-
-        return std::make_pair(nullptr, true);
+        return std::make_pair(node, false);
     }
 
-    // Consume 'else'
-    advance();
-
-    // Finally, we need an expression for the false case.
-    auto false_expr_start = tok.span;
-    auto false_expr = parse_py_expr();
+    if (min_prec == Precedence::None) {
+        return parse_py_expr();
+    }
 
-    if (!false_expr.first) {
-        if (!false_expr.second) {
-            report_error(
-                false_expr_start,
-                "expected expression after 'false' in conditional expression.");
+    return parse_py_binary_expr(min_prec);
+}
 
-            return std::make_pair(nullptr, true);
-        }
+/*
+    This method will parse a list of expressions separated by commas, such as
+   the value of 'return a, b'. A single expression without a comma is returned
+   as is, and otherwise the elements form a tuple. A trailing comma is allowed,
+   so the list ends at the first token that cannot begin an expression.
+*/
+auto Parser::parse_py_expr_list(Precedence min_prec) -> ReturnType {
+    auto first = parse_py_star_or_expr(min_prec);
 
-        return false_expr;
+    if (!first.first || !expect(TokenKind::Comma)) {
+        return first;
     }
 
-    // Now, we can make the node and return it.
-    auto *node = arena.allocate<Tree::ASTTernaryOpExprNode>(
-        condition.first, true_expr.first, false_expr.first,
-        condition.first->loc + false_expr.first->loc);
+    ScratchScope elements{node_scratch};
+    elements.push(first.first);
 
-    return std::make_pair(node, false);
-}
+    auto end_loc = first.first->loc;
 
-auto Parser::parse_py_assignment_expr() -> ReturnType {
-    // This part gets a little bit tricky. In order to determine if we have an
-    // assignment expression, we need two lookahead tokens. The first case is
-    // simple - if we don't have an identifier, we can directly proceed to
-    // parsing further down.
-    if (!expect(TokenKind::Identifier)) {
-        return parse_py_ternary_op_expr();
-    }
-
-    // Now that we now we have an identifier, we need to get the 2nd lookahead;
-    lexer.lex_next_tok(tok_2);
-
-    // The 2nd lookahead will help us determine if this is an assignment
-    // expression. If it is the ':=' operator, it means that we have an
-    // assignment expression.
-    if (tok_2.kind == TokenKind::ColonEquals) {
-        // Here, we need to first construct the node for the identifier we
-        // found.
-        auto *id_node = arena.allocate<Tree::ASTNameExprNode>(tok.span);
-
-        // Now, we can consume both the identifier and the ':=' operator.
-        advance();
+    while (expect(TokenKind::Comma)) {
+        end_loc = tok.span;
         advance();
 
-        // Now, we must have the RHS of the assignment expression.
-        auto rhs_start = tok.span;
-        auto rhs = parse_py_expr();
+        if (!starts_py_expr()) {
+            break;
+        }
 
-        if (!rhs.first) {
-            if (!rhs.second) {
-                report_error(rhs_start, "expected expression on the right hand "
-                                        "side of the binary operator ':='.");
+        auto expr_start = tok.span;
+        auto expr = parse_py_star_or_expr(min_prec);
 
+        if (!expr.first) {
+            if (!expr.second) {
+                report_error(expr_start,
+                             "expected expression after ',' in tuple.");
                 return std::make_pair(nullptr, true);
             }
 
-            return rhs;
+            return expr;
         }
 
-        // Now, we can maek the node.
-        auto *node = arena.allocate<Tree::ASTBinaryOpExprNode>(
-            id_node, rhs.first, TokenKind::ColonEquals,
-            id_node->loc + rhs.first->loc);
-
-        return std::make_pair(node, false);
+        elements.push(expr.first);
+        end_loc = expr.first->loc;
     }
 
-    // Otherwise, we can simply continue parsing like normal and the parser will
-    // know to use the 2nd lookahead next.
-    return parse_py_ternary_op_expr();
+    auto *node = make_node<Tree::ASTTupleExprNode>(
+        elements.copy_to(arena),
+        Source::Span::merge(first.first->loc, end_loc));
+
+    return std::make_pair(node, false);
 }
 
-} // namespace tpy::Parse
\ No newline at end of file
+// This method will parse the right hand side of an assignment, or an expression
+// statement, which may be a 'yield' expression instead of an expression list.
+auto Parser::parse_py_expr_list_or_yield() -> ReturnType {
+    if (expect(TokenKind::KeywordYield)) {
+        return parse_py_yield_expr();
+    }
+
+    return parse_py_expr_list();
+}
+} // namespace tpy::Parse
@@ -0,0 +1,1594 @@
+/*
+    This file implements the iterative expression parser. It parses the same
+   grammar as the recursive expression methods and builds the same trees with
+   the same errors, but it keeps the state of every pending method in a frame on
+   an explicit stack instead of the native stack. This way, expressions that are
+   nested thousands of levels deep cannot overflow the stack of the thread.
+*/
+
+#include "tpy/parse/Parser.h"
+#include "tpy/parse/Token.h"
+#include "tpy/source/Span.h"
+#include "tpy/tree/ASTExpr.h"
+#include "tpy/tree/ASTNode.h"
+#include "tpy/tree/ASTStmt.h"
+
+namespace tpy::Parse {
+/*
+    This method will pop the frame on top of the explicit stack once its method
+   has returned. The children that the frame collected on a scratch stack are
+   popped along with it, just like a 'ScratchScope' would do.
+*/
+auto Parser::pop_expr_frame() -> void {
+    auto &frame = expr_frames.back();
+
+    if (frame.mark != NO_MARK) {
+        if (frame.kind == ExprFrameKind::Dict) {
+            pair_scratch.erase(pair_scratch.begin() + frame.mark,
+                               pair_scratch.end());
+        } else {
+            node_scratch.erase(node_scratch.begin() + frame.mark,
+                               node_scratch.end());
+        }
+    }
+
+    // A binary or lambda frame only counts towards the nesting depth once it
+    // has passed the depth check.
+    if ((frame.kind == ExprFrameKind::Binary ||
+         frame.kind == ExprFrameKind::Lambda) &&
+        frame.state != 0) {
+        --nesting_depth;
+    }
+
+    expr_frames.pop_back();
+}
+
+/*
+    This method will parse an expression with the explicit stack. The kind of
+   the first frame selects the method that the parse begins with, which is
+   either a whole expression or a binary expression of the given precedence.
+
+    Every frame runs until it either needs the result of a nested expression or
+   returns. In the first case, it records the state to resume from and pushes
+   the frame of the nested method. In the second case, it stores its result in
+   'result' and is popped, so the frame below it resumes with that result.
+   Frames are only ever accessed through the top of the stack, as pushing a
+   frame can move all of them.
+*/
+auto Parser::parse_py_expr_iteratively(ExprFrameKind kind,
+                                       Precedence prec) -> ReturnType {
+    ReturnType result{nullptr, false};
+    auto base = expr_frames.size();
+
+    auto call = [this](ExprFrameKind kind,
+                       Precedence prec = Precedence::None) {
+        expr_frames.emplace_back(kind, prec);
+    };
+
+    auto finish = [this, &result](Tree::ASTNode *node, bool has_error) {
+        result = std::make_pair(node, has_error);
+        pop_expr_frame();
+    };
+
+    // This reports the error for a missing child unless one has already been
+    // reported while parsing it.
+    auto fail_child = [this, &finish, &result](const char *msg) {
+        if (!result.second) {
+            report_error(expr_frames.back().child_loc, msg);
+        }
+
+        finish(nullptr, true);
+    };
+
+    call(kind, prec);
+
+    while (expr_frames.size() > base) {
+        auto &frame = expr_frames.back();
+
+        switch (frame.kind) {
+        // See 'parse_py_assignment_expr'.
+        case ExprFrameKind::Expr: {
+            switch (frame.state) {
+            case 0: {
+                if (!expect(TokenKind::Identifier) ||
+                    peek().kind != TokenKind::ColonEquals) {
+                    frame.state = 1;
+                    call(ExprFrameKind::Ternary);
+                    break;
+                }
+
+                frame.node = make_node<Tree::ASTNameExprNode>(tok.span);
+                advance();
+                advance();
+
+                frame.child_loc = tok.span;
+                frame.state = 2;
+                call(ExprFrameKind::Expr);
+                break;
+            }
+            case 1: {
+                finish(result.first, result.second);
+                break;
+            }
+            case 2: {
+                if (!result.first) {
+                    fail_child("expected expression on the right hand side of "
+                               "the binary operator ':='.");
+                    break;
+                }
+
+                auto *id_node = frame.node;
+                finish(make_node<Tree::ASTBinaryOpExprNode>(
+                           id_node, result.first, TokenKind::ColonEquals,
+                           id_node->loc + result.first->loc),
+                       false);
+                break;
+            }
+            }
+            break;
+        }
+        // See 'parse_py_assignment_expr'.
+        case ExprFrameKind::Ternary: {
+            switch (frame.state) {
+            case 0: {
+                frame.state = 1;
+                call(expect(TokenKind::KeywordLambda) ? ExprFrameKind::Lambda
+                                                      : ExprFrameKind::Binary,
+                     Precedence::LogicalOr);
+                break;
+            }
+            case 1: {
+                if (!result.first || !expect(TokenKind::KeywordIf)) {
+                    finish(result.first, result.second);
+                    break;
+                }
+
+                frame.node = result.first;
+                advance();
+
+                frame.child_loc = tok.span;
+                frame.state = 2;
+                call(ExprFrameKind::Binary, Precedence::LogicalOr);
+                break;
+            }
+            case 2: {
+                if (!result.first) {
+                    fail_child("expected expression after 'if' in conditional "
+                               "expression.");
+                    break;
+                }
+
+                frame.node_2 = result.first;
+
+                if (!expect(TokenKind::KeywordElse)) {
+                    report_error(tok.span,
+                                 "expected 'else' clause after expression "
+                                 "within conditional expression.");
+                    finish(nullptr, true);
+                    break;
+                }
+
+                advance();
+
+                frame.child_loc = tok.span;
+                frame.state = 3;
+                call(ExprFrameKind::Expr);
+                break;
+            }
+            case 3: {
+                if (!result.first) {
+                    fail_child("expected expression after 'false' in "
+                               "conditional expression.");
+                    break;
+                }
+
+                auto *condition = frame.node;
+                finish(make_node<Tree::ASTTernaryOpExprNode>(
+                           condition, frame.node_2, result.first,
+                           condition->loc + result.first->loc),
+                       false);
+                break;
+            }
+            }
+            break;
+        }
+        // See 'parse_py_binary_expr'.
+        case ExprFrameKind::Binary: {
+            switch (frame.state) {
+            case 0: {
+                if (!check_nesting_depth()) {
+                    finish(nullptr, true);
+                    break;
+                }
+
+                ++nesting_depth;
+                frame.state = 1;
+                call(ExprFrameKind::Prefix, frame.prec);
+                break;
+            }
+            case 1:
+            case 2: {
+                if (frame.state == 1) {
+                    if (!result.first) {
+                        finish(result.first, result.second);
+                        break;
+                    }
+
+                    frame.node = result.first;
+                } else {
+                    if (!result.first) {
+                        if (!result.second) {
+                            report_error(frame.child_loc,
+                                         frame.info->rhs_error);
+                        }
+
+                        finish(nullptr, true);
+                        break;
+                    }
+
+                    auto *lhs_node = frame.node;
+                    frame.node = make_node<Tree::ASTBinaryOpExprNode>(
+                        lhs_node, result.first, frame.op,
+                        lhs_node->loc + result.first->loc);
+                }
+
+                auto &info = binary_op_info(tok.kind);
+                if (info.prec < frame.prec || info.prec == Precedence::None) {
+                    finish(frame.node, false);
+                    break;
+                }
+
+                auto op = tok.kind;
+                auto op_loc = tok.span;
+                advance();
+
+                if (op == TokenKind::KeywordIs) {
+                    if (expect(TokenKind::KeywordNot)) {
+                        op = TokenKind::IsNotOp;
+                        advance();
+                    }
+                } else if (op == TokenKind::KeywordNot) {
+                    if (!expect(TokenKind::KeywordIn)) {
+                        report_error(op_loc,
+                                     "'not' is not a valid operator. Did you "
+                                     "mean 'not in' instead?");
+                    } else {
+                        advance();
+                    }
+
+                    op = TokenKind::NotInOp;
+                }
+
+                frame.op = op;
+                frame.info = &info;
+                frame.child_loc = tok.span;
+                frame.state = 2;
+                call(ExprFrameKind::Binary, info.rhs_prec);
+                break;
+            }
+            }
+            break;
+        }
+        // See 'parse_py_prefix_expr'.
+        case ExprFrameKind::Prefix: {
+            switch (frame.state) {
+            case 0: {
+                switch (tok.kind) {
+                case TokenKind::Plus:
+                case TokenKind::Minus:
+                case TokenKind::Tilda: {
+                    frame.op = tok.kind;
+                    frame.loc = tok.span;
+                    advance();
+
+                    frame.child_loc = tok.span;
+                    frame.state = 1;
+                    call(ExprFrameKind::Binary, Precedence::Unary);
+                    break;
+                }
+                case TokenKind::KeywordNot: {
+                    if (frame.prec > Precedence::LogicalNot) {
+                        frame.state = 3;
+                        call(ExprFrameKind::Primary);
+                        break;
+                    }
+
+                    frame.op = TokenKind::KeywordNot;
+                    frame.loc = tok.span;
+                    advance();
+
+                    frame.state = 2;
+                    call(ExprFrameKind::Binary, Precedence::LogicalNot);
+                    break;
+                }
+                case TokenKind::KeywordAwait: {
+                    frame.loc = tok.span;
+                    advance();
+
+                    frame.child_loc = tok.span;
+                    frame.state = 4;
+                    call(ExprFrameKind::Primary);
+                    break;
+                }
+                default: {
+                    frame.state = 3;
+                    call(ExprFrameKind::Primary);
+                    break;
+                }
+                }
+                break;
+            }
+            case 1: {
+                if (!result.first) {
+                    fail_child("expected expression after unary operator.");
+                    break;
+                }
+
+                finish(make_node<Tree::ASTUnaryOpExprNode>(
+                           result.first, frame.op,
+                           frame.loc + result.first->loc),
+                       false);
+                break;
+            }
+            case 2: {
+                if (!result.first) {
+                    // The error is reported at the 'not' keyword.
+                    frame.child_loc = frame.loc;
+                    fail_child(
+                        "expected expression after the unary operator '!'.");
+                    break;
+                }
+
+                finish(make_node<Tree::ASTUnaryOpExprNode>(
+                           result.first, TokenKind::KeywordNot,
+                           frame.loc + result.first->loc),
+                       false);
+                break;
+            }
+            case 3: {
+                finish(result.first, result.second);
+                break;
+            }
+            case 4: {
+                if (!result.first) {
+                    fail_child("expected expression after 'await'.");
+                    break;
+                }
+
+                finish(make_node<Tree::ASTAwaitExprNode>(
+                           result.first, frame.loc + result.first->loc),
+                       false);
+                break;
+            }
+            }
+            break;
+        }
+        // See 'parse_py_atom_and_primary_expr'.
+        case ExprFrameKind::Primary: {
+            if (frame.state == 0) {
+                Tree::ASTNode *atom = nullptr;
+
+                switch (tok.kind) {
+                case TokenKind::IntLiteral:
+                case TokenKind::ErrorToken: {
+                    atom = make_node<Tree::ASTIntLiteralNode>(10, tok.span);
+                    break;
+                }
+                case TokenKind::HexIntLiteral: {
+                    atom = make_node<Tree::ASTIntLiteralNode>(16, tok.span);
+                    break;
+                }
+                case TokenKind::BinaryIntLiteral: {
+                    atom = make_node<Tree::ASTIntLiteralNode>(2, tok.span);
+                    break;
+                }
+                case TokenKind::OctalIntLiteral: {
+                    atom = make_node<Tree::ASTIntLiteralNode>(8, tok.span);
+                    break;
+                }
+                case TokenKind::FloatLiteral: {
+                    atom = make_node<Tree::ASTFloatLiteralNode>(tok.span);
+                    break;
+                }
+                case TokenKind::StringLiteral:
+                case TokenKind::BytesLiteral:
+                case TokenKind::FStringLiteral: {
+                    // Strings do not contain expressions, and they are consumed
+                    // along with the ones that follow them.
+                    result = std::make_pair(parse_py_string_literals(), false);
+                    frame.state = 1;
+                    break;
+                }
+                case TokenKind::KeywordTrue: {
+                    atom = make_node<Tree::ASTBoolLiteralNode>(true, tok.span);
+                    break;
+                }
+                case TokenKind::KeywordFalse: {
+                    atom = make_node<Tree::ASTBoolLiteralNode>(false, tok.span);
+                    break;
+                }
+                case TokenKind::KeywordNone: {
+                    atom = make_node<Tree::ASTNoneLiteralNode>(tok.span);
+                    break;
+                }
+                case TokenKind::Ellipsis: {
+                    atom = make_node<Tree::ASTEllipsisLiteralNode>(tok.span);
+                    break;
+                }
+                case TokenKind::Identifier: {
+                    atom = make_node<Tree::ASTNameExprNode>(tok.span);
+                    break;
+                }
+                case TokenKind::LeftParen: {
+                    frame.loc = tok.span;
+                    frame.op = TokenKind::RightParen;
+                    frame.state = 1;
+                    call(ExprFrameKind::Paren);
+                    break;
+                }
+                case TokenKind::LeftSquare: {
+                    frame.loc = tok.span;
+                    frame.op = TokenKind::RightSquare;
+                    frame.state = 1;
+                    call(ExprFrameKind::List);
+                    break;
+                }
+                case TokenKind::LeftCurly: {
+                    frame.loc = tok.span;
+                    frame.op = TokenKind::RightCurly;
+                    frame.state = 1;
+                    call(ExprFrameKind::SetOrDict);
+                    break;
+                }
+                default: {
+                    finish(nullptr, false);
+                    break;
+                }
+                }
+
+                if (!atom) {
+                    break;
+                }
+
+                advance();
+                result = std::make_pair(atom, false);
+                frame.state = 1;
+            }
+
+            // Now, we are either back from the atom or from a postfix
+            // expression. The bracketed ones are recovered from here.
+            result = recover_in_brackets(result, frame.loc, frame.op);
+            if (!result.first) {
+                finish(result.first, result.second);
+                break;
+            }
+
+            // Attribute references do not contain expressions, so they are
+            // parsed directly.
+            if (expect(TokenKind::Dot)) {
+                result = parse_py_attr_ref_expr(result.first);
+                if (!result.first) {
+                    finish(result.first, result.second);
+                    break;
+                }
+            }
+
+            if (expect(TokenKind::LeftParen)) {
+                frame.loc = result.first->loc;
+                frame.op = TokenKind::RightParen;
+                call(ExprFrameKind::Call);
+                expr_frames.back().node = result.first;
+            } else if (expect(TokenKind::LeftSquare)) {
+                frame.loc = result.first->loc;
+                frame.op = TokenKind::RightSquare;
+                call(ExprFrameKind::Slice);
+                expr_frames.back().node = result.first;
+            } else {
+                finish(result.first, false);
+            }
+            break;
+        }
+        // See 'parse_py_paren_expr'.
+        case ExprFrameKind::Paren: {
+            if (frame.state == 0) {
+                frame.loc = tok.span;
+                advance();
+
+                if (expect(TokenKind::RightParen)) {
+                    auto *node = make_node<Tree::ASTTupleExprNode>(
+                        Utility::ArenaArray<Tree::ASTNode *>{},
+                        Source::Span::merge(frame.loc, tok.span));
+                    advance();
+
+                    finish(node, false);
+                    break;
+                }
+
+                frame.child_loc = tok.span;
+                frame.state = 1;
+                call(expect(TokenKind::KeywordYield)
+                         ? ExprFrameKind::Yield
+                         : ExprFrameKind::StarOrExpr);
+                break;
+            }
+
+            if (!result.first) {
+                fail_child("expected expression after '('.");
+                break;
+            }
+
+            // The parentheses hold a tuple, so the rest is parsed as one.
+            if (expect(TokenKind::Comma)) {
+                frame.kind = ExprFrameKind::ParenTuple;
+                frame.state = 0;
+                frame.node = result.first;
+                break;
+            }
+
+            if (expect(TokenKind::KeywordFor) ||
+                expect(TokenKind::KeywordAsync)) {
+                frame.kind = ExprFrameKind::Comprehension;
+                frame.state = 0;
+                frame.op = TokenKind::RightParen;
+                frame.node = result.first;
+                break;
+            }
+
+            if (!expect(TokenKind::RightParen)) {
+                report_error(tok.span,
+                             "expected closing ')' after expression.");
+                finish(nullptr, true);
+                break;
+            }
+
+            auto *node = make_node<Tree::ASTParenExprNode>(
+                result.first, frame.loc + tok.span);
+            advance();
+
+            finish(node, false);
+            break;
+        }
+        // See 'parse_py_paren_tuple_expr'.
+        case ExprFrameKind::ParenTuple: {
+            if (frame.state == 0) {
+                frame.mark = node_scratch.size();
+                node_scratch.push_back(frame.node);
+            } else {
+                if (!result.first) {
+                    fail_child("expected expression after ',' in tuple.");
+                    break;
+                }
+
+                node_scratch.push_back(result.first);
+            }
+
+            if (expect(TokenKind::Comma)) {
+                advance();
+
+                if (!expect(TokenKind::RightParen)) {
+                    frame.child_loc = tok.span;
+                    frame.state = 1;
+                    call(ExprFrameKind::StarOrExpr);
+                    break;
+                }
+            }
+
+            if (!expect(TokenKind::RightParen)) {
+                report_error(tok.span, "expected closing ')' in tuple.");
+                finish(nullptr, true);
+                break;
+            }
+
+            auto *node = make_node<Tree::ASTTupleExprNode>(
+                arena.allocate_array(node_scratch.data() + frame.mark,
+                                     node_scratch.size() - frame.mark),
+                Source::Span::merge(frame.loc, tok.span));
+            advance();
+
+            finish(node, false);
+            break;
+        }
+        // See 'parse_py_list_expr'.
+        case ExprFrameKind::List: {
+            switch (frame.state) {
+            case 0: {
+                frame.loc = tok.span;
+                advance();
+
+                if (expect(TokenKind::RightSquare)) {
+                    auto *node = make_node<Tree::ASTListExprNode>(
+                        frame.loc + tok.span);
+                    advance();
+
+                    finish(node, false);
+                    break;
+                }
+
+                frame.child_loc = tok.span;
+                frame.state = 1;
+                call(ExprFrameKind::StarOrExpr);
+                break;
+            }
+            case 1:
+            case 2: {
+                if (!result.first) {
+                    fail_child(frame.state == 1
+                                   ? "expected expression after '[' in list "
+                                     "literal."
+                                   : "expected expression after ',' in list "
+                                     "literal.");
+                    break;
+                }
+
+                if (frame.state == 1 && (expect(TokenKind::KeywordFor) ||
+                                         expect(TokenKind::KeywordAsync))) {
+                    frame.kind = ExprFrameKind::Comprehension;
+                    frame.state = 0;
+                    frame.op = TokenKind::RightSquare;
+                    frame.node = result.first;
+                    break;
+                }
+
+                if (frame.state == 1) {
+                    frame.mark = node_scratch.size();
+                }
+
+                node_scratch.push_back(result.first);
+
+                if (expect(TokenKind::Comma)) {
+                    advance();
+
+                    if (!expect(TokenKind::RightSquare)) {
+                        frame.child_loc = tok.span;
+                        frame.state = 2;
+                        call(ExprFrameKind::StarOrExpr);
+                        break;
+                    }
+                } else if (!expect(TokenKind::RightSquare)) {
+                    report_error(tok.span,
+                                 "expected closing ']' in list literal.");
+                    finish(nullptr, true);
+                    break;
+                }
+
+                auto *node = make_node<Tree::ASTListExprNode>(
+                    arena.allocate_array(node_scratch.data() + frame.mark,
+                                         node_scratch.size() - frame.mark),
+                    frame.loc + tok.span);
+                advance();
+
+                finish(node, false);
+                break;
+            }
+            }
+            break;
+        }
+        // See 'parse_py_set_or_dict_expr'.
+        case ExprFrameKind::SetOrDict: {
+            switch (frame.state) {
+            case 0: {
+                frame.loc = tok.span;
+                advance();
+
+                if (expect(TokenKind::RightCurly)) {
+                    auto *node = make_node<Tree::ASTDictExprNode>(
+                        frame.loc + tok.span);
+                    advance();
+
+                    finish(node, false);
+                    break;
+                }
+
+                if (expect(TokenKind::AsteriskAsterisk)) {
+                    frame.kind = ExprFrameKind::Dict;
+                    frame.state = 4;
+                    break;
+                }
+
+                frame.child_loc = tok.span;
+                frame.state = 1;
+                call(ExprFrameKind::StarOrExpr);
+                break;
+            }
+            case 1:
+            case 2: {
+                if (!result.first) {
+                    fail_child(frame.state == 1
+                                   ? "expected expression after '{' in set "
+                                     "literal."
+                                   : "expected expression after ',' in set "
+                                     "literal.");
+                    break;
+                }
+
+                // A ':' after the first expression makes it a dict, unless
+                // the expression is unpacked.
+                if (frame.state == 1 && expect(TokenKind::Colon) &&
+                    result.first->kind != Tree::ASTNodeKind::StarredExpr) {
+                    frame.kind = ExprFrameKind::Dict;
+                    frame.state = 0;
+                    frame.node = result.first;
+                    break;
+                }
+
+                if (frame.state == 1 && (expect(TokenKind::KeywordFor) ||
+                                         expect(TokenKind::KeywordAsync))) {
+                    frame.kind = ExprFrameKind::Comprehension;
+                    frame.state = 0;
+                    frame.op = TokenKind::RightCurly;
+                    frame.node = result.first;
+                    break;
+                }
+
+                if (frame.state == 1) {
+                    frame.mark = node_scratch.size();
+                }
+
+                node_scratch.push_back(result.first);
+
+                if (expect(TokenKind::Comma)) {
+                    advance();
+
+                    if (!expect(TokenKind::RightCurly)) {
+                        frame.child_loc = tok.span;
+                        frame.state = 2;
+                        call(ExprFrameKind::StarOrExpr);
+                        break;
+                    }
+                } else if (!expect(TokenKind::RightCurly)) {
+                    report_error(tok.span,
+                                 "expected closing '}' in set literal.");
+                    finish(nullptr, true);
+                    break;
+                }
+
+                auto *node = make_node<Tree::ASTSetExprNode>(
+                    arena.allocate_array(node_scratch.data() + frame.mark,
+                                         node_scratch.size() - frame.mark),
+                    frame.loc + tok.span);
+                advance();
+
+                finish(node, false);
+                break;
+            }
+            }
+            break;
+        }
+        // See 'parse_py_dict_expr'. The frame begins on the ':' after the
+        // first key, in state 0, or on the '**' of an unpacked entry, in state
+        // 4. The key of the entry is kept in the frame.
+        case ExprFrameKind::Dict: {
+            switch (frame.state) {
+            case 0: {
+                advance();
+
+                frame.child_loc = tok.span;
+                frame.state = 1;
+                call(ExprFrameKind::Expr);
+                break;
+            }
+            case 4: {
+                frame.node = nullptr;
+                advance();
+
+                frame.child_loc = tok.span;
+                frame.state = 5;
+                call(ExprFrameKind::Binary, Precedence::BitwiseOr);
+                break;
+            }
+            case 1:
+            case 3:
+            case 5: {
+                if (!result.first) {
+                    fail_child(frame.state == 5
+                                   ? "expected expression after '**' in dict "
+                                     "literal."
+                               : frame.state == 1
+                                   ? "expected expression as value after ':' "
+                                     "in dict literal"
+                                   : "expected expression as value for "
+                                     "key-value pair after ':' in dict "
+                                     "literal.");
+                    break;
+                }
+
+                // Only the first entry can be followed by a comprehension.
+                if (frame.state == 1 && (expect(TokenKind::KeywordFor) ||
+                                         expect(TokenKind::KeywordAsync))) {
+                    frame.kind = ExprFrameKind::Comprehension;
+                    frame.state = 0;
+                    frame.op = TokenKind::RightCurly;
+                    frame.node_2 = result.first;
+                    break;
+                }
+
+                if (frame.mark == NO_MARK) {
+                    frame.mark = pair_scratch.size();
+                }
+
+                pair_scratch.emplace_back(frame.node, result.first);
+
+                if (expect(TokenKind::Comma)) {
+                    advance();
+
+                    if (expect(TokenKind::AsteriskAsterisk)) {
+                        frame.state = 4;
+                        break;
+                    }
+
+                    if (!expect(TokenKind::RightCurly)) {
+                        frame.child_loc = tok.span;
+                        frame.state = 2;
+                        call(ExprFrameKind::Expr);
+                        break;
+                    }
+                } else if (!expect(TokenKind::RightCurly)) {
+                    // Like the recursive method, the dict is still made.
+                    report_error(tok.span,
+                                 "expected closing '}' in dict literal.");
+                }
+
+                auto *node = make_node<Tree::ASTDictExprNode>(
+                    arena.allocate_array(pair_scratch.data() + frame.mark,
+                                         pair_scratch.size() - frame.mark),
+                    frame.loc + tok.span);
+                advance();
+
+                finish(node, false);
+                break;
+            }
+            case 2: {
+                if (!result.first) {
+                    fail_child("expected expression as key for key-value pair "
+                               "after ',' in dict literal.");
+                    break;
+                }
+
+                frame.node = result.first;
+
+                if (!expect(TokenKind::Colon)) {
+                    report_error(tok.span,
+                                 "expected ':' between key and value within "
+                                 "key-value pair in dict literal.");
+                    finish(nullptr, true);
+                    break;
+                }
+
+                advance();
+
+                frame.child_loc = tok.span;
+                frame.state = 3;
+                call(ExprFrameKind::Expr);
+                break;
+            }
+            }
+            break;
+        }
+        // See 'parse_py_call_expr'. The callee is passed in the frame.
+        case ExprFrameKind::Call: {
+            auto *callee = frame.node;
+
+            if (frame.state == 0) {
+                advance();
+
+                if (expect(TokenKind::RightParen)) {
+                    auto *node = make_node<Tree::ASTCallExprNode>(
+                        callee, callee->loc + tok.span);
+                    advance();
+
+                    finish(node, false);
+                    break;
+                }
+
+                frame.child_loc = tok.span;
+                frame.state = 1;
+                call(ExprFrameKind::CallArg);
+                break;
+            }
+
+            if (!result.first) {
+                fail_child(frame.state == 1
+                               ? "expected expression as argument after '(' "
+                                 "in function call."
+                               : "expected expression as argument after ',' "
+                                 "in function call.");
+                break;
+            }
+
+            if (frame.state == 1) {
+                frame.mark = node_scratch.size();
+            }
+
+            node_scratch.push_back(result.first);
+
+            if (expect(TokenKind::Comma)) {
+                advance();
+
+                if (!expect(TokenKind::RightParen)) {
+                    frame.child_loc = tok.span;
+                    frame.state = 2;
+                    call(ExprFrameKind::CallArg);
+                    break;
+                }
+            }
+
+            if (!expect(TokenKind::RightParen)) {
+                report_error(tok.span,
+                             "expected ')' at the end of a function call.");
+                finish(nullptr, true);
+                break;
+            }
+
+            auto *node = make_node<Tree::ASTCallExprNode>(
+                callee,
+                arena.allocate_array(node_scratch.data() + frame.mark,
+                                     node_scratch.size() - frame.mark),
+                callee->loc + tok.span);
+            advance();
+
+            finish(node, false);
+            break;
+        }
+        // See 'parse_py_call_arg'.
+        case ExprFrameKind::CallArg: {
+            switch (frame.state) {
+            case 0: {
+                if (expect(TokenKind::Asterisk) ||
+                    expect(TokenKind::AsteriskAsterisk)) {
+                    frame.op = tok.kind;
+                    frame.loc = tok.span;
+                    advance();
+
+                    frame.child_loc = tok.span;
+                    frame.state = 1;
+                    call(ExprFrameKind::Expr);
+                    break;
+                }
+
+                if (!expect(TokenKind::Identifier) ||
+                    peek().kind != TokenKind::Equals) {
+                    frame.state = 3;
+                    call(ExprFrameKind::Expr);
+                    break;
+                }
+
+                frame.node = make_node<Tree::ASTNameExprNode>(tok.span);
+                advance();
+                advance();
+
+                frame.child_loc = tok.span;
+                frame.state = 2;
+                call(ExprFrameKind::Expr);
+                break;
+            }
+            case 1: {
+                if (!result.first) {
+                    fail_child("expected expression after '*' or '**' in "
+                               "function call.");
+                    break;
+                }
+
+                finish(make_node<Tree::ASTStarredExprNode>(
+                           result.first, frame.op,
+                           Source::Span::merge(frame.loc, result.first->loc)),
+                       false);
+                break;
+            }
+            case 2: {
+                if (!result.first) {
+                    fail_child(
+                        "expected expression after '=' in keyword argument.");
+                    break;
+                }
+
+                auto *name = static_cast<Tree::ASTNameExprNode *>(frame.node);
+                finish(make_node<Tree::ASTKeywordArgNode>(
+                           name, result.first,
+                           Source::Span::merge(name->loc, result.first->loc)),
+                       false);
+                break;
+            }
+            case 3: {
+                // The expression may be the element of a generator.
+                if (result.first && (expect(TokenKind::KeywordFor) ||
+                                     expect(TokenKind::KeywordAsync))) {
+                    frame.kind = ExprFrameKind::Comprehension;
+                    frame.state = 0;
+                    frame.op = TokenKind::Dummy;
+                    frame.loc = result.first->loc;
+                    frame.node = result.first;
+                    break;
+                }
+
+                finish(result.first, result.second);
+                break;
+            }
+            }
+            break;
+        }
+        // See 'parse_py_slice_expr'. The slicee is passed in the frame.
+        case ExprFrameKind::Slice: {
+            switch (frame.state) {
+            case 0: {
+                advance();
+
+                if (expect(TokenKind::Colon)) {
+                    frame.kind = ExprFrameKind::ProperSlice;
+                    frame.node_2 = nullptr;
+                    break;
+                }
+
+                frame.child_loc = tok.span;
+                frame.state = 1;
+                call(ExprFrameKind::Expr);
+                break;
+            }
+            case 1:
+            case 2: {
+                if (!result.first) {
+                    fail_child(frame.state == 1
+                                   ? "expected expression after '[' in "
+                                     "slicing expression."
+                                   : "expected expression after ',' in "
+                                     "slicing expression.");
+                    break;
+                }
+
+                if (frame.state == 1) {
+                    if (expect(TokenKind::Colon)) {
+                        frame.kind = ExprFrameKind::ProperSlice;
+                        frame.state = 0;
+                        frame.node_2 = result.first;
+                        break;
+                    }
+
+                    frame.node_2 = result.first;
+
+                    if (!expect(TokenKind::Comma)) {
+                        frame.state = 3;
+                        break;
+                    }
+
+                    frame.mark = node_scratch.size();
+                }
+
+                node_scratch.push_back(result.first);
+
+                if (expect(TokenKind::Comma)) {
+                    advance();
+
+                    if (!expect(TokenKind::RightSquare)) {
+                        frame.child_loc = tok.span;
+                        frame.state = 2;
+                        call(ExprFrameKind::Expr);
+                        break;
+                    }
+                }
+
+                // Several indices form a tuple.
+                auto elements =
+                    arena.allocate_array(node_scratch.data() + frame.mark,
+                                         node_scratch.size() - frame.mark);
+                frame.node_2 = make_node<Tree::ASTTupleExprNode>(
+                    elements,
+                    Source::Span::merge(elements[0]->loc,
+                                        elements[elements.size() - 1]->loc));
+                frame.state = 3;
+                break;
+            }
+            case 3: {
+                if (!expect(TokenKind::RightSquare)) {
+                    report_error(tok.span,
+                                 "expected closing ']' after index expression "
+                                 "in slicing expression.");
+                    finish(nullptr, true);
+                    break;
+                }
+
+                auto *slicee = frame.node;
+                auto *node = make_node<Tree::ASTIndexSliceExprNode>(
+                    slicee, frame.node_2, slicee->loc + tok.span);
+                advance();
+
+                finish(node, false);
+                break;
+            }
+            }
+            break;
+        }
+        // See 'parse_py_proper_slice_expr'. The frame begins on the ':', and
+        // the lower bound is passed in the frame. The upper bound is kept in
+        // the frame while the step is parsed.
+        case ExprFrameKind::ProperSlice: {
+            auto *slicee = frame.node;
+            Tree::ASTNode *step = nullptr;
+
+            if (frame.state == 0) {
+                advance();
+
+                if (!expect(TokenKind::RightSquare) &&
+                    !expect(TokenKind::Colon)) {
+                    frame.child_loc = tok.span;
+                    frame.state = 1;
+                    call(ExprFrameKind::Expr);
+                    break;
+                }
+
+                frame.state = 2;
+            } else if (frame.state == 1) {
+                if (!result.first) {
+                    fail_child("expected expression as upper bound after ':' "
+                               "in proper slicing expression.");
+                    break;
+                }
+
+                frame.node_3 = result.first;
+                frame.state = 2;
+            } else {
+                if (!result.first) {
+                    fail_child("expected expression as step after ':' in "
+                               "proper slicing expression.");
+                    break;
+                }
+
+                step = result.first;
+            }
+
+            if (frame.state == 2 && expect(TokenKind::Colon)) {
+                advance();
+
+                if (!expect(TokenKind::RightSquare)) {
+                    frame.child_loc = tok.span;
+                    frame.state = 3;
+                    call(ExprFrameKind::Expr);
+                    break;
+                }
+            }
+
+            if (!expect(TokenKind::RightSquare)) {
+                report_error(tok.span,
+                             "expected closing ']' in slicing expression.");
+                finish(nullptr, true);
+                break;
+            }
+
+            auto *node = make_node<Tree::ASTProperSliceExprNode>(
+                slicee, frame.node_2, frame.node_3, step,
+                slicee->loc + tok.span);
+            advance();
+
+            finish(node, false);
+            break;
+        }
+        // See 'parse_py_star_or_expr'.
+        case ExprFrameKind::StarOrExpr: {
+            switch (frame.state) {
+            case 0: {
+                if (!expect(TokenKind::Asterisk)) {
+                    frame.state = 2;
+                    if (frame.prec == Precedence::None) {
+                        call(ExprFrameKind::Expr);
+                    } else {
+                        call(ExprFrameKind::Binary, frame.prec);
+                    }
+                    break;
+                }
+
+                frame.loc = tok.span;
+                advance();
+
+                frame.child_loc = tok.span;
+                frame.state = 1;
+                call(ExprFrameKind::Binary, Precedence::BitwiseOr);
+                break;
+            }
+            case 1: {
+                if (!result.first) {
+                    fail_child("expected expression after '*'.");
+                    break;
+                }
+
+                finish(make_node<Tree::ASTStarredExprNode>(
+                           result.first, TokenKind::Asterisk,
+                           Source::Span::merge(frame.loc, result.first->loc)),
+                       false);
+                break;
+            }
+            case 2: {
+                finish(result.first, result.second);
+                break;
+            }
+            }
+            break;
+        }
+        // See 'parse_py_expr_list'. The minimum precedence is passed on to
+        // the elements.
+        case ExprFrameKind::ExprList: {
+            switch (frame.state) {
+            case 0: {
+                frame.state = 1;
+                call(ExprFrameKind::StarOrExpr, frame.prec);
+                break;
+            }
+            case 1:
+            case 2: {
+                if (frame.state == 1) {
+                    if (!result.first || !expect(TokenKind::Comma)) {
+                        finish(result.first, result.second);
+                        break;
+                    }
+
+                    frame.mark = node_scratch.size();
+                } else if (!result.first) {
+                    fail_child("expected expression after ',' in tuple.");
+                    break;
+                }
+
+                node_scratch.push_back(result.first);
+
+                if (expect(TokenKind::Comma)) {
+                    advance();
+
+                    if (starts_py_expr()) {
+                        frame.child_loc = tok.span;
+                        frame.state = 2;
+                        call(ExprFrameKind::StarOrExpr, frame.prec);
+                        break;
+                    }
+                }
+
+                // The tuple ends at its last element, or at the trailing comma
+                // that was just consumed.
+                auto elements =
+                    arena.allocate_array(node_scratch.data() + frame.mark,
+                                         node_scratch.size() - frame.mark);
+                auto end_loc = prev_kind == TokenKind::Comma
+                                   ? prev_span
+                                   : elements[elements.size() - 1]->loc;
+                finish(make_node<Tree::ASTTupleExprNode>(
+                           elements,
+                           Source::Span::merge(elements[0]->loc, end_loc)),
+                       false);
+                break;
+            }
+            }
+            break;
+        }
+        // See 'parse_py_yield_expr'.
+        case ExprFrameKind::Yield: {
+            switch (frame.state) {
+            case 0: {
+                frame.loc = tok.span;
+                advance();
+
+                if (expect(TokenKind::KeywordFrom)) {
+                    advance();
+
+                    frame.child_loc = tok.span;
+                    frame.state = 1;
+                    call(ExprFrameKind::Expr);
+                    break;
+                }
+
+                if (!starts_py_expr()) {
+                    finish(make_node<Tree::ASTYieldExprNode>(nullptr, false,
+                                                             frame.loc),
+                           false);
+                    break;
+                }
+
+                frame.child_loc = tok.span;
+                frame.state = 2;
+                call(ExprFrameKind::ExprList);
+                break;
+            }
+            case 1:
+            case 2: {
+                bool is_from = frame.state == 1;
+
+                if (!result.first) {
+                    fail_child(is_from
+                                   ? "expected expression after 'yield from'."
+                                   : "expected expression after 'yield'.");
+                    break;
+                }
+
+                finish(make_node<Tree::ASTYieldExprNode>(
+                           result.first, is_from,
+                           Source::Span::merge(frame.loc, result.first->loc)),
+                       false);
+                break;
+            }
+            }
+            break;
+        }
+        // See 'parse_py_lambda_expr' and 'parse_py_param'. The parameters are
+        // collected on the scratch stack, and the name of a parameter is kept
+        // in the frame while its default value is parsed.
+        case ExprFrameKind::Lambda: {
+            switch (frame.state) {
+            case 0: {
+                if (!check_nesting_depth()) {
+                    finish(nullptr, true);
+                    break;
+                }
+
+                ++nesting_depth;
+                frame.loc = tok.span;
+                advance();
+
+                frame.mark = node_scratch.size();
+                frame.state = 1;
+                break;
+            }
+            case 1: {
+                if (expect(TokenKind::Colon)) {
+                    advance();
+
+                    frame.child_loc = tok.span;
+                    frame.state = 3;
+                    call(ExprFrameKind::Expr);
+                    break;
+                }
+
+                auto start = tok.span;
+                auto kind = Tree::ParamKind::Normal;
+                frame.state = 4;
+
+                if (expect(TokenKind::Slash)) {
+                    advance();
+                    node_scratch.push_back(make_node<Tree::ASTParamNode>(
+                        Tree::ParamKind::PositionalOnlyMarker, nullptr,
+                        nullptr, nullptr, start));
+                    break;
+                }
+
+                if (expect(TokenKind::Asterisk)) {
+                    advance();
+
+                    if (!expect(TokenKind::Identifier)) {
+                        node_scratch.push_back(make_node<Tree::ASTParamNode>(
+                            Tree::ParamKind::KeywordOnlyMarker, nullptr,
+                            nullptr, nullptr, start));
+                        break;
+                    }
+
+                    kind = Tree::ParamKind::VarPositional;
+                } else if (expect(TokenKind::AsteriskAsterisk)) {
+                    advance();
+                    kind = Tree::ParamKind::VarKeyword;
+                }
+
+                if (!expect(TokenKind::Identifier)) {
+                    report_error(tok.span, "expected parameter name.");
+                    finish(nullptr, true);
+                    break;
+                }
+
+                auto *name = make_node<Tree::ASTNameExprNode>(tok.span);
+                auto end_loc = tok.span;
+                advance();
+
+                if (kind == Tree::ParamKind::Normal &&
+                    expect(TokenKind::Equals)) {
+                    advance();
+
+                    frame.node = name;
+                    frame.child_loc = tok.span;
+                    frame.state = 2;
+                    call(ExprFrameKind::Expr);
+                    break;
+                }
+
+                node_scratch.push_back(make_node<Tree::ASTParamNode>(
+                    kind, name, nullptr, nullptr,
+                    Source::Span::merge(start, end_loc)));
+                break;
+            }
+            case 2: {
+                if (!result.first) {
+                    fail_child("expected default value after '='.");
+                    break;
+                }
+
+                // An ordinary parameter begins at its name.
+                auto *name = frame.node;
+                node_scratch.push_back(make_node<Tree::ASTParamNode>(
+                    Tree::ParamKind::Normal, name, nullptr, result.first,
+                    Source::Span::merge(name->loc, result.first->loc)));
+                frame.state = 4;
+                break;
+            }
+            case 3: {
+                if (!result.first) {
+                    fail_child("expected expression after ':' in lambda.");
+                    break;
+                }
+
+                auto params =
+                    arena.allocate_array(node_scratch.data() + frame.mark,
+                                         node_scratch.size() - frame.mark);
+                finish(make_node<Tree::ASTLambdaExprNode>(
+                           params, result.first,
+                           Source::Span::merge(frame.loc, result.first->loc)),
+                       false);
+                break;
+            }
+            case 4: {
+                // A parameter has just been parsed, so either a ',' or the ':'
+                // that ends the parameters follows it.
+                if (expect(TokenKind::Comma)) {
+                    advance();
+                    frame.state = 1;
+                    break;
+                }
+
+                if (!expect(TokenKind::Colon)) {
+                    report_error(tok.span,
+                                 "expected ':' after parameters of lambda.");
+                    finish(nullptr, true);
+                    break;
+                }
+
+                frame.state = 1;
+                break;
+            }
+            }
+            break;
+        }
+        // See 'parse_py_comprehension'. The element and the value are passed
+        // in the frame, along with the closing bracket, and the clauses are
+        // collected on the scratch stack.
+        case ExprFrameKind::Comprehension: {
+            if (frame.state == 0) {
+                frame.mark = node_scratch.size();
+                frame.state = 1;
+                call(ExprFrameKind::ComprehensionClause);
+                break;
+            }
+
+            if (!result.first) {
+                finish(result.first, result.second);
+                break;
+            }
+
+            node_scratch.push_back(result.first);
+
+            if (expect(TokenKind::KeywordFor) ||
+                expect(TokenKind::KeywordAsync)) {
+                call(ExprFrameKind::ComprehensionClause);
+                break;
+            }
+
+            auto closer = frame.op;
+            auto bracket = closer == TokenKind::RightSquare
+                               ? TokenKind::LeftSquare
+                           : closer == TokenKind::RightCurly
+                               ? TokenKind::LeftCurly
+                               : TokenKind::LeftParen;
+            auto generators =
+                arena.allocate_array(node_scratch.data() + frame.mark,
+                                     node_scratch.size() - frame.mark);
+
+            if (closer == TokenKind::Dummy) {
+                finish(make_node<Tree::ASTComprehensionExprNode>(
+                           bracket, frame.node, frame.node_2, generators,
+                           Source::Span::merge(
+                               frame.loc,
+                               generators[generators.size() - 1]->loc)),
+                       false);
+                break;
+            }
+
+            if (!expect(closer)) {
+                report_error(tok.span,
+                             "expected closing bracket after comprehension.");
+                finish(nullptr, true);
+                break;
+            }
+
+            auto *node = make_node<Tree::ASTComprehensionExprNode>(
+                bracket, frame.node, frame.node_2, generators,
+                Source::Span::merge(frame.loc, tok.span));
+            advance();
+
+            finish(node, false);
+            break;
+        }
+        // See 'parse_py_comprehension_clause'. The 'async' flag is kept as the
+        // operator of the frame, and the conditions are collected on the
+        // scratch stack.
+        case ExprFrameKind::ComprehensionClause: {
+            switch (frame.state) {
+            case 0: {
+                frame.loc = tok.span;
+                frame.op = tok.kind;
+
+                if (expect(TokenKind::KeywordAsync)) {
+                    advance();
+
+                    if (!expect(TokenKind::KeywordFor)) {
+                        report_error(tok.span, "expected 'for' after 'async' "
+                                               "in comprehension.");
+                        finish(nullptr, true);
+                        break;
+                    }
+                }
+
+                advance();
+
+                frame.child_loc = tok.span;
+                frame.state = 1;
+                call(ExprFrameKind::ExprList, Precedence::BitwiseOr);
+                break;
+            }
+            case 1: {
+                if (!result.first) {
+                    fail_child("expected target after 'for' in comprehension.");
+                    break;
+                }
+
+                frame.node = result.first;
+
+                if (!expect(TokenKind::KeywordIn)) {
+                    report_error(tok.span, "expected 'in' after target of "
+                                           "'for' in comprehension.");
+                    finish(nullptr, true);
+                    break;
+                }
+
+                advance();
+
+                frame.child_loc = tok.span;
+                frame.state = 2;
+                call(ExprFrameKind::Binary, Precedence::LogicalOr);
+                break;
+            }
+            case 2:
+            case 3: {
+                if (!result.first) {
+                    fail_child(frame.state == 2
+                                   ? "expected expression after 'in' in "
+                                     "comprehension."
+                                   : "expected condition after 'if' in "
+                                     "comprehension.");
+                    break;
+                }
+
+                if (frame.state == 2) {
+                    frame.node_2 = result.first;
+                    frame.mark = node_scratch.size();
+                } else {
+                    node_scratch.push_back(result.first);
+                }
+
+                if (expect(TokenKind::KeywordIf)) {
+                    advance();
+
+                    frame.child_loc = tok.span;
+                    frame.state = 3;
+                    call(ExprFrameKind::Binary, Precedence::LogicalOr);
+                    break;
+                }
+
+                auto ifs =
+                    arena.allocate_array(node_scratch.data() + frame.mark,
+                                         node_scratch.size() - frame.mark);
+                auto end_loc =
+                    ifs.empty() ? frame.node_2->loc : ifs[ifs.size() - 1]->loc;
+                finish(make_node<Tree::ASTComprehensionClauseNode>(
+                           frame.op == TokenKind::KeywordAsync, frame.node,
+                           frame.node_2, ifs,
+                           Source::Span::merge(frame.loc, end_loc)),
+                       false);
+                break;
+            }
+            }
+            break;
+        }
+        }
+    }
+
+    return result;
+}
+} // namespace tpy::Parse
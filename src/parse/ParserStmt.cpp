@@ -0,0 +1,1497 @@
+/*
+    This file implements the parser for Python statements and modules.
+*/
+
+#include "tpy/parse/Parser.h"
+#include "tpy/parse/Token.h"
+#include "tpy/source/Span.h"
+#include "tpy/tree/ASTExpr.h"
+#include "tpy/tree/ASTNode.h"
+#include "tpy/tree/ASTStmt.h"
+
+namespace tpy::Parse {
+// This function returns the location of the last statement of a block, which
+// is where a compound statement ends. Blocks are never empty.
+static auto last_loc(const Utility::ArenaArray<Tree::ASTNode *> &body)
+    -> const Source::Span & {
+    return body[body.size() - 1]->loc;
+}
+
+/*
+    This method will skip an indented block, beginning at its 'Indent' token and
+   ending after the matching 'Dedent' token. It returns the location of the last
+   token of the block.
+*/
+auto Parser::skip_indented_block() -> Source::Span {
+    auto end_loc = tok.span;
+    size_t depth = 0;
+
+    do {
+        if (expect(TokenKind::Indent)) {
+            ++depth;
+        } else if (expect(TokenKind::Dedent)) {
+            --depth;
+        } else if (expect(TokenKind::End)) {
+            break;
+        } else {
+            end_loc = tok.span;
+        }
+
+        advance();
+    } while (depth);
+
+    return end_loc;
+}
+
+/*
+    This method will recover from an error within the statement that began at
+   the given location, once the error has been reported. Newlines are the
+   synchronization points of statements, so the rest of the logical line is
+   skipped, and an error node takes the place of the statement. If the line was
+   the header of a compound statement, its indented block is skipped as well,
+   since it cannot be parsed without the header. A 'Dedent' ends the block that
+   the statement belongs to, so it is left for the block.
+
+    A compound statement may fail at the start of a line once its block has
+   been parsed, such as a 'try' statement without an 'except' clause. Nothing
+   is skipped then, as the line belongs to the next statement. Every recovery
+   skips each token at most once, so the parse stays linear.
+
+    The error node ends at the last token of the statement that was consumed or
+   skipped, so a statement that fails at the end of its line still covers all of
+   it.
+*/
+auto Parser::synchronize(StmtScope &stmts, Source::Span start) -> void {
+    bool past_start = tok.span.local_pos != start.local_pos;
+    bool at_line_start = past_start && (prev_kind == TokenKind::Newline ||
+                                        prev_kind == TokenKind::Dedent);
+    auto end_loc = start;
+
+    if (!at_line_start) {
+        if (past_start) {
+            end_loc = prev_span;
+        }
+
+        while (!expect(TokenKind::Newline) && !expect(TokenKind::Dedent) &&
+               !expect(TokenKind::End)) {
+            end_loc = tok.span;
+            advance();
+        }
+
+        if (expect(TokenKind::Newline)) {
+            advance();
+
+            while (expect(TokenKind::Newline)) {
+                advance();
+            }
+
+            if (expect(TokenKind::Indent)) {
+                end_loc = skip_indented_block();
+            }
+        }
+    }
+
+    stmts.push(
+        make_node<Tree::ASTErrorNode>(Source::Span::merge(start, end_loc)));
+}
+
+/*
+    This method will parse a whole module. A module is a list of statements
+   that ends with the 'End' token. Blank lines only produce 'Newline' tokens,
+   so they are skipped between statements.
+*/
+auto Parser::parse_py_module() -> Tree::ASTNode * {
+    advance();
+
+    auto start = tok.span;
+    StmtScope body{node_scratch};
+
+    while (!expect(TokenKind::End)) {
+        if (expect(TokenKind::Newline)) {
+            advance();
+            continue;
+        }
+
+        auto stmt_start = tok.span;
+
+        if (expect(TokenKind::Indent)) {
+            report_error(tok.span, "unexpected indent.");
+            body.push(make_node<Tree::ASTErrorNode>(
+                Source::Span::merge(stmt_start, skip_indented_block())));
+            continue;
+        }
+
+        if (!parse_py_statement(body)) {
+            synchronize(body, stmt_start);
+        }
+    }
+
+    return make_node<Tree::ASTModuleNode>(
+        body.copy_to(arena), Source::Span::merge(start, tok.span));
+}
+
+/*
+    This method will parse a single statement and add it to the block. A line
+   of simple statements separated by ';' adds all of them.
+*/
+auto Parser::parse_py_statement(StmtScope &stmts) -> bool {
+    ReturnType stmt;
+
+    switch (tok.kind) {
+    case TokenKind::KeywordIf: {
+        stmt = parse_py_if_stmt();
+        break;
+    }
+    case TokenKind::KeywordWhile: {
+        stmt = parse_py_while_stmt();
+        break;
+    }
+    case TokenKind::KeywordFor: {
+        stmt = parse_py_for_stmt(tok.span, false);
+        break;
+    }
+    case TokenKind::KeywordTry: {
+        stmt = parse_py_try_stmt();
+        break;
+    }
+    case TokenKind::KeywordWith: {
+        stmt = parse_py_with_stmt(tok.span, false);
+        break;
+    }
+    case TokenKind::KeywordDef: {
+        stmt = parse_py_function_def({}, tok.span, false);
+        break;
+    }
+    case TokenKind::KeywordClass: {
+        stmt = parse_py_class_def({}, tok.span);
+        break;
+    }
+    case TokenKind::KeywordAsync: {
+        stmt = parse_py_async_stmt();
+        break;
+    }
+    case TokenKind::At: {
+        stmt = parse_py_decorated();
+        break;
+    }
+    default: {
+        return parse_py_simple_stmt_line(stmts);
+    }
+    }
+
+    // The compound statement methods report all of their errors.
+    if (!stmt.first) {
+        return false;
+    }
+
+    stmts.push(stmt.first);
+    return true;
+}
+
+/*
+    This method will parse a line of simple statements, which are separated by
+   ';' and end with a newline. The end of a block or of the module also ends the
+   line, in which case nothing is consumed. If the line has an error, none of
+   its statements are added, as the error node that replaces the line covers
+   them.
+*/
+auto Parser::parse_py_simple_stmt_line(StmtScope &stmts) -> bool {
+    auto line_start = stmts.size();
+
+    while (true) {
+        auto stmt_start = tok.span;
+        auto stmt = parse_py_simple_stmt();
+
+        if (!stmt.first) {
+            if (!stmt.second) {
+                report_error(stmt_start, "expected statement.");
+            }
+
+            stmts.pop_to(line_start);
+            return false;
+        }
+
+        stmts.push(stmt.first);
+
+        if (!expect(TokenKind::Semicolon)) {
+            break;
+        }
+
+        // Consume the ';'. A trailing ';' is allowed at the end of the line.
+        advance();
+
+        if (expect(TokenKind::Newline) || expect(TokenKind::End) ||
+            expect(TokenKind::Dedent)) {
+            break;
+        }
+    }
+
+    if (expect(TokenKind::Newline)) {
+        advance();
+        return true;
+    }
+
+    if (expect(TokenKind::End) || expect(TokenKind::Dedent)) {
+        return true;
+    }
+
+    report_error(tok.span, "expected newline at the end of a statement.");
+    stmts.pop_to(line_start);
+    return false;
+}
+
+/*
+    This method will parse a single simple statement. Most of them begin with a
+   keyword, and everything else is an expression or an assignment.
+*/
+auto Parser::parse_py_simple_stmt() -> ReturnType {
+    auto start = tok.span;
+
+    switch (tok.kind) {
+    case TokenKind::KeywordPass: {
+        auto *node = make_node<Tree::ASTPassStmtNode>(start);
+        advance();
+        return std::make_pair(node, false);
+    }
+    case TokenKind::KeywordBreak: {
+        auto *node = make_node<Tree::ASTBreakStmtNode>(start);
+        advance();
+        return std::make_pair(node, false);
+    }
+    case TokenKind::KeywordContinue: {
+        auto *node = make_node<Tree::ASTContinueStmtNode>(start);
+        advance();
+        return std::make_pair(node, false);
+    }
+    case TokenKind::KeywordReturn: {
+        advance();
+
+        // The value of a return statement is optional.
+        if (!starts_py_expr()) {
+            auto *node = make_node<Tree::ASTReturnStmtNode>(nullptr, start);
+            return std::make_pair(node, false);
+        }
+
+        auto value_start = tok.span;
+        auto value = parse_py_expr_list();
+
+        if (!value.first) {
+            if (!value.second) {
+                report_error(value_start,
+                             "expected expression after 'return'.");
+            }
+
+            return std::make_pair(nullptr, true);
+        }
+
+        auto *node = make_node<Tree::ASTReturnStmtNode>(
+            value.first, Source::Span::merge(start, value.first->loc));
+
+        return std::make_pair(node, false);
+    }
+    case TokenKind::KeywordDel: {
+        advance();
+
+        StmtScope targets{node_scratch};
+        auto end_loc = start;
+
+        do {
+            // Consume the ',' between targets.
+            if (expect(TokenKind::Comma)) {
+                advance();
+
+                if (!starts_py_expr()) {
+                    break;
+                }
+            }
+
+            auto target_start = tok.span;
+            auto target = parse_py_binary_expr(Precedence::BitwiseOr);
+
+            if (!target.first) {
+                if (!target.second) {
+                    report_error(target_start,
+                                 "expected expression as target of 'del'.");
+                }
+
+                return std::make_pair(nullptr, true);
+            }
+
+            targets.push(target.first);
+            end_loc = target.first->loc;
+        } while (expect(TokenKind::Comma));
+
+        auto *node = make_node<Tree::ASTDelStmtNode>(
+            targets.copy_to(arena), Source::Span::merge(start, end_loc));
+
+        return std::make_pair(node, false);
+    }
+    case TokenKind::KeywordGlobal:
+    case TokenKind::KeywordNonlocal: {
+        auto keyword = tok.kind;
+        advance();
+
+        StmtScope names{node_scratch};
+        if (!parse_py_name_list(names,
+                                "expected identifier in 'global' or "
+                                "'nonlocal' statement.")) {
+            return std::make_pair(nullptr, true);
+        }
+
+        auto list = names.copy_to(arena);
+        auto loc = Source::Span::merge(start, last_loc(list));
+
+        if (keyword == TokenKind::KeywordGlobal) {
+            return std::make_pair(
+                make_node<Tree::ASTGlobalStmtNode>(list, loc), false);
+        }
+
+        return std::make_pair(
+            make_node<Tree::ASTNonlocalStmtNode>(list, loc), false);
+    }
+    case TokenKind::KeywordAssert: {
+        advance();
+
+        auto test_start = tok.span;
+        auto test = parse_py_expr();
+
+        if (!test.first) {
+            if (!test.second) {
+                report_error(test_start, "expected expression after 'assert'.");
+            }
+
+            return std::make_pair(nullptr, true);
+        }
+
+        Tree::ASTNode *msg = nullptr;
+        auto end_loc = test.first->loc;
+
+        // The message is optional and follows a ','.
+        if (expect(TokenKind::Comma)) {
+            advance();
+
+            auto msg_start = tok.span;
+            auto msg_expr = parse_py_expr();
+
+            if (!msg_expr.first) {
+                if (!msg_expr.second) {
+                    report_error(msg_start, "expected expression as message "
+                                            "after ',' in 'assert'.");
+                }
+
+                return std::make_pair(nullptr, true);
+            }
+
+            msg = msg_expr.first;
+            end_loc = msg->loc;
+        }
+
+        auto *node = make_node<Tree::ASTAssertStmtNode>(
+            test.first, msg, Source::Span::merge(start, end_loc));
+
+        return std::make_pair(node, false);
+    }
+    case TokenKind::KeywordRaise: {
+        advance();
+
+        // A bare 'raise' re-raises the exception that is being handled.
+        if (!starts_py_expr()) {
+            auto *node =
+                make_node<Tree::ASTRaiseStmtNode>(nullptr, nullptr, start);
+            return std::make_pair(node, false);
+        }
+
+        auto exc_start = tok.span;
+        auto exc = parse_py_expr();
+
+        if (!exc.first) {
+            if (!exc.second) {
+                report_error(exc_start, "expected expression after 'raise'.");
+            }
+
+            return std::make_pair(nullptr, true);
+        }
+
+        Tree::ASTNode *cause = nullptr;
+        auto end_loc = exc.first->loc;
+
+        if (expect(TokenKind::KeywordFrom)) {
+            advance();
+
+            auto cause_start = tok.span;
+            auto cause_expr = parse_py_expr();
+
+            if (!cause_expr.first) {
+                if (!cause_expr.second) {
+                    report_error(cause_start, "expected expression after "
+                                              "'from' in 'raise'.");
+                }
+
+                return std::make_pair(nullptr, true);
+            }
+
+            cause = cause_expr.first;
+            end_loc = cause->loc;
+        }
+
+        auto *node = make_node<Tree::ASTRaiseStmtNode>(
+            exc.first, cause, Source::Span::merge(start, end_loc));
+
+        return std::make_pair(node, false);
+    }
+    case TokenKind::KeywordImport: {
+        return parse_py_import_stmt();
+    }
+    case TokenKind::KeywordFrom: {
+        return parse_py_import_from_stmt();
+    }
+    default: {
+        return parse_py_expr_stmt();
+    }
+    }
+}
+
+/*
+    This method will parse the statements that begin with an expression. These
+   are expression statements and the three kinds of assignments. A 'yield'
+   expression can be a statement of its own, or the value of an assignment.
+*/
+auto Parser::parse_py_expr_stmt() -> ReturnType {
+    auto first = parse_py_expr_list_or_yield();
+
+    if (!first.first) {
+        // Here, we let the caller report that no statement was found.
+        return first;
+    }
+
+    auto *target = first.first;
+
+    switch (tok.kind) {
+    case TokenKind::Equals: {
+        // Every expression but the last one of 'a = b = c' is a target.
+        StmtScope targets{node_scratch};
+        auto *value = target;
+
+        while (expect(TokenKind::Equals)) {
+            targets.push(value);
+            advance();
+
+            auto value_start = tok.span;
+            auto next = parse_py_expr_list_or_yield();
+
+            if (!next.first) {
+                if (!next.second) {
+                    report_error(value_start,
+                                 "expected expression after '=' in "
+                                 "assignment.");
+                }
+
+                return std::make_pair(nullptr, true);
+            }
+
+            value = next.first;
+        }
+
+        auto *node = make_node<Tree::ASTAssignStmtNode>(
+            targets.copy_to(arena), value,
+            Source::Span::merge(target->loc, value->loc));
+
+        return std::make_pair(node, false);
+    }
+    case TokenKind::PlusEquals:
+    case TokenKind::MinusEquals:
+    case TokenKind::AsteriskEquals:
+    case TokenKind::SlashEquals:
+    case TokenKind::SlashSlashEquals:
+    case TokenKind::PercentEquals:
+    case TokenKind::AtEquals:
+    case TokenKind::AmpersandEquals:
+    case TokenKind::BarEquals:
+    case TokenKind::CaretEquals:
+    case TokenKind::GreaterGreaterEquals:
+    case TokenKind::LessLessEquals:
+    case TokenKind::AsteriskAsteriskEquals: {
+        auto op = tok.kind;
+        advance();
+
+        auto value_start = tok.span;
+        auto value = parse_py_expr_list_or_yield();
+
+        if (!value.first) {
+            if (!value.second) {
+                report_error(value_start, "expected expression after "
+                                          "augmented assignment operator.");
+            }
+
+            return std::make_pair(nullptr, true);
+        }
+
+        auto *node = make_node<Tree::ASTAugAssignStmtNode>(
+            target, op, value.first,
+            Source::Span::merge(target->loc, value.first->loc));
+
+        return std::make_pair(node, false);
+    }
+    case TokenKind::Colon: {
+        advance();
+
+        auto annotation_start = tok.span;
+        auto annotation = parse_py_expr();
+
+        if (!annotation.first) {
+            if (!annotation.second) {
+                report_error(annotation_start,
+                             "expected type annotation after ':'.");
+            }
+
+            return std::make_pair(nullptr, true);
+        }
+
+        // The value of an annotated assignment is optional.
+        Tree::ASTNode *value = nullptr;
+        auto end_loc = annotation.first->loc;
+
+        if (expect(TokenKind::Equals)) {
+            advance();
+
+            auto value_start = tok.span;
+            auto value_expr = parse_py_expr_list_or_yield();
+
+            if (!value_expr.first) {
+                if (!value_expr.second) {
+                    report_error(value_start,
+                                 "expected expression after '=' in "
+                                 "annotated assignment.");
+                }
+
+                return std::make_pair(nullptr, true);
+            }
+
+            value = value_expr.first;
+            end_loc = value->loc;
+        }
+
+        auto *node = make_node<Tree::ASTAnnAssignStmtNode>(
+            target, annotation.first, value,
+            Source::Span::merge(target->loc, end_loc));
+
+        return std::make_pair(node, false);
+    }
+    default: {
+        auto *node = make_node<Tree::ASTExprStmtNode>(target, target->loc);
+        return std::make_pair(node, false);
+    }
+    }
+}
+
+// This method will parse a list of identifiers separated by commas, as used by
+// the 'global' and 'nonlocal' statements.
+auto Parser::parse_py_name_list(StmtScope &names, const char *error) -> bool {
+    while (true) {
+        if (!expect(TokenKind::Identifier)) {
+            report_error(tok.span, error);
+            return false;
+        }
+
+        names.push(make_node<Tree::ASTNameExprNode>(tok.span));
+        advance();
+
+        if (!expect(TokenKind::Comma)) {
+            return true;
+        }
+
+        advance();
+    }
+}
+
+// This method will parse a dotted module name such as 'os.path'. It is made up
+// of attribute references, just like the same expression would be.
+auto Parser::parse_py_dotted_name() -> ReturnType {
+    if (!expect(TokenKind::Identifier)) {
+        report_error(tok.span, "expected module name.");
+        return std::make_pair(nullptr, true);
+    }
+
+    Tree::ASTNode *name = make_node<Tree::ASTNameExprNode>(tok.span);
+    advance();
+
+    while (expect(TokenKind::Dot)) {
+        advance();
+
+        if (!expect(TokenKind::Identifier)) {
+            report_error(tok.span, "expected identifier after '.' in module "
+                                   "name.");
+            return std::make_pair(nullptr, true);
+        }
+
+        auto *attr = make_node<Tree::ASTNameExprNode>(tok.span);
+        name = make_node<Tree::ASTAttrRefExprNode>(
+            name, attr, Source::Span::merge(name->loc, attr->loc));
+        advance();
+    }
+
+    return std::make_pair(name, false);
+}
+
+// This method will parse an imported name along with the optional 'as' name.
+// The names imported by 'from ... import' cannot be dotted.
+auto Parser::parse_py_import_alias(bool dotted) -> ReturnType {
+    ReturnType name;
+
+    if (dotted) {
+        name = parse_py_dotted_name();
+    } else if (expect(TokenKind::Identifier)) {
+        name.first = make_node<Tree::ASTNameExprNode>(tok.span);
+        advance();
+    } else {
+        report_error(tok.span, "expected identifier of the imported name.");
+        return std::make_pair(nullptr, true);
+    }
+
+    if (!name.first) {
+        return name;
+    }
+
+    Tree::ASTNode *as_name = nullptr;
+
+    if (expect(TokenKind::KeywordAs)) {
+        advance();
+
+        if (!expect(TokenKind::Identifier)) {
+            report_error(tok.span, "expected identifier after 'as'.");
+            return std::make_pair(nullptr, true);
+        }
+
+        as_name = make_node<Tree::ASTNameExprNode>(tok.span);
+        advance();
+    }
+
+    auto *node = make_node<Tree::ASTImportAliasNode>(
+        name.first, as_name,
+        Source::Span::merge(name.first->loc,
+                            as_name ? as_name->loc : name.first->loc));
+
+    return std::make_pair(node, false);
+}
+
+// This method will parse statements of the form 'import a.b as c, d'.
+auto Parser::parse_py_import_stmt() -> ReturnType {
+    auto start = tok.span;
+    advance();
+
+    StmtScope names{node_scratch};
+
+    while (true) {
+        auto alias = parse_py_import_alias(true);
+
+        if (!alias.first) {
+            return alias;
+        }
+
+        names.push(alias.first);
+
+        if (!expect(TokenKind::Comma)) {
+            break;
+        }
+
+        advance();
+    }
+
+    auto list = names.copy_to(arena);
+    auto *node = make_node<Tree::ASTImportStmtNode>(
+        list, Source::Span::merge(start, last_loc(list)));
+
+    return std::make_pair(node, false);
+}
+
+/*
+    This method will parse statements of the form 'from ..a import b as c'. The
+   imported names can be enclosed in parentheses, in which case they may have a
+   trailing comma, and '*' imports every public name.
+*/
+auto Parser::parse_py_import_from_stmt() -> ReturnType {
+    auto start = tok.span;
+    advance();
+
+    // Each leading '.' goes up one package for a relative import. The lexer
+    // reads three of them in a row as an ellipsis.
+    uint32_t level = 0;
+    while (expect(TokenKind::Dot) || expect(TokenKind::Ellipsis)) {
+        level += expect(TokenKind::Dot) ? 1 : 3;
+        advance();
+    }
+
+    Tree::ASTNode *module = nullptr;
+
+    if (!level || !expect(TokenKind::KeywordImport)) {
+        auto name = parse_py_dotted_name();
+
+        if (!name.first) {
+            return name;
+        }
+
+        module = name.first;
+    }
+
+    if (!expect(TokenKind::KeywordImport)) {
+        report_error(tok.span, "expected 'import' after module name.");
+        return std::make_pair(nullptr, true);
+    }
+
+    advance();
+
+    // An empty list of names means that every name is imported.
+    if (expect(TokenKind::Asterisk)) {
+        auto *node = make_node<Tree::ASTImportFromStmtNode>(
+            level, module, Utility::ArenaArray<Tree::ASTNode *>{},
+            Source::Span::merge(start, tok.span));
+        advance();
+
+        return std::make_pair(node, false);
+    }
+
+    bool is_paren = expect(TokenKind::LeftParen);
+    if (is_paren) {
+        advance();
+    }
+
+    StmtScope names{node_scratch};
+
+    while (true) {
+        auto alias = parse_py_import_alias(false);
+
+        if (!alias.first) {
+            return alias;
+        }
+
+        names.push(alias.first);
+
+        if (!expect(TokenKind::Comma)) {
+            break;
+        }
+
+        advance();
+
+        if (is_paren && expect(TokenKind::RightParen)) {
+            break;
+        }
+    }
+
+    auto list = names.copy_to(arena);
+    auto end_loc = last_loc(list);
+
+    if (is_paren) {
+        if (!expect(TokenKind::RightParen)) {
+            report_error(tok.span,
+                         "expected closing ')' after imported names.");
+            return std::make_pair(nullptr, true);
+        }
+
+        end_loc = tok.span;
+        advance();
+    }
+
+    auto *node = make_node<Tree::ASTImportFromStmtNode>(
+        level, module, list, Source::Span::merge(start, end_loc));
+
+    return std::make_pair(node, false);
+}
+
+/*
+    This method will parse the block of a compound statement, which follows a
+   ':'. The block is either a line of simple statements on the same line, or
+   an indented list of statements on the following lines.
+*/
+auto Parser::parse_py_suite(Utility::ArenaArray<Tree::ASTNode *> &body,
+                            const char *colon_error) -> bool {
+    if (!expect(TokenKind::Colon)) {
+        report_error(tok.span, colon_error);
+        return false;
+    }
+
+    advance();
+
+    StmtScope stmts{node_scratch};
+
+    if (!expect(TokenKind::Newline)) {
+        if (!parse_py_simple_stmt_line(stmts)) {
+            return false;
+        }
+
+        body = stmts.copy_to(arena);
+        return true;
+    }
+
+    // Blank lines are skipped before the indented block.
+    while (expect(TokenKind::Newline)) {
+        advance();
+    }
+
+    if (!expect(TokenKind::Indent)) {
+        report_error(tok.span, "expected an indented block.");
+        return false;
+    }
+
+    advance();
+
+    while (!expect(TokenKind::Dedent) && !expect(TokenKind::End)) {
+        if (expect(TokenKind::Newline)) {
+            advance();
+            continue;
+        }
+
+        auto stmt_start = tok.span;
+
+        if (expect(TokenKind::Indent)) {
+            report_error(tok.span, "unexpected indent.");
+            stmts.push(make_node<Tree::ASTErrorNode>(
+                Source::Span::merge(stmt_start, skip_indented_block())));
+            continue;
+        }
+
+        if (!parse_py_statement(stmts)) {
+            synchronize(stmts, stmt_start);
+        }
+    }
+
+    // Consume the 'Dedent' that closes the block.
+    if (expect(TokenKind::Dedent)) {
+        advance();
+    }
+
+    body = stmts.copy_to(arena);
+    if (body.empty()) {
+        report_error(tok.span, "expected an indented block.");
+        return false;
+    }
+
+    return true;
+}
+
+// This method will parse the optional 'else' clause of the 'while', 'for', and
+// 'try' statements.
+auto Parser::parse_py_else_suite(Utility::ArenaArray<Tree::ASTNode *> &orelse)
+    -> bool {
+    if (!expect(TokenKind::KeywordElse)) {
+        return true;
+    }
+
+    advance();
+    return parse_py_suite(orelse, "expected ':' after 'else'.");
+}
+
+/*
+    This method will parse 'if' statements. An 'elif' clause is parsed just like
+   another 'if' statement, which becomes the only statement of the else branch.
+*/
+auto Parser::parse_py_if_stmt() -> ReturnType {
+    // This is either the 'if' or the 'elif' keyword.
+    auto start = tok.span;
+    advance();
+
+    auto test_start = tok.span;
+    auto test = parse_py_expr();
+
+    if (!test.first) {
+        if (!test.second) {
+            report_error(test_start, "expected condition after 'if'.");
+        }
+
+        return std::make_pair(nullptr, true);
+    }
+
+    Utility::ArenaArray<Tree::ASTNode *> body;
+    if (!parse_py_suite(body, "expected ':' after condition of 'if'.")) {
+        return std::make_pair(nullptr, true);
+    }
+
+    Utility::ArenaArray<Tree::ASTNode *> orelse;
+
+    if (expect(TokenKind::KeywordElif)) {
+        auto elif = parse_py_if_stmt();
+
+        if (!elif.first) {
+            return elif;
+        }
+
+        orelse = arena.allocate_array(&elif.first, 1);
+    } else if (expect(TokenKind::KeywordElse)) {
+        advance();
+
+        if (!parse_py_suite(orelse, "expected ':' after 'else'.")) {
+            return std::make_pair(nullptr, true);
+        }
+    }
+
+    auto end_loc = orelse.empty() ? last_loc(body) : last_loc(orelse);
+    auto *node = make_node<Tree::ASTIfStmtNode>(
+        test.first, body, orelse, Source::Span::merge(start, end_loc));
+
+    return std::make_pair(node, false);
+}
+
+auto Parser::parse_py_while_stmt() -> ReturnType {
+    auto start = tok.span;
+    advance();
+
+    auto test_start = tok.span;
+    auto test = parse_py_expr();
+
+    if (!test.first) {
+        if (!test.second) {
+            report_error(test_start, "expected condition after 'while'.");
+        }
+
+        return std::make_pair(nullptr, true);
+    }
+
+    Utility::ArenaArray<Tree::ASTNode *> body, orelse;
+    if (!parse_py_suite(body, "expected ':' after condition of 'while'.") ||
+        !parse_py_else_suite(orelse)) {
+        return std::make_pair(nullptr, true);
+    }
+
+    auto end_loc = orelse.empty() ? last_loc(body) : last_loc(orelse);
+    auto *node = make_node<Tree::ASTWhileStmtNode>(
+        test.first, body, orelse, Source::Span::merge(start, end_loc));
+
+    return std::make_pair(node, false);
+}
+
+// This method will parse 'for' statements. The 'for' keyword is the lookahead,
+// and the start is the location of the 'async' keyword if there is one.
+auto Parser::parse_py_for_stmt(Source::Span start, bool is_async)
+    -> ReturnType {
+    advance();
+
+    // The target cannot contain comparisons, so it stops before the 'in'.
+    auto target_start = tok.span;
+    auto target = parse_py_expr_list(Precedence::BitwiseOr);
+
+    if (!target.first) {
+        if (!target.second) {
+            report_error(target_start, "expected target after 'for'.");
+        }
+
+        return std::make_pair(nullptr, true);
+    }
+
+    if (!expect(TokenKind::KeywordIn)) {
+        report_error(tok.span, "expected 'in' after target of 'for'.");
+        return std::make_pair(nullptr, true);
+    }
+
+    advance();
+
+    auto iter_start = tok.span;
+    auto iter = parse_py_expr_list();
+
+    if (!iter.first) {
+        if (!iter.second) {
+            report_error(iter_start, "expected expression after 'in'.");
+        }
+
+        return std::make_pair(nullptr, true);
+    }
+
+    Utility::ArenaArray<Tree::ASTNode *> body, orelse;
+    if (!parse_py_suite(body, "expected ':' after iterable of 'for'.") ||
+        !parse_py_else_suite(orelse)) {
+        return std::make_pair(nullptr, true);
+    }
+
+    auto end_loc = orelse.empty() ? last_loc(body) : last_loc(orelse);
+    auto *node = make_node<Tree::ASTForStmtNode>(
+        is_async, target.first, iter.first, body, orelse,
+        Source::Span::merge(start, end_loc));
+
+    return std::make_pair(node, false);
+}
+
+/*
+    This method will parse 'try' statements. There must be at least one
+   'except' or a 'finally' clause, and the 'else' clause is only allowed after
+   an 'except' clause.
+*/
+auto Parser::parse_py_try_stmt() -> ReturnType {
+    auto start = tok.span;
+    advance();
+
+    Utility::ArenaArray<Tree::ASTNode *> body;
+    if (!parse_py_suite(body, "expected ':' after 'try'.")) {
+        return std::make_pair(nullptr, true);
+    }
+
+    StmtScope handlers{node_scratch};
+
+    while (expect(TokenKind::KeywordExcept)) {
+        auto except_loc = tok.span;
+        advance();
+
+        Tree::ASTNode *type = nullptr;
+        Tree::ASTNode *name = nullptr;
+
+        if (!expect(TokenKind::Colon)) {
+            auto type_start = tok.span;
+            auto type_expr = parse_py_expr();
+
+            if (!type_expr.first) {
+                if (!type_expr.second) {
+                    report_error(type_start,
+                                 "expected exception type after 'except'.");
+                }
+
+                return std::make_pair(nullptr, true);
+            }
+
+            type = type_expr.first;
+
+            if (expect(TokenKind::KeywordAs)) {
+                advance();
+
+                if (!expect(TokenKind::Identifier)) {
+                    report_error(tok.span, "expected identifier after 'as'.");
+                    return std::make_pair(nullptr, true);
+                }
+
+                name = make_node<Tree::ASTNameExprNode>(tok.span);
+                advance();
+            }
+        }
+
+        Utility::ArenaArray<Tree::ASTNode *> handler_body;
+        if (!parse_py_suite(handler_body, "expected ':' after 'except'.")) {
+            return std::make_pair(nullptr, true);
+        }
+
+        handlers.push(make_node<Tree::ASTExceptHandlerNode>(
+            type, name, handler_body,
+            Source::Span::merge(except_loc, last_loc(handler_body))));
+    }
+
+    auto handler_list = handlers.copy_to(arena);
+
+    Utility::ArenaArray<Tree::ASTNode *> orelse, finalbody;
+
+    if (!handler_list.empty() && !parse_py_else_suite(orelse)) {
+        return std::make_pair(nullptr, true);
+    }
+
+    if (expect(TokenKind::KeywordFinally)) {
+        advance();
+
+        if (!parse_py_suite(finalbody, "expected ':' after 'finally'.")) {
+            return std::make_pair(nullptr, true);
+        }
+    }
+
+    if (handler_list.empty() && finalbody.empty()) {
+        report_error(tok.span, "expected 'except' or 'finally' clause after "
+                               "'try'.");
+        return std::make_pair(nullptr, true);
+    }
+
+    auto end_loc = last_loc(body);
+    if (!finalbody.empty()) {
+        end_loc = last_loc(finalbody);
+    } else if (!orelse.empty()) {
+        end_loc = last_loc(orelse);
+    } else {
+        end_loc = last_loc(handler_list);
+    }
+
+    auto *node = make_node<Tree::ASTTryStmtNode>(
+        body, handler_list, orelse, finalbody,
+        Source::Span::merge(start, end_loc));
+
+    return std::make_pair(node, false);
+}
+
+// This method will parse 'with' statements. The 'with' keyword is the
+// lookahead, and the start is the location of the 'async' keyword if there is
+// one.
+auto Parser::parse_py_with_stmt(Source::Span start, bool is_async)
+    -> ReturnType {
+    advance();
+
+    StmtScope items{node_scratch};
+
+    while (true) {
+        auto expr_start = tok.span;
+        auto expr = parse_py_expr();
+
+        if (!expr.first) {
+            if (!expr.second) {
+                report_error(expr_start,
+                             "expected context manager after 'with'.");
+            }
+
+            return std::make_pair(nullptr, true);
+        }
+
+        Tree::ASTNode *target = nullptr;
+
+        if (expect(TokenKind::KeywordAs)) {
+            advance();
+
+            auto target_start = tok.span;
+            auto target_expr = parse_py_binary_expr(Precedence::BitwiseOr);
+
+            if (!target_expr.first) {
+                if (!target_expr.second) {
+                    report_error(target_start,
+                                 "expected target after 'as' in 'with'.");
+                }
+
+                return std::make_pair(nullptr, true);
+            }
+
+            target = target_expr.first;
+        }
+
+        items.push(make_node<Tree::ASTWithItemNode>(
+            expr.first, target,
+            Source::Span::merge(expr.first->loc,
+                                target ? target->loc : expr.first->loc)));
+
+        if (!expect(TokenKind::Comma)) {
+            break;
+        }
+
+        advance();
+    }
+
+    auto item_list = items.copy_to(arena);
+
+    Utility::ArenaArray<Tree::ASTNode *> body;
+    if (!parse_py_suite(body, "expected ':' after context managers of "
+                              "'with'.")) {
+        return std::make_pair(nullptr, true);
+    }
+
+    auto *node = make_node<Tree::ASTWithStmtNode>(
+        is_async, item_list, body, Source::Span::merge(start, last_loc(body)));
+
+    return std::make_pair(node, false);
+}
+
+// This method will parse the statements that begin with 'async', which are the
+// forms of function definitions, 'for' statements, and 'with' statements that
+// run within a coroutine.
+auto Parser::parse_py_async_stmt() -> ReturnType {
+    auto start = tok.span;
+    advance();
+
+    switch (tok.kind) {
+    case TokenKind::KeywordDef: {
+        return parse_py_function_def({}, start, true);
+    }
+    case TokenKind::KeywordFor: {
+        return parse_py_for_stmt(start, true);
+    }
+    case TokenKind::KeywordWith: {
+        return parse_py_with_stmt(start, true);
+    }
+    default: {
+        report_error(tok.span,
+                     "expected 'def', 'for', or 'with' after 'async'.");
+        return std::make_pair(nullptr, true);
+    }
+    }
+}
+
+/*
+    This method will parse a single entry of the parameter list of a function.
+   The location of the last token of the entry is stored, as markers such as '/'
+   do not have any child to take it from. The parameters of a lambda are not
+   annotated, as the ':' ends their list.
+*/
+auto Parser::parse_py_param(Source::Span &end_loc,
+                            bool annotated) -> ReturnType {
+    auto start = tok.span;
+    auto kind = Tree::ParamKind::Normal;
+
+    if (expect(TokenKind::Slash)) {
+        end_loc = tok.span;
+        advance();
+
+        auto *node = make_node<Tree::ASTParamNode>(
+            Tree::ParamKind::PositionalOnlyMarker, nullptr, nullptr, nullptr,
+            start);
+
+        return std::make_pair(node, false);
+    }
+
+    if (expect(TokenKind::Asterisk)) {
+        end_loc = tok.span;
+        advance();
+
+        // A bare '*' begins the keyword-only parameters.
+        if (!expect(TokenKind::Identifier)) {
+            auto *node = make_node<Tree::ASTParamNode>(
+                Tree::ParamKind::KeywordOnlyMarker, nullptr, nullptr, nullptr,
+                start);
+
+            return std::make_pair(node, false);
+        }
+
+        kind = Tree::ParamKind::VarPositional;
+    } else if (expect(TokenKind::AsteriskAsterisk)) {
+        advance();
+        kind = Tree::ParamKind::VarKeyword;
+    }
+
+    if (!expect(TokenKind::Identifier)) {
+        report_error(tok.span, "expected parameter name.");
+        return std::make_pair(nullptr, true);
+    }
+
+    auto *name = make_node<Tree::ASTNameExprNode>(tok.span);
+    end_loc = tok.span;
+    advance();
+
+    Tree::ASTNode *annotation = nullptr;
+    Tree::ASTNode *default_value = nullptr;
+
+    if (annotated && expect(TokenKind::Colon)) {
+        advance();
+
+        auto annotation_start = tok.span;
+        auto annotation_expr = parse_py_expr();
+
+        if (!annotation_expr.first) {
+            if (!annotation_expr.second) {
+                report_error(annotation_start,
+                             "expected type annotation after ':'.");
+            }
+
+            return std::make_pair(nullptr, true);
+        }
+
+        annotation = annotation_expr.first;
+        end_loc = annotation->loc;
+    }
+
+    // Only ordinary parameters can have a default value.
+    if (kind == Tree::ParamKind::Normal && expect(TokenKind::Equals)) {
+        advance();
+
+        auto default_start = tok.span;
+        auto default_expr = parse_py_expr();
+
+        if (!default_expr.first) {
+            if (!default_expr.second) {
+                report_error(default_start,
+                             "expected default value after '='.");
+            }
+
+            return std::make_pair(nullptr, true);
+        }
+
+        default_value = default_expr.first;
+        end_loc = default_value->loc;
+    }
+
+    auto *node = make_node<Tree::ASTParamNode>(
+        kind, name, annotation, default_value,
+        Source::Span::merge(start, end_loc));
+
+    return std::make_pair(node, false);
+}
+
+// This method will parse function definitions. The 'def' keyword is the
+// lookahead, and the start is the location of the first decorator or of the
+// 'async' keyword if there is one.
+auto Parser::parse_py_function_def(
+    Utility::ArenaArray<Tree::ASTNode *> decorators, Source::Span start,
+    bool is_async) -> ReturnType {
+    advance();
+
+    if (!expect(TokenKind::Identifier)) {
+        report_error(tok.span, "expected function name after 'def'.");
+        return std::make_pair(nullptr, true);
+    }
+
+    auto *name = make_node<Tree::ASTNameExprNode>(tok.span);
+    advance();
+
+    if (!expect(TokenKind::LeftParen)) {
+        report_error(tok.span, "expected '(' after function name.");
+        return std::make_pair(nullptr, true);
+    }
+
+    advance();
+
+    StmtScope params{node_scratch};
+
+    while (!expect(TokenKind::RightParen)) {
+        Source::Span end_loc = tok.span;
+        auto param = parse_py_param(end_loc, true);
+
+        if (!param.first) {
+            return param;
+        }
+
+        params.push(param.first);
+
+        if (!expect(TokenKind::Comma)) {
+            break;
+        }
+
+        advance();
+    }
+
+    if (!expect(TokenKind::RightParen)) {
+        report_error(tok.span, "expected closing ')' after parameters.");
+        return std::make_pair(nullptr, true);
+    }
+
+    auto param_list = params.copy_to(arena);
+    advance();
+
+    Tree::ASTNode *returns = nullptr;
+
+    if (expect(TokenKind::Arrow)) {
+        advance();
+
+        auto returns_start = tok.span;
+        auto returns_expr = parse_py_expr();
+
+        if (!returns_expr.first) {
+            if (!returns_expr.second) {
+                report_error(returns_start,
+                             "expected return type annotation after '->'.");
+            }
+
+            return std::make_pair(nullptr, true);
+        }
+
+        returns = returns_expr.first;
+    }
+
+    Utility::ArenaArray<Tree::ASTNode *> body;
+    if (!parse_py_suite(body, "expected ':' after function signature.")) {
+        return std::make_pair(nullptr, true);
+    }
+
+    auto *node = make_node<Tree::ASTFunctionDefNode>(
+        is_async, decorators, name, param_list, returns, body,
+        Source::Span::merge(start, last_loc(body)));
+
+    return std::make_pair(node, false);
+}
+
+// This method will parse class definitions. The bases are parsed just like the
+// arguments of a call.
+auto Parser::parse_py_class_def(Utility::ArenaArray<Tree::ASTNode *> decorators,
+                                Source::Span start) -> ReturnType {
+    advance();
+
+    if (!expect(TokenKind::Identifier)) {
+        report_error(tok.span, "expected class name after 'class'.");
+        return std::make_pair(nullptr, true);
+    }
+
+    auto *name = make_node<Tree::ASTNameExprNode>(tok.span);
+    advance();
+
+    Utility::ArenaArray<Tree::ASTNode *> base_list;
+
+    if (expect(TokenKind::LeftParen)) {
+        advance();
+
+        StmtScope bases{node_scratch};
+
+        while (!expect(TokenKind::RightParen)) {
+            auto base_start = tok.span;
+            auto base = parse_py_call_arg();
+
+            if (!base.first) {
+                if (!base.second) {
+                    report_error(base_start, "expected base class.");
+                }
+
+                return std::make_pair(nullptr, true);
+            }
+
+            bases.push(base.first);
+
+            if (!expect(TokenKind::Comma)) {
+                break;
+            }
+
+            advance();
+        }
+
+        if (!expect(TokenKind::RightParen)) {
+            report_error(tok.span, "expected closing ')' after base classes.");
+            return std::make_pair(nullptr, true);
+        }
+
+        base_list = bases.copy_to(arena);
+        advance();
+    }
+
+    Utility::ArenaArray<Tree::ASTNode *> body;
+    if (!parse_py_suite(body, "expected ':' after class name.")) {
+        return std::make_pair(nullptr, true);
+    }
+
+    auto *node = make_node<Tree::ASTClassDefNode>(
+        decorators, name, base_list, body,
+        Source::Span::merge(start, last_loc(body)));
+
+    return std::make_pair(node, false);
+}
+
+// This method will parse the decorators that precede a function or class
+// definition. Each decorator is an expression on its own line.
+auto Parser::parse_py_decorated() -> ReturnType {
+    auto start = tok.span;
+    StmtScope decorators{node_scratch};
+
+    while (expect(TokenKind::At)) {
+        advance();
+
+        auto expr_start = tok.span;
+        auto expr = parse_py_expr();
+
+        if (!expr.first) {
+            if (!expr.second) {
+                report_error(expr_start, "expected expression after '@'.");
+            }
+
+            return std::make_pair(nullptr, true);
+        }
+
+        decorators.push(expr.first);
+
+        if (!expect(TokenKind::Newline)) {
+            report_error(tok.span, "expected newline after decorator.");
+            return std::make_pair(nullptr, true);
+        }
+
+        advance();
+    }
+
+    auto decorator_list = decorators.copy_to(arena);
+
+    if (expect(TokenKind::KeywordDef)) {
+        return parse_py_function_def(decorator_list, start, false);
+    }
+
+    if (expect(TokenKind::KeywordAsync) &&
+        peek().kind == TokenKind::KeywordDef) {
+        advance();
+        return parse_py_function_def(decorator_list, start, true);
+    }
+
+    if (expect(TokenKind::KeywordClass)) {
+        return parse_py_class_def(decorator_list, start);
+    }
+
+    report_error(tok.span, "expected function or class definition after "
+                           "decorators.");
+    return std::make_pair(nullptr, true);
+}
+} // namespace tpy::Parse
@@ -7,7 +7,7 @@
 namespace tpy::Parse {
 
 #define F(x) #x,
-extern const char *token_names[] = {TOKEN_LIST(F)};
+const char *token_names[] = {TOKEN_LIST(F)};
 #undef F
 
 } // namespace tpy::Parse
\ No newline at end of file
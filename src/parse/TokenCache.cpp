@@ -0,0 +1,228 @@
+/*
+    This file implements the on-disk token cache.
+*/
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#include "tpy/parse/Lexer.h"
+#include "tpy/parse/TokenCache.h"
+#include "tpy/utility/AtomicFile.h"
+
+namespace tpy::Parse {
+static constexpr char CACHE_MAGIC[4] = {'T', 'P', 'Y', 'T'};
+
+// Segments are written to the cache as they are laid out in memory.
+static_assert(sizeof(FStringSegment) == 12 && alignof(FStringSegment) == 4,
+              "f-string segments must have a stable layout.");
+
+// This function returns the size of the kind array including its padding.
+static auto padded_kinds_size(size_t count) -> size_t {
+    return (count + 3) & ~static_cast<size_t>(3);
+}
+
+/*
+    This function checks every token and f-string segment of a stream that has
+   been read from a cache file, so that a corrupted entry is treated as a miss
+   instead of being read out of bounds. The stream must end with the 'End'
+   token, which the parser stops at, and every span must lie within the buffer
+   of the source, which has room for the 'End' token past the contents. The f-strings must be sorted, as they are looked up with a
+   binary search, and their segments must be in range.
+*/
+static auto is_valid_stream(const TokenStreamView &view, size_t src_size)
+    -> bool {
+    if (view.size == 0 || view.kind(view.size - 1) != TokenKind::End) {
+        return false;
+    }
+
+    for (size_t i = 0; i < view.size; i++) {
+        if (view.kinds[i] >= NUM_TOKEN_KINDS ||
+            static_cast<uint64_t>(view.offsets[i]) + view.lens[i] > src_size) {
+            return false;
+        }
+    }
+
+    auto &fstrings = view.fstrings;
+    for (size_t i = 0; i < fstrings.num_fstrings; i++) {
+        if (fstrings.token_offsets[i] >= src_size ||
+            fstrings.first_segments[i] > fstrings.num_segments) {
+            return false;
+        }
+
+        if (i > 0 &&
+            (fstrings.token_offsets[i] <= fstrings.token_offsets[i - 1] ||
+             fstrings.first_segments[i] < fstrings.first_segments[i - 1])) {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < fstrings.num_segments; i++) {
+        auto &segment = fstrings.segments[i];
+        if (static_cast<uint64_t>(segment.offset) + segment.len > src_size ||
+            segment.kind > FStringSegmentKind::FormatSpec) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+    This method computes the 64-bit FNV-1a hash of the given bytes. It is not a
+   cryptographic hash, but it is fast and more than enough to tell whether a
+   file has changed.
+*/
+auto TokenCache::hash_contents(const std::byte *data, size_t len) -> uint64_t {
+    uint64_t hash = 0xcbf29ce484222325;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= static_cast<uint64_t>(data[i]);
+        hash *= 0x100000001b3;
+    }
+
+    return hash;
+}
+
+/*
+    This method computes the path of the cache entry for the given hash. The
+   lexer version is part of the name so that entries from different versions
+   can live side by side.
+*/
+auto TokenCache::entry_path(uint64_t content_hash) const -> std::string {
+    char name[48];
+    snprintf(name, sizeof(name), "%016" PRIx64 "-%" PRIu32 ".tok", content_hash,
+             Lexer::VERSION);
+
+    return cache_dir + "/" + name;
+}
+
+/*
+    This method will look up the token stream of a source file in the cache. The
+   cache file is loaded through a memory buffer, which will map it if it is
+   large, and the returned view points directly into that buffer. If the entry
+   is missing or does not match the file, null is returned.
+*/
+auto TokenCache::load(Source::SourceFile *src_file)
+    -> std::unique_ptr<CachedTokenStream> {
+    auto content_size = src_file->buffer->get_size();
+    auto content_hash =
+        hash_contents(src_file->buffer->data(), content_size);
+
+    auto path = entry_path(content_hash);
+
+    std::unique_ptr<Utility::MemoryBuffer> buffer;
+    try {
+        buffer = Utility::MemoryBuffer::create_buffer_from_file(path.data());
+    } catch (std::runtime_error &) {
+        // A missing or unreadable entry is simply a cache miss.
+        return nullptr;
+    }
+
+    // Now, we must validate the header before trusting any of the contents.
+    auto size = buffer->get_size();
+    if (size < sizeof(TokenCacheHeader)) {
+        return nullptr;
+    }
+
+    auto *data = buffer->data();
+    auto *header = reinterpret_cast<const TokenCacheHeader *>(data);
+
+    if (memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+        header->format_version != FORMAT_VERSION ||
+        header->lexer_version != Lexer::VERSION ||
+        header->content_hash != content_hash ||
+        header->content_size != content_size) {
+        return nullptr;
+    }
+
+    // The counts must account for every byte after the header.
+    size_t count = header->token_count;
+    size_t num_fstrings = header->num_fstrings;
+    size_t num_segments = header->num_segments;
+    if (size != sizeof(TokenCacheHeader) + count * 2 * sizeof(uint32_t) +
+                    padded_kinds_size(count) +
+                    num_fstrings * 2 * sizeof(uint32_t) +
+                    num_segments * sizeof(FStringSegment)) {
+        return nullptr;
+    }
+
+    // The arrays follow the header directly.
+    TokenStreamView view;
+    view.size = count;
+    view.offsets =
+        reinterpret_cast<const uint32_t *>(data + sizeof(TokenCacheHeader));
+    view.lens = view.offsets + count;
+    view.kinds = reinterpret_cast<const uint8_t *>(view.lens + count);
+
+    auto &fstrings = view.fstrings;
+    fstrings.num_fstrings = num_fstrings;
+    fstrings.token_offsets = reinterpret_cast<const uint32_t *>(
+        view.kinds + padded_kinds_size(count));
+    fstrings.first_segments = fstrings.token_offsets + num_fstrings;
+    fstrings.num_segments = num_segments;
+    fstrings.segments = reinterpret_cast<const FStringSegment *>(
+        fstrings.first_segments + num_fstrings);
+
+    if (!is_valid_stream(view, src_file->buffer->str_size())) {
+        return nullptr;
+    }
+
+    return std::make_unique<CachedTokenStream>(std::move(buffer), view);
+}
+
+/*
+    This method will write the token stream of a source file into the cache. The
+   entry is written through an atomic file, so concurrent readers never
+   observe a partially written entry.
+*/
+auto TokenCache::store(Source::SourceFile *src_file,
+                       const TokenStream &tokens) -> bool {
+    std::error_code ec;
+    std::filesystem::create_directories(cache_dir, ec);
+    if (ec) {
+        return false;
+    }
+
+    auto content_size = src_file->buffer->get_size();
+
+    TokenCacheHeader header;
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.format_version = FORMAT_VERSION;
+    header.lexer_version = Lexer::VERSION;
+    header.token_count = static_cast<uint32_t>(tokens.size());
+    header.content_hash =
+        hash_contents(src_file->buffer->data(), content_size);
+    header.content_size = content_size;
+
+    auto view = tokens.view();
+    header.num_fstrings = static_cast<uint32_t>(view.fstrings.num_fstrings);
+    header.num_segments = static_cast<uint32_t>(view.fstrings.num_segments);
+
+    Utility::AtomicFile file{entry_path(header.content_hash)};
+    if (!file.get()) {
+        return false;
+    }
+
+    static constexpr uint8_t padding[4] = {};
+    auto padding_size = padded_kinds_size(view.size) - view.size;
+
+    auto &fstrings = view.fstrings;
+    bool ok =
+        file.write(&header, sizeof(header), 1) &&
+        file.write(view.offsets, sizeof(uint32_t), view.size) &&
+        file.write(view.lens, sizeof(uint32_t), view.size) &&
+        file.write(view.kinds, sizeof(uint8_t), view.size) &&
+        file.write(padding, 1, padding_size) &&
+        file.write(fstrings.token_offsets, sizeof(uint32_t),
+                   fstrings.num_fstrings) &&
+        file.write(fstrings.first_segments, sizeof(uint32_t),
+                   fstrings.num_fstrings) &&
+        file.write(fstrings.segments, sizeof(FStringSegment),
+                   fstrings.num_segments);
+
+    return file.commit(ok);
+}
+} // namespace tpy::Parse
@@ -0,0 +1,30 @@
+/*
+    This file implements the fully lexed stream of tokens for a source file.
+*/
+#include "tpy/parse/TokenStream.h"
+#include "tpy/parse/Lexer.h"
+
+namespace tpy::Parse {
+// Token kinds are stored as single bytes within a token stream.
+static_assert(static_cast<int>(TokenKind::ErrorToken) < 256,
+              "token kinds must fit within a byte.");
+
+auto TokenStream::lex_all(Lexer &lexer) -> TokenStream {
+    TokenStream stream;
+
+    // The index is only attached while the stream is being lexed, as the
+    // lexer must not refer to it once the stream has been moved out.
+    auto *prev_index = lexer.fstring_index;
+    lexer.attach_fstring_index(&stream.fstrings);
+
+    auto tok = Token::dummy();
+    do {
+        lexer.lex_next_tok(tok);
+        stream.push(tok);
+    } while (tok.kind != TokenKind::End);
+
+    lexer.attach_fstring_index(prev_index);
+
+    return stream;
+}
+} // namespace tpy::Parse
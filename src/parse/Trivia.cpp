@@ -0,0 +1,23 @@
+/*
+    This file implements the trivia side-table that the lexer can optionally
+   fill with comments and other non-token source regions.
+*/
+#include <algorithm>
+
+#include "tpy/parse/Trivia.h"
+
+namespace tpy::Parse {
+/*
+    This method will find all of the trivia that directly precede the given
+   token. Since the keys are sorted, we can use a binary search over them.
+*/
+auto TriviaTable::trivia_before(uint32_t tok_index) const
+    -> std::pair<const Trivia *, const Trivia *> {
+    auto [first, last] = std::equal_range(token_indices.begin(),
+                                          token_indices.end(), tok_index);
+
+    auto *base = entries.data();
+    return std::make_pair(base + (first - token_indices.begin()),
+                          base + (last - token_indices.begin()));
+}
+} // namespace tpy::Parse
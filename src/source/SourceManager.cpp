@@ -13,7 +13,7 @@ namespace tpy::Source {
    by the SourceManager. It will compute the starting offset for this source
    file and get the memory buffer as well as the line map.
 */
-auto SourceManager::open_py_src_file(char *path)
+auto SourceManager::open_py_src_file(const char *path)
     -> SourceFile * {
     // First, we need to get the source file as a Memory Buffer
     auto mem_buffer = Utility::MemoryBuffer::create_buffer_from_file(path);
@@ -0,0 +1,383 @@
+/*
+    This file implements the on-disk AST cache.
+*/
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "tpy/parse/Lexer.h"
+#include "tpy/parse/Parser.h"
+#include "tpy/parse/TokenCache.h"
+#include "tpy/tree/ASTCache.h"
+#include "tpy/tree/ASTExpr.h"
+#include "tpy/tree/ASTStmt.h"
+#include "tpy/utility/AtomicFile.h"
+
+namespace tpy::Tree {
+static constexpr char CACHE_MAGIC[4] = {'T', 'P', 'Y', 'A'};
+
+// The columns are written to the cache as they are laid out in memory.
+static_assert(sizeof(ASTNodeKind) == 1, "node kinds must be a single byte.");
+static_assert(sizeof(std::pair<uint32_t, uint32_t>) == 8 &&
+                  alignof(std::pair<uint32_t, uint32_t>) == 4,
+              "f-string segment ranges must have a stable layout.");
+static_assert(sizeof(ASTCacheHeader) % 8 == 0,
+              "the columns must be aligned after the header.");
+
+// This function returns the size of a cache file with the given counts.
+static auto entry_size(const ASTCacheHeader &header) -> size_t {
+    return sizeof(ASTCacheHeader) +
+           (static_cast<size_t>(header.num_nodes) * 4 + header.num_children +
+            header.num_fstrings * 2 + header.num_constant_words +
+            header.num_strings + 1) *
+               sizeof(uint32_t) +
+           header.num_nodes * sizeof(ASTNodeKind) + header.string_data_size;
+}
+
+// This is the number of fields of every kind, each of which takes up a single
+// slot within the shared array of children.
+static constexpr uint8_t NUM_FIELDS[] = {
+#define AST_CHILD(member) +1
+#define AST_CHILD_LIST(member) +1
+#define AST_CHILD_PAIRS(member) +1
+#define F(x, children) 0 children,
+    AST_NODE_LIST(F)
+#undef F
+#undef AST_CHILD_PAIRS
+#undef AST_CHILD_LIST
+#undef AST_CHILD
+};
+
+/*
+    This function checks every index and offset of a tree that has been read
+   from a cache file, so that a corrupted entry is treated as a miss instead
+   of being read out of bounds. The children of a node must come after it, as
+   they do in pre-order, since the tree is rebuilt from the last node to the
+   first. The spans must lie within the buffer of the source, which has room
+   for the end of the module past the contents, and the payloads that refer to
+   another column, or that hold an operator or a kind, must be in range.
+*/
+static auto is_valid_tree(const FlatASTView &tree, size_t src_size,
+                          const uint32_t *string_offsets, size_t num_strings,
+                          size_t string_data_size) -> bool {
+    using NodeIndex = FlatASTView::NodeIndex;
+
+    if (string_offsets[0] != 0 ||
+        string_offsets[num_strings] != string_data_size) {
+        return false;
+    }
+
+    for (size_t i = 0; i < num_strings; i++) {
+        if (string_offsets[i] > string_offsets[i + 1]) {
+            return false;
+        }
+    }
+
+    auto is_valid_child = [&](NodeIndex parent, NodeIndex child) {
+        return child == FlatASTView::NO_NODE ||
+               (child > parent && child < tree.num_nodes);
+    };
+
+    auto is_valid_list = [&](NodeIndex parent, uint32_t pos, bool pairs) {
+        if (pos >= tree.num_children ||
+            tree.children[pos] > tree.num_children - pos - 1 ||
+            (pairs && tree.children[pos] % 2 != 0)) {
+            return false;
+        }
+
+        for (uint32_t k = 1; k <= tree.children[pos]; k++) {
+            if (!is_valid_child(parent, tree.children[pos + k])) {
+                return false;
+            }
+        }
+
+        return true;
+    };
+
+    for (NodeIndex i = 0; i < tree.num_nodes; i++) {
+        auto kind = tree.kinds[i];
+        if (static_cast<size_t>(kind) >= NUM_AST_NODE_KINDS ||
+            static_cast<uint64_t>(tree.positions[i]) + tree.lens[i] >
+                src_size ||
+            tree.fields[i] > tree.num_children ||
+            NUM_FIELDS[static_cast<size_t>(kind)] >
+                tree.num_children - tree.fields[i]) {
+            return false;
+        }
+
+        auto payload = tree.payloads[i];
+
+        switch (kind) {
+        case ASTNodeKind::FStringLiteral: {
+            if (payload >= tree.num_fstrings) {
+                return false;
+            }
+            break;
+        }
+        case ASTNodeKind::ConstantExpr: {
+            if (payload > tree.num_constant_words ||
+                tree.num_constant_words - payload < 2) {
+                return false;
+            }
+
+            auto *words = tree.constant_words(i);
+            uint64_t length = words[1], num_words;
+
+            switch (static_cast<ConstantKind>(words[0] & 0xFF)) {
+            case ConstantKind::Int: {
+                num_words = length;
+                break;
+            }
+            case ConstantKind::Float: {
+                num_words = 2;
+                break;
+            }
+            case ConstantKind::String:
+            case ConstantKind::Bytes: {
+                num_words = (length + 3) / 4;
+                break;
+            }
+            default: {
+                return false;
+            }
+            }
+
+            if (num_words > tree.num_constant_words - payload - 2) {
+                return false;
+            }
+            break;
+        }
+        case ASTNodeKind::NameExpr: {
+            if (payload >= num_strings) {
+                return false;
+            }
+            break;
+        }
+        case ASTNodeKind::StarredExpr:
+        case ASTNodeKind::BinaryOpExpr:
+        case ASTNodeKind::UnaryOpExpr:
+        case ASTNodeKind::ComprehensionExpr:
+        case ASTNodeKind::AugAssignStmt: {
+            if (payload >= Parse::NUM_TOKEN_KINDS) {
+                return false;
+            }
+            break;
+        }
+        case ASTNodeKind::Param: {
+            if (payload > static_cast<uint32_t>(ParamKind::VarKeyword)) {
+                return false;
+            }
+            break;
+        }
+        default: {
+            break;
+        }
+        }
+
+        // The fields of every kind come from the list of kinds.
+        bool valid = true;
+        auto field = tree.fields[i];
+
+        switch (kind) {
+#define AST_CHILD(member)                                                      \
+    valid = valid && is_valid_child(i, tree.children[field++]);
+#define AST_CHILD_LIST(member)                                                 \
+    valid = valid && is_valid_list(i, tree.children[field++], false);
+#define AST_CHILD_PAIRS(member)                                                \
+    valid = valid && is_valid_list(i, tree.children[field++], true);
+#define F(x, children)                                                         \
+    case ASTNodeKind::x: {                                                     \
+        children break;                                                        \
+    }
+            AST_NODE_LIST(F)
+#undef F
+#undef AST_CHILD_PAIRS
+#undef AST_CHILD_LIST
+#undef AST_CHILD
+        }
+
+        if (!valid) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+    This method computes the path of the cache entry for the given hash. The
+   versions of the lexer and the parser are part of the name so that entries
+   from different versions can live side by side.
+*/
+auto ASTCache::entry_path(uint64_t content_hash) const -> std::string {
+    char name[64];
+    snprintf(name, sizeof(name), "%016" PRIx64 "-%" PRIu32 "-%" PRIu32 ".ast",
+             content_hash, Parse::Lexer::VERSION, Parse::Parser::VERSION);
+
+    return cache_dir + "/" + name;
+}
+
+/*
+    This method will look up the tree of a source file in the cache. The cache
+   file is loaded through a memory buffer, which will map it if it is large,
+   and the returned view points directly into that buffer. If the entry is
+   missing or does not match the file, null is returned.
+*/
+auto ASTCache::load(Source::SourceFile *src_file)
+    -> std::unique_ptr<CachedAST> {
+    auto content_size = src_file->buffer->get_size();
+    auto content_hash = Parse::TokenCache::hash_contents(
+        src_file->buffer->data(), content_size);
+
+    auto path = entry_path(content_hash);
+
+    std::unique_ptr<Utility::MemoryBuffer> buffer;
+    try {
+        buffer = Utility::MemoryBuffer::create_buffer_from_file(path.data());
+    } catch (std::runtime_error &) {
+        // A missing or unreadable entry is simply a cache miss.
+        return nullptr;
+    }
+
+    // Now, we must validate the header before trusting any of the contents.
+    auto size = buffer->get_size();
+    if (size < sizeof(ASTCacheHeader)) {
+        return nullptr;
+    }
+
+    auto *data = buffer->data();
+    auto *header = reinterpret_cast<const ASTCacheHeader *>(data);
+
+    if (memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+        header->format_version != FORMAT_VERSION ||
+        header->lexer_version != Parse::Lexer::VERSION ||
+        header->parser_version != Parse::Parser::VERSION ||
+        header->content_hash != content_hash ||
+        header->content_size != content_size ||
+        size != entry_size(*header)) {
+        return nullptr;
+    }
+
+    size_t num_nodes = header->num_nodes;
+
+    // The arrays follow the header directly.
+    FlatASTView tree;
+    tree.num_nodes = num_nodes;
+    tree.num_children = header->num_children;
+    tree.num_fstrings = header->num_fstrings;
+    tree.num_constant_words = header->num_constant_words;
+    tree.absolute_offset = src_file->offset;
+    tree.positions =
+        reinterpret_cast<const uint32_t *>(data + sizeof(ASTCacheHeader));
+    tree.lens = tree.positions + num_nodes;
+    tree.payloads = tree.lens + num_nodes;
+    tree.fields = tree.payloads + num_nodes;
+    tree.children = tree.fields + num_nodes;
+    tree.fstring_segments =
+        reinterpret_cast<const std::pair<uint32_t, uint32_t> *>(
+            tree.children + header->num_children);
+
+    tree.constants = reinterpret_cast<const uint32_t *>(
+        tree.fstring_segments + header->num_fstrings);
+
+    auto *string_offsets = tree.constants + header->num_constant_words;
+    tree.kinds = reinterpret_cast<const ASTNodeKind *>(
+        string_offsets + header->num_strings + 1);
+    auto *string_data = reinterpret_cast<const char *>(tree.kinds + num_nodes);
+
+    if (!is_valid_tree(tree, src_file->buffer->str_size(), string_offsets,
+                       header->num_strings, header->string_data_size)) {
+        return nullptr;
+    }
+
+    return std::make_unique<CachedAST>(std::move(buffer), tree, string_offsets,
+                                       string_data, header->num_strings);
+}
+
+/*
+    This method will write the tree of a source file into the cache. The names
+   are interned on the way, and the payload of each name is replaced by the
+   index of its text. The entry is written through an atomic file, so
+   concurrent readers never observe a partially written entry.
+*/
+auto ASTCache::store(Source::SourceFile *src_file, const FlatAST &tree)
+    -> bool {
+    std::error_code ec;
+    std::filesystem::create_directories(cache_dir, ec);
+    if (ec) {
+        return false;
+    }
+
+    auto view = tree.view();
+    auto content_size = src_file->buffer->get_size();
+
+    // The names are the only nodes whose payload changes.
+    std::vector<uint32_t> payloads(view.payloads,
+                                   view.payloads + view.num_nodes);
+    std::unordered_map<std::string_view, uint32_t> string_ids;
+    std::vector<uint32_t> string_offsets{0};
+    std::string string_data;
+
+    for (FlatAST::NodeIndex i = 0; i < view.num_nodes; i++) {
+        if (view.kind(i) != ASTNodeKind::NameExpr) {
+            continue;
+        }
+
+        auto loc = view.loc(i);
+        std::string_view text(src_file->start() + loc.local_pos, loc.len);
+
+        auto [it, inserted] = string_ids.try_emplace(
+            text, static_cast<uint32_t>(string_offsets.size() - 1));
+        if (inserted) {
+            string_data.append(text);
+            string_offsets.push_back(static_cast<uint32_t>(string_data.size()));
+        }
+
+        payloads[i] = it->second;
+    }
+
+    ASTCacheHeader header;
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.format_version = FORMAT_VERSION;
+    header.lexer_version = Parse::Lexer::VERSION;
+    header.parser_version = Parse::Parser::VERSION;
+    header.content_hash = Parse::TokenCache::hash_contents(
+        src_file->buffer->data(), content_size);
+    header.content_size = content_size;
+    header.num_nodes = static_cast<uint32_t>(view.num_nodes);
+    header.num_children = static_cast<uint32_t>(view.num_children);
+    header.num_fstrings = static_cast<uint32_t>(view.num_fstrings);
+    header.num_strings = static_cast<uint32_t>(string_offsets.size() - 1);
+    header.string_data_size = static_cast<uint32_t>(string_data.size());
+    header.num_constant_words =
+        static_cast<uint32_t>(view.num_constant_words);
+
+    Utility::AtomicFile file{entry_path(header.content_hash)};
+    if (!file.get()) {
+        return false;
+    }
+
+    auto n = view.num_nodes;
+    bool ok = file.write(&header, sizeof(header), 1) &&
+              file.write(view.positions, sizeof(uint32_t), n) &&
+              file.write(view.lens, sizeof(uint32_t), n) &&
+              file.write(payloads.data(), sizeof(uint32_t), n) &&
+              file.write(view.fields, sizeof(uint32_t), n) &&
+              file.write(view.children, sizeof(uint32_t), view.num_children) &&
+              file.write(view.fstring_segments,
+                         sizeof(view.fstring_segments[0]), view.num_fstrings) &&
+              file.write(view.constants, sizeof(uint32_t),
+                         view.num_constant_words) &&
+              file.write(string_offsets.data(), sizeof(uint32_t),
+                         string_offsets.size()) &&
+              file.write(view.kinds, sizeof(ASTNodeKind), n) &&
+              file.write(string_data.data(), 1, string_data.size());
+
+    return file.commit(ok);
+}
+} // namespace tpy::Tree
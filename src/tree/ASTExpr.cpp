@@ -4,6 +4,13 @@
 
 #include "tpy/tree/ASTExpr.h"
 #include "tpy/parse/Token.h"
+#include "tpy/utility/BigInt.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
 
 namespace tpy::Tree {
 
@@ -125,7 +132,7 @@ auto ASTStringLiteralNode::pretty_print(FILE *result_file, int level) -> void {
     fputs("}\n", result_file);
 }
 
-auto ASTBoolLiteralNode::pretty_print(FILE *result_file, int level) -> void {
+auto ASTBytesLiteralNode::pretty_print(FILE *result_file, int level) -> void {
     // Indentation space based on the level.
     // 4 spaces per level.
     for (int i = 0; i < level; i++) {
@@ -139,24 +146,19 @@ auto ASTBoolLiteralNode::pretty_print(FILE *result_file, int level) -> void {
     }
 
     // Node kind.
-    fputs("kind: ASTBoolLiteralNode\n", result_file);
-
-    for (int i = 0; i < level + 1; i++) {
-        putc(' ', result_file);
-    }
-    fprintf(result_file, "val: %s\n", val ? "True" : "False");
+    fputs("kind: ASTBytesLiteralNode\n", result_file);
 
     // Now, we need to indent to level + 1.
     for (int i = 0; i < level + 1; i++) {
         putc(' ', result_file);
     }
-    fprintf(result_file, "start: %llu\n", loc.local_pos);
+    fprintf(result_file, "start: %zu\n", loc.local_pos);
 
     // Now, we need to indent to level + 1.
     for (int i = 0; i < level + 1; i++) {
         putc(' ', result_file);
     }
-    fprintf(result_file, "end: %llu\n", loc.local_end());
+    fprintf(result_file, "end: %zu\n", loc.local_end());
     // Indentation space based on the level.
     // 4 spaces per level.
     for (int i = 0; i < level; i++) {
@@ -166,7 +168,7 @@ auto ASTBoolLiteralNode::pretty_print(FILE *result_file, int level) -> void {
     fputs("}\n", result_file);
 }
 
-auto ASTParenExprNode::pretty_print(FILE *result_file, int level) -> void {
+auto ASTFStringLiteralNode::pretty_print(FILE *result_file, int level) -> void {
     // Indentation space based on the level.
     // 4 spaces per level.
     for (int i = 0; i < level; i++) {
@@ -180,18 +182,25 @@ auto ASTParenExprNode::pretty_print(FILE *result_file, int level) -> void {
     }
 
     // Node kind.
-    fputs("kind: ASTParenExprNode\n", result_file);
-
-    // Now, print the inner expression.
+    fputs("kind: ASTFStringLiteralNode\n", result_file);
 
     // Now, we need to indent to level + 1.
     for (int i = 0; i < level + 1; i++) {
         putc(' ', result_file);
     }
-    fputs("expr:", result_file);
+    fprintf(result_file, "start: %zu\n", loc.local_pos);
 
-    inner_expr->pretty_print(result_file, level + 1);
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+    fprintf(result_file, "end: %zu\n", loc.local_end());
 
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+    fprintf(result_file, "segments: %u\n", segment_end - segment_begin);
     // Indentation space based on the level.
     // 4 spaces per level.
     for (int i = 0; i < level; i++) {
@@ -201,7 +210,7 @@ auto ASTParenExprNode::pretty_print(FILE *result_file, int level) -> void {
     fputs("}\n", result_file);
 }
 
-auto ASTListExprNode::pretty_print(FILE *result_file, int level) -> void {
+auto ASTBoolLiteralNode::pretty_print(FILE *result_file, int level) -> void {
     // Indentation space based on the level.
     // 4 spaces per level.
     for (int i = 0; i < level; i++) {
@@ -215,31 +224,34 @@ auto ASTListExprNode::pretty_print(FILE *result_file, int level) -> void {
     }
 
     // Node kind.
-    fputs("kind: ASTListExprNode\n", result_file);
+    fputs("kind: ASTBoolLiteralNode\n", result_file);
 
-    // Now, we need to indent to level + 1.
     for (int i = 0; i < level + 1; i++) {
         putc(' ', result_file);
     }
-    fputs("[\n", result_file);
+    fprintf(result_file, "val: %s\n", val ? "True" : "False");
 
-    for (auto &x : list) {
-        x->pretty_print(result_file, level + 2);
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
     }
+    fprintf(result_file, "start: %llu\n", loc.local_pos);
 
     // Now, we need to indent to level + 1.
     for (int i = 0; i < level + 1; i++) {
         putc(' ', result_file);
     }
-    fputs("]\n", result_file);
-
+    fprintf(result_file, "end: %llu\n", loc.local_end());
+    // Indentation space based on the level.
+    // 4 spaces per level.
     for (int i = 0; i < level; i++) {
         putc(' ', result_file);
     }
+
     fputs("}\n", result_file);
 }
 
-auto ASTSetExprNode::pretty_print(FILE *result_file, int level) -> void {
+auto ASTNoneLiteralNode::pretty_print(FILE *result_file, int level) -> void {
     // Indentation space based on the level.
     // 4 spaces per level.
     for (int i = 0; i < level; i++) {
@@ -253,31 +265,214 @@ auto ASTSetExprNode::pretty_print(FILE *result_file, int level) -> void {
     }
 
     // Node kind.
-    fputs("kind: ASTSetExprNode\n", result_file);
+    fputs("kind: ASTNoneLiteralNode\n", result_file);
 
     // Now, we need to indent to level + 1.
     for (int i = 0; i < level + 1; i++) {
         putc(' ', result_file);
     }
-    fputs("[\n", result_file);
+    fprintf(result_file, "start: %zu\n", loc.local_pos);
 
-    for (auto x : contents) {
-        x->pretty_print(result_file, level + 2);
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+    fprintf(result_file, "end: %zu\n", loc.local_end());
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+
+    fputs("}\n", result_file);
+}
+
+auto ASTEllipsisLiteralNode::pretty_print(FILE *result_file,
+                                          int level) -> void {
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
     }
+    fputs("{\n", result_file);
 
     // Now, we need to indent to level + 1.
     for (int i = 0; i < level + 1; i++) {
         putc(' ', result_file);
     }
-    fputs("]\n", result_file);
 
+    // Node kind.
+    fputs("kind: ASTEllipsisLiteralNode\n", result_file);
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+    fprintf(result_file, "start: %zu\n", loc.local_pos);
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+    fprintf(result_file, "end: %zu\n", loc.local_end());
+    // Indentation space based on the level.
+    // 4 spaces per level.
     for (int i = 0; i < level; i++) {
         putc(' ', result_file);
     }
+
     fputs("}\n", result_file);
 }
 
-auto ASTDictExprNode::pretty_print(FILE *result_file, int level) -> void {
+auto constant_kind_name(ConstantKind kind) -> const char * {
+    switch (kind) {
+    case ConstantKind::Int:
+        return "int";
+    case ConstantKind::Float:
+        return "float";
+    case ConstantKind::String:
+        return "str";
+    case ConstantKind::Bytes:
+        return "bytes";
+    }
+
+    return "";
+}
+
+/*
+    This function writes a float the way that Python's 'repr' does. The digits
+   are the fewest that read back as the same value, and they are written in
+   positional notation if the exponent is within [-4, 16), and in scientific
+   notation with at least two digits of exponent otherwise.
+*/
+static auto float_repr(double value) -> std::string {
+    if (std::isnan(value)) {
+        return "nan";
+    }
+    if (std::isinf(value)) {
+        return value > 0 ? "inf" : "-inf";
+    }
+
+    char buffer[32];
+    for (int precision = 1; precision <= 17; precision++) {
+        snprintf(buffer, sizeof(buffer), "%.*e", precision - 1, value);
+        if (strtod(buffer, nullptr) == value) {
+            break;
+        }
+    }
+
+    // The buffer now holds an optional sign, the digits with a point after the
+    // first one, and the exponent.
+    std::string result;
+    const char *pos = buffer;
+    if (*pos == '-') {
+        result += '-';
+        ++pos;
+    }
+
+    std::string digits;
+    for (; *pos != 'e'; ++pos) {
+        if (*pos != '.') {
+            digits += *pos;
+        }
+    }
+    auto exponent = atoi(pos + 1);
+
+    while (digits.size() > 1 && digits.back() == '0') {
+        digits.pop_back();
+    }
+
+    if (exponent >= -4 && exponent < 16) {
+        if (exponent < 0) {
+            result += "0.";
+            result.append(-exponent - 1, '0');
+            result += digits;
+        } else if (static_cast<size_t>(exponent) + 1 >= digits.size()) {
+            result += digits;
+            result.append(exponent + 1 - digits.size(), '0');
+            result += ".0";
+        } else {
+            result += digits.substr(0, exponent + 1);
+            result += '.';
+            result += digits.substr(exponent + 1);
+        }
+        return result;
+    }
+
+    result += digits[0];
+    if (digits.size() > 1) {
+        result += '.';
+        result += digits.substr(1);
+    }
+
+    snprintf(buffer, sizeof(buffer), "e%c%02d", exponent < 0 ? '-' : '+',
+             std::abs(exponent));
+    result += buffer;
+    return result;
+}
+
+/*
+    This function writes a string or bytes the way that Python's 'repr' does.
+   Single quotes are used unless the text holds a single quote and no double
+   quote. Control characters are escaped, and so are bytes outside of ASCII.
+   The text of a string is UTF-8, and the characters outside of ASCII are
+   kept as they are.
+*/
+static auto text_repr(const Utility::ArenaArray<char> &text, bool is_bytes)
+    -> std::string {
+    auto has = [&](char c) {
+        return std::find(text.begin(), text.end(), c) != text.end();
+    };
+    char quote = has('\'') && !has('"') ? '"' : '\'';
+
+    std::string result = is_bytes ? "b" : "";
+    result += quote;
+
+    for (auto c : text) {
+        auto byte = static_cast<unsigned char>(c);
+        if (c == quote || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if (c == '\t') {
+            result += "\\t";
+        } else if (c == '\n') {
+            result += "\\n";
+        } else if (c == '\r') {
+            result += "\\r";
+        } else if (byte < 0x20 || byte == 0x7F || (is_bytes && byte >= 0x80)) {
+            char escape[5];
+            snprintf(escape, sizeof(escape), "\\x%02x", byte);
+            result += escape;
+        } else {
+            result += c;
+        }
+    }
+
+    result += quote;
+    return result;
+}
+
+auto ASTConstantExprNode::repr() const -> std::string {
+    switch (constant_kind) {
+    case ConstantKind::Int: {
+        std::vector<uint32_t> magnitude(digits.begin(), digits.end());
+        return Utility::BigInt{std::move(magnitude), negative}.to_decimal();
+    }
+    case ConstantKind::Float: {
+        return float_repr(float_value);
+    }
+    case ConstantKind::String: {
+        return text_repr(text, false);
+    }
+    case ConstantKind::Bytes: {
+        return text_repr(text, true);
+    }
+    }
+
+    return "";
+}
+
+auto ASTConstantExprNode::pretty_print(FILE *result_file, int level) -> void {
     // Indentation space based on the level.
     // 4 spaces per level.
     for (int i = 0; i < level; i++) {
@@ -291,32 +486,39 @@ auto ASTDictExprNode::pretty_print(FILE *result_file, int level) -> void {
     }
 
     // Node kind.
-    fputs("kind: ASTDictExprNode\n", result_file);
+    fputs("kind: ASTConstantExprNode\n", result_file);
 
-    // Now, we need to indent to level + 1.
     for (int i = 0; i < level + 1; i++) {
         putc(' ', result_file);
     }
-    fputs("[\n", result_file);
+    fprintf(result_file, "type: %s\n", constant_kind_name(constant_kind));
 
-    for (auto &x : contents) {
-        x.first->pretty_print(result_file, level + 2);
-        x.second->pretty_print(result_file, level + 2);
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
     }
+    fprintf(result_file, "value: %s\n", repr().c_str());
 
     // Now, we need to indent to level + 1.
     for (int i = 0; i < level + 1; i++) {
         putc(' ', result_file);
     }
-    fputs("]\n", result_file);
+    fprintf(result_file, "start: %zu\n", loc.local_pos);
 
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+    fprintf(result_file, "end: %zu\n", loc.local_end());
+    // Indentation space based on the level.
+    // 4 spaces per level.
     for (int i = 0; i < level; i++) {
         putc(' ', result_file);
     }
+
     fputs("}\n", result_file);
 }
 
-auto ASTNameExprNode::pretty_print(FILE *result_file, int level) -> void {
+auto ASTErrorNode::pretty_print(FILE *result_file, int level) -> void {
     // Indentation space based on the level.
     // 4 spaces per level.
     for (int i = 0; i < level; i++) {
@@ -330,19 +532,19 @@ auto ASTNameExprNode::pretty_print(FILE *result_file, int level) -> void {
     }
 
     // Node kind.
-    fputs("kind: ASTNameExprNode\n", result_file);
+    fputs("kind: ASTErrorNode\n", result_file);
 
     // Now, we need to indent to level + 1.
     for (int i = 0; i < level + 1; i++) {
         putc(' ', result_file);
     }
-    fprintf(result_file, "start: %llu\n", loc.local_pos);
+    fprintf(result_file, "start: %zu\n", loc.local_pos);
 
     // Now, we need to indent to level + 1.
     for (int i = 0; i < level + 1; i++) {
         putc(' ', result_file);
     }
-    fprintf(result_file, "end: %llu\n", loc.local_end());
+    fprintf(result_file, "end: %zu\n", loc.local_end());
     // Indentation space based on the level.
     // 4 spaces per level.
     for (int i = 0; i < level; i++) {
@@ -352,7 +554,7 @@ auto ASTNameExprNode::pretty_print(FILE *result_file, int level) -> void {
     fputs("}\n", result_file);
 }
 
-auto ASTAttrRefExprNode::pretty_print(FILE *result_file, int level) -> void {
+auto ASTParenExprNode::pretty_print(FILE *result_file, int level) -> void {
     // Indentation space based on the level.
     // 4 spaces per level.
     for (int i = 0; i < level; i++) {
@@ -366,9 +568,17 @@ auto ASTAttrRefExprNode::pretty_print(FILE *result_file, int level) -> void {
     }
 
     // Node kind.
-    fputs("kind: ASTAttrRefExprNode\n", result_file);
-    lhs->pretty_print(result_file, level + 2);
-    rhs->pretty_print(result_file, level + 2);
+    fputs("kind: ASTParenExprNode\n", result_file);
+
+    // Now, print the inner expression.
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+    fputs("expr:", result_file);
+
+    inner_expr->pretty_print(result_file, level + 1);
 
     // Indentation space based on the level.
     // 4 spaces per level.
@@ -379,7 +589,7 @@ auto ASTAttrRefExprNode::pretty_print(FILE *result_file, int level) -> void {
     fputs("}\n", result_file);
 }
 
-auto ASTCallExprNode::pretty_print(FILE *result_file, int level) -> void {
+auto ASTListExprNode::pretty_print(FILE *result_file, int level) -> void {
     // Indentation space based on the level.
     // 4 spaces per level.
     for (int i = 0; i < level; i++) {
@@ -393,9 +603,7 @@ auto ASTCallExprNode::pretty_print(FILE *result_file, int level) -> void {
     }
 
     // Node kind.
-    fputs("kind: ASTCallExprNode\n", result_file);
-
-    callee->pretty_print(result_file, level + 2);
+    fputs("kind: ASTListExprNode\n", result_file);
 
     // Now, we need to indent to level + 1.
     for (int i = 0; i < level + 1; i++) {
@@ -403,7 +611,7 @@ auto ASTCallExprNode::pretty_print(FILE *result_file, int level) -> void {
     }
     fputs("[\n", result_file);
 
-    for (auto x : args) {
+    for (auto &x : list) {
         x->pretty_print(result_file, level + 2);
     }
 
@@ -413,16 +621,13 @@ auto ASTCallExprNode::pretty_print(FILE *result_file, int level) -> void {
     }
     fputs("]\n", result_file);
 
-    // Indentation space based on the level.
-    // 4 spaces per level.
     for (int i = 0; i < level; i++) {
         putc(' ', result_file);
     }
-
     fputs("}\n", result_file);
 }
 
-auto ASTIndexSliceExprNode::pretty_print(FILE *result_file, int level) -> void {
+auto ASTSetExprNode::pretty_print(FILE *result_file, int level) -> void {
     // Indentation space based on the level.
     // 4 spaces per level.
     for (int i = 0; i < level; i++) {
@@ -436,22 +641,31 @@ auto ASTIndexSliceExprNode::pretty_print(FILE *result_file, int level) -> void {
     }
 
     // Node kind.
-    fputs("kind: ASTIndexSliceExprNode\n", result_file);
+    fputs("kind: ASTSetExprNode\n", result_file);
 
-    slicee->pretty_print(result_file, level + 2);
-    index_expr->pretty_print(result_file, level + 2);
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+    fputs("[\n", result_file);
 
-    // Indentation space based on the level.
-    // 4 spaces per level.
-    for (int i = 0; i < level; i++) {
+    for (auto x : contents) {
+        x->pretty_print(result_file, level + 2);
+    }
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
         putc(' ', result_file);
     }
+    fputs("]\n", result_file);
 
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
     fputs("}\n", result_file);
 }
 
-auto ASTProperSliceExprNode::pretty_print(FILE *result_file,
-                                          int level) -> void {
+auto ASTDictExprNode::pretty_print(FILE *result_file, int level) -> void {
     // Indentation space based on the level.
     // 4 spaces per level.
     for (int i = 0; i < level; i++) {
@@ -465,26 +679,41 @@ auto ASTProperSliceExprNode::pretty_print(FILE *result_file,
     }
 
     // Node kind.
-    fputs("kind: ASTProperSliceExprNode\n", result_file);
+    fputs("kind: ASTDictExprNode\n", result_file);
 
-    slicee->pretty_print(result_file, level + 2);
-    if (lower_bound) {
-        lower_bound->pretty_print(result_file, level + 2);
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
     }
-    if (upper_bound) {
-        upper_bound->pretty_print(result_file, level + 2);
+    fputs("[\n", result_file);
+
+    for (auto &x : contents) {
+        // The key is missing for an unpacked entry such as '**d'.
+        if (x.first) {
+            x.first->pretty_print(result_file, level + 2);
+        } else {
+            // Now, we need to indent to level + 2.
+            for (int i = 0; i < level + 2; i++) {
+                putc(' ', result_file);
+            }
+            fputs("**\n", result_file);
+        }
+        x.second->pretty_print(result_file, level + 2);
     }
 
-    // Indentation space based on the level.
-    // 4 spaces per level.
-    for (int i = 0; i < level; i++) {
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
         putc(' ', result_file);
     }
+    fputs("]\n", result_file);
 
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
     fputs("}\n", result_file);
 }
 
-auto ASTBinaryOpExprNode::pretty_print(FILE *result_file, int level) -> void {
+auto ASTTupleExprNode::pretty_print(FILE *result_file, int level) -> void {
     // Indentation space based on the level.
     // 4 spaces per level.
     for (int i = 0; i < level; i++) {
@@ -498,30 +727,31 @@ auto ASTBinaryOpExprNode::pretty_print(FILE *result_file, int level) -> void {
     }
 
     // Node kind.
-    fputs("kind: ASTBinaryOpExprNode\n", result_file);
+    fputs("kind: ASTTupleExprNode\n", result_file);
 
-    // Now, we need to indent to level + 2.
-    for (int i = 0; i < level + 2; i++) {
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
         putc(' ', result_file);
     }
+    fputs("[\n", result_file);
 
-    fputs("op: ", result_file);
-    fputs(Parse::token_names[static_cast<int>(op)], result_file);
-    fputc('\n', result_file);
+    for (auto x : elements) {
+        x->pretty_print(result_file, level + 2);
+    }
 
-    lhs->pretty_print(result_file, level + 2);
-    rhs->pretty_print(result_file, level + 2);
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+    fputs("]\n", result_file);
 
-    // Indentation space based on the level.
-    // 4 spaces per level.
     for (int i = 0; i < level; i++) {
         putc(' ', result_file);
     }
-
     fputs("}\n", result_file);
 }
 
-auto ASTUnaryOpExprNode::pretty_print(FILE *result_file, int level) -> void {
+auto ASTNameExprNode::pretty_print(FILE *result_file, int level) -> void {
     // Indentation space based on the level.
     // 4 spaces per level.
     for (int i = 0; i < level; i++) {
@@ -535,19 +765,19 @@ auto ASTUnaryOpExprNode::pretty_print(FILE *result_file, int level) -> void {
     }
 
     // Node kind.
-    fputs("kind: ASTUnaryOpExprNode\n", result_file);
+    fputs("kind: ASTNameExprNode\n", result_file);
 
-    // Now, we need to indent to level + 2.
-    for (int i = 0; i < level + 2; i++) {
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
         putc(' ', result_file);
     }
+    fprintf(result_file, "start: %llu\n", loc.local_pos);
 
-    fputs("op: ", result_file);
-    fputs(Parse::token_names[static_cast<int>(op)], result_file);
-    fputc('\n', result_file);
-
-    expr->pretty_print(result_file, level + 2);
-
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+    fprintf(result_file, "end: %llu\n", loc.local_end());
     // Indentation space based on the level.
     // 4 spaces per level.
     for (int i = 0; i < level; i++) {
@@ -557,7 +787,7 @@ auto ASTUnaryOpExprNode::pretty_print(FILE *result_file, int level) -> void {
     fputs("}\n", result_file);
 }
 
-auto ASTTernaryOpExprNode::pretty_print(FILE *result_file, int level) -> void {
+auto ASTAttrRefExprNode::pretty_print(FILE *result_file, int level) -> void {
     // Indentation space based on the level.
     // 4 spaces per level.
     for (int i = 0; i < level; i++) {
@@ -571,11 +801,535 @@ auto ASTTernaryOpExprNode::pretty_print(FILE *result_file, int level) -> void {
     }
 
     // Node kind.
-    fputs("kind: ASTTernaryOpExprNode\n", result_file);
+    fputs("kind: ASTAttrRefExprNode\n", result_file);
+    lhs->pretty_print(result_file, level + 2);
+    rhs->pretty_print(result_file, level + 2);
 
-    condition->pretty_print(result_file, level + 2);
-    true_case->pretty_print(result_file, level + 2);
-    false_case->pretty_print(result_file, level + 2);
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+
+    fputs("}\n", result_file);
+}
+
+auto ASTKeywordArgNode::pretty_print(FILE *result_file, int level) -> void {
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+    fputs("{\n", result_file);
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+
+    // Node kind.
+    fputs("kind: ASTKeywordArgNode\n", result_file);
+
+    name->pretty_print(result_file, level + 2);
+    value->pretty_print(result_file, level + 2);
+
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+
+    fputs("}\n", result_file);
+}
+
+auto ASTStarredExprNode::pretty_print(FILE *result_file, int level) -> void {
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+    fputs("{\n", result_file);
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+
+    // Node kind.
+    fputs("kind: ASTStarredExprNode\n", result_file);
+
+    // Now, we need to indent to level + 2.
+    for (int i = 0; i < level + 2; i++) {
+        putc(' ', result_file);
+    }
+
+    fputs("op: ", result_file);
+    fputs(Parse::token_names[static_cast<int>(op)], result_file);
+    fputc('\n', result_file);
+
+    expr->pretty_print(result_file, level + 2);
+
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+
+    fputs("}\n", result_file);
+}
+
+auto ASTCallExprNode::pretty_print(FILE *result_file, int level) -> void {
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+    fputs("{\n", result_file);
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+
+    // Node kind.
+    fputs("kind: ASTCallExprNode\n", result_file);
+
+    callee->pretty_print(result_file, level + 2);
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+    fputs("[\n", result_file);
+
+    for (auto x : args) {
+        x->pretty_print(result_file, level + 2);
+    }
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+    fputs("]\n", result_file);
+
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+
+    fputs("}\n", result_file);
+}
+
+auto ASTIndexSliceExprNode::pretty_print(FILE *result_file, int level) -> void {
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+    fputs("{\n", result_file);
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+
+    // Node kind.
+    fputs("kind: ASTIndexSliceExprNode\n", result_file);
+
+    slicee->pretty_print(result_file, level + 2);
+    index_expr->pretty_print(result_file, level + 2);
+
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+
+    fputs("}\n", result_file);
+}
+
+auto ASTProperSliceExprNode::pretty_print(FILE *result_file,
+                                          int level) -> void {
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+    fputs("{\n", result_file);
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+
+    // Node kind.
+    fputs("kind: ASTProperSliceExprNode\n", result_file);
+
+    slicee->pretty_print(result_file, level + 2);
+    if (lower_bound) {
+        lower_bound->pretty_print(result_file, level + 2);
+    }
+    if (upper_bound) {
+        upper_bound->pretty_print(result_file, level + 2);
+    }
+    if (step) {
+        // Now, we need to indent to level + 2.
+        for (int i = 0; i < level + 2; i++) {
+            putc(' ', result_file);
+        }
+        fputs("step:\n", result_file);
+
+        step->pretty_print(result_file, level + 2);
+    }
+
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+
+    fputs("}\n", result_file);
+}
+
+auto ASTBinaryOpExprNode::pretty_print(FILE *result_file, int level) -> void {
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+    fputs("{\n", result_file);
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+
+    // Node kind.
+    fputs("kind: ASTBinaryOpExprNode\n", result_file);
+
+    // Now, we need to indent to level + 2.
+    for (int i = 0; i < level + 2; i++) {
+        putc(' ', result_file);
+    }
+
+    fputs("op: ", result_file);
+    fputs(Parse::token_names[static_cast<int>(op)], result_file);
+    fputc('\n', result_file);
+
+    lhs->pretty_print(result_file, level + 2);
+    rhs->pretty_print(result_file, level + 2);
+
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+
+    fputs("}\n", result_file);
+}
+
+auto ASTUnaryOpExprNode::pretty_print(FILE *result_file, int level) -> void {
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+    fputs("{\n", result_file);
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+
+    // Node kind.
+    fputs("kind: ASTUnaryOpExprNode\n", result_file);
+
+    // Now, we need to indent to level + 2.
+    for (int i = 0; i < level + 2; i++) {
+        putc(' ', result_file);
+    }
+
+    fputs("op: ", result_file);
+    fputs(Parse::token_names[static_cast<int>(op)], result_file);
+    fputc('\n', result_file);
+
+    expr->pretty_print(result_file, level + 2);
+
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+
+    fputs("}\n", result_file);
+}
+
+auto ASTTernaryOpExprNode::pretty_print(FILE *result_file, int level) -> void {
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+    fputs("{\n", result_file);
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+
+    // Node kind.
+    fputs("kind: ASTTernaryOpExprNode\n", result_file);
+
+    condition->pretty_print(result_file, level + 2);
+    true_case->pretty_print(result_file, level + 2);
+    false_case->pretty_print(result_file, level + 2);
+
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+
+    fputs("}\n", result_file);
+}
+
+auto ASTStringConcatExprNode::pretty_print(FILE *result_file,
+                                           int level) -> void {
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+    fputs("{\n", result_file);
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+
+    // Node kind.
+    fputs("kind: ASTStringConcatExprNode\n", result_file);
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+    fputs("parts: [\n", result_file);
+
+    for (auto *x : parts) {
+        x->pretty_print(result_file, level + 2);
+    }
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+    fputs("]\n", result_file);
+
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+
+    fputs("}\n", result_file);
+}
+
+auto ASTAwaitExprNode::pretty_print(FILE *result_file, int level) -> void {
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+    fputs("{\n", result_file);
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+
+    // Node kind.
+    fputs("kind: ASTAwaitExprNode\n", result_file);
+
+    expr->pretty_print(result_file, level + 2);
+
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+
+    fputs("}\n", result_file);
+}
+
+auto ASTYieldExprNode::pretty_print(FILE *result_file, int level) -> void {
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+    fputs("{\n", result_file);
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+
+    // Node kind.
+    fputs("kind: ASTYieldExprNode\n", result_file);
+
+    if (is_from) {
+        // Now, we need to indent to level + 2.
+        for (int i = 0; i < level + 2; i++) {
+            putc(' ', result_file);
+        }
+        fputs("from\n", result_file);
+    }
+
+    if (value) {
+        value->pretty_print(result_file, level + 2);
+    }
+
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+
+    fputs("}\n", result_file);
+}
+
+auto ASTLambdaExprNode::pretty_print(FILE *result_file, int level) -> void {
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+    fputs("{\n", result_file);
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+
+    // Node kind.
+    fputs("kind: ASTLambdaExprNode\n", result_file);
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+    fputs("params: [\n", result_file);
+
+    for (auto *x : params) {
+        x->pretty_print(result_file, level + 2);
+    }
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+    fputs("]\n", result_file);
+
+    body->pretty_print(result_file, level + 2);
+
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+
+    fputs("}\n", result_file);
+}
+
+auto ASTComprehensionClauseNode::pretty_print(FILE *result_file,
+                                              int level) -> void {
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+    fputs("{\n", result_file);
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+
+    // Node kind.
+    fputs("kind: ASTComprehensionClauseNode\n", result_file);
+
+    if (is_async) {
+        // Now, we need to indent to level + 2.
+        for (int i = 0; i < level + 2; i++) {
+            putc(' ', result_file);
+        }
+        fputs("async\n", result_file);
+    }
+
+    target->pretty_print(result_file, level + 2);
+    iter->pretty_print(result_file, level + 2);
+
+    for (auto *x : ifs) {
+        x->pretty_print(result_file, level + 2);
+    }
+
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+
+    fputs("}\n", result_file);
+}
+
+auto ASTComprehensionExprNode::pretty_print(FILE *result_file,
+                                            int level) -> void {
+    // Indentation space based on the level.
+    // 4 spaces per level.
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+    fputs("{\n", result_file);
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+
+    // Node kind.
+    fputs("kind: ASTComprehensionExprNode\n", result_file);
+
+    // Now, we need to indent to level + 2.
+    for (int i = 0; i < level + 2; i++) {
+        putc(' ', result_file);
+    }
+
+    fputs("bracket: ", result_file);
+    fputs(Parse::token_names[static_cast<int>(bracket)], result_file);
+    fputc('\n', result_file);
+
+    element->pretty_print(result_file, level + 2);
+    if (value) {
+        value->pretty_print(result_file, level + 2);
+    }
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+    fputs("generators: [\n", result_file);
+
+    for (auto *x : generators) {
+        x->pretty_print(result_file, level + 2);
+    }
+
+    // Now, we need to indent to level + 1.
+    for (int i = 0; i < level + 1; i++) {
+        putc(' ', result_file);
+    }
+    fputs("]\n", result_file);
 
     // Indentation space based on the level.
     // 4 spaces per level.
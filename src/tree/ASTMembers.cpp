@@ -0,0 +1,115 @@
+/*
+    This file implements the description of the members of an AST node.
+*/
+
+#include "tpy/tree/ASTMembers.h"
+
+#include "tpy/tree/ASTExpr.h"
+#include "tpy/tree/ASTNodeKind.h"
+#include "tpy/tree/ASTStmt.h"
+
+namespace tpy::Tree {
+auto describe_members(ASTNode *node, NodeMembers &members) -> void {
+    // The scalar members are particular to a few kinds.
+    switch (node->kind) {
+    case ASTNodeKind::IntLiteral: {
+        members.number("base", static_cast<ASTIntLiteralNode *>(node)->base);
+        break;
+    }
+    case ASTNodeKind::FStringLiteral: {
+        auto *fstring = static_cast<ASTFStringLiteralNode *>(node);
+        members.number("segment_begin", fstring->segment_begin);
+        members.number("segment_end", fstring->segment_end);
+        break;
+    }
+    case ASTNodeKind::BoolLiteral: {
+        members.boolean("val", static_cast<ASTBoolLiteralNode *>(node)->val);
+        break;
+    }
+    case ASTNodeKind::ConstantExpr: {
+        auto *constant = static_cast<ASTConstantExprNode *>(node);
+        members.name("type", constant_kind_name(constant->constant_kind));
+        members.text("value", constant->repr());
+        break;
+    }
+    case ASTNodeKind::StarredExpr: {
+        members.op(static_cast<ASTStarredExprNode *>(node)->op);
+        break;
+    }
+    case ASTNodeKind::BinaryOpExpr: {
+        members.op(static_cast<ASTBinaryOpExprNode *>(node)->op);
+        break;
+    }
+    case ASTNodeKind::UnaryOpExpr: {
+        members.op(static_cast<ASTUnaryOpExprNode *>(node)->op);
+        break;
+    }
+    case ASTNodeKind::YieldExpr: {
+        members.boolean("is_from",
+                        static_cast<ASTYieldExprNode *>(node)->is_from);
+        break;
+    }
+    case ASTNodeKind::ComprehensionClause: {
+        auto *clause = static_cast<ASTComprehensionClauseNode *>(node);
+        members.boolean("is_async", clause->is_async);
+        break;
+    }
+    case ASTNodeKind::ComprehensionExpr: {
+        auto *comprehension = static_cast<ASTComprehensionExprNode *>(node);
+        members.name("bracket", Parse::token_names[static_cast<int>(
+                                    comprehension->bracket)]);
+        break;
+    }
+    case ASTNodeKind::AugAssignStmt: {
+        members.op(static_cast<ASTAugAssignStmtNode *>(node)->op);
+        break;
+    }
+    case ASTNodeKind::ImportFromStmt: {
+        members.number("level",
+                       static_cast<ASTImportFromStmtNode *>(node)->level);
+        break;
+    }
+    case ASTNodeKind::ForStmt: {
+        members.boolean("is_async",
+                        static_cast<ASTForStmtNode *>(node)->is_async);
+        break;
+    }
+    case ASTNodeKind::WithStmt: {
+        members.boolean("is_async",
+                        static_cast<ASTWithStmtNode *>(node)->is_async);
+        break;
+    }
+    case ASTNodeKind::FunctionDef: {
+        members.boolean("is_async",
+                        static_cast<ASTFunctionDefNode *>(node)->is_async);
+        break;
+    }
+    case ASTNodeKind::Param: {
+        auto *param = static_cast<ASTParamNode *>(node);
+        members.name("param_kind", param_kind_name(param->param_kind));
+        break;
+    }
+    default: {
+        break;
+    }
+    }
+
+    // The children of every kind come from the list of kinds, and the labels
+    // are the names of their members.
+    switch (node->kind) {
+#define AST_CHILD(member) members.node(#member, typed->member);
+#define AST_CHILD_LIST(member) members.list(#member, typed->member);
+#define AST_CHILD_PAIRS(member) members.pairs(#member, typed->member);
+#define F(x, children)                                                         \
+    case ASTNodeKind::x: {                                                     \
+        [[maybe_unused]] auto *typed = static_cast<AST##x##Node *>(node);      \
+        children break;                                                        \
+    }
+        AST_NODE_LIST(F)
+#undef F
+#undef AST_CHILD_PAIRS
+#undef AST_CHILD_LIST
+#undef AST_CHILD
+    }
+}
+} // namespace tpy::Tree
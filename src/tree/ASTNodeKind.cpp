@@ -0,0 +1,36 @@
+/*
+    This file implements the names of the kinds of the nodes of the AST, and
+   what the arena needs to know about the class of every kind.
+*/
+#include "tpy/tree/ASTNodeKind.h"
+
+#include "tpy/tree/ASTExpr.h"
+#include "tpy/tree/ASTStmt.h"
+#include "tpy/utility/ArenaAllocator.h"
+
+namespace tpy::Tree {
+
+#define F(x, children) #x,
+const char *ast_node_kind_names[] = {AST_NODE_LIST(F)};
+#undef F
+
+// Every node is allocated without a destructor record, so a node that holds
+// memory of its own has to keep it in the arena as well.
+#define F(x, children)                                                         \
+    static_assert(!Utility::ArenaAllocator::NEEDS_DESTRUCTOR<AST##x##Node>,    \
+                  "AST" #x "Node is not trivially destructible.");
+AST_NODE_LIST(F)
+#undef F
+
+auto deallocate_node(ASTNode *node, Utility::ArenaAllocator &arena) -> void {
+    switch (node->kind) {
+#define F(x, children)                                                         \
+    case ASTNodeKind::x:                                                       \
+        arena.deallocate(static_cast<AST##x##Node *>(node));                   \
+        break;
+        AST_NODE_LIST(F)
+#undef F
+    }
+}
+
+} // namespace tpy::Tree
\ No newline at end of file
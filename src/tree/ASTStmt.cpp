@@ -0,0 +1,297 @@
+/*
+    This file implements the AST nodes for Python statements and modules.
+*/
+
+#include "tpy/tree/ASTStmt.h"
+#include "tpy/parse/Token.h"
+
+namespace tpy::Tree {
+// Statements have many more children than expressions, so the printing of the
+// common parts is shared by these helpers. The output has the same layout as
+// the expression nodes.
+
+// This function prints the indentation space based on the level.
+static auto print_indent(FILE *result_file, int level) -> void {
+    for (int i = 0; i < level; i++) {
+        putc(' ', result_file);
+    }
+}
+
+// This function prints the opening brace and the kind of a node.
+static auto print_open(FILE *result_file, int level, const char *kind) -> void {
+    print_indent(result_file, level);
+    fputs("{\n", result_file);
+
+    print_indent(result_file, level + 1);
+    fprintf(result_file, "kind: %s\n", kind);
+}
+
+// This function prints the closing brace of a node.
+static auto print_close(FILE *result_file, int level) -> void {
+    print_indent(result_file, level);
+    fputs("}\n", result_file);
+}
+
+// This function prints a labelled list of child nodes. Empty lists are
+// omitted.
+static auto print_array(FILE *result_file, int level, const char *label,
+                        const Utility::ArenaArray<ASTNode *> &nodes) -> void {
+    if (nodes.empty()) {
+        return;
+    }
+
+    print_indent(result_file, level + 1);
+    fprintf(result_file, "%s: [\n", label);
+
+    for (auto *node : nodes) {
+        node->pretty_print(result_file, level + 2);
+    }
+
+    print_indent(result_file, level + 1);
+    fputs("]\n", result_file);
+}
+
+// This function prints an optional child node. The label is printed before it
+// when a child could otherwise be mistaken for another one.
+static auto print_optional(FILE *result_file, int level, const char *label,
+                           ASTNode *node) -> void {
+    if (!node) {
+        return;
+    }
+
+    if (label) {
+        print_indent(result_file, level + 1);
+        fprintf(result_file, "%s:\n", label);
+    }
+
+    node->pretty_print(result_file, level + 2);
+}
+
+// This function prints the flag of an 'async' statement. It is omitted unless
+// it is set.
+static auto print_async(FILE *result_file, int level, bool is_async) -> void {
+    if (!is_async) {
+        return;
+    }
+
+    print_indent(result_file, level + 1);
+    fputs("async: true\n", result_file);
+}
+
+auto param_kind_name(ParamKind kind) -> const char * {
+    switch (kind) {
+    case ParamKind::Normal:
+        return "Normal";
+    case ParamKind::PositionalOnlyMarker:
+        return "PositionalOnlyMarker";
+    case ParamKind::KeywordOnlyMarker:
+        return "KeywordOnlyMarker";
+    case ParamKind::VarPositional:
+        return "VarPositional";
+    case ParamKind::VarKeyword:
+        return "VarKeyword";
+    }
+
+    return "";
+}
+
+auto ASTModuleNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTModuleNode");
+    print_array(result_file, level, "body", body);
+    print_close(result_file, level);
+}
+
+auto ASTExprStmtNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTExprStmtNode");
+    expr->pretty_print(result_file, level + 2);
+    print_close(result_file, level);
+}
+
+auto ASTAssignStmtNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTAssignStmtNode");
+    print_array(result_file, level, "targets", targets);
+    value->pretty_print(result_file, level + 2);
+    print_close(result_file, level);
+}
+
+auto ASTAugAssignStmtNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTAugAssignStmtNode");
+    print_indent(result_file, level + 1);
+    fprintf(result_file, "op: %s\n",
+            Parse::token_names[static_cast<int>(op)]);
+    target->pretty_print(result_file, level + 2);
+    value->pretty_print(result_file, level + 2);
+    print_close(result_file, level);
+}
+
+auto ASTAnnAssignStmtNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTAnnAssignStmtNode");
+    target->pretty_print(result_file, level + 2);
+    annotation->pretty_print(result_file, level + 2);
+    print_optional(result_file, level, "value", value);
+    print_close(result_file, level);
+}
+
+auto ASTPassStmtNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTPassStmtNode");
+    print_close(result_file, level);
+}
+
+auto ASTBreakStmtNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTBreakStmtNode");
+    print_close(result_file, level);
+}
+
+auto ASTContinueStmtNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTContinueStmtNode");
+    print_close(result_file, level);
+}
+
+auto ASTReturnStmtNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTReturnStmtNode");
+    print_optional(result_file, level, nullptr, value);
+    print_close(result_file, level);
+}
+
+auto ASTDelStmtNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTDelStmtNode");
+    print_array(result_file, level, "targets", targets);
+    print_close(result_file, level);
+}
+
+auto ASTGlobalStmtNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTGlobalStmtNode");
+    print_array(result_file, level, "names", names);
+    print_close(result_file, level);
+}
+
+auto ASTNonlocalStmtNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTNonlocalStmtNode");
+    print_array(result_file, level, "names", names);
+    print_close(result_file, level);
+}
+
+auto ASTAssertStmtNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTAssertStmtNode");
+    test->pretty_print(result_file, level + 2);
+    print_optional(result_file, level, "msg", msg);
+    print_close(result_file, level);
+}
+
+auto ASTRaiseStmtNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTRaiseStmtNode");
+    print_optional(result_file, level, nullptr, exc);
+    print_optional(result_file, level, "cause", cause);
+    print_close(result_file, level);
+}
+
+auto ASTImportAliasNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTImportAliasNode");
+    name->pretty_print(result_file, level + 2);
+    print_optional(result_file, level, "as", as_name);
+    print_close(result_file, level);
+}
+
+auto ASTImportStmtNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTImportStmtNode");
+    print_array(result_file, level, "names", names);
+    print_close(result_file, level);
+}
+
+auto ASTImportFromStmtNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTImportFromStmtNode");
+    print_indent(result_file, level + 1);
+    fprintf(result_file, "level: %u\n", this->level);
+    print_optional(result_file, level, "module", module);
+    print_array(result_file, level, "names", names);
+    print_close(result_file, level);
+}
+
+auto ASTIfStmtNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTIfStmtNode");
+    test->pretty_print(result_file, level + 2);
+    print_array(result_file, level, "body", body);
+    print_array(result_file, level, "orelse", orelse);
+    print_close(result_file, level);
+}
+
+auto ASTWhileStmtNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTWhileStmtNode");
+    test->pretty_print(result_file, level + 2);
+    print_array(result_file, level, "body", body);
+    print_array(result_file, level, "orelse", orelse);
+    print_close(result_file, level);
+}
+
+auto ASTForStmtNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTForStmtNode");
+    print_async(result_file, level, is_async);
+    target->pretty_print(result_file, level + 2);
+    iter->pretty_print(result_file, level + 2);
+    print_array(result_file, level, "body", body);
+    print_array(result_file, level, "orelse", orelse);
+    print_close(result_file, level);
+}
+
+auto ASTExceptHandlerNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTExceptHandlerNode");
+    print_optional(result_file, level, "type", type);
+    print_optional(result_file, level, "name", name);
+    print_array(result_file, level, "body", body);
+    print_close(result_file, level);
+}
+
+auto ASTTryStmtNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTTryStmtNode");
+    print_array(result_file, level, "body", body);
+    print_array(result_file, level, "handlers", handlers);
+    print_array(result_file, level, "orelse", orelse);
+    print_array(result_file, level, "finalbody", finalbody);
+    print_close(result_file, level);
+}
+
+auto ASTWithItemNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTWithItemNode");
+    context_expr->pretty_print(result_file, level + 2);
+    print_optional(result_file, level, "as", target);
+    print_close(result_file, level);
+}
+
+auto ASTWithStmtNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTWithStmtNode");
+    print_async(result_file, level, is_async);
+    print_array(result_file, level, "items", items);
+    print_array(result_file, level, "body", body);
+    print_close(result_file, level);
+}
+
+auto ASTParamNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTParamNode");
+    print_indent(result_file, level + 1);
+    fprintf(result_file, "param_kind: %s\n", param_kind_name(param_kind));
+    print_optional(result_file, level, nullptr, name);
+    print_optional(result_file, level, "annotation", annotation);
+    print_optional(result_file, level, "default", default_value);
+    print_close(result_file, level);
+}
+
+auto ASTFunctionDefNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTFunctionDefNode");
+    print_async(result_file, level, is_async);
+    print_array(result_file, level, "decorators", decorators);
+    name->pretty_print(result_file, level + 2);
+    print_array(result_file, level, "params", params);
+    print_optional(result_file, level, "returns", returns);
+    print_array(result_file, level, "body", body);
+    print_close(result_file, level);
+}
+
+auto ASTClassDefNode::pretty_print(FILE *result_file, int level) -> void {
+    print_open(result_file, level, "ASTClassDefNode");
+    print_array(result_file, level, "decorators", decorators);
+    name->pretty_print(result_file, level + 2);
+    print_array(result_file, level, "bases", bases);
+    print_array(result_file, level, "body", body);
+    print_close(result_file, level);
+}
+} // namespace tpy::Tree
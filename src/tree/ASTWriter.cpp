@@ -0,0 +1,259 @@
+/*
+    This file implements the writer that dumps the AST as JSON or as compact
+   S-expressions.
+*/
+
+#include "tpy/tree/ASTWriter.h"
+
+#include <utility>
+
+#include "tpy/tree/ASTMembers.h"
+#include "tpy/tree/ASTNodeKind.h"
+
+namespace tpy::Tree {
+auto ASTWriter::write_json_string(std::string_view text) -> void {
+    out.put('"');
+
+    for (auto c : text) {
+        auto byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out.put('\\');
+            out.put(c);
+        } else if (byte < 0x20) {
+            static const char digits[] = "0123456789abcdef";
+            out.write("\\u00");
+            out.put(digits[byte >> 4]);
+            out.put(digits[byte & 0xF]);
+        } else {
+            out.put(c);
+        }
+    }
+
+    out.put('"');
+}
+
+auto ASTWriter::write_separator(Separator separator, uint32_t depth) -> void {
+    if (format == ASTFormat::SExpr) {
+        if (separator == Separator::Next) {
+            out.put(' ');
+        }
+        return;
+    }
+
+    switch (separator) {
+    case Separator::None: {
+        return;
+    }
+    case Separator::Next: {
+        out.put(',');
+        break;
+    }
+    case Separator::First:
+    case Separator::Close: {
+        break;
+    }
+    }
+
+    out.put('\n');
+    out.write_indent(depth * 2);
+}
+
+auto ASTWriter::write_node(ASTNode *node, uint32_t depth) -> void {
+    bool json = format == ASTFormat::JSON;
+
+    if (!node) {
+        out.write(json ? "null" : "nil");
+        return;
+    }
+
+    NodeMembers members;
+    describe_members(node, members);
+
+    // The kind, the span, and the scalar members come first.
+    auto *kind = ast_node_kind_names[static_cast<size_t>(node->kind)];
+
+    if (json) {
+        out.put('{');
+        write_separator(Separator::First, depth + 1);
+        out.write("\"kind\": \"");
+        out.write(kind);
+        out.put('"');
+        write_separator(Separator::Next, depth + 1);
+        out.write("\"start\": ");
+        out.write_uint(node->loc.local_pos);
+        write_separator(Separator::Next, depth + 1);
+        out.write("\"end\": ");
+        out.write_uint(node->loc.local_end());
+    } else {
+        out.put('(');
+        out.write(kind);
+        out.put(' ');
+        out.write_uint(node->loc.local_pos);
+        out.put(' ');
+        out.write_uint(node->loc.local_end());
+    }
+
+    for (size_t i = 0; i < members.num_scalars; i++) {
+        auto &scalar = members.scalars[i];
+
+        write_separator(Separator::Next, depth + 1);
+        if (json) {
+            out.put('"');
+            out.write(scalar.label);
+            out.write("\": ");
+        } else {
+            out.put(':');
+            out.write(scalar.label);
+            out.put(' ');
+        }
+
+        switch (scalar.kind) {
+        case NodeMembers::Scalar::Kind::Number: {
+            out.write_uint(scalar.number);
+            break;
+        }
+        case NodeMembers::Scalar::Kind::Name: {
+            // The names are identifiers, so they never need to be escaped.
+            if (json) {
+                out.put('"');
+            }
+            out.write(scalar.name);
+            if (json) {
+                out.put('"');
+            }
+            break;
+        }
+        case NodeMembers::Scalar::Kind::Bool: {
+            out.write(scalar.number ? "true" : "false");
+            break;
+        }
+        case NodeMembers::Scalar::Kind::Text: {
+            if (json) {
+                write_json_string(members.text_value);
+            } else {
+                out.write(members.text_value);
+            }
+            break;
+        }
+        }
+    }
+
+    // The children are pushed in reverse, so the first one is on top.
+    stack.push_back(Item{Item::Kind::Text,
+                         json ? Separator::Close : Separator::None, depth,
+                         nullptr, json ? "}" : ")"});
+
+    auto inner = depth + 1;
+    for (auto i = members.num_children; i-- > 0;) {
+        auto &child = members.children[i];
+
+        switch (child.kind) {
+        case NodeMembers::Child::Kind::Node: {
+            if (!*child.slot && !json) {
+                continue;
+            }
+
+            stack.push_back(Item{Item::Kind::Node, Separator::None, inner,
+                                 *child.slot, nullptr});
+            break;
+        }
+        case NodeMembers::Child::Kind::List: {
+            auto &list = *child.list;
+            if (list.empty()) {
+                if (!json) {
+                    continue;
+                }
+
+                stack.push_back(Item{Item::Kind::Text, Separator::None, inner,
+                                     nullptr, "[]"});
+                break;
+            }
+
+            stack.push_back(
+                Item{Item::Kind::Text, Separator::Close, inner, nullptr, "]"});
+            for (auto k = list.size(); k-- > 0;) {
+                stack.push_back(Item{Item::Kind::Node,
+                                     k == 0 ? Separator::First
+                                            : Separator::Next,
+                                     inner + 1, list[k], nullptr});
+            }
+            stack.push_back(
+                Item{Item::Kind::Text, Separator::None, inner, nullptr, "["});
+            break;
+        }
+        case NodeMembers::Child::Kind::Pairs: {
+            auto &pairs = *child.pairs;
+            if (pairs.empty()) {
+                if (!json) {
+                    continue;
+                }
+
+                stack.push_back(Item{Item::Kind::Text, Separator::None, inner,
+                                     nullptr, "[]"});
+                break;
+            }
+
+            // Every entry is a list of its key and its value.
+            stack.push_back(
+                Item{Item::Kind::Text, Separator::Close, inner, nullptr, "]"});
+            for (auto k = pairs.size(); k-- > 0;) {
+                stack.push_back(Item{Item::Kind::Text, Separator::Close,
+                                     inner + 1, nullptr, "]"});
+                stack.push_back(Item{Item::Kind::Node, Separator::Next,
+                                     inner + 2, pairs[k].second, nullptr});
+                stack.push_back(Item{Item::Kind::Node, Separator::First,
+                                     inner + 2, pairs[k].first, nullptr});
+                stack.push_back(Item{Item::Kind::Text,
+                                     k == 0 ? Separator::First
+                                            : Separator::Next,
+                                     inner + 1, nullptr, "["});
+            }
+            stack.push_back(
+                Item{Item::Kind::Text, Separator::None, inner, nullptr, "["});
+            break;
+        }
+        }
+
+        stack.push_back(Item{Item::Kind::Label, Separator::Next, inner,
+                             nullptr, child.label});
+    }
+}
+
+auto ASTWriter::write(ASTNode *root) -> void {
+    stack.clear();
+    stack.push_back(
+        Item{Item::Kind::Node, Separator::None, 0, root, nullptr});
+
+    while (!stack.empty()) {
+        auto item = stack.back();
+        stack.pop_back();
+
+        write_separator(item.separator, item.depth);
+
+        switch (item.kind) {
+        case Item::Kind::Node: {
+            write_node(item.node, item.depth);
+            break;
+        }
+        case Item::Kind::Label: {
+            if (format == ASTFormat::JSON) {
+                out.put('"');
+                out.write(item.text);
+                out.write("\": ");
+            } else {
+                out.put(':');
+                out.write(item.text);
+                out.put(' ');
+            }
+            break;
+        }
+        case Item::Kind::Text: {
+            out.write(item.text);
+            break;
+        }
+        }
+    }
+
+    out.put('\n');
+}
+} // namespace tpy::Tree
@@ -0,0 +1,829 @@
+/*
+    This file implements the constant folding pass.
+*/
+
+#include "tpy/tree/ConstantFolder.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "tpy/parse/Token.h"
+#include "tpy/tree/ASTExpr.h"
+#include "tpy/tree/ASTMembers.h"
+#include "tpy/utility/BigInt.h"
+#include "tpy/utility/Unicode.h"
+
+namespace tpy::Tree {
+using Parse::TokenKind;
+using Utility::BigInt;
+
+namespace {
+/*
+    This is the value of a constant operand or result. Booleans are kept apart
+   from integers, as some operators give a boolean for two booleans, and
+   'None' is only ever an operand.
+*/
+struct Value {
+    enum class Kind : uint8_t { Int, Float, Bool, None, String, Bytes };
+
+    // Every member has a default, so that a value can be made from its kind
+    // and only the members that the kind uses.
+    Kind kind = Kind::None;
+
+    // This holds an integer, or 0 or 1 for a boolean.
+    BigInt int_value{};
+
+    double float_value = 0;
+
+    // This holds the UTF-8 text of a string, or the contents of a bytes
+    // object.
+    std::string text{};
+
+    auto is_int() const -> bool {
+        return kind == Kind::Int || kind == Kind::Bool;
+    }
+
+    auto is_number() const -> bool { return is_int() || kind == Kind::Float; }
+
+    auto is_text() const -> bool {
+        return kind == Kind::String || kind == Kind::Bytes;
+    }
+
+    // This method tells whether the value is true, as 'bool' would.
+    auto truth() const -> bool {
+        switch (kind) {
+        case Kind::Int:
+        case Kind::Bool:
+            return !int_value.is_zero();
+        case Kind::Float:
+            return float_value != 0;
+        case Kind::None:
+            return false;
+        case Kind::String:
+        case Kind::Bytes:
+            return !text.empty();
+        }
+
+        return false;
+    }
+
+    // This method converts a number to a float. It returns false for an
+    // integer that is too large, for which Python raises 'OverflowError'.
+    auto to_float(double &result) const -> bool {
+        if (kind == Kind::Float) {
+            result = float_value;
+            return true;
+        }
+
+        return int_value.to_double(result);
+    }
+};
+
+auto int_value(BigInt value) -> Value {
+    return Value{Value::Kind::Int, std::move(value)};
+}
+
+auto float_value(double value) -> Value {
+    return Value{Value::Kind::Float, BigInt{}, value};
+}
+
+auto bool_value(bool value) -> Value {
+    return Value{Value::Kind::Bool, BigInt{value ? 1 : 0}};
+}
+
+auto hex_digit(char c) -> int {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/*
+    This function decodes the text of a string or bytes literal, including its
+   prefix and its quotes, the way that Python does. It returns false for the
+   literals that it does not handle: named escapes, surrogates, and anything
+   that Python itself would reject.
+*/
+auto decode_text(std::string_view literal, bool is_bytes, std::string &result)
+    -> bool {
+    bool is_raw = false;
+
+    size_t pos = 0;
+    while (pos < literal.size() && literal[pos] != '\'' &&
+           literal[pos] != '"') {
+        if (literal[pos] == 'r' || literal[pos] == 'R') {
+            is_raw = true;
+        }
+        ++pos;
+    }
+
+    // The quotes at both ends are either single or tripled.
+    auto quote = literal.substr(pos, 1);
+    size_t quote_len = literal.substr(pos, 3) == std::string(3, quote[0])
+                           ? 3
+                           : 1;
+    if (literal.size() < pos + quote_len * 2) {
+        return false;
+    }
+
+    auto body = literal.substr(pos + quote_len,
+                               literal.size() - pos - quote_len * 2);
+
+    result.clear();
+    for (size_t i = 0; i < body.size();) {
+        auto c = body[i];
+
+        if (is_bytes && static_cast<unsigned char>(c) >= 0x80) {
+            return false;
+        }
+
+        // The line breaks within a literal are always read as '\n'.
+        if (c == '\r') {
+            result += '\n';
+            i += i + 1 < body.size() && body[i + 1] == '\n' ? 2 : 1;
+            continue;
+        }
+
+        if (c != '\\' || is_raw) {
+            // A backslash still escapes the next character of a raw literal,
+            // but both of them are kept.
+            result += c;
+            ++i;
+            if (c == '\\' && i < body.size()) {
+                if (is_bytes && static_cast<unsigned char>(body[i]) >= 0x80) {
+                    return false;
+                }
+                result += body[i++];
+            }
+            continue;
+        }
+
+        if (i + 1 >= body.size()) {
+            return false;
+        }
+
+        auto escape = body[i + 1];
+        i += 2;
+
+        switch (escape) {
+        case '\n': {
+            break;
+        }
+        case '\r': {
+            if (i < body.size() && body[i] == '\n') {
+                ++i;
+            }
+            break;
+        }
+        case '\\':
+        case '\'':
+        case '"': {
+            result += escape;
+            break;
+        }
+        case 'a': {
+            result += '\a';
+            break;
+        }
+        case 'b': {
+            result += '\b';
+            break;
+        }
+        case 'f': {
+            result += '\f';
+            break;
+        }
+        case 'n': {
+            result += '\n';
+            break;
+        }
+        case 'r': {
+            result += '\r';
+            break;
+        }
+        case 't': {
+            result += '\t';
+            break;
+        }
+        case 'v': {
+            result += '\v';
+            break;
+        }
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7': {
+            uint32_t value = escape - '0';
+            for (int k = 0; k < 2 && i < body.size() && body[i] >= '0' &&
+                            body[i] <= '7';
+                 k++) {
+                value = value * 8 + (body[i++] - '0');
+            }
+
+            if (is_bytes) {
+                if (value > 0xFF) {
+                    return false;
+                }
+                result += static_cast<char>(value);
+            } else {
+                Utility::Unicode::encode_utf8(value, result);
+            }
+            break;
+        }
+        case 'x':
+        case 'u':
+        case 'U': {
+            if (is_bytes && escape != 'x') {
+                result += '\\';
+                result += escape;
+                break;
+            }
+
+            int num_digits = escape == 'x' ? 2 : escape == 'u' ? 4 : 8;
+            if (i + num_digits > body.size()) {
+                return false;
+            }
+
+            uint32_t value = 0;
+            for (int k = 0; k < num_digits; k++) {
+                auto digit = hex_digit(body[i++]);
+                if (digit < 0) {
+                    return false;
+                }
+                value = value * 16 + digit;
+            }
+
+            if (is_bytes) {
+                result += static_cast<char>(value);
+            } else if (value > 0x10FFFF ||
+                       (value >= 0xD800 && value <= 0xDFFF)) {
+                return false;
+            } else {
+                Utility::Unicode::encode_utf8(value, result);
+            }
+            break;
+        }
+        case 'N': {
+            if (!is_bytes) {
+                return false;
+            }
+            [[fallthrough]];
+        }
+        default: {
+            // An unknown escape keeps its backslash.
+            if (is_bytes && static_cast<unsigned char>(escape) >= 0x80) {
+                return false;
+            }
+            result += '\\';
+            result += escape;
+            break;
+        }
+        }
+    }
+
+    return true;
+}
+
+// This function tells whether a text of the given size may be repeated the
+// given number of times.
+auto repeat_fits(size_t size, const BigInt &count, int64_t &times) -> bool {
+    if (!count.to_int64(times)) {
+        return false;
+    }
+
+    if (times <= 0 || size == 0) {
+        times = times < 0 ? 0 : times;
+        return true;
+    }
+
+    return static_cast<uint64_t>(times) <= ConstantFolder::MAX_TEXT_SIZE / size;
+}
+
+// This function computes 'lhs // rhs' and 'lhs % rhs' for floats, exactly as
+// CPython does. The divisor must not be zero.
+auto float_divmod(double lhs, double rhs, double &quotient, double &remainder)
+    -> void {
+    remainder = std::fmod(lhs, rhs);
+    auto div = (lhs - remainder) / rhs;
+
+    if (remainder != 0) {
+        if ((rhs < 0) != (remainder < 0)) {
+            remainder += rhs;
+            div -= 1.0;
+        }
+    } else {
+        remainder = std::copysign(0.0, rhs);
+    }
+
+    if (div != 0) {
+        quotient = std::floor(div);
+        if (div - quotient > 0.5) {
+            quotient += 1.0;
+        }
+    } else {
+        quotient = std::copysign(0.0, lhs / rhs);
+    }
+}
+
+// This function computes 'lhs ** rhs' for floats. It returns false where
+// Python would raise, or give a complex number.
+auto float_pow(double lhs, double rhs, double &result) -> bool {
+    if (lhs == 0 && rhs < 0) {
+        return false;
+    }
+
+    if (lhs < 0 && std::isfinite(rhs) && rhs != std::floor(rhs)) {
+        return false;
+    }
+
+    result = std::pow(lhs, rhs);
+    return std::isfinite(result) || !std::isfinite(lhs) ||
+           !std::isfinite(rhs);
+}
+
+// This function applies an operator to two floats.
+auto fold_float(TokenKind op, double lhs, double rhs, Value &result) -> bool {
+    double value;
+
+    switch (op) {
+    case TokenKind::Plus: {
+        value = lhs + rhs;
+        break;
+    }
+    case TokenKind::Minus: {
+        value = lhs - rhs;
+        break;
+    }
+    case TokenKind::Asterisk: {
+        value = lhs * rhs;
+        break;
+    }
+    case TokenKind::Slash: {
+        if (rhs == 0) {
+            return false;
+        }
+        value = lhs / rhs;
+        break;
+    }
+    case TokenKind::SlashSlash:
+    case TokenKind::Percent: {
+        if (rhs == 0) {
+            return false;
+        }
+
+        double quotient, remainder;
+        float_divmod(lhs, rhs, quotient, remainder);
+        value = op == TokenKind::SlashSlash ? quotient : remainder;
+        break;
+    }
+    case TokenKind::AsteriskAsterisk: {
+        if (!float_pow(lhs, rhs, value)) {
+            return false;
+        }
+        break;
+    }
+    default: {
+        return false;
+    }
+    }
+
+    result = float_value(value);
+    return true;
+}
+
+// This function applies an operator to two integers. Every result is bounded
+// by the size of the operands, except for those of '*', '**', and '<<'.
+auto fold_int(TokenKind op, const Value &lhs, const Value &rhs, Value &result)
+    -> bool {
+    auto &x = lhs.int_value;
+    auto &y = rhs.int_value;
+    bool both_bool =
+        lhs.kind == Value::Kind::Bool && rhs.kind == Value::Kind::Bool;
+
+    switch (op) {
+    case TokenKind::Plus: {
+        result = int_value(x + y);
+        return true;
+    }
+    case TokenKind::Minus: {
+        result = int_value(x - y);
+        return true;
+    }
+    case TokenKind::Asterisk: {
+        if (!x.is_zero() && !y.is_zero() &&
+            x.bit_length() + y.bit_length() > ConstantFolder::MAX_INT_BITS) {
+            return false;
+        }
+        result = int_value(x * y);
+        return true;
+    }
+    case TokenKind::Slash: {
+        // The quotient of two doubles is correctly rounded, so it is the same
+        // as Python's exact true division as long as both are exact.
+        constexpr size_t EXACT_BITS = std::numeric_limits<double>::digits;
+        if (y.is_zero() || x.bit_length() > EXACT_BITS ||
+            y.bit_length() > EXACT_BITS) {
+            return false;
+        }
+
+        double a, b;
+        x.to_double(a);
+        y.to_double(b);
+        result = float_value(a / b);
+        return true;
+    }
+    case TokenKind::SlashSlash:
+    case TokenKind::Percent: {
+        if (y.is_zero()) {
+            return false;
+        }
+
+        BigInt quotient, remainder;
+        BigInt::floor_divmod(x, y, quotient, remainder);
+        result = int_value(op == TokenKind::SlashSlash ? std::move(quotient)
+                                                       : std::move(remainder));
+        return true;
+    }
+    case TokenKind::AsteriskAsterisk: {
+        // A negative exponent gives a float.
+        if (y.is_negative()) {
+            double a, b;
+            if (!x.to_double(a) || !y.to_double(b)) {
+                return false;
+            }
+            return fold_float(op, a, b, result);
+        }
+
+        int64_t exponent;
+        if (!y.to_int64(exponent)) {
+            return false;
+        }
+
+        if (!x.is_zero() && exponent > 0 &&
+            x.bit_length() > ConstantFolder::MAX_INT_BITS / exponent) {
+            return false;
+        }
+
+        result = int_value(x.pow(static_cast<uint64_t>(exponent)));
+        return true;
+    }
+    case TokenKind::LessLess:
+    case TokenKind::GreaterGreater: {
+        int64_t count;
+        if (y.is_negative()) {
+            return false;
+        }
+
+        if (!y.to_int64(count)) {
+            // Only a right shift can be this large, and it leaves the sign.
+            if (op == TokenKind::LessLess && !x.is_zero()) {
+                return false;
+            }
+            result = int_value(BigInt{x.is_negative() ? -1 : 0});
+            return true;
+        }
+
+        if (op == TokenKind::GreaterGreater) {
+            result = int_value(x.shift_right(static_cast<size_t>(count)));
+            return true;
+        }
+
+        if (!x.is_zero() &&
+            (static_cast<uint64_t>(count) > ConstantFolder::MAX_INT_BITS ||
+             x.bit_length() > ConstantFolder::MAX_INT_BITS - count)) {
+            return false;
+        }
+
+        result = int_value(x.shift_left(static_cast<size_t>(count)));
+        return true;
+    }
+    case TokenKind::Ampersand:
+    case TokenKind::Bar:
+    case TokenKind::Caret: {
+        auto value = op == TokenKind::Ampersand ? x & y
+                     : op == TokenKind::Bar     ? x | y
+                                                : x ^ y;
+        result = both_bool ? bool_value(!value.is_zero())
+                           : int_value(std::move(value));
+        return true;
+    }
+    default: {
+        return false;
+    }
+    }
+}
+
+// This function applies a binary operator to two constants.
+auto fold_binary(TokenKind op, const Value &lhs, const Value &rhs,
+                 Value &result) -> bool {
+    if (lhs.is_int() && rhs.is_int()) {
+        return fold_int(op, lhs, rhs, result);
+    }
+
+    if (lhs.is_number() && rhs.is_number()) {
+        double a, b;
+        if (!lhs.to_float(a) || !rhs.to_float(b)) {
+            return false;
+        }
+        return fold_float(op, a, b, result);
+    }
+
+    if (op == TokenKind::Plus && lhs.is_text() && lhs.kind == rhs.kind) {
+        if (lhs.text.size() + rhs.text.size() > ConstantFolder::MAX_TEXT_SIZE) {
+            return false;
+        }
+
+        result = Value{lhs.kind};
+        result.text = lhs.text + rhs.text;
+        return true;
+    }
+
+    if (op == TokenKind::Asterisk &&
+        ((lhs.is_text() && rhs.is_int()) || (lhs.is_int() && rhs.is_text()))) {
+        auto &text = lhs.is_text() ? lhs : rhs;
+        auto &count = lhs.is_text() ? rhs : lhs;
+
+        int64_t times;
+        if (!repeat_fits(text.text.size(), count.int_value, times)) {
+            return false;
+        }
+
+        result = Value{text.kind};
+        result.text.reserve(text.text.size() * times);
+        for (int64_t i = 0; i < times; i++) {
+            result.text += text.text;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+// This function applies a unary operator to a constant.
+auto fold_unary(TokenKind op, const Value &operand, Value &result) -> bool {
+    if (op == TokenKind::KeywordNot) {
+        result = bool_value(!operand.truth());
+        return true;
+    }
+
+    if (operand.kind == Value::Kind::Float) {
+        if (op == TokenKind::Minus || op == TokenKind::Plus) {
+            result = float_value(op == TokenKind::Minus ? -operand.float_value
+                                                        : operand.float_value);
+            return true;
+        }
+        return false;
+    }
+
+    if (!operand.is_int()) {
+        return false;
+    }
+
+    switch (op) {
+    case TokenKind::Minus: {
+        result = int_value(-operand.int_value);
+        return true;
+    }
+    case TokenKind::Plus: {
+        result = int_value(operand.int_value);
+        return true;
+    }
+    case TokenKind::Tilda: {
+        result = int_value(~operand.int_value);
+        return true;
+    }
+    default: {
+        return false;
+    }
+    }
+}
+
+/*
+    This function reads the value of a constant node, looking through any
+   parentheses around it. It returns false if the node is not a constant, or
+   if it is a literal that it cannot decode.
+*/
+auto value_of(Source::SourceFile *src_file, ASTNode *node, Value &result)
+    -> bool {
+    while (node->kind == ASTNodeKind::ParenExpr) {
+        node = static_cast<ASTParenExprNode *>(node)->inner_expr;
+        if (!node) {
+            return false;
+        }
+    }
+
+    auto text = std::string_view(src_file->start() + node->loc.local_pos,
+                                 node->loc.len);
+
+    switch (node->kind) {
+    case ASTNodeKind::IntLiteral: {
+        auto base = static_cast<ASTIntLiteralNode *>(node)->base;
+
+        // The prefix of the base is two characters, as in '0x'.
+        if (base != 10) {
+            if (text.size() < 2) {
+                return false;
+            }
+            text.remove_prefix(2);
+        }
+
+        result = Value{Value::Kind::Int};
+        return BigInt::parse(text, base, result.int_value);
+    }
+    case ASTNodeKind::FloatLiteral: {
+        std::string digits;
+        for (auto c : text) {
+            if (c != '_') {
+                digits += c;
+            }
+        }
+
+        char *end;
+        auto value = strtod(digits.c_str(), &end);
+        if (digits.empty() || *end != '\0') {
+            return false;
+        }
+
+        result = float_value(value);
+        return true;
+    }
+    case ASTNodeKind::StringLiteral:
+    case ASTNodeKind::BytesLiteral: {
+        bool is_bytes = node->kind == ASTNodeKind::BytesLiteral;
+        result = Value{is_bytes ? Value::Kind::Bytes : Value::Kind::String};
+        return decode_text(text, is_bytes, result.text);
+    }
+    case ASTNodeKind::BoolLiteral: {
+        result = bool_value(static_cast<ASTBoolLiteralNode *>(node)->val);
+        return true;
+    }
+    case ASTNodeKind::NoneLiteral: {
+        result = Value{Value::Kind::None};
+        return true;
+    }
+    case ASTNodeKind::ConstantExpr: {
+        auto *constant = static_cast<ASTConstantExprNode *>(node);
+
+        switch (constant->constant_kind) {
+        case ConstantKind::Int: {
+            std::vector<uint32_t> digits(constant->digits.begin(),
+                                         constant->digits.end());
+            result = int_value(BigInt{std::move(digits), constant->negative});
+            break;
+        }
+        case ConstantKind::Float: {
+            result = float_value(constant->float_value);
+            break;
+        }
+        case ConstantKind::String:
+        case ConstantKind::Bytes: {
+            result = Value{constant->constant_kind == ConstantKind::String
+                               ? Value::Kind::String
+                               : Value::Kind::Bytes};
+            result.text.assign(constant->text.begin(), constant->text.end());
+            break;
+        }
+        }
+        return true;
+    }
+    default: {
+        return false;
+    }
+    }
+}
+} // namespace
+
+auto ConstantFolder::fold_node(ASTNode *node) -> ASTNode * {
+    Value result;
+
+    if (node->kind == ASTNodeKind::BinaryOpExpr) {
+        auto *binary = static_cast<ASTBinaryOpExprNode *>(node);
+
+        Value lhs, rhs;
+        if (!value_of(src_file, binary->lhs, lhs) ||
+            !value_of(src_file, binary->rhs, rhs) ||
+            !fold_binary(binary->op, lhs, rhs, result)) {
+            return nullptr;
+        }
+    } else if (node->kind == ASTNodeKind::UnaryOpExpr) {
+        auto *unary = static_cast<ASTUnaryOpExprNode *>(node);
+
+        Value operand;
+        if (!unary->expr || !value_of(src_file, unary->expr, operand) ||
+            !fold_unary(unary->op, operand, result)) {
+            return nullptr;
+        }
+    } else if (node->kind == ASTNodeKind::StringConcatExpr) {
+        // Adjacent literals are joined like '+', so they are kept as they are
+        // if one is an f-string, or if strings are mixed with bytes.
+        auto *concat = static_cast<ASTStringConcatExprNode *>(node);
+
+        for (size_t i = 0; i < concat->parts.size(); i++) {
+            Value part;
+            if (!value_of(src_file, concat->parts[i], part) ||
+                (i > 0 && part.kind != result.kind)) {
+                return nullptr;
+            }
+
+            if (i == 0) {
+                result = Value{part.kind};
+            }
+
+            if (result.text.size() + part.text.size() >
+                ConstantFolder::MAX_TEXT_SIZE) {
+                return nullptr;
+            }
+
+            result.text += part.text;
+        }
+    } else {
+        return nullptr;
+    }
+
+    switch (result.kind) {
+    case Value::Kind::Bool: {
+        return arena.allocate<ASTBoolLiteralNode>(!result.int_value.is_zero(),
+                                                  node->loc);
+    }
+    case Value::Kind::None: {
+        return arena.allocate<ASTNoneLiteralNode>(node->loc);
+    }
+    case Value::Kind::Int: {
+        auto &digits = result.int_value.get_digits();
+        return arena.allocate<ASTConstantExprNode>(
+            ConstantKind::Int, result.int_value.is_negative(),
+            arena.allocate_array(digits.data(), digits.size()), 0.0,
+            Utility::ArenaArray<char>{}, node->loc);
+    }
+    case Value::Kind::Float: {
+        return arena.allocate<ASTConstantExprNode>(
+            ConstantKind::Float, false, Utility::ArenaArray<uint32_t>{},
+            result.float_value, Utility::ArenaArray<char>{}, node->loc);
+    }
+    case Value::Kind::String:
+    case Value::Kind::Bytes: {
+        return arena.allocate<ASTConstantExprNode>(
+            result.kind == Value::Kind::String ? ConstantKind::String
+                                               : ConstantKind::Bytes,
+            false, Utility::ArenaArray<uint32_t>{}, 0.0,
+            arena.allocate_array(result.text.data(), result.text.size()),
+            node->loc);
+    }
+    }
+
+    return nullptr;
+}
+
+/*
+    The tree is walked in post-order through the slots that hold the nodes, so
+   the operands of an operator have been folded by the time that it is, and a
+   folded node replaces the original within its parent right away.
+*/
+auto ConstantFolder::fold(ASTNode *root) -> ASTNode * {
+    if (!root) {
+        return nullptr;
+    }
+
+    std::vector<std::pair<ASTNode **, bool>> stack{{&root, false}};
+
+    while (!stack.empty()) {
+        auto [slot, expanded] = stack.back();
+        stack.pop_back();
+
+        auto *node = *slot;
+
+        if (!expanded) {
+            stack.emplace_back(slot, true);
+
+            NodeMembers members;
+            describe_members(node, members);
+            for_each_child_slot(members, [&](ASTNode **child_slot) {
+                stack.emplace_back(child_slot, false);
+            });
+            continue;
+        }
+
+        if (auto *folded = fold_node(node)) {
+            *slot = folded;
+            num_folded++;
+        }
+    }
+
+    return root;
+}
+} // namespace tpy::Tree
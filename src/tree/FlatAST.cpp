@@ -0,0 +1,626 @@
+/*
+    This file implements the flat representation of the AST.
+*/
+
+#include "tpy/tree/FlatAST.h"
+
+#include "tpy/parse/Token.h"
+#include "tpy/tree/ASTExpr.h"
+#include "tpy/tree/ASTStmt.h"
+
+#include <cstring>
+
+namespace tpy::Tree {
+using NodeIndex = FlatAST::NodeIndex;
+
+// The root of a tree is not stored in the field of any other node.
+static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+/*
+    This object writes the fields of a single node into the shared array. The
+   elements of the lists are laid out after the last field, so that the fields
+   of every node of a kind take up the same number of slots. The children that
+   still have to be flattened are added to the pending list, along with the
+   slot that their index goes into.
+*/
+class FieldWriter {
+    // This is a list field whose elements have not been laid out yet.
+    struct PendingList {
+        uint32_t slot;
+        ASTNode *const *nodes;
+        const std::pair<ASTNode *, ASTNode *> *pairs;
+        size_t count;
+    };
+
+    std::vector<NodeIndex> &children;
+    std::vector<std::pair<ASTNode *, uint32_t>> &pending;
+    std::vector<PendingList> lists;
+
+  public:
+    FieldWriter(std::vector<NodeIndex> &children,
+                std::vector<std::pair<ASTNode *, uint32_t>> &pending)
+        : children{children}, pending{pending} {}
+
+    auto node(ASTNode *child) -> void {
+        if (child) {
+            pending.emplace_back(child, children.size());
+        }
+
+        children.push_back(FlatAST::NO_NODE);
+    }
+
+    auto list(const Utility::ArenaArray<ASTNode *> &elements) -> void {
+        lists.push_back(PendingList{static_cast<uint32_t>(children.size()),
+                                    elements.data(), nullptr, elements.size()});
+        children.push_back(0);
+    }
+
+    auto pairs(const Utility::ArenaArray<std::pair<ASTNode *, ASTNode *>>
+                   &entries) -> void {
+        lists.push_back(PendingList{static_cast<uint32_t>(children.size()),
+                                    nullptr, entries.data(), entries.size()});
+        children.push_back(0);
+    }
+
+    // This method lays out the elements of the lists.
+    auto finish() -> void {
+        for (auto &list : lists) {
+            children[list.slot] = children.size();
+
+            if (list.nodes) {
+                children.push_back(list.count);
+                for (size_t i = 0; i < list.count; i++) {
+                    node(list.nodes[i]);
+                }
+            } else {
+                children.push_back(list.count * 2);
+                for (size_t i = 0; i < list.count; i++) {
+                    node(list.pairs[i].first);
+                    node(list.pairs[i].second);
+                }
+            }
+        }
+    }
+};
+
+auto FlatAST::add_node(ASTNode *node,
+                       std::vector<std::pair<ASTNode *, uint32_t>> &pending)
+    -> NodeIndex {
+    auto index = static_cast<NodeIndex>(kinds.size());
+    auto kind = node->kind;
+
+    kinds.push_back(kind);
+    positions.push_back(node->loc.local_pos);
+    lens.push_back(node->loc.len);
+    fields.push_back(children.size());
+
+    uint32_t payload = 0;
+    FieldWriter writer{children, pending};
+
+    // The payload holds the scalar member of the few kinds that have one.
+    switch (kind) {
+    case ASTNodeKind::IntLiteral: {
+        payload = static_cast<ASTIntLiteralNode *>(node)->base;
+        break;
+    }
+    case ASTNodeKind::FStringLiteral: {
+        auto *fstring = static_cast<ASTFStringLiteralNode *>(node);
+        payload = fstring_segments.size();
+        fstring_segments.emplace_back(fstring->segment_begin,
+                                      fstring->segment_end);
+        break;
+    }
+    case ASTNodeKind::BoolLiteral: {
+        payload = static_cast<ASTBoolLiteralNode *>(node)->val;
+        break;
+    }
+    case ASTNodeKind::ConstantExpr: {
+        auto *constant = static_cast<ASTConstantExprNode *>(node);
+        payload = constants.size();
+        constants.push_back(static_cast<uint32_t>(constant->constant_kind) |
+                            static_cast<uint32_t>(constant->negative) << 8);
+
+        switch (constant->constant_kind) {
+        case ConstantKind::Int: {
+            constants.push_back(constant->digits.size());
+            constants.insert(constants.end(), constant->digits.begin(),
+                             constant->digits.end());
+            break;
+        }
+        case ConstantKind::Float: {
+            uint64_t bits;
+            memcpy(&bits, &constant->float_value, sizeof(bits));
+            constants.push_back(2);
+            constants.push_back(static_cast<uint32_t>(bits));
+            constants.push_back(static_cast<uint32_t>(bits >> 32));
+            break;
+        }
+        case ConstantKind::String:
+        case ConstantKind::Bytes: {
+            auto size = constant->text.size();
+            constants.push_back(size);
+            auto pos = constants.size();
+            constants.resize(pos + (size + 3) / 4, 0);
+            memcpy(constants.data() + pos, constant->text.data(), size);
+            break;
+        }
+        }
+        break;
+    }
+    case ASTNodeKind::StarredExpr: {
+        payload = static_cast<uint32_t>(
+            static_cast<ASTStarredExprNode *>(node)->op);
+        break;
+    }
+    case ASTNodeKind::BinaryOpExpr: {
+        payload = static_cast<uint32_t>(
+            static_cast<ASTBinaryOpExprNode *>(node)->op);
+        break;
+    }
+    case ASTNodeKind::UnaryOpExpr: {
+        payload =
+            static_cast<uint32_t>(static_cast<ASTUnaryOpExprNode *>(node)->op);
+        break;
+    }
+    case ASTNodeKind::YieldExpr: {
+        payload = static_cast<ASTYieldExprNode *>(node)->is_from;
+        break;
+    }
+    case ASTNodeKind::ComprehensionClause: {
+        payload = static_cast<ASTComprehensionClauseNode *>(node)->is_async;
+        break;
+    }
+    case ASTNodeKind::ComprehensionExpr: {
+        payload = static_cast<uint32_t>(
+            static_cast<ASTComprehensionExprNode *>(node)->bracket);
+        break;
+    }
+    case ASTNodeKind::AugAssignStmt: {
+        payload = static_cast<uint32_t>(
+            static_cast<ASTAugAssignStmtNode *>(node)->op);
+        break;
+    }
+    case ASTNodeKind::ImportFromStmt: {
+        payload = static_cast<ASTImportFromStmtNode *>(node)->level;
+        break;
+    }
+    case ASTNodeKind::ForStmt: {
+        payload = static_cast<ASTForStmtNode *>(node)->is_async;
+        break;
+    }
+    case ASTNodeKind::WithStmt: {
+        payload = static_cast<ASTWithStmtNode *>(node)->is_async;
+        break;
+    }
+    case ASTNodeKind::FunctionDef: {
+        payload = static_cast<ASTFunctionDefNode *>(node)->is_async;
+        break;
+    }
+    case ASTNodeKind::Param: {
+        payload = static_cast<uint32_t>(
+            static_cast<ASTParamNode *>(node)->param_kind);
+        break;
+    }
+    default: {
+        break;
+    }
+    }
+
+    // The fields of every kind come from the list of kinds.
+    switch (kind) {
+#define AST_CHILD(member) writer.node(typed->member);
+#define AST_CHILD_LIST(member) writer.list(typed->member);
+#define AST_CHILD_PAIRS(member) writer.pairs(typed->member);
+#define F(x, children)                                                         \
+    case ASTNodeKind::x: {                                                     \
+        [[maybe_unused]] auto *typed = static_cast<AST##x##Node *>(node);      \
+        children break;                                                        \
+    }
+        AST_NODE_LIST(F)
+#undef F
+#undef AST_CHILD_PAIRS
+#undef AST_CHILD_LIST
+#undef AST_CHILD
+    }
+
+    writer.finish();
+    payloads.push_back(payload);
+
+    return index;
+}
+
+/*
+    The nodes are numbered in the order that they are taken off the stack. The
+   children of a node are pushed in reverse, so that the first child is taken
+   off first, which numbers the tree in pre-order.
+*/
+auto FlatAST::from_tree(ASTNode *root) -> FlatAST {
+    FlatAST ast;
+    if (!root) {
+        return ast;
+    }
+
+    ast.absolute_offset = root->loc.absolute_pos - root->loc.local_pos;
+
+    std::vector<std::pair<ASTNode *, uint32_t>> stack{{root, NO_SLOT}};
+    std::vector<std::pair<ASTNode *, uint32_t>> pending;
+
+    while (!stack.empty()) {
+        auto [node, slot] = stack.back();
+        stack.pop_back();
+
+        auto index = ast.add_node(node, pending);
+        if (slot != NO_SLOT) {
+            ast.children[slot] = index;
+        }
+
+        stack.insert(stack.end(), pending.rbegin(), pending.rend());
+        pending.clear();
+    }
+
+    return ast;
+}
+
+/*
+    Since every child comes after its parent, the nodes are rebuilt from the
+   last one to the first, so the children of a node have always been rebuilt
+   by the time that it is.
+*/
+auto FlatASTView::to_tree(Utility::ArenaAllocator &arena) const -> ASTNode * {
+    if (num_nodes == 0) {
+        return nullptr;
+    }
+
+    std::vector<ASTNode *> nodes(num_nodes, nullptr);
+    std::vector<ASTNode *> scratch;
+    std::vector<std::pair<ASTNode *, ASTNode *>> pair_scratch;
+
+    auto node = [&](NodeIndex index, size_t field) -> ASTNode * {
+        auto child_index = child(index, field);
+        return child_index == NO_NODE ? nullptr : nodes[child_index];
+    };
+
+    auto name = [&](NodeIndex index, size_t field) {
+        return static_cast<ASTNameExprNode *>(node(index, field));
+    };
+
+    auto nodes_of = [&](NodeIndex index, size_t field) {
+        scratch.clear();
+        for (auto element : list(index, field)) {
+            scratch.push_back(element == NO_NODE ? nullptr : nodes[element]);
+        }
+
+        return arena.allocate_array(scratch.data(), scratch.size());
+    };
+
+    auto pairs_of = [&](NodeIndex index, size_t field) {
+        auto elements = list(index, field);
+        pair_scratch.clear();
+        for (size_t i = 0; i < elements.size(); i += 2) {
+            auto key = elements[i], value = elements[i + 1];
+            pair_scratch.emplace_back(key == NO_NODE ? nullptr : nodes[key],
+                                      value == NO_NODE ? nullptr
+                                                       : nodes[value]);
+        }
+
+        return arena.allocate_array(pair_scratch.data(), pair_scratch.size());
+    };
+
+    for (auto i = static_cast<NodeIndex>(num_nodes); i-- > 0;) {
+        auto span = loc(i);
+        auto op = static_cast<Parse::TokenKind>(payload(i));
+        ASTNode *result = nullptr;
+
+        switch (kind(i)) {
+        case ASTNodeKind::IntLiteral: {
+            result = arena.allocate<ASTIntLiteralNode>(
+                static_cast<int>(payload(i)), span);
+            break;
+        }
+        case ASTNodeKind::FloatLiteral: {
+            result = arena.allocate<ASTFloatLiteralNode>(span);
+            break;
+        }
+        case ASTNodeKind::StringLiteral: {
+            result = arena.allocate<ASTStringLiteralNode>(span);
+            break;
+        }
+        case ASTNodeKind::BytesLiteral: {
+            result = arena.allocate<ASTBytesLiteralNode>(span);
+            break;
+        }
+        case ASTNodeKind::FStringLiteral: {
+            auto [begin, end] = fstring_segment_range(i);
+            result = arena.allocate<ASTFStringLiteralNode>(begin, end, span);
+            break;
+        }
+        case ASTNodeKind::BoolLiteral: {
+            result = arena.allocate<ASTBoolLiteralNode>(payload(i) != 0, span);
+            break;
+        }
+        case ASTNodeKind::NoneLiteral: {
+            result = arena.allocate<ASTNoneLiteralNode>(span);
+            break;
+        }
+        case ASTNodeKind::EllipsisLiteral: {
+            result = arena.allocate<ASTEllipsisLiteralNode>(span);
+            break;
+        }
+        case ASTNodeKind::ConstantExpr: {
+            auto *words = constant_words(i);
+            auto constant_kind = static_cast<ConstantKind>(words[0] & 0xFF);
+            bool negative = (words[0] >> 8) & 1;
+            auto length = words[1];
+            Utility::ArenaArray<uint32_t> digits;
+            Utility::ArenaArray<char> text;
+            double float_value = 0;
+
+            switch (constant_kind) {
+            case ConstantKind::Int: {
+                digits = arena.allocate_array(words + 2, length);
+                break;
+            }
+            case ConstantKind::Float: {
+                auto bits = words[2] | static_cast<uint64_t>(words[3]) << 32;
+                memcpy(&float_value, &bits, sizeof(float_value));
+                break;
+            }
+            case ConstantKind::String:
+            case ConstantKind::Bytes: {
+                text = arena.allocate_array(
+                    reinterpret_cast<const char *>(words + 2), length);
+                break;
+            }
+            }
+
+            result = arena.allocate<ASTConstantExprNode>(
+                constant_kind, negative, digits, float_value, text, span);
+            break;
+        }
+        case ASTNodeKind::Error: {
+            result = arena.allocate<ASTErrorNode>(span);
+            break;
+        }
+        case ASTNodeKind::ParenExpr: {
+            result = arena.allocate<ASTParenExprNode>(node(i, 0), span);
+            break;
+        }
+        case ASTNodeKind::ListExpr: {
+            result = arena.allocate<ASTListExprNode>(nodes_of(i, 0), span);
+            break;
+        }
+        case ASTNodeKind::SetExpr: {
+            result = arena.allocate<ASTSetExprNode>(nodes_of(i, 0), span);
+            break;
+        }
+        case ASTNodeKind::DictExpr: {
+            result = arena.allocate<ASTDictExprNode>(pairs_of(i, 0), span);
+            break;
+        }
+        case ASTNodeKind::TupleExpr: {
+            result = arena.allocate<ASTTupleExprNode>(nodes_of(i, 0), span);
+            break;
+        }
+        case ASTNodeKind::NameExpr: {
+            result = arena.allocate<ASTNameExprNode>(span);
+            break;
+        }
+        case ASTNodeKind::AttrRefExpr: {
+            result = arena.allocate<ASTAttrRefExprNode>(node(i, 0), name(i, 1),
+                                                        span);
+            break;
+        }
+        case ASTNodeKind::KeywordArg: {
+            result =
+                arena.allocate<ASTKeywordArgNode>(name(i, 0), node(i, 1), span);
+            break;
+        }
+        case ASTNodeKind::StarredExpr: {
+            result = arena.allocate<ASTStarredExprNode>(node(i, 0), op, span);
+            break;
+        }
+        case ASTNodeKind::CallExpr: {
+            result = arena.allocate<ASTCallExprNode>(node(i, 0),
+                                                     nodes_of(i, 1), span);
+            break;
+        }
+        case ASTNodeKind::IndexSliceExpr: {
+            result = arena.allocate<ASTIndexSliceExprNode>(node(i, 0),
+                                                           node(i, 1), span);
+            break;
+        }
+        case ASTNodeKind::ProperSliceExpr: {
+            result = arena.allocate<ASTProperSliceExprNode>(
+                node(i, 0), node(i, 1), node(i, 2), node(i, 3), span);
+            break;
+        }
+        case ASTNodeKind::BinaryOpExpr: {
+            result = arena.allocate<ASTBinaryOpExprNode>(node(i, 0),
+                                                         node(i, 1), op, span);
+            break;
+        }
+        case ASTNodeKind::UnaryOpExpr: {
+            result = arena.allocate<ASTUnaryOpExprNode>(node(i, 0), op, span);
+            break;
+        }
+        case ASTNodeKind::TernaryOpExpr: {
+            result = arena.allocate<ASTTernaryOpExprNode>(
+                node(i, 0), node(i, 1), node(i, 2), span);
+            break;
+        }
+        case ASTNodeKind::StringConcatExpr: {
+            result =
+                arena.allocate<ASTStringConcatExprNode>(nodes_of(i, 0), span);
+            break;
+        }
+        case ASTNodeKind::AwaitExpr: {
+            result = arena.allocate<ASTAwaitExprNode>(node(i, 0), span);
+            break;
+        }
+        case ASTNodeKind::YieldExpr: {
+            result = arena.allocate<ASTYieldExprNode>(node(i, 0),
+                                                      payload(i) != 0, span);
+            break;
+        }
+        case ASTNodeKind::LambdaExpr: {
+            result = arena.allocate<ASTLambdaExprNode>(nodes_of(i, 0),
+                                                       node(i, 1), span);
+            break;
+        }
+        case ASTNodeKind::ComprehensionClause: {
+            result = arena.allocate<ASTComprehensionClauseNode>(
+                payload(i) != 0, node(i, 0), node(i, 1), nodes_of(i, 2), span);
+            break;
+        }
+        case ASTNodeKind::ComprehensionExpr: {
+            result = arena.allocate<ASTComprehensionExprNode>(
+                op, node(i, 0), node(i, 1), nodes_of(i, 2), span);
+            break;
+        }
+        case ASTNodeKind::Module: {
+            result = arena.allocate<ASTModuleNode>(nodes_of(i, 0), span);
+            break;
+        }
+        case ASTNodeKind::ExprStmt: {
+            result = arena.allocate<ASTExprStmtNode>(node(i, 0), span);
+            break;
+        }
+        case ASTNodeKind::AssignStmt: {
+            result = arena.allocate<ASTAssignStmtNode>(nodes_of(i, 0),
+                                                       node(i, 1), span);
+            break;
+        }
+        case ASTNodeKind::AugAssignStmt: {
+            result = arena.allocate<ASTAugAssignStmtNode>(node(i, 0), op,
+                                                          node(i, 1), span);
+            break;
+        }
+        case ASTNodeKind::AnnAssignStmt: {
+            result = arena.allocate<ASTAnnAssignStmtNode>(
+                node(i, 0), node(i, 1), node(i, 2), span);
+            break;
+        }
+        case ASTNodeKind::PassStmt: {
+            result = arena.allocate<ASTPassStmtNode>(span);
+            break;
+        }
+        case ASTNodeKind::BreakStmt: {
+            result = arena.allocate<ASTBreakStmtNode>(span);
+            break;
+        }
+        case ASTNodeKind::ContinueStmt: {
+            result = arena.allocate<ASTContinueStmtNode>(span);
+            break;
+        }
+        case ASTNodeKind::ReturnStmt: {
+            result = arena.allocate<ASTReturnStmtNode>(node(i, 0), span);
+            break;
+        }
+        case ASTNodeKind::DelStmt: {
+            result = arena.allocate<ASTDelStmtNode>(nodes_of(i, 0), span);
+            break;
+        }
+        case ASTNodeKind::GlobalStmt: {
+            result = arena.allocate<ASTGlobalStmtNode>(nodes_of(i, 0), span);
+            break;
+        }
+        case ASTNodeKind::NonlocalStmt: {
+            result = arena.allocate<ASTNonlocalStmtNode>(nodes_of(i, 0), span);
+            break;
+        }
+        case ASTNodeKind::AssertStmt: {
+            result =
+                arena.allocate<ASTAssertStmtNode>(node(i, 0), node(i, 1), span);
+            break;
+        }
+        case ASTNodeKind::RaiseStmt: {
+            result =
+                arena.allocate<ASTRaiseStmtNode>(node(i, 0), node(i, 1), span);
+            break;
+        }
+        case ASTNodeKind::ImportAlias: {
+            result = arena.allocate<ASTImportAliasNode>(node(i, 0), node(i, 1),
+                                                        span);
+            break;
+        }
+        case ASTNodeKind::ImportStmt: {
+            result = arena.allocate<ASTImportStmtNode>(nodes_of(i, 0), span);
+            break;
+        }
+        case ASTNodeKind::ImportFromStmt: {
+            result = arena.allocate<ASTImportFromStmtNode>(
+                payload(i), node(i, 0), nodes_of(i, 1), span);
+            break;
+        }
+        case ASTNodeKind::IfStmt: {
+            result = arena.allocate<ASTIfStmtNode>(node(i, 0), nodes_of(i, 1),
+                                                   nodes_of(i, 2), span);
+            break;
+        }
+        case ASTNodeKind::WhileStmt: {
+            result = arena.allocate<ASTWhileStmtNode>(
+                node(i, 0), nodes_of(i, 1), nodes_of(i, 2), span);
+            break;
+        }
+        case ASTNodeKind::ForStmt: {
+            result = arena.allocate<ASTForStmtNode>(
+                payload(i) != 0, node(i, 0), node(i, 1), nodes_of(i, 2),
+                nodes_of(i, 3), span);
+            break;
+        }
+        case ASTNodeKind::ExceptHandler: {
+            result = arena.allocate<ASTExceptHandlerNode>(
+                node(i, 0), node(i, 1), nodes_of(i, 2), span);
+            break;
+        }
+        case ASTNodeKind::TryStmt: {
+            result = arena.allocate<ASTTryStmtNode>(
+                nodes_of(i, 0), nodes_of(i, 1), nodes_of(i, 2), nodes_of(i, 3),
+                span);
+            break;
+        }
+        case ASTNodeKind::WithItem: {
+            result =
+                arena.allocate<ASTWithItemNode>(node(i, 0), node(i, 1), span);
+            break;
+        }
+        case ASTNodeKind::WithStmt: {
+            result = arena.allocate<ASTWithStmtNode>(
+                payload(i) != 0, nodes_of(i, 0), nodes_of(i, 1), span);
+            break;
+        }
+        case ASTNodeKind::Param: {
+            result = arena.allocate<ASTParamNode>(
+                static_cast<ParamKind>(payload(i)), node(i, 0), node(i, 1),
+                node(i, 2), span);
+            break;
+        }
+        case ASTNodeKind::FunctionDef: {
+            result = arena.allocate<ASTFunctionDefNode>(
+                payload(i) != 0, nodes_of(i, 0), node(i, 1), nodes_of(i, 2),
+                node(i, 3), nodes_of(i, 4), span);
+            break;
+        }
+        case ASTNodeKind::ClassDef: {
+            result = arena.allocate<ASTClassDefNode>(
+                nodes_of(i, 0), node(i, 1), nodes_of(i, 2), nodes_of(i, 3),
+                span);
+            break;
+        }
+        }
+
+        nodes[i] = result;
+    }
+
+    return nodes[0];
+}
+
+auto FlatAST::memory_size() const -> size_t {
+    return kinds.size() * sizeof(ASTNodeKind) +
+           (positions.size() + lens.size() + payloads.size() + fields.size()) *
+               sizeof(uint32_t) +
+           children.size() * sizeof(NodeIndex) +
+           fstring_segments.size() * sizeof(fstring_segments[0]) +
+           constants.size() * sizeof(uint32_t);
+}
+} // namespace tpy::Tree
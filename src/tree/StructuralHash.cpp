@@ -0,0 +1,447 @@
+/*
+    This file implements the structural hash of the AST and the hash-consing of
+   identical subtrees.
+*/
+
+#include "tpy/tree/StructuralHash.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+
+#include "tpy/tree/ASTMembers.h"
+#include "tpy/tree/ASTVisitor.h"
+#include "tpy/utility/ArenaResource.h"
+
+namespace tpy::Tree {
+// This is what a missing child adds to the hash, so that a missing child and
+// a present one in another field give different hashes.
+static constexpr uint64_t NO_CHILD_HASH = 0x9e3779b97f4a7c15;
+
+// These are the sizes of the node classes, indexed by their kind.
+static constexpr size_t NODE_SIZES[] = {
+#define F(x, children) sizeof(AST##x##Node),
+    AST_NODE_LIST(F)
+#undef F
+};
+
+// This function adds a value to a hash. It is the multiply-and-rotate step of
+// the hash that Firefox and rustc use for small keys.
+static auto mix(uint64_t hash, uint64_t value) -> uint64_t {
+    return (((hash << 5) | (hash >> 59)) ^ value) * 0x517cc1b727220a95;
+}
+
+// This function hashes a string with 64-bit FNV-1a.
+static auto hash_text(std::string_view text) -> uint64_t {
+    uint64_t hash = 0xcbf29ce484222325;
+
+    for (auto c : text) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3;
+    }
+
+    return hash;
+}
+
+// This function returns the number of bytes that the node and its lists take
+// up within the arena.
+static auto node_bytes(ASTNode *node, const NodeMembers &members) -> size_t {
+    auto bytes = NODE_SIZES[static_cast<size_t>(node->kind)];
+
+    for (size_t i = 0; i < members.num_children; i++) {
+        auto &child = members.children[i];
+        if (child.list) {
+            bytes += child.list->size() * sizeof(ASTNode *);
+        } else if (child.pairs) {
+            bytes += child.pairs->size() * sizeof(child.pairs->data()[0]);
+        }
+    }
+
+    if (node->kind == ASTNodeKind::ConstantExpr) {
+        auto *constant = static_cast<ASTConstantExprNode *>(node);
+        bytes += constant->digits.size() * sizeof(uint32_t) +
+                 constant->text.size();
+    }
+
+    return bytes;
+}
+
+auto StructuralHasher::text_of(ASTNode *node) const -> std::string_view {
+    switch (node->kind) {
+    case ASTNodeKind::IntLiteral:
+    case ASTNodeKind::FloatLiteral:
+    case ASTNodeKind::StringLiteral:
+    case ASTNodeKind::BytesLiteral:
+    case ASTNodeKind::FStringLiteral:
+    case ASTNodeKind::NameExpr: {
+        return std::string_view(src_file->start() + node->loc.local_pos,
+                                node->loc.len);
+    }
+    default: {
+        return std::string_view();
+    }
+    }
+}
+
+/*
+    The nodes are hashed in post-order, so the children of a node have always
+   been hashed by the time that it is.
+*/
+auto StructuralHasher::hash_tree(ASTNode *root) -> uint32_t {
+    if (!root) {
+        return 0;
+    }
+
+    std::vector<std::pair<ASTNode *, bool>> stack{{root, false}};
+
+    while (!stack.empty()) {
+        auto [node, expanded] = stack.back();
+        stack.pop_back();
+
+        if (expanded) {
+            hash_node(node);
+            continue;
+        }
+
+        stack.emplace_back(node, true);
+        for_each_child(node, [&](ASTNode *child) {
+            stack.emplace_back(child, false);
+        });
+    }
+
+    return root->hash;
+}
+
+auto StructuralHasher::hash_node(ASTNode *node) -> uint32_t {
+    NodeMembers members;
+    describe_members(node, members);
+
+    uint64_t hash = mix(0, static_cast<uint64_t>(node->kind));
+
+    // The segments of an f-string depend on where it is within the file, and
+    // its text already says everything about it.
+    if (node->kind != ASTNodeKind::FStringLiteral) {
+        for (size_t i = 0; i < members.num_scalars; i++) {
+            auto &scalar = members.scalars[i];
+            switch (scalar.kind) {
+            case NodeMembers::Scalar::Kind::Name: {
+                hash = mix(hash, hash_text(scalar.name));
+                break;
+            }
+            case NodeMembers::Scalar::Kind::Text: {
+                hash = mix(hash, hash_text(members.text_value));
+                break;
+            }
+            default: {
+                hash = mix(hash, scalar.number);
+                break;
+            }
+            }
+        }
+    }
+
+    auto text = text_of(node);
+    if (!text.empty()) {
+        hash = mix(hash, hash_text(text));
+    }
+
+    auto child_hash = [](ASTNode *child) {
+        return child ? child->hash : NO_CHILD_HASH;
+    };
+
+    for (size_t i = 0; i < members.num_children; i++) {
+        auto &child = members.children[i];
+
+        switch (child.kind) {
+        case NodeMembers::Child::Kind::Node: {
+            hash = mix(hash, child_hash(*child.slot));
+            break;
+        }
+        case NodeMembers::Child::Kind::List: {
+            hash = mix(hash, child.list->size());
+            for (auto *element : *child.list) {
+                hash = mix(hash, child_hash(element));
+            }
+            break;
+        }
+        case NodeMembers::Child::Kind::Pairs: {
+            hash = mix(hash, child.pairs->size());
+            for (auto &[key, value] : *child.pairs) {
+                hash = mix(mix(hash, child_hash(key)), child_hash(value));
+            }
+            break;
+        }
+        }
+    }
+
+    node->hash = static_cast<uint32_t>(hash ^ (hash >> 32));
+    return node->hash;
+}
+
+auto StructuralHasher::same_node(ASTNode *lhs, ASTNode *rhs) const -> bool {
+    if (lhs->kind != rhs->kind || lhs->hash != rhs->hash ||
+        text_of(lhs) != text_of(rhs)) {
+        return false;
+    }
+
+    NodeMembers lhs_members, rhs_members;
+    describe_members(lhs, lhs_members);
+    describe_members(rhs, rhs_members);
+
+    if (lhs_members.text_value != rhs_members.text_value) {
+        return false;
+    }
+
+    if (lhs->kind != ASTNodeKind::FStringLiteral) {
+        for (size_t i = 0; i < lhs_members.num_scalars; i++) {
+            auto &lhs_scalar = lhs_members.scalars[i];
+            auto &rhs_scalar = rhs_members.scalars[i];
+
+            if (lhs_scalar.number != rhs_scalar.number ||
+                strcmp(lhs_scalar.name, rhs_scalar.name) != 0) {
+                return false;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < lhs_members.num_children; i++) {
+        auto &lhs_child = lhs_members.children[i];
+        auto &rhs_child = rhs_members.children[i];
+
+        switch (lhs_child.kind) {
+        case NodeMembers::Child::Kind::Node: {
+            if (*lhs_child.slot != *rhs_child.slot) {
+                return false;
+            }
+            break;
+        }
+        case NodeMembers::Child::Kind::List: {
+            auto &lhs_list = *lhs_child.list;
+            auto &rhs_list = *rhs_child.list;
+            if (lhs_list.size() != rhs_list.size() ||
+                !std::equal(lhs_list.begin(), lhs_list.end(),
+                            rhs_list.begin())) {
+                return false;
+            }
+            break;
+        }
+        case NodeMembers::Child::Kind::Pairs: {
+            auto &lhs_pairs = *lhs_child.pairs;
+            auto &rhs_pairs = *rhs_child.pairs;
+            if (lhs_pairs.size() != rhs_pairs.size() ||
+                !std::equal(lhs_pairs.begin(), lhs_pairs.end(),
+                            rhs_pairs.begin())) {
+                return false;
+            }
+            break;
+        }
+        }
+    }
+
+    return true;
+}
+
+auto HashConser::grow() -> void {
+    std::vector<ASTNode *> old_table(table.size() * 2, nullptr);
+    std::swap(table, old_table);
+
+    auto mask = table.size() - 1;
+    for (auto *node : old_table) {
+        if (node) {
+            auto index = node->hash & mask;
+            while (table[index]) {
+                index = (index + 1) & mask;
+            }
+            table[index] = node;
+        }
+    }
+}
+
+auto HashConser::find_or_insert(ASTNode *node) -> ASTNode * {
+    auto mask = table.size() - 1;
+    auto index = node->hash & mask;
+
+    while (auto *entry = table[index]) {
+        if (entry == node || hasher.same_node(entry, node)) {
+            return entry;
+        }
+        index = (index + 1) & mask;
+    }
+
+    table[index] = node;
+
+    // The table is kept at most half full, so that the probes stay short.
+    if (++num_distinct * 2 > table.size()) {
+        grow();
+    }
+
+    return node;
+}
+
+/*
+    The tree is walked in post-order through the slots that hold the nodes, so
+   that a node that has been replaced is replaced within its parent right
+   away. By the time that a node is hashed and looked up, each of its children
+   has therefore been replaced by the first of its identical subtrees, and two
+   nodes are identical exactly when their own members and the addresses of
+   their children are the same. Replacing a child by an identical one does not
+   change the hash of its parent, so a tree that has already been hashed keeps
+   its hashes.
+*/
+auto HashConser::intern(ASTNode *root, bool is_hashed) -> ASTNode * {
+    if (!root) {
+        return nullptr;
+    }
+
+    std::vector<std::pair<ASTNode **, bool>> stack{{&root, false}};
+
+    while (!stack.empty()) {
+        auto [slot, expanded] = stack.back();
+        stack.pop_back();
+
+        auto *node = *slot;
+
+        NodeMembers members;
+        describe_members(node, members);
+
+        if (!expanded) {
+            stack.emplace_back(slot, true);
+            for_each_child_slot(members, [&](ASTNode **child_slot) {
+                stack.emplace_back(child_slot, false);
+            });
+            continue;
+        }
+
+        if (!is_hashed) {
+            hasher.hash_node(node);
+        }
+
+        auto bytes = node_bytes(node, members);
+        num_nodes++;
+        bytes_total += bytes;
+
+        if (node->kind == ASTNodeKind::Error) {
+            continue;
+        }
+
+        auto *canonical = find_or_insert(node);
+        if (canonical != node) {
+            *slot = canonical;
+            num_shared++;
+            bytes_shared += bytes;
+        }
+    }
+
+    return root;
+}
+
+auto HashConser::print_report(FILE *file) const -> void {
+    fprintf(file, "nodes:    %zu (%zu shared, %.1f%%)\n", num_nodes, num_shared,
+            dedup_ratio() * 100);
+    fprintf(file, "bytes:    %zu (%zu shared, %.1f%%)\n", bytes_total,
+            bytes_shared,
+            bytes_total == 0 ? 0.0 : bytes_shared * 100.0 / bytes_total);
+}
+
+// This function copies the node itself into the arena. Its children and its
+// lists still belong to the original.
+static auto copy_node(ASTNode *node, Utility::ArenaAllocator &arena)
+    -> ASTNode * {
+    switch (node->kind) {
+#define F(x, children)                                                         \
+    case ASTNodeKind::x:                                                       \
+        return arena.allocate<AST##x##Node>(*static_cast<AST##x##Node *>(node));
+        AST_NODE_LIST(F)
+#undef F
+    }
+
+    return nullptr;
+}
+
+/*
+    The nodes are copied in post-order, so the copies of the children of a node
+   already exist by the time that it is copied. The copies are remembered by
+   the address of the original, so a shared subtree is copied only once.
+*/
+auto copy_tree(ASTNode *root, Utility::ArenaAllocator &arena) -> ASTNode * {
+    if (!root) {
+        return nullptr;
+    }
+
+    // The bookkeeping only lives until the copy is done, so it is kept on the
+    // stack while it fits, rather than in the arena of the copy.
+    Utility::ScratchResource<16384> scratch_memory;
+
+    std::pmr::unordered_map<ASTNode *, ASTNode *> copies{&scratch_memory};
+    std::pmr::vector<std::pair<ASTNode *, bool>> stack{&scratch_memory};
+    std::pmr::vector<ASTNode *> scratch{&scratch_memory};
+    std::pmr::vector<std::pair<ASTNode *, ASTNode *>> pair_scratch{
+        &scratch_memory};
+
+    stack.emplace_back(root, false);
+
+    auto copy_of = [&](ASTNode *node) {
+        return node ? copies.at(node) : nullptr;
+    };
+
+    while (!stack.empty()) {
+        auto [node, expanded] = stack.back();
+        stack.pop_back();
+
+        if (copies.count(node)) {
+            continue;
+        }
+
+        if (!expanded) {
+            stack.emplace_back(node, true);
+            for_each_child(node, [&](ASTNode *child) {
+                if (!copies.count(child)) {
+                    stack.emplace_back(child, false);
+                }
+            });
+            continue;
+        }
+
+        auto *copy = copy_node(node, arena);
+
+        // The value of a constant lives within the arena as well.
+        if (copy->kind == ASTNodeKind::ConstantExpr) {
+            auto *constant = static_cast<ASTConstantExprNode *>(copy);
+            constant->digits = arena.allocate_array(constant->digits.data(),
+                                                    constant->digits.size());
+            constant->text = arena.allocate_array(constant->text.data(),
+                                                  constant->text.size());
+        }
+
+        NodeMembers members;
+        describe_members(copy, members);
+
+        for (size_t i = 0; i < members.num_children; i++) {
+            auto &child = members.children[i];
+
+            if (child.slot) {
+                *child.slot = copy_of(*child.slot);
+            } else if (child.list) {
+                scratch.clear();
+                for (auto *element : *child.list) {
+                    scratch.push_back(copy_of(element));
+                }
+                *child.list = arena.allocate_array(scratch.data(),
+                                                   scratch.size());
+            } else {
+                pair_scratch.clear();
+                for (auto &[key, value] : *child.pairs) {
+                    pair_scratch.emplace_back(copy_of(key), copy_of(value));
+                }
+                *child.pairs = arena.allocate_array(pair_scratch.data(),
+                                                    pair_scratch.size());
+            }
+        }
+
+        copies.emplace(node, copy);
+    }
+
+    return copies.at(root);
+}
+} // namespace tpy::Tree
@@ -3,19 +3,302 @@
 */
 #include "tpy/utility/ArenaAllocator.h"
 
+#include <algorithm>
+#include <vector>
+
+#include "tpy/utility/HugePages.h"
+
 namespace tpy::Utility {
 /*
-    This method will add a new slab of memory to the list held by the arena
-   allocator.
+    This method will allocate a new slab of memory for the arena allocator. The
+   slab is not linked in yet, as the caller decides where it goes.
 */
-auto ArenaAllocator::create_new_slab() -> void {
-    // First, we need to allocate a new slab.
-    auto new_slab = std::make_unique<std::byte[]>(slab_size);
+auto ArenaAllocator::create_new_slab(size_t size) -> Slab * {
+    void *memory = nullptr;
+    bool huge = false;
+
+    // A slab of huge pages is as large as the pages that it takes up, so the
+    // rest of the last page is not lost. If there are none, the slab comes
+    // from regular memory instead.
+    if (pages == SlabPages::Huge && (memory = map_huge_pages(size))) {
+        size = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+        huge = true;
+    }
+
+    if (!memory && pool) {
+        memory = pool->acquire(size);
+    }
+    if (!memory) {
+        memory = ::operator new(size);
+    }
+
+    auto *slab = static_cast<Slab *>(memory);
+    slab->next = nullptr;
+    slab->size = size;
+    slab->huge = huge;
+
+    num_slabs++;
+    total_capacity += size;
+
+#ifdef TPY_ARENA_STATS
+    stats.peak_capacity = std::max(stats.peak_capacity, total_capacity);
+#endif
+
+    return slab;
+}
+
+auto ArenaAllocator::free_slab(Slab *slab) -> void {
+    num_slabs--;
+    total_capacity -= slab->size;
+
+    if (slab->huge) {
+        unmap_huge_pages(slab, slab->size);
+    } else if (!pool || !pool->release(slab, slab->size)) {
+        ::operator delete(slab);
+    }
+}
+
+auto ArenaAllocator::free_slabs(Slab *&list, Slab *until) -> void {
+    while (list && list != until) {
+        auto *next = list->next;
+        free_slab(list);
+        list = next;
+    }
+}
+
+auto ArenaAllocator::allocate_slow(size_t size, size_t align) -> void * {
+    // The worst case of rounding up wastes all but one byte of the alignment.
+    auto needed = size + (align > alignof(std::max_align_t) ? align - 1 : 0);
+
+    // A large allocation gets a slab of its own, which does not replace the
+    // current one. The current slab therefore stays in use. Everything else
+    // fits into the rest of a new regular slab after its header.
+    if (SLAB_HEADER_SIZE + needed > slab_size / 2) {
+        auto *slab = create_new_slab(SLAB_HEADER_SIZE + needed);
+        if (!large_slabs) {
+            oldest_large_slab = slab;
+        }
+        slab->next = large_slabs;
+        large_slabs = slab;
+
+        auto start = reinterpret_cast<uintptr_t>(slab) + SLAB_HEADER_SIZE;
+        auto pos = (start + align - 1) & ~static_cast<uintptr_t>(align - 1);
+
+#ifdef TPY_ARENA_STATS
+        stats.requested_bytes += size;
+        stats.padding_bytes += pos - start;
+        stats.tail_bytes += slab->size - (pos - start) - size -
+                            SLAB_HEADER_SIZE;
+#endif
+
+        return reinterpret_cast<void *>(pos);
+    }
+
+    // Otherwise, a new regular slab replaces the current one. A spare slab is
+    // used if it is large enough, and a new slab makes the ones after it
+    // larger.
+    Slab *slab;
+    if (spare_slabs && SLAB_HEADER_SIZE + needed <= spare_slabs->size / 2) {
+        slab = spare_slabs;
+        spare_slabs = slab->next;
+    } else {
+        slab = create_new_slab(slab_size);
+
+        if (slab_size < GET_MAX_SLAB_SIZE()) {
+            slab_size = std::min(slab_size * 2, GET_MAX_SLAB_SIZE());
+        }
+    }
+
+    if (!slabs) {
+        oldest_slab = slab;
+    }
+    slab->next = slabs;
+    slabs = slab;
+
+#ifdef TPY_ARENA_STATS
+    // The rest of the slab that was current is never allocated from again.
+    if (current_pos) {
+        stats.tail_bytes += end_of_current_slab - current_pos;
+    }
+#endif
+
+    current_pos = reinterpret_cast<std::byte *>(slab) + SLAB_HEADER_SIZE;
+    end_of_current_slab = reinterpret_cast<std::byte *>(slab) + slab->size;
+
+    return allocate_bytes(size, align);
+}
+
+auto ArenaAllocator::run_destructors(DestructorRecord *until) -> void {
+    // The list is unlinked before every call, so that a destructor that
+    // allocates from the arena does not see its own record.
+    while (destructors && destructors != until) {
+        auto *record = destructors;
+        destructors = record->next;
+        record->destroy(record->object);
+    }
+
+    if (!destructors) {
+        oldest_destructor = nullptr;
+    }
+}
+
+auto ArenaAllocator::release_to(const Mark &mark) -> void {
+    run_destructors(mark.destructor);
+
+    // A free block may lie in memory that is freed now, and it cannot be told
+    // apart from the others cheaply, so every list is dropped.
+    free_blocks = {};
+
+    free_slabs(slabs, mark.slab);
+    free_slabs(large_slabs, mark.large_slab);
+
+    if (!slabs) {
+        oldest_slab = nullptr;
+    }
+    if (!large_slabs) {
+        oldest_large_slab = nullptr;
+    }
+
+    current_pos = mark.pos;
+    end_of_current_slab =
+        slabs ? reinterpret_cast<std::byte *>(slabs) + slabs->size : nullptr;
+}
+
+auto ArenaAllocator::reset(size_t keep_slabs) -> void {
+    run_destructors(nullptr);
+
+    free_blocks = {};
+    free_slabs(large_slabs, nullptr);
+
+    // The regular slabs and the spare ones are sorted by size, so that the
+    // largest ones are kept.
+    std::vector<Slab *> all;
+    for (auto *list : {slabs, spare_slabs}) {
+        for (auto *slab = list; slab; slab = slab->next) {
+            all.push_back(slab);
+        }
+    }
+
+    std::sort(all.begin(), all.end(),
+              [](Slab *lhs, Slab *rhs) { return lhs->size > rhs->size; });
+
+    slabs = spare_slabs = nullptr;
+    oldest_slab = oldest_large_slab = nullptr;
+    current_pos = end_of_current_slab = nullptr;
+
+    // The spare slabs are used in the order of the list, so the largest one
+    // is used first.
+    for (auto i = all.size(); i-- > 0;) {
+        if (i < keep_slabs) {
+            all[i]->next = spare_slabs;
+            spare_slabs = all[i];
+        } else {
+            free_slab(all[i]);
+        }
+    }
+}
+
+auto ArenaAllocator::release_slabs() -> void {
+    run_destructors(nullptr);
+
+    free_slabs(slabs, nullptr);
+    free_slabs(large_slabs, nullptr);
+    free_slabs(spare_slabs, nullptr);
+
+    oldest_slab = oldest_large_slab = nullptr;
+    current_pos = end_of_current_slab = nullptr;
+}
+
+auto ArenaAllocator::splice(ArenaAllocator &&other) -> void {
+    if (this == &other) {
+        return;
+    }
+
+    // The spare slabs of the other arena hold nothing, so they are given back
+    // rather than kept.
+    other.free_slabs(other.spare_slabs, nullptr);
+
+    // Both kinds of slabs of the other arena are placed in front of the
+    // dedicated slabs, as nothing more is allocated from them either.
+    auto link = [&](Slab *head, Slab *tail) {
+        if (!head) {
+            return;
+        }
+        if (!large_slabs) {
+            oldest_large_slab = tail;
+        }
+        tail->next = large_slabs;
+        large_slabs = head;
+    };
+
+    link(other.large_slabs, other.oldest_large_slab);
+    link(other.slabs, other.oldest_slab);
+
+    // The objects of the other arena are newer than any object of this one,
+    // so they are destroyed first.
+    if (other.destructors) {
+        if (!destructors) {
+            oldest_destructor = other.oldest_destructor;
+        }
+        other.oldest_destructor->next = destructors;
+        destructors = other.destructors;
+    }
+
+    num_slabs += std::exchange(other.num_slabs, 0);
+    total_capacity += std::exchange(other.total_capacity, 0);
+
+#ifdef TPY_ARENA_STATS
+    stats.merge(std::exchange(other.stats, {}));
+    stats.peak_capacity = std::max(stats.peak_capacity, total_capacity);
+#endif
+
+    other.slabs = other.large_slabs = nullptr;
+    other.oldest_slab = other.oldest_large_slab = nullptr;
+    other.destructors = other.oldest_destructor = nullptr;
+    other.current_pos = other.end_of_current_slab = nullptr;
+
+    // The free blocks of the other arena are left behind, as the lists cannot
+    // be joined without walking them.
+    other.free_blocks = {};
+}
+
+auto ArenaAllocator::operator=(ArenaAllocator &&other) noexcept
+    -> ArenaAllocator & {
+    if (this != &other) {
+        release_slabs();
+
+        slabs = std::exchange(other.slabs, nullptr);
+        large_slabs = std::exchange(other.large_slabs, nullptr);
+        spare_slabs = std::exchange(other.spare_slabs, nullptr);
+        destructors = std::exchange(other.destructors, nullptr);
+        oldest_slab = std::exchange(other.oldest_slab, nullptr);
+        oldest_large_slab = std::exchange(other.oldest_large_slab, nullptr);
+        oldest_destructor = std::exchange(other.oldest_destructor, nullptr);
+        pool = other.pool;
+        pages = other.pages;
+        current_pos = std::exchange(other.current_pos, nullptr);
+        end_of_current_slab = std::exchange(other.end_of_current_slab, nullptr);
+        slab_size = other.slab_size;
+        num_slabs = std::exchange(other.num_slabs, 0);
+        total_capacity = std::exchange(other.total_capacity, 0);
+        free_blocks = std::exchange(other.free_blocks, {});
+#ifdef TPY_ARENA_STATS
+        stats = std::exchange(other.stats, {});
+#endif
+    }
+
+    return *this;
+}
 
-    // Now, set the start and end pointers and insert the slab.
-    current_pos = new_slab.get();
-    end_of_current_slab = current_pos + slab_size;
+auto ArenaAllocator::print_stats(FILE *file) const -> void {
+    fprintf(file, "slabs:     %zu\n", num_slabs);
+    fprintf(file, "capacity:  %zu bytes\n", total_capacity);
 
-    slabs.push_front(std::move(new_slab));
+#ifdef TPY_ARENA_STATS
+    stats.print_report(file);
+#else
+    fprintf(file, "tpy was built without TPY_ARENA_STATS, so nothing else is "
+                  "counted.\n");
+#endif
 }
-} // namespace tpy::Utility
\ No newline at end of file
+} // namespace tpy::Utility
@@ -0,0 +1,20 @@
+/*
+    This file implements the memory resource that allocates from an arena.
+*/
+#include "tpy/utility/ArenaResource.h"
+
+namespace tpy::Utility {
+auto ArenaResource::do_allocate(size_t bytes, size_t alignment) -> void * {
+    return arena.allocate_bytes(bytes, alignment);
+}
+
+auto ArenaResource::do_deallocate(void *, size_t, size_t) -> void {}
+
+// Two resources are equal if memory from one can be given back to the other,
+// which holds for any two resources of the same arena.
+auto ArenaResource::do_is_equal(
+    const std::pmr::memory_resource &other) const noexcept -> bool {
+    auto *arena_resource = dynamic_cast<const ArenaResource *>(&other);
+    return arena_resource && &arena_resource->arena == &arena;
+}
+} // namespace tpy::Utility
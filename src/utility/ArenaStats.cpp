@@ -0,0 +1,71 @@
+/*
+    This file implements the statistics of an arena allocator.
+*/
+#include "tpy/utility/ArenaStats.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+
+namespace tpy::Utility {
+// This function returns the readable name of a type, where the compiler
+// offers a way to demangle it.
+static auto type_name(const std::type_index &type) -> std::string {
+#ifdef __GNUG__
+    int status = 0;
+    if (auto *name = abi::__cxa_demangle(type.name(), nullptr, nullptr,
+                                         &status)) {
+        std::string result = name;
+        free(name);
+        return result;
+    }
+#endif
+    return type.name();
+}
+
+auto ArenaStats::merge(const ArenaStats &other) -> void {
+    requested_bytes += other.requested_bytes;
+    padding_bytes += other.padding_bytes;
+    tail_bytes += other.tail_bytes;
+    freed_bytes += other.freed_bytes;
+    reused_bytes += other.reused_bytes;
+
+    for (auto &[type, entry] : other.types) {
+        auto &merged = types[type];
+        merged.count += entry.count;
+        merged.bytes += entry.bytes;
+    }
+}
+
+auto ArenaStats::print_report(FILE *file) const -> void {
+    fprintf(file, "requested: %zu bytes\n", requested_bytes);
+    fprintf(file, "padding:   %zu bytes\n", padding_bytes);
+    fprintf(file, "tails:     %zu bytes\n", tail_bytes);
+    fprintf(file, "freed:     %zu bytes\n", freed_bytes);
+    fprintf(file, "reused:    %zu bytes\n", reused_bytes);
+    fprintf(file, "peak:      %zu bytes\n", peak_capacity);
+
+    std::vector<std::pair<std::string, TypeStats>> rows;
+    for (auto &[type, entry] : types) {
+        rows.emplace_back(type_name(type), entry);
+    }
+
+    std::sort(rows.begin(), rows.end(), [](auto &lhs, auto &rhs) {
+        return lhs.second.bytes != rhs.second.bytes
+                   ? lhs.second.bytes > rhs.second.bytes
+                   : lhs.first < rhs.first;
+    });
+
+    fprintf(file, "%-40s %10s %12s\n", "type", "count", "bytes");
+    for (auto &[name, entry] : rows) {
+        fprintf(file, "%-40s %10zu %12zu\n", name.c_str(), entry.count,
+                entry.bytes);
+    }
+}
+} // namespace tpy::Utility
@@ -0,0 +1,57 @@
+/*
+    This file implements files that are renamed into place once written.
+*/
+
+#include "tpy/utility/AtomicFile.h"
+
+#include <filesystem>
+
+// OS Specific headers
+#ifdef _WIN32
+#include <process.h>
+
+#define GET_PID() _getpid()
+#else
+#include <unistd.h>
+
+#define GET_PID() getpid()
+#endif
+
+namespace tpy::Utility {
+AtomicFile::AtomicFile(std::string path)
+    : path{std::move(path)},
+      tmp_path{this->path + ".tmp" + std::to_string(GET_PID())} {
+    file = fopen(tmp_path.c_str(), "wb");
+}
+
+AtomicFile::~AtomicFile() {
+    if (file) {
+        fclose(file);
+        std::remove(tmp_path.c_str());
+    }
+}
+
+auto AtomicFile::commit(bool ok) -> bool {
+    if (!file) {
+        return false;
+    }
+
+    // The stream must be closed even if a write failed.
+    ok = fclose(file) == 0 && ok;
+    file = nullptr;
+
+    if (!ok) {
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec) {
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+
+    return true;
+}
+} // namespace tpy::Utility
@@ -0,0 +1,561 @@
+/*
+    This file implements the arbitrary-precision integer.
+*/
+
+#include "tpy/utility/BigInt.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace tpy::Utility {
+using Digits = std::vector<uint32_t>;
+
+static constexpr uint64_t DIGIT_BASE = uint64_t{1} << 32;
+
+// This is the largest power of ten that fits into a digit, which is used to
+// convert to and from decimal nine digits at a time.
+static constexpr uint32_t DECIMAL_CHUNK = 1000000000;
+static constexpr int DECIMAL_CHUNK_DIGITS = 9;
+
+// This function returns the number of leading zero bits of a nonzero digit.
+static auto leading_zeros(uint32_t digit) -> int {
+    int count = 0;
+    while (!(digit & 0x80000000)) {
+        digit <<= 1;
+        count++;
+    }
+    return count;
+}
+
+static auto trim(Digits &digits) -> void {
+    while (!digits.empty() && digits.back() == 0) {
+        digits.pop_back();
+    }
+}
+
+static auto compare_magnitudes(const Digits &lhs, const Digits &rhs) -> int {
+    if (lhs.size() != rhs.size()) {
+        return lhs.size() < rhs.size() ? -1 : 1;
+    }
+
+    for (auto i = lhs.size(); i-- > 0;) {
+        if (lhs[i] != rhs[i]) {
+            return lhs[i] < rhs[i] ? -1 : 1;
+        }
+    }
+
+    return 0;
+}
+
+static auto add_magnitudes(const Digits &lhs, const Digits &rhs) -> Digits {
+    auto &longer = lhs.size() >= rhs.size() ? lhs : rhs;
+    auto &shorter = lhs.size() >= rhs.size() ? rhs : lhs;
+
+    Digits result(longer.size() + 1, 0);
+    uint64_t carry = 0;
+    for (size_t i = 0; i < longer.size(); i++) {
+        auto sum = carry + longer[i] + (i < shorter.size() ? shorter[i] : 0);
+        result[i] = static_cast<uint32_t>(sum);
+        carry = sum >> 32;
+    }
+    result[longer.size()] = static_cast<uint32_t>(carry);
+
+    trim(result);
+    return result;
+}
+
+// This function subtracts the smaller magnitude from the larger one.
+static auto subtract_magnitudes(const Digits &larger, const Digits &smaller)
+    -> Digits {
+    Digits result(larger.size(), 0);
+    int64_t borrow = 0;
+    for (size_t i = 0; i < larger.size(); i++) {
+        auto difference = static_cast<int64_t>(larger[i]) - borrow -
+                          (i < smaller.size() ? smaller[i] : 0);
+        borrow = difference < 0;
+        result[i] = static_cast<uint32_t>(difference + (borrow << 32));
+    }
+
+    trim(result);
+    return result;
+}
+
+static auto multiply_magnitudes(const Digits &lhs, const Digits &rhs)
+    -> Digits {
+    if (lhs.empty() || rhs.empty()) {
+        return Digits{};
+    }
+
+    Digits result(lhs.size() + rhs.size(), 0);
+    for (size_t i = 0; i < lhs.size(); i++) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < rhs.size(); j++) {
+            auto product = static_cast<uint64_t>(lhs[i]) * rhs[j] +
+                           result[i + j] + carry;
+            result[i + j] = static_cast<uint32_t>(product);
+            carry = product >> 32;
+        }
+        result[i + rhs.size()] = static_cast<uint32_t>(carry);
+    }
+
+    trim(result);
+    return result;
+}
+
+// This function multiplies the magnitude by a small factor and adds a small
+// value to it, in place.
+static auto multiply_add_small(Digits &digits, uint32_t factor, uint32_t addend)
+    -> void {
+    uint64_t carry = addend;
+    for (auto &digit : digits) {
+        auto product = static_cast<uint64_t>(digit) * factor + carry;
+        digit = static_cast<uint32_t>(product);
+        carry = product >> 32;
+    }
+
+    if (carry) {
+        digits.push_back(static_cast<uint32_t>(carry));
+    }
+}
+
+// This function divides the magnitude by a small divisor in place, and returns
+// the remainder.
+static auto divide_small(Digits &digits, uint32_t divisor) -> uint32_t {
+    uint64_t remainder = 0;
+    for (auto i = digits.size(); i-- > 0;) {
+        auto current = (remainder << 32) | digits[i];
+        digits[i] = static_cast<uint32_t>(current / divisor);
+        remainder = current % divisor;
+    }
+
+    trim(digits);
+    return static_cast<uint32_t>(remainder);
+}
+
+// This function shifts the digits left by fewer than 32 bits, into a result
+// with the given number of digits.
+static auto shift_digits_left(const Digits &digits, int bits, size_t size)
+    -> Digits {
+    Digits result(size, 0);
+    for (size_t i = 0; i < digits.size(); i++) {
+        auto shifted = static_cast<uint64_t>(digits[i]) << bits;
+        result[i] |= static_cast<uint32_t>(shifted);
+        if (i + 1 < size) {
+            result[i + 1] |= static_cast<uint32_t>(shifted >> 32);
+        }
+    }
+    return result;
+}
+
+/*
+    This function divides the magnitudes with the long division of Knuth's
+   Algorithm D, as it is given in Hacker's Delight. The divisor is shifted so
+   that its top bit is set, which makes every estimate of a quotient digit at
+   most two too large.
+*/
+static auto divide_magnitudes(const Digits &lhs, const Digits &rhs,
+                              Digits &quotient, Digits &remainder) -> void {
+    if (compare_magnitudes(lhs, rhs) < 0) {
+        quotient.clear();
+        remainder = lhs;
+        return;
+    }
+
+    if (rhs.size() == 1) {
+        quotient = lhs;
+        auto rest = divide_small(quotient, rhs[0]);
+        remainder = rest ? Digits{rest} : Digits{};
+        return;
+    }
+
+    auto n = rhs.size();
+    auto m = lhs.size() - n;
+    auto shift = leading_zeros(rhs.back());
+
+    auto divisor = shift_digits_left(rhs, shift, n);
+    auto dividend = shift_digits_left(lhs, shift, lhs.size() + 1);
+
+    quotient.assign(m + 1, 0);
+    for (auto j = m + 1; j-- > 0;) {
+        auto top = (static_cast<uint64_t>(dividend[j + n]) << 32) |
+                   dividend[j + n - 1];
+        auto estimate = top / divisor[n - 1];
+        auto rest = top % divisor[n - 1];
+
+        while (estimate >= DIGIT_BASE ||
+               estimate * divisor[n - 2] >
+                   ((rest << 32) | dividend[j + n - 2])) {
+            estimate--;
+            rest += divisor[n - 1];
+            if (rest >= DIGIT_BASE) {
+                break;
+            }
+        }
+
+        // Now, the divisor times the estimate is subtracted from the dividend.
+        int64_t borrow = 0;
+        int64_t difference = 0;
+        for (size_t i = 0; i < n; i++) {
+            auto product = estimate * divisor[i];
+            difference = static_cast<int64_t>(dividend[i + j]) - borrow -
+                         static_cast<int64_t>(product & 0xFFFFFFFF);
+            dividend[i + j] = static_cast<uint32_t>(difference);
+            borrow = static_cast<int64_t>(product >> 32) - (difference >> 32);
+        }
+        difference = static_cast<int64_t>(dividend[j + n]) - borrow;
+        dividend[j + n] = static_cast<uint32_t>(difference);
+
+        // If the estimate was still one too large, the divisor is added back.
+        quotient[j] = static_cast<uint32_t>(estimate);
+        if (difference < 0) {
+            quotient[j]--;
+            uint64_t carry = 0;
+            for (size_t i = 0; i < n; i++) {
+                auto sum = static_cast<uint64_t>(dividend[i + j]) + divisor[i] +
+                           carry;
+                dividend[i + j] = static_cast<uint32_t>(sum);
+                carry = sum >> 32;
+            }
+            dividend[j + n] += static_cast<uint32_t>(carry);
+        }
+    }
+
+    // The remainder is what is left of the dividend, shifted back.
+    remainder.assign(n, 0);
+    for (size_t i = 0; i < n; i++) {
+        remainder[i] = shift == 0
+                           ? dividend[i]
+                           : (dividend[i] >> shift) |
+                                 (dividend[i + 1] << (32 - shift));
+    }
+
+    trim(quotient);
+    trim(remainder);
+}
+
+// This function returns the digits of the number in two's complement, with the
+// given number of digits, which must leave room for the sign bit.
+static auto to_twos_complement(const BigInt &value, size_t size) -> Digits {
+    auto digits = value.get_digits();
+    if (value.is_negative()) {
+        digits = subtract_magnitudes(digits, Digits{1});
+    }
+
+    digits.resize(size, 0);
+    if (value.is_negative()) {
+        for (auto &digit : digits) {
+            digit = ~digit;
+        }
+    }
+
+    return digits;
+}
+
+static auto from_twos_complement(Digits digits) -> BigInt {
+    bool negative = !digits.empty() && (digits.back() & 0x80000000);
+    if (negative) {
+        for (auto &digit : digits) {
+            digit = ~digit;
+        }
+        trim(digits);
+        digits = add_magnitudes(digits, Digits{1});
+    }
+
+    return BigInt{std::move(digits), negative};
+}
+
+BigInt::BigInt(int64_t value) : negative{value < 0} {
+    auto magnitude = negative ? ~static_cast<uint64_t>(value) + 1
+                              : static_cast<uint64_t>(value);
+    while (magnitude) {
+        digits.push_back(static_cast<uint32_t>(magnitude));
+        magnitude >>= 32;
+    }
+}
+
+BigInt::BigInt(std::vector<uint32_t> digits, bool negative)
+    : digits{std::move(digits)}, negative{negative} {
+    normalize();
+}
+
+auto BigInt::normalize() -> void {
+    trim(digits);
+    if (digits.empty()) {
+        negative = false;
+    }
+}
+
+auto BigInt::parse(std::string_view text, int base, BigInt &result) -> bool {
+    Digits digits;
+    uint32_t chunk = 0, chunk_factor = 1;
+    int chunk_digits = 0;
+
+    // Decimal digits are gathered into chunks, so that the whole number is
+    // only multiplied once for every nine of them.
+    auto max_chunk_digits = base == 10 ? DECIMAL_CHUNK_DIGITS : 1;
+
+    for (auto c : text) {
+        if (c == '_') {
+            continue;
+        }
+
+        int digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            return false;
+        }
+
+        if (digit >= base) {
+            return false;
+        }
+
+        chunk = chunk * base + digit;
+        chunk_factor *= base;
+        if (++chunk_digits == max_chunk_digits) {
+            multiply_add_small(digits, chunk_factor, chunk);
+            chunk = 0;
+            chunk_factor = 1;
+            chunk_digits = 0;
+        }
+    }
+
+    if (chunk_digits) {
+        multiply_add_small(digits, chunk_factor, chunk);
+    }
+
+    result = BigInt{std::move(digits), false};
+    return true;
+}
+
+auto BigInt::bit_length() const -> size_t {
+    if (digits.empty()) {
+        return 0;
+    }
+
+    return digits.size() * 32 - leading_zeros(digits.back());
+}
+
+auto BigInt::to_int64(int64_t &result) const -> bool {
+    if (digits.size() > 2) {
+        return false;
+    }
+
+    uint64_t magnitude = 0;
+    for (auto i = digits.size(); i-- > 0;) {
+        magnitude = (magnitude << 32) | digits[i];
+    }
+
+    if (magnitude > static_cast<uint64_t>(INT64_MAX) + negative) {
+        return false;
+    }
+
+    result = negative ? static_cast<int64_t>(~magnitude + 1)
+                      : static_cast<int64_t>(magnitude);
+    return true;
+}
+
+/*
+    The top 64 bits of the magnitude are converted on their own, with the lowest
+   bit set if any of the bits below them is. A double has 53 bits, so that
+   lowest bit is never kept, but it is enough to round a value that is just
+   above a tie upwards. The conversion of a 64-bit integer rounds ties to even.
+*/
+auto BigInt::to_double(double &result) const -> bool {
+    auto bits = bit_length();
+    auto shift = bits > 64 ? bits - 64 : 0;
+
+    // The shift of a negative number rounds down, so the magnitude is shifted
+    // on its own.
+    auto top = BigInt{digits, false}.shift_right(shift);
+
+    uint64_t magnitude = 0;
+    for (auto i = top.digits.size(); i-- > 0;) {
+        magnitude = (magnitude << 32) | top.digits[i];
+    }
+
+    if (shift > 0) {
+        auto sticky = false;
+        for (size_t i = 0; i < shift / 32 && !sticky; i++) {
+            sticky = digits[i] != 0;
+        }
+        if (shift % 32) {
+            sticky |= (digits[shift / 32] & ((1u << (shift % 32)) - 1)) != 0;
+        }
+        magnitude |= sticky;
+    }
+
+    auto value = std::ldexp(static_cast<double>(magnitude),
+                            static_cast<int>(std::min<size_t>(shift, 4096)));
+    if (std::isinf(value)) {
+        return false;
+    }
+
+    result = negative ? -value : value;
+    return true;
+}
+
+auto BigInt::to_decimal() const -> std::string {
+    if (digits.empty()) {
+        return "0";
+    }
+
+    // The chunks of nine decimal digits come out from the lowest one up.
+    auto rest = digits;
+    std::vector<uint32_t> chunks;
+    while (!rest.empty()) {
+        chunks.push_back(divide_small(rest, DECIMAL_CHUNK));
+    }
+
+    std::string result = negative ? "-" : "";
+    result += std::to_string(chunks.back());
+    for (auto i = chunks.size() - 1; i-- > 0;) {
+        auto chunk = std::to_string(chunks[i]);
+        result.append(DECIMAL_CHUNK_DIGITS - chunk.size(), '0');
+        result += chunk;
+    }
+
+    return result;
+}
+
+auto BigInt::compare(const BigInt &rhs) const -> int {
+    if (negative != rhs.negative) {
+        return negative ? -1 : 1;
+    }
+
+    auto result = compare_magnitudes(digits, rhs.digits);
+    return negative ? -result : result;
+}
+
+auto BigInt::operator-() const -> BigInt {
+    return BigInt{digits, !negative};
+}
+
+auto BigInt::operator~() const -> BigInt { return -(*this + BigInt{1}); }
+
+auto BigInt::operator+(const BigInt &rhs) const -> BigInt {
+    if (negative == rhs.negative) {
+        return BigInt{add_magnitudes(digits, rhs.digits), negative};
+    }
+
+    // The signs differ, so the smaller magnitude is taken from the larger one,
+    // and the result has the sign of the larger one.
+    if (compare_magnitudes(digits, rhs.digits) >= 0) {
+        return BigInt{subtract_magnitudes(digits, rhs.digits), negative};
+    }
+    return BigInt{subtract_magnitudes(rhs.digits, digits), rhs.negative};
+}
+
+auto BigInt::operator-(const BigInt &rhs) const -> BigInt {
+    return *this + -rhs;
+}
+
+auto BigInt::operator*(const BigInt &rhs) const -> BigInt {
+    return BigInt{multiply_magnitudes(digits, rhs.digits),
+                  negative != rhs.negative};
+}
+
+auto BigInt::operator&(const BigInt &rhs) const -> BigInt {
+    auto size = std::max(digits.size(), rhs.digits.size()) + 1;
+    auto lhs_digits = to_twos_complement(*this, size);
+    auto rhs_digits = to_twos_complement(rhs, size);
+    for (size_t i = 0; i < size; i++) {
+        lhs_digits[i] &= rhs_digits[i];
+    }
+    return from_twos_complement(std::move(lhs_digits));
+}
+
+auto BigInt::operator|(const BigInt &rhs) const -> BigInt {
+    auto size = std::max(digits.size(), rhs.digits.size()) + 1;
+    auto lhs_digits = to_twos_complement(*this, size);
+    auto rhs_digits = to_twos_complement(rhs, size);
+    for (size_t i = 0; i < size; i++) {
+        lhs_digits[i] |= rhs_digits[i];
+    }
+    return from_twos_complement(std::move(lhs_digits));
+}
+
+auto BigInt::operator^(const BigInt &rhs) const -> BigInt {
+    auto size = std::max(digits.size(), rhs.digits.size()) + 1;
+    auto lhs_digits = to_twos_complement(*this, size);
+    auto rhs_digits = to_twos_complement(rhs, size);
+    for (size_t i = 0; i < size; i++) {
+        lhs_digits[i] ^= rhs_digits[i];
+    }
+    return from_twos_complement(std::move(lhs_digits));
+}
+
+auto BigInt::shift_left(size_t bits) const -> BigInt {
+    if (digits.empty()) {
+        return BigInt{};
+    }
+
+    auto whole = bits / 32;
+    auto shifted = shift_digits_left(digits, static_cast<int>(bits % 32),
+                                     digits.size() + 1);
+    shifted.insert(shifted.begin(), whole, 0);
+    return BigInt{std::move(shifted), negative};
+}
+
+// A negative number is shifted as '-((-x - 1) >> n) - 1', which rounds down.
+auto BigInt::shift_right(size_t bits) const -> BigInt {
+    if (negative) {
+        return -((-*this - BigInt{1}).shift_right(bits)) - BigInt{1};
+    }
+
+    auto whole = bits / 32;
+    if (whole >= digits.size()) {
+        return BigInt{};
+    }
+
+    auto part = static_cast<int>(bits % 32);
+    Digits shifted(digits.size() - whole, 0);
+    for (size_t i = 0; i < shifted.size(); i++) {
+        auto low = digits[i + whole];
+        auto high = i + whole + 1 < digits.size() ? digits[i + whole + 1] : 0;
+        shifted[i] = part == 0 ? low : (low >> part) | (high << (32 - part));
+    }
+
+    return BigInt{std::move(shifted), false};
+}
+
+auto BigInt::pow(uint64_t exponent) const -> BigInt {
+    BigInt result{1};
+    auto base = *this;
+
+    while (exponent) {
+        if (exponent & 1) {
+            result = result * base;
+        }
+
+        exponent >>= 1;
+        if (exponent) {
+            base = base * base;
+        }
+    }
+
+    return result;
+}
+
+auto BigInt::floor_divmod(const BigInt &lhs, const BigInt &rhs,
+                          BigInt &quotient, BigInt &remainder) -> void {
+    Digits quotient_digits, remainder_digits;
+    divide_magnitudes(lhs.digits, rhs.digits, quotient_digits,
+                      remainder_digits);
+
+    quotient = BigInt{std::move(quotient_digits), lhs.negative != rhs.negative};
+    remainder = BigInt{std::move(remainder_digits), rhs.negative};
+
+    // The division above truncates. When the signs differ and there is a
+    // remainder, the quotient is one less, and the remainder is taken from the
+    // other side of the divisor.
+    if (lhs.negative != rhs.negative && !remainder.is_zero()) {
+        quotient = quotient - BigInt{1};
+        remainder = rhs + BigInt{remainder.digits, !rhs.negative};
+    }
+}
+} // namespace tpy::Utility
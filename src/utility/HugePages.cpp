@@ -0,0 +1,81 @@
+/*
+    This file implements the mapping of memory that is backed by huge pages.
+*/
+
+#include "tpy/utility/HugePages.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+// OS Specific headers
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace tpy::Utility {
+auto huge_pages_available() -> bool {
+#ifdef __linux__
+    // The current mode is the one in brackets, such as "always [madvise]
+    // never". Huge pages can be asked for unless it is 'never'.
+    static const bool available = []() {
+        std::ifstream file{"/sys/kernel/mm/transparent_hugepage/enabled"};
+        std::string modes;
+        return std::getline(file, modes) &&
+               modes.find("[never]") == std::string::npos;
+    }();
+
+    return available;
+#else
+    return false;
+#endif
+}
+
+auto map_huge_pages(size_t size) -> void * {
+#ifdef __linux__
+    if (!huge_pages_available()) {
+        return nullptr;
+    }
+
+    size = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+
+    // The kernel only aligns a mapping to a regular page, so an extra huge
+    // page is mapped and the parts before and after the aligned block are
+    // unmapped again.
+    auto *memory = mmap(nullptr, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return nullptr;
+    }
+
+    auto start = reinterpret_cast<uintptr_t>(memory);
+    auto aligned = (start + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+
+    if (aligned > start) {
+        munmap(memory, aligned - start);
+    }
+    if (auto tail = start + HUGE_PAGE_SIZE - aligned) {
+        munmap(reinterpret_cast<void *>(aligned + size), tail);
+    }
+
+    // The advice is only a hint, so the block is still usable with regular
+    // pages if the kernel has no huge page to spare.
+    madvise(reinterpret_cast<void *>(aligned), size, MADV_HUGEPAGE);
+
+    return reinterpret_cast<void *>(aligned);
+#else
+    (void)size;
+    return nullptr;
+#endif
+}
+
+auto unmap_huge_pages(void *memory, size_t size) -> void {
+#ifdef __linux__
+    size = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    munmap(memory, size);
+#else
+    (void)memory;
+    (void)size;
+#endif
+}
+} // namespace tpy::Utility
@@ -5,6 +5,7 @@
 
 #include "tpy/utility/MemoryBuffer.h"
 
+#include <cstring>
 #include <fcntl.h>
 #include <stdexcept>
 #include <sys/stat.h>
@@ -46,7 +47,7 @@ MemoryBuffer::~MemoryBuffer() {
     For now, however, memory mapping will only be supposed on POSIX based
    systems.
 */
-auto MemoryBuffer::create_buffer_from_file(char *file_path)
+auto MemoryBuffer::create_buffer_from_file(const char *file_path)
     -> std::unique_ptr<MemoryBuffer> {
     // First, we must open the file.
     errno = 0;
@@ -68,14 +69,29 @@ auto MemoryBuffer::create_buffer_from_file(char *file_path)
 #ifndef _WIN32
     // If the file is larger than 16384 bytes, we must map it.
     if (file_size > 16384) {
+        // We need one byte past the end of the file for the null terminator.
+        // If the file size is a multiple of the page size, that byte would be
+        // past the end of the file mapping. Therefore, we first reserve an
+        // anonymous region that is large enough, and then map the file over
+        // it. The mapping is private so that the terminator can be written.
         errno = 0;
-        std::byte *buffer = reinterpret_cast<std::byte *>(
-            mmap(nullptr, file_size + 1, PROT_READ, MAP_SHARED, fd, 0));
+        void *region = mmap(nullptr, file_size + 1, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
 
-        if (buffer == MAP_FAILED) {
+        if (region == MAP_FAILED) {
             throw std::runtime_error{strerror(errno)};
         }
 
+        if (mmap(region, file_size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+            munmap(region, file_size + 1);
+            throw std::runtime_error{strerror(errno)};
+        }
+
+        // The mapping stays valid after the file is closed.
+        close(fd);
+
+        std::byte *buffer = reinterpret_cast<std::byte *>(region);
         buffer[file_size] = std::byte{0};
 
         return std::make_unique<MemoryBuffer>(buffer, file_size + 1, true);
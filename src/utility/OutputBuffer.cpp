@@ -0,0 +1,103 @@
+/*
+    This file implements the buffer that text output is gathered in before it
+   is written out in large chunks.
+*/
+
+#include "tpy/utility/OutputBuffer.h"
+
+#include <cerrno>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace tpy::Utility {
+// This is a run of spaces that indentation is copied from, so that an indent
+// costs a single copy instead of a loop of single characters.
+static constexpr char SPACES[] = "                                "
+                                 "                                "
+                                 "                                "
+                                 "                                ";
+static constexpr size_t NUM_SPACES = sizeof(SPACES) - 1;
+
+// This table holds every pair of decimal digits, so that integers are
+// formatted two digits at a time without going through the locale.
+static constexpr char DIGIT_PAIRS[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536"
+    "37383940414243444546474849505152535455565758596061626364656667686970717273"
+    "7475767778798081828384858687888990919293949596979899";
+
+// A destructor must not throw, so an error while flushing is dropped here.
+// Callers that care about errors flush explicitly.
+OutputBuffer::~OutputBuffer() {
+    try {
+        flush();
+    } catch (const std::exception &) {
+    }
+}
+
+auto OutputBuffer::write_uint(uint64_t value) -> void {
+    // The largest 64-bit integer has 20 digits.
+    char digits[20];
+    auto *pos = digits + sizeof(digits);
+
+    while (value >= 100) {
+        auto pair = (value % 100) * 2;
+        value /= 100;
+        *--pos = DIGIT_PAIRS[pair + 1];
+        *--pos = DIGIT_PAIRS[pair];
+    }
+
+    if (value >= 10) {
+        *--pos = DIGIT_PAIRS[value * 2 + 1];
+        *--pos = DIGIT_PAIRS[value * 2];
+    } else {
+        *--pos = static_cast<char>('0' + value);
+    }
+
+    write(std::string_view(pos, digits + sizeof(digits) - pos));
+}
+
+auto OutputBuffer::write_indent(size_t spaces) -> void {
+    while (spaces > NUM_SPACES) {
+        write(std::string_view(SPACES, NUM_SPACES));
+        spaces -= NUM_SPACES;
+    }
+
+    write(std::string_view(SPACES, spaces));
+}
+
+auto OutputBuffer::flush() -> void {
+    // The buffer is emptied first, so a failed write is not repeated by the
+    // destructor.
+    auto len = size;
+    size = 0;
+    write_out(buffer.get(), len);
+}
+
+auto OutputBuffer::write_out(const char *data, size_t len) -> void {
+    if (target) {
+        target->append(data, len);
+        return;
+    }
+
+    // A write may be cut short, so it is repeated until everything is out.
+    while (len > 0) {
+        auto written = ::write(fd, data, len);
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            throw std::runtime_error{strerror(errno)};
+        }
+
+        data += written;
+        len -= written;
+    }
+}
+} // namespace tpy::Utility
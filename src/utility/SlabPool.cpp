@@ -0,0 +1,84 @@
+/*
+    This file implements the pool of free slabs.
+*/
+#include "tpy/utility/SlabPool.h"
+
+#include <new>
+
+namespace tpy::Utility {
+SlabPool::~SlabPool() {
+    for (auto &bucket : buckets) {
+        while (bucket.head) {
+            auto *next = bucket.head->next;
+            ::operator delete(bucket.head);
+            bucket.head = next;
+        }
+    }
+}
+
+auto SlabPool::global() -> SlabPool & {
+    static SlabPool pool{256 << 20};
+    return pool;
+}
+
+auto SlabPool::acquire(size_t size) -> void * {
+    std::lock_guard<std::mutex> lock{mutex};
+
+    for (auto &bucket : buckets) {
+        if (bucket.size == size && bucket.head) {
+            auto *slab = bucket.head;
+            bucket.head = slab->next;
+            pooled_bytes -= size;
+            num_hits++;
+            return slab;
+        }
+    }
+
+    num_misses++;
+    return nullptr;
+}
+
+auto SlabPool::release(void *slab, size_t size) -> bool {
+    std::lock_guard<std::mutex> lock{mutex};
+
+    if (pooled_bytes + size > max_bytes) {
+        return false;
+    }
+
+    // There are only a few distinct sizes, so the buckets are searched in
+    // order.
+    Bucket *target = nullptr;
+    for (auto &bucket : buckets) {
+        if (bucket.size == size) {
+            target = &bucket;
+            break;
+        }
+    }
+
+    if (!target) {
+        target = &buckets.emplace_back(Bucket{size, nullptr});
+    }
+
+    auto *free_slab = static_cast<FreeSlab *>(slab);
+    free_slab->next = target->head;
+    target->head = free_slab;
+    pooled_bytes += size;
+
+    return true;
+}
+
+auto SlabPool::hit_count() -> size_t {
+    std::lock_guard<std::mutex> lock{mutex};
+    return num_hits;
+}
+
+auto SlabPool::miss_count() -> size_t {
+    std::lock_guard<std::mutex> lock{mutex};
+    return num_misses;
+}
+
+auto SlabPool::size() -> size_t {
+    std::lock_guard<std::mutex> lock{mutex};
+    return pooled_bytes;
+}
+} // namespace tpy::Utility
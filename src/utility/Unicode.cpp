@@ -140,6 +140,24 @@ auto Unicode::decode_utf8_sequence(uint8_t **start, uint8_t *end) -> uint32_t {
            static_cast<char32_t>(b3 & MASKX);
 }
 
+auto Unicode::encode_utf8(uint32_t cp, std::string &result) -> void {
+    if (cp < 0x80) {
+        result += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        result += static_cast<char>(0xC0 | (cp >> 6));
+        result += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        result += static_cast<char>(0xE0 | (cp >> 12));
+        result += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        result += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        result += static_cast<char>(0xF0 | (cp >> 18));
+        result += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        result += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        result += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
 /*
     This implementation of searching unicode categories is based off of
    https://raw.githubusercontent.com/yhirose/cpp-unicodelib/master/unicodelib.h,
@@ -0,0 +1 @@
+f'''{a:'^9}''' + f"""{b:"<{w}}"""
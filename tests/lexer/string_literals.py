@@ -0,0 +1,2 @@
+b'ab' rb"\d" u'x' fr'{a}' """multi
+line""" f"x{a!r:>{w}}y{{z}}" bar
@@ -0,0 +1,5 @@
+# leading
+x = 1  # trailing
+
+y = \
+    2
\ No newline at end of file
@@ -0,0 +1,4 @@
+import os.path
+from a import b; c = None
+def f(x):
+    return g(x[0], [1, 2], {x: (y)})
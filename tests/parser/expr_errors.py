@@ -0,0 +1,10 @@
+[a not b, (c + )]
+[a for ]
+{k: v for k in }
+{**}
+f(x for x in y if )
+lambda a b: a
+lambda: 
+await
+(yield from)
+a[1:2:]]
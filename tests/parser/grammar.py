@@ -0,0 +1,42 @@
+"""A module that uses the rest of the grammar."""
+from ... import parent
+from .... import grandparent
+
+x = ...
+s = "a" 'b' f"{c}"
+b = b"a" b'b'
+y = a[::2], a[1:], a[:2:], a[1:2:3], a[:]
+d = {**base, 'key': 1, **other,}
+e = {**base}
+l = [*a, *b, c]
+t = {*a, b}
+squares = [i * i for i in range(10) if i % 2 if i]
+pairs = {k: v for k, v in items}
+unique = {v for _, v in items}
+nested = [a for row in rows for a in row]
+total = sum(v for v in values)
+gen = (v async for v in stream)
+first = next((v for v in values), None)
+key = lambda a, *b, c=1, **d: a
+bare = lambda: 0
+keyword = lambda *, k: k
+sort(items, key=lambda item: item[0])
+choice = lambda v: v if v else lambda: None
+
+def produce():
+    yield
+    yield 1, 2
+    x = yield value
+    x = (yield)
+    x += yield
+    yield from other()
+
+async def fetch(session):
+    async with session.get(url) as response, lock:
+        async for chunk in response:
+            await process(chunk)
+    return await response.json()
+
+@decorator
+async def decorated():
+    total = [await v for v in values]
@@ -0,0 +1,47 @@
+"""A module that uses every kind of statement."""
+import os.path as osp, sys
+from . import sibling
+from ..pkg.mod import (a, b as c,)
+from typing import *
+
+x = y = 1, 2
+x[0] += 1; del x[0], y
+count: int = 0
+
+@decorator
+@module.decorator(arg)
+def f(a, /, b: int = 1, *args, c, **kwargs) -> Dict[str, int]:
+    global count
+    if a:
+        return a
+    elif b:
+        pass
+    else:
+        raise ValueError("bad") from None
+    return
+
+class C(Base, metaclass=Meta):
+    def method(self, *, key=None):
+        for i, *rest in self.items(**key):
+            while i:
+                if i > 0:
+                    break
+                continue
+            else:
+                pass
+
+    # A comment between the methods.
+
+    def other(self): return self.value
+
+try:
+    with open(path) as f, lock:
+        assert f, "message"
+except (KeyError, IndexError) as error:
+    pass
+except:
+    raise
+else:
+    nonlocal_name = (lambda_free,)
+finally:
+    f(*args, key=value)
@@ -0,0 +1 @@
+[f(a, [b, c], {d: e, f: [g]}), {h, i}, g()]
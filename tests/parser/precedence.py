@@ -0,0 +1 @@
+a or b and not c < d not in e | f ^ g & h << i + j * -k ** -l ** m % n or o is not p
@@ -0,0 +1,23 @@
+x = (1 +) * 2
+y = [a, b c, d]
+def f(a, b)
+    return a
+if x y:
+    pass
+print(f(1, 2 3), g(*))
+z = 3
+
+class C:
+    def g(self):
+        return self.
+    h = 1
+        i = 2
+try:
+    pass
+w = {1: 2, 3: }
+b = 1 2
+v = f(1,
+import u
+if u:
+    t = [1, 2
+y = 2 +
@@ -3,12 +3,39 @@
 */
 #define CATCH_CONFIG_MAIN
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "catch2/catch_test_macros.hpp"
+#include "tpy/compiler/FrontendErrorHandler.h"
+#include "tpy/parse/EventParser.h"
+#include "tpy/parse/IncrementalParser.h"
+#include "tpy/parse/ParallelParser.h"
 #include "tpy/parse/Parser.h"
+#include "tpy/parse/TokenCache.h"
 #include "tpy/source/SourceManager.h"
+#include "tpy/tree/ASTCache.h"
+#include "tpy/tree/ASTExpr.h"
+#include "tpy/tree/ASTStmt.h"
+#include "tpy/tree/ASTVisitor.h"
+#include "tpy/tree/ASTWriter.h"
+#include "tpy/tree/ConstantFolder.h"
+#include "tpy/tree/FlatAST.h"
+#include "tpy/tree/PassManager.h"
+#include "tpy/tree/StructuralHash.h"
 #include "tpy/utility/ArenaAllocator.h"
+#include "tpy/utility/ArenaResource.h"
+#include "tpy/utility/BigInt.h"
+#include "tpy/utility/HugePages.h"
+#include "tpy/utility/OutputBuffer.h"
+#include "tpy/utility/SlabPool.h"
 
 /*
     Since windows uses the CRLF mechanism for newline characters, we must
@@ -158,6 +185,351 @@ TEST_CASE("Source Location is being tested", "[src_location]") {
 }
 #endif
 
+TEST_CASE("Arena allocator is being tested", "[arena]") {
+    using tpy::Utility::ArenaAllocator;
+
+    auto offset = [](void *mem, size_t align) {
+        return reinterpret_cast<uintptr_t>(mem) % align;
+    };
+
+    SECTION("Alignment") {
+        struct alignas(64) Line {
+            char bytes[64];
+        };
+
+        ArenaAllocator arena;
+        for (int i = 0; i < 100; i++) {
+            REQUIRE(offset(arena.allocate<char>('a'), 1) == 0);
+            REQUIRE(offset(arena.allocate<double>(1.0), alignof(double)) == 0);
+            REQUIRE(offset(arena.allocate<Line>(), 64) == 0);
+            REQUIRE(offset(arena.allocate_bytes(3, 256), 256) == 0);
+        }
+    }
+
+    SECTION("Oversized objects") {
+        ArenaAllocator arena;
+        auto *first = static_cast<char *>(arena.allocate_bytes(16, 8));
+
+        // The large block gets a slab of its own, so the current slab is
+        // still used for the next small block.
+        auto *large = static_cast<char *>(arena.allocate_bytes(100000, 8));
+        std::fill(large, large + 100000, 'x');
+        REQUIRE(arena.slab_count() == 2);
+
+        auto *second = static_cast<char *>(arena.allocate_bytes(16, 8));
+        REQUIRE(second == first + 16);
+        REQUIRE(arena.slab_count() == 2);
+    }
+
+    SECTION("Slab growth") {
+        // A megabyte of small objects needs only a few slabs, as each slab
+        // is twice as large as the one before it.
+        ArenaAllocator arena;
+        for (int i = 0; i < (1 << 20) / 32; i++) {
+            arena.allocate_bytes(32, 8);
+        }
+        REQUIRE(arena.slab_count() <= 10);
+        REQUIRE(arena.capacity() < 3 << 20);
+
+        // The slabs stop growing at the cap.
+        for (int i = 0; i < (16 << 20) / 32; i++) {
+            arena.allocate_bytes(32, 8);
+        }
+        REQUIRE(arena.capacity() <
+                (17 << 20) + ArenaAllocator::GET_MAX_SLAB_SIZE());
+    }
+
+    SECTION("Marks") {
+        ArenaAllocator arena;
+        auto *kept = arena.allocate<int>(1);
+        auto mark = arena.mark();
+
+        // Enough is allocated after the mark to need new slabs, and a
+        // dedicated one.
+        for (int i = 0; i < 10000; i++) {
+            arena.allocate_bytes(64, 8);
+        }
+        arena.allocate_bytes(100000, 8);
+        REQUIRE(arena.slab_count() > 3);
+
+        arena.release_to(mark);
+        REQUIRE(arena.slab_count() == 1);
+        REQUIRE(*kept == 1);
+
+        // The next allocation reuses the memory right after the mark.
+        auto *next = arena.allocate<int>(2);
+        REQUIRE(next == kept + 1);
+    }
+
+    SECTION("Reset") {
+        ArenaAllocator arena;
+        for (int i = 0; i < 10000; i++) {
+            arena.allocate_bytes(64, 8);
+        }
+
+        arena.reset(1);
+        REQUIRE(arena.slab_count() == 1);
+        auto capacity = arena.capacity();
+
+        // The kept slab is the largest one, so the same allocations need
+        // only a few new slabs.
+        for (int i = 0; i < 2000; i++) {
+            arena.allocate_bytes(64, 8);
+        }
+        REQUIRE(arena.slab_count() == 1);
+        REQUIRE(arena.capacity() == capacity);
+
+        arena.reset(0);
+        REQUIRE(arena.slab_count() == 0);
+    }
+
+    SECTION("Slab pool") {
+        tpy::Utility::SlabPool pool{64 << 20};
+
+        auto fill = [&]() {
+            ArenaAllocator arena{4096, &pool};
+            for (int i = 0; i < 100000; i++) {
+                arena.allocate_bytes(32, 8);
+            }
+            return arena.slab_count();
+        };
+
+        auto slabs = fill();
+        REQUIRE(pool.hit_count() == 0);
+        REQUIRE(pool.miss_count() == slabs);
+        REQUIRE(pool.size() > 0);
+
+        // The second arena takes all of its slabs from the pool.
+        REQUIRE(fill() == slabs);
+        REQUIRE(pool.hit_count() == slabs);
+        REQUIRE(pool.miss_count() == slabs);
+
+        // A full pool frees the slabs instead.
+        tpy::Utility::SlabPool tiny{4096};
+        {
+            ArenaAllocator arena{4096, &tiny};
+            arena.allocate_bytes(1 << 20, 8);
+        }
+        REQUIRE(tiny.size() == 0);
+    }
+
+    SECTION("Destructors") {
+        static_assert(!ArenaAllocator::NEEDS_DESTRUCTOR<int>);
+        static_assert(ArenaAllocator::NEEDS_DESTRUCTOR<std::string>);
+
+        std::vector<int> order;
+        struct Tracked {
+            std::vector<int> &order;
+            int id;
+
+            Tracked(std::vector<int> &order, int id) : order{order}, id{id} {}
+
+            ~Tracked() { order.push_back(id); }
+        };
+
+        {
+            ArenaAllocator arena;
+            arena.allocate<Tracked>(order, 1);
+            auto mark = arena.mark();
+            arena.allocate<Tracked>(order, 2);
+            arena.allocate<Tracked>(order, 3);
+
+            // Only the objects after the mark are destroyed, the newest first.
+            arena.release_to(mark);
+            REQUIRE(order == std::vector<int>{3, 2});
+
+            arena.allocate<Tracked>(order, 4);
+            arena.reset();
+            REQUIRE(order == std::vector<int>{3, 2, 4, 1});
+
+            arena.allocate<Tracked>(order, 5);
+        }
+        REQUIRE(order == std::vector<int>{3, 2, 4, 1, 5});
+
+        // An object that holds memory of its own gives it back.
+        ArenaAllocator arena;
+        auto *text = arena.allocate<std::string>(1000, 'x');
+        REQUIRE(text->size() == 1000);
+    }
+
+    SECTION("Splicing") {
+        ArenaAllocator arena;
+        auto *first = arena.allocate<int>(1);
+        auto mark = arena.mark();
+        auto parent_slabs = arena.slab_count();
+
+        std::vector<ArenaAllocator> workers(4);
+        std::vector<std::thread> threads;
+        for (int k = 0; k < 4; k++) {
+            threads.emplace_back([&workers, k]() {
+                for (int i = 0; i < 10000; i++) {
+                    *workers[k].allocate<int>() = k;
+                }
+                workers[k].allocate_bytes(1 << 16, 8);
+                workers[k].allocate<std::string>(100, 'x');
+            });
+        }
+
+        for (auto &thread : threads) {
+            thread.join();
+        }
+
+        size_t worker_slabs = 0;
+        for (auto &worker : workers) {
+            worker_slabs += worker.slab_count();
+            arena.splice(std::move(worker));
+            REQUIRE(worker.slab_count() == 0);
+        }
+        REQUIRE(arena.slab_count() == parent_slabs + worker_slabs);
+
+        // The current slab of the parent is still used.
+        auto *second = arena.allocate<int>(2);
+        REQUIRE(second == first + 1);
+
+        arena.release_to(mark);
+        REQUIRE(arena.slab_count() == parent_slabs);
+        REQUIRE(*first == 1);
+    }
+
+    SECTION("Huge pages") {
+        using tpy::Utility::HUGE_PAGE_SIZE;
+        tpy::Utility::SlabPool pool{64 << 20};
+
+        {
+            ArenaAllocator arena{4096, &pool, ArenaAllocator::SlabPages::Huge};
+            auto *value = arena.allocate<int>(7);
+            arena.allocate_bytes(3 << 20, 8);
+
+            // Without huge pages, the slabs come from regular memory.
+            if (tpy::Utility::huge_pages_available()) {
+                REQUIRE(arena.capacity() == 3 * HUGE_PAGE_SIZE);
+                REQUIRE(reinterpret_cast<uintptr_t>(value) % HUGE_PAGE_SIZE <
+                        64);
+            } else {
+                REQUIRE(arena.capacity() < 2 * HUGE_PAGE_SIZE);
+            }
+
+            // The mapped slabs can be handed over to a regular arena.
+            ArenaAllocator parent;
+            parent.splice(std::move(arena));
+            REQUIRE(*value == 7);
+        }
+
+        // The mapped slabs are unmapped rather than pooled.
+        if (tpy::Utility::huge_pages_available()) {
+            REQUIRE(pool.size() == 0);
+        }
+    }
+
+#ifdef TPY_ARENA_STATS
+    SECTION("Statistics") {
+        ArenaAllocator arena;
+        arena.allocate<char>('a');
+        arena.allocate<double>(1.0);
+        arena.allocate<double>(2.0);
+
+        int values[] = {1, 2, 3};
+        arena.allocate_array(values, 3);
+
+        auto &stats = arena.get_stats();
+        REQUIRE(stats.requested_bytes == 1 + 2 * sizeof(double) + 12);
+        REQUIRE(stats.padding_bytes == alignof(double) - 1);
+        REQUIRE(stats.types.at(typeid(double)).count == 2);
+        REQUIRE(stats.types.at(typeid(int[])).bytes == 12);
+
+        // A full slab leaves its tail behind.
+        for (int i = 0; i < 3; i++) {
+            arena.allocate_bytes(1500, 8);
+        }
+        REQUIRE(stats.tail_bytes > 1000);
+        REQUIRE(stats.peak_capacity == arena.capacity());
+
+        // The statistics of a spliced arena are added up.
+        ArenaAllocator other;
+        other.allocate<double>(3.0);
+        arena.splice(std::move(other));
+        REQUIRE(stats.types.at(typeid(double)).count == 3);
+        REQUIRE(stats.peak_capacity == arena.capacity());
+    }
+#endif
+
+    SECTION("Freed memory") {
+        struct Pair {
+            int64_t first, second;
+        };
+        struct Triple {
+            int64_t first, second, third;
+        };
+
+        ArenaAllocator arena;
+        auto *pair = arena.allocate<Pair>(Pair{1, 2});
+        arena.deallocate(pair);
+
+        // Only an object of the same size class takes the freed block.
+        auto *triple = arena.allocate<Triple>(Triple{1, 2, 3});
+        REQUIRE(static_cast<void *>(triple) != pair);
+        REQUIRE(arena.allocate<Pair>(Pair{3, 4}) == pair);
+        REQUIRE(arena.allocate<Pair>(Pair{5, 6}) != pair);
+
+        // A node is given back by the size of its own class.
+        tpy::Tree::ASTNode *node =
+            arena.allocate<tpy::Tree::ASTNoneLiteralNode>(
+                tpy::Source::Span{0, 0, 4});
+        tpy::Tree::deallocate_node(node, arena);
+        REQUIRE(arena.allocate<tpy::Tree::ASTNoneLiteralNode>(
+                    tpy::Source::Span{0, 0, 4}) == node);
+
+        // Rewinding drops the free blocks, as they may have been released.
+        auto mark = arena.mark();
+        auto *scratch = arena.allocate<Pair>(Pair{7, 8});
+        arena.deallocate(scratch);
+        arena.release_to(mark);
+        arena.allocate<Triple>(Triple{4, 5, 6});
+        REQUIRE(arena.allocate<Pair>(Pair{9, 10}) != scratch);
+    }
+
+    SECTION("Memory resources") {
+        ArenaAllocator arena;
+        tpy::Utility::ArenaResource resource{arena};
+
+        std::pmr::vector<int> values{&resource};
+        for (int i = 0; i < 1000; i++) {
+            values.push_back(i);
+        }
+        REQUIRE(values[999] == 999);
+        REQUIRE(arena.slab_count() > 0);
+
+        std::pmr::unordered_map<int, int> squares{&resource};
+        squares[12] = 144;
+        REQUIRE(squares.at(12) == 144);
+        REQUIRE(resource == tpy::Utility::ArenaResource{arena});
+
+        // A scratch resource only goes upstream once its buffer is used up.
+        ArenaAllocator upstream_arena;
+        tpy::Utility::ArenaResource upstream{upstream_arena};
+        {
+            tpy::Utility::ScratchResource<1024> scratch{&upstream};
+            std::pmr::vector<int> small{&scratch};
+            small.reserve(64);
+            REQUIRE(upstream_arena.slab_count() == 0);
+
+            std::pmr::vector<int> large{&scratch};
+            large.resize(4096);
+            REQUIRE(upstream_arena.slab_count() > 0);
+        }
+    }
+
+    SECTION("Moves") {
+        ArenaAllocator arena;
+        auto *value = arena.allocate<int>(42);
+
+        ArenaAllocator other{std::move(arena)};
+        REQUIRE(*value == 42);
+        REQUIRE(other.slab_count() == 1);
+        REQUIRE(arena.slab_count() == 0);
+    }
+}
+
 TEST_CASE("Lexer is being tested", "[lexer]") {
     using tpy::Parse::TokenKind;
     tpy::Source::SourceManager src_mgr;
@@ -253,6 +625,178 @@ TEST_CASE("Lexer is being tested", "[lexer]") {
         REQUIRE(tokens == std::vector<TokenKind>{TokenKind::Newline,
                                                  TokenKind::IntLiteral});
     }
+
+    SECTION("Trivia side-table") {
+        using tpy::Parse::TriviaKind;
+        auto src_file = src_mgr.open_py_src_file("./tests/lexer/trivia.py");
+
+        tpy::Parse::Lexer lexer{src_file};
+        tpy::Parse::TriviaTable trivia;
+        lexer.attach_trivia_table(&trivia);
+
+        auto tok = tpy::Parse::Token::dummy();
+        std::vector<TokenKind> tokens;
+
+        lexer.lex_next_tok(tok);
+        while (tok.kind != TokenKind::End) {
+            tokens.emplace_back(tok.kind);
+            lexer.lex_next_tok(tok);
+        }
+
+        // The continuation must join the two lines without a newline token.
+        REQUIRE(tokens ==
+                std::vector<TokenKind>{
+                    TokenKind::Newline, TokenKind::Identifier,
+                    TokenKind::Equals, TokenKind::IntLiteral,
+                    TokenKind::Newline, TokenKind::Newline,
+                    TokenKind::Identifier, TokenKind::Equals,
+                    TokenKind::IntLiteral});
+
+        REQUIRE(trivia.size() == 5);
+
+        REQUIRE(trivia[0].kind == TriviaKind::Comment);
+        REQUIRE(trivia[0].offset == 0);
+        REQUIRE(trivia[0].len == 9);
+        REQUIRE(trivia.token_index(0) == 0);
+
+        REQUIRE(trivia[1].kind == TriviaKind::BlankLine);
+        REQUIRE(trivia[1].offset == 9);
+        REQUIRE(trivia.token_index(1) == 0);
+
+        REQUIRE(trivia[2].kind == TriviaKind::Comment);
+        REQUIRE(trivia[2].offset == 17);
+        REQUIRE(trivia[2].len == 10);
+        REQUIRE(trivia.token_index(2) == 4);
+
+        REQUIRE(trivia[3].kind == TriviaKind::BlankLine);
+        REQUIRE(trivia[3].offset == 28);
+        REQUIRE(trivia.token_index(3) == 5);
+
+        REQUIRE(trivia[4].kind == TriviaKind::Continuation);
+        REQUIRE(trivia[4].offset == 33);
+        REQUIRE(trivia[4].len == 2);
+        REQUIRE(trivia.token_index(4) == 8);
+
+        auto [first, last] = trivia.trivia_before(0);
+        REQUIRE(last - first == 2);
+
+        auto [none_first, none_last] = trivia.trivia_before(1);
+        REQUIRE(none_first == none_last);
+    }
+
+    SECTION("Prefixed and f-string literals") {
+        using tpy::Parse::FStringSegmentKind;
+        auto src_file =
+            src_mgr.open_py_src_file("./tests/lexer/string_literals.py");
+
+        tpy::Parse::Lexer lexer{src_file};
+        auto stream = tpy::Parse::TokenStream::lex_all(lexer);
+        auto view = stream.view();
+
+        std::vector<TokenKind> tokens;
+        for (size_t i = 0; i < view.size; i++) {
+            tokens.emplace_back(view.kind(i));
+        }
+
+        REQUIRE(tokens ==
+                std::vector<TokenKind>{
+                    TokenKind::BytesLiteral, TokenKind::BytesLiteral,
+                    TokenKind::StringLiteral, TokenKind::FStringLiteral,
+                    TokenKind::StringLiteral, TokenKind::FStringLiteral,
+                    TokenKind::Identifier, TokenKind::Newline,
+                    TokenKind::End});
+
+        // The triple quoted string spans both lines.
+        REQUIRE(view.offsets[4] == 26);
+        REQUIRE(view.lens[4] == 16);
+
+        auto &fstrings = view.fstrings;
+        REQUIRE(fstrings.num_fstrings == 2);
+        REQUIRE(fstrings.num_segments == 7);
+
+        auto [first, last] = fstrings.find(view.offsets[3]);
+        REQUIRE(last - first == 1);
+        REQUIRE(fstrings.segments[first].kind ==
+                FStringSegmentKind::Expression);
+        REQUIRE(fstrings.segments[first].offset == 22);
+        REQUIRE(fstrings.segments[first].len == 1);
+
+        std::tie(first, last) = fstrings.find(view.offsets[5]);
+        REQUIRE(last - first == 6);
+
+        std::vector<FStringSegmentKind> kinds;
+        for (auto i = first; i < last; i++) {
+            kinds.emplace_back(fstrings.segments[i].kind);
+        }
+
+        REQUIRE(kinds == std::vector<FStringSegmentKind>{
+                             FStringSegmentKind::Literal,
+                             FStringSegmentKind::Expression,
+                             FStringSegmentKind::Conversion,
+                             FStringSegmentKind::FormatSpec,
+                             FStringSegmentKind::Expression,
+                             FStringSegmentKind::Literal});
+
+        // The format spec covers the nested field, which has a greater depth.
+        REQUIRE(fstrings.segments[first + 3].len == 4);
+        REQUIRE(fstrings.segments[first + 4].offset == 53);
+        REQUIRE(fstrings.segments[first + 4].depth == 1);
+
+        // Escaped braces are part of the trailing literal run.
+        REQUIRE(fstrings.segments[first + 5].offset == 56);
+        REQUIRE(fstrings.segments[first + 5].len == 6);
+
+        // Other tokens do not have any segments.
+        auto [none_first, none_last] = fstrings.find(view.offsets[4]);
+        REQUIRE(none_first == none_last);
+    }
+
+    SECTION("Quotes in the format specs of triple quoted f-strings") {
+        using namespace tpy::Tree;
+        using tpy::Parse::FStringSegmentKind;
+        auto src_file =
+            src_mgr.open_py_src_file("./tests/lexer/fstring_format_spec.py");
+
+        tpy::Parse::Lexer lexer{src_file};
+        auto stream = tpy::Parse::TokenStream::lex_all(lexer);
+        auto view = stream.view();
+
+        REQUIRE(view.size == 5);
+        REQUIRE(view.kind(0) == TokenKind::FStringLiteral);
+        REQUIRE(view.kind(2) == TokenKind::FStringLiteral);
+
+        // A single quote of the same kind is the fill character of the format
+        // spec, and not the end of the f-string.
+        auto &fstrings = view.fstrings;
+        auto [first, last] = fstrings.find(view.offsets[0]);
+        REQUIRE(last - first == 2);
+        REQUIRE(fstrings.segments[first + 1].kind ==
+                FStringSegmentKind::FormatSpec);
+        REQUIRE(fstrings.segments[first + 1].len == 3);
+
+        std::tie(first, last) = fstrings.find(view.offsets[2]);
+        REQUIRE(last - first == 3);
+        REQUIRE(fstrings.segments[first + 1].len == 5);
+        REQUIRE(fstrings.segments[first + 2].depth == 1);
+
+        // A parser that reads from the lexer itself finds the segments in the
+        // index of the lexer.
+        tpy::Parse::Lexer parse_lexer{src_file};
+        tpy::Utility::ArenaAllocator arena;
+        tpy::Parse::Parser parser{parse_lexer, arena};
+        auto *module = dynamic_cast<ASTModuleNode *>(parser.parse_py_module());
+        REQUIRE(module);
+
+        auto *stmt = dynamic_cast<ASTExprStmtNode *>(module->body[0]);
+        REQUIRE(stmt);
+        auto *sum = dynamic_cast<ASTBinaryOpExprNode *>(stmt->expr);
+        REQUIRE(sum);
+        auto *fstring = dynamic_cast<ASTFStringLiteralNode *>(sum->rhs);
+        REQUIRE(fstring);
+        REQUIRE(fstring->segment_end - fstring->segment_begin == 3);
+        REQUIRE(parse_lexer.fstrings()[fstring->segment_begin].kind ==
+                FStringSegmentKind::Expression);
+    }
 }
 
 TEST_CASE("Parser is being tested", "[parser]") {
@@ -287,4 +831,1723 @@ TEST_CASE("Parser is being tested", "[parser]") {
         result->pretty_print(result_file, 0);
     }
     fclose(result_file);
-}
\ No newline at end of file
+}
+
+/*
+    This helper will pretty-print a tree into a string so that trees can be
+   compared against each other.
+*/
+static auto tree_to_string(tpy::Tree::ASTNode *node) -> std::string {
+    FILE *file = tmpfile();
+    node->pretty_print(file, 0);
+
+    std::string result(ftell(file), '\0');
+    rewind(file);
+    fread(result.data(), 1, result.size(), file);
+    fclose(file);
+
+    return result;
+}
+
+/*
+    This helper will print an expression tree of single letter names as a fully
+   parenthesized string, so that the grouping of operators can be checked.
+*/
+static auto expr_to_string(tpy::Tree::ASTNode *node, const char *src)
+    -> std::string {
+    if (auto *binary = dynamic_cast<tpy::Tree::ASTBinaryOpExprNode *>(node)) {
+        return "(" + expr_to_string(binary->lhs, src) + " " +
+               tpy::Parse::token_names[static_cast<int>(binary->op)] + " " +
+               expr_to_string(binary->rhs, src) + ")";
+    }
+
+    if (auto *unary = dynamic_cast<tpy::Tree::ASTUnaryOpExprNode *>(node)) {
+        return "(" +
+               std::string{tpy::Parse::token_names[static_cast<int>(unary->op)]} +
+               " " + expr_to_string(unary->expr, src) + ")";
+    }
+
+    return std::string(1, src[node->loc.local_pos]);
+}
+
+TEST_CASE("Operator precedence is being tested", "[parser]") {
+    tpy::Source::SourceManager src_mgr;
+    auto src_file = src_mgr.open_py_src_file("./tests/parser/precedence.py");
+
+    tpy::Parse::Lexer lexer{src_file};
+    tpy::Utility::ArenaAllocator arena;
+    tpy::Parse::Parser parser{lexer, arena};
+
+    auto *result = parser.parse_py_compilation_unit();
+    REQUIRE(result);
+
+    REQUIRE(expr_to_string(result, src_file->start()) ==
+            "((a KeywordOr (b KeywordAnd (KeywordNot ((c Less d) NotInOp (e "
+            "Bar (f Caret (g Ampersand (h LessLess (i Plus ((j Asterisk "
+            "(Minus (k AsteriskAsterisk (Minus (l AsteriskAsterisk m))))) "
+            "Percent n)))))))))) KeywordOr (o IsNotOp p))");
+}
+
+TEST_CASE("Child arrays are being tested", "[parser]") {
+    using namespace tpy::Tree;
+    tpy::Source::SourceManager src_mgr;
+    auto src_file =
+        src_mgr.open_py_src_file("./tests/parser/nested_children.py");
+
+    tpy::Parse::Lexer lexer{src_file};
+    tpy::Utility::ArenaAllocator arena;
+    tpy::Parse::Parser parser{lexer, arena};
+
+    auto *list = dynamic_cast<ASTListExprNode *>(
+        parser.parse_py_compilation_unit());
+    REQUIRE(list);
+    REQUIRE(list->list.size() == 3);
+
+    // The children of nested nodes must not leak into their parents.
+    auto *call = dynamic_cast<ASTCallExprNode *>(list->list[0]);
+    REQUIRE(call);
+    REQUIRE(call->args.size() == 3);
+
+    auto *inner_list = dynamic_cast<ASTListExprNode *>(call->args[1]);
+    REQUIRE(inner_list);
+    REQUIRE(inner_list->list.size() == 2);
+
+    auto *dict = dynamic_cast<ASTDictExprNode *>(call->args[2]);
+    REQUIRE(dict);
+    REQUIRE(dict->contents.size() == 2);
+    REQUIRE(dynamic_cast<ASTListExprNode *>(dict->contents[1].second)
+                ->list.size() == 1);
+
+    auto *set = dynamic_cast<ASTSetExprNode *>(list->list[1]);
+    REQUIRE(set);
+    REQUIRE(set->contents.size() == 2);
+
+    auto *empty_call = dynamic_cast<ASTCallExprNode *>(list->list[2]);
+    REQUIRE(empty_call);
+    REQUIRE(empty_call->args.empty());
+}
+
+TEST_CASE("Module parsing is being tested", "[parser]") {
+    using namespace tpy::Tree;
+    tpy::Source::SourceManager src_mgr;
+    auto src_file = src_mgr.open_py_src_file("./tests/parser/module.py");
+
+    tpy::Parse::Lexer lexer{src_file};
+    auto stream = tpy::Parse::TokenStream::lex_all(lexer);
+    auto view = stream.view();
+
+    tpy::Utility::ArenaAllocator arena;
+    tpy::Parse::Parser parser{view, src_file, arena};
+    auto *module = dynamic_cast<ASTModuleNode *>(parser.parse_py_module());
+    REQUIRE(module);
+
+    SECTION("Statements") {
+        REQUIRE(module->body.size() == 12);
+        REQUIRE(dynamic_cast<ASTImportStmtNode *>(module->body[1]));
+        REQUIRE(dynamic_cast<ASTAssignStmtNode *>(module->body[5]));
+
+        // Both statements of a line separated by ';' belong to the module.
+        REQUIRE(dynamic_cast<ASTAugAssignStmtNode *>(module->body[6]));
+        REQUIRE(dynamic_cast<ASTDelStmtNode *>(module->body[7]));
+
+        auto *func = dynamic_cast<ASTFunctionDefNode *>(module->body[9]);
+        REQUIRE(func);
+        REQUIRE(func->decorators.size() == 2);
+        REQUIRE(func->params.size() == 6);
+        REQUIRE(func->body.size() == 3);
+
+        // The 'elif' clause is a nested 'if' statement.
+        auto *if_stmt = dynamic_cast<ASTIfStmtNode *>(func->body[1]);
+        REQUIRE(if_stmt);
+        REQUIRE(if_stmt->orelse.size() == 1);
+        REQUIRE(dynamic_cast<ASTIfStmtNode *>(if_stmt->orelse[0]));
+
+        // The block of 'for' closes several levels of indentation at once.
+        auto *cls = dynamic_cast<ASTClassDefNode *>(module->body[10]);
+        REQUIRE(cls);
+        REQUIRE(cls->bases.size() == 2);
+        REQUIRE(cls->body.size() == 2);
+
+        auto *try_stmt = dynamic_cast<ASTTryStmtNode *>(module->body[11]);
+        REQUIRE(try_stmt);
+        REQUIRE(try_stmt->handlers.size() == 2);
+        REQUIRE(try_stmt->orelse.size() == 1);
+        REQUIRE(try_stmt->finalbody.size() == 1);
+    }
+
+    SECTION("Top-level statements") {
+        auto starts = tpy::Parse::ParallelParser::find_top_level_stmts(view);
+        REQUIRE(starts.size() == module->body.size() - 1);
+
+        // The line with the ';' holds two statements of the module.
+        for (size_t i = 0; i < starts.size(); i++) {
+            REQUIRE(view.offsets[starts[i]] ==
+                    module->body[i + (i > 6)]->loc.local_pos);
+        }
+    }
+
+    SECTION("Parallel parsing") {
+        auto expected = tree_to_string(module);
+
+        for (size_t threads = 1; threads <= 8; threads++) {
+            tpy::Utility::ArenaAllocator parallel_arena;
+            tpy::Parse::ParallelParser parallel_parser{view, src_file,
+                                                       parallel_arena};
+
+            auto *parallel_module = parallel_parser.parse_py_module(threads);
+            REQUIRE(parallel_module);
+            REQUIRE(tree_to_string(parallel_module) == expected);
+        }
+    }
+}
+
+TEST_CASE("Grammar is being tested", "[parser]") {
+    using namespace tpy::Tree;
+    tpy::Source::SourceManager src_mgr;
+    auto src_file = src_mgr.open_py_src_file("./tests/parser/grammar.py");
+
+    tpy::Parse::Lexer lexer{src_file};
+    tpy::Utility::ArenaAllocator arena;
+    tpy::Parse::Parser parser{lexer, arena};
+
+    auto before = tpy::Compiler::FrontendErrorHandler::error_count();
+    auto *module = dynamic_cast<ASTModuleNode *>(parser.parse_py_module());
+    REQUIRE(module);
+    REQUIRE(tpy::Compiler::FrontendErrorHandler::error_count() == before);
+    REQUIRE(module->body.size() == 26);
+
+    auto value_of = [&](size_t i) {
+        auto *assign = dynamic_cast<ASTAssignStmtNode *>(module->body[i]);
+        REQUIRE(assign);
+        return assign->value;
+    };
+
+    SECTION("Literals") {
+        REQUIRE(static_cast<ASTImportFromStmtNode *>(module->body[1])->level ==
+                3);
+        REQUIRE(dynamic_cast<ASTEllipsisLiteralNode *>(value_of(3)));
+
+        // Adjacent strings are kept as the parts of a single node.
+        auto *concat = dynamic_cast<ASTStringConcatExprNode *>(value_of(4));
+        REQUIRE(concat);
+        REQUIRE(concat->parts.size() == 3);
+
+        auto *slices = dynamic_cast<ASTTupleExprNode *>(value_of(6));
+        REQUIRE(slices);
+        auto *stepped =
+            dynamic_cast<ASTProperSliceExprNode *>(slices->elements[0]);
+        REQUIRE(stepped);
+        REQUIRE(!stepped->lower_bound);
+        REQUIRE(!stepped->upper_bound);
+        REQUIRE(stepped->step);
+
+        // An unpacked entry of a dict has no key.
+        auto *dict = dynamic_cast<ASTDictExprNode *>(value_of(7));
+        REQUIRE(dict);
+        REQUIRE(dict->contents.size() == 3);
+        REQUIRE(!dict->contents[0].first);
+        REQUIRE(dict->contents[1].first);
+    }
+
+    SECTION("Comprehensions and lambdas") {
+        auto *squares = dynamic_cast<ASTComprehensionExprNode *>(value_of(11));
+        REQUIRE(squares);
+        REQUIRE(squares->bracket == tpy::Parse::TokenKind::LeftSquare);
+        REQUIRE(squares->generators.size() == 1);
+        REQUIRE(static_cast<ASTComprehensionClauseNode *>(
+                    squares->generators[0])
+                    ->ifs.size() == 2);
+
+        auto *pairs = dynamic_cast<ASTComprehensionExprNode *>(value_of(12));
+        REQUIRE(pairs);
+        REQUIRE(pairs->value);
+
+        // A generator can be the only argument of a call without parentheses
+        // of its own.
+        auto *call = dynamic_cast<ASTCallExprNode *>(value_of(15));
+        REQUIRE(call);
+        REQUIRE(dynamic_cast<ASTComprehensionExprNode *>(call->args[0]));
+
+        auto *lambda = dynamic_cast<ASTLambdaExprNode *>(value_of(18));
+        REQUIRE(lambda);
+        REQUIRE(lambda->params.size() == 4);
+        REQUIRE(dynamic_cast<ASTLambdaExprNode *>(value_of(19)));
+    }
+
+    SECTION("Generators and coroutines") {
+        auto *produce = dynamic_cast<ASTFunctionDefNode *>(module->body[23]);
+        REQUIRE(produce);
+        REQUIRE(!produce->is_async);
+        REQUIRE(produce->body.size() == 6);
+
+        auto *yield_from = dynamic_cast<ASTExprStmtNode *>(produce->body[5]);
+        REQUIRE(yield_from);
+        REQUIRE(static_cast<ASTYieldExprNode *>(yield_from->expr)->is_from);
+
+        auto *fetch = dynamic_cast<ASTFunctionDefNode *>(module->body[24]);
+        REQUIRE(fetch);
+        REQUIRE(fetch->is_async);
+
+        auto *with = dynamic_cast<ASTWithStmtNode *>(fetch->body[0]);
+        REQUIRE(with);
+        REQUIRE(with->is_async);
+        auto *loop = dynamic_cast<ASTForStmtNode *>(with->body[0]);
+        REQUIRE(loop);
+        REQUIRE(loop->is_async);
+
+        auto *decorated = dynamic_cast<ASTFunctionDefNode *>(module->body[25]);
+        REQUIRE(decorated);
+        REQUIRE(decorated->is_async);
+        REQUIRE(decorated->decorators.size() == 1);
+    }
+}
+
+TEST_CASE("Error recovery is being tested", "[parser]") {
+    using namespace tpy::Tree;
+    using tpy::Parse::ExprParseMode;
+    tpy::Source::SourceManager src_mgr;
+    auto src_file = src_mgr.open_py_src_file("./tests/parser/recovery.py");
+
+    // Every independent error of the file is reported by a single parse.
+    std::string trees[2];
+    ExprParseMode modes[] = {ExprParseMode::Recursive,
+                             ExprParseMode::Iterative};
+
+    for (size_t i = 0; i < 2; i++) {
+        tpy::Parse::Lexer lexer{src_file};
+        tpy::Utility::ArenaAllocator arena;
+        tpy::Parse::Parser parser{lexer, arena};
+        parser.set_expr_parse_mode(modes[i]);
+
+        auto before = tpy::Compiler::FrontendErrorHandler::error_count();
+        auto *module = dynamic_cast<ASTModuleNode *>(parser.parse_py_module());
+        REQUIRE(module);
+        REQUIRE(tpy::Compiler::FrontendErrorHandler::error_count() ==
+                before + 14);
+
+        // The statements that could not be parsed are replaced by error
+        // nodes, and the ones around them are kept.
+        REQUIRE(module->body.size() == 14);
+        REQUIRE(dynamic_cast<ASTAssignStmtNode *>(module->body[0]));
+        REQUIRE(dynamic_cast<ASTErrorNode *>(module->body[2]));
+        REQUIRE(dynamic_cast<ASTErrorNode *>(module->body[3]));
+        REQUIRE(dynamic_cast<ASTExprStmtNode *>(module->body[4]));
+        REQUIRE(dynamic_cast<ASTAssignStmtNode *>(module->body[5]));
+        REQUIRE(dynamic_cast<ASTErrorNode *>(module->body[7]));
+        REQUIRE(dynamic_cast<ASTAssignStmtNode *>(module->body[8]));
+
+        // Errors within brackets only replace the bracketed expression.
+        auto *assign = dynamic_cast<ASTAssignStmtNode *>(module->body[1]);
+        REQUIRE(assign);
+        REQUIRE(dynamic_cast<ASTErrorNode *>(assign->value));
+
+        auto *cls = dynamic_cast<ASTClassDefNode *>(module->body[6]);
+        REQUIRE(cls);
+        REQUIRE(cls->body.size() == 3);
+        REQUIRE(dynamic_cast<ASTErrorNode *>(cls->body[2]));
+
+        // A line with an error is replaced by a single error node that covers
+        // all of it, even if the error is only found at its end.
+        auto *line = dynamic_cast<ASTErrorNode *>(module->body[9]);
+        REQUIRE(line);
+        REQUIRE(line->loc.len == 7);
+
+        // A bracket that is never closed does not hide the statements after
+        // it, whether they begin with a keyword or are indented less.
+        REQUIRE(dynamic_cast<ASTErrorNode *>(module->body[10]));
+        REQUIRE(dynamic_cast<ASTImportStmtNode *>(module->body[11]));
+        REQUIRE(dynamic_cast<ASTIfStmtNode *>(module->body[12]));
+
+        line = dynamic_cast<ASTErrorNode *>(module->body[13]);
+        REQUIRE(line);
+        REQUIRE(line->loc.len == 7);
+
+        trees[i] = tree_to_string(module);
+    }
+
+    REQUIRE(trees[0] == trees[1]);
+}
+
+/*
+    This helper will write an expression that is nested the given number of
+   times, cycling through every kind of bracket and prefix operator.
+*/
+static auto write_nested_expr(const char *name, size_t depth) -> std::string {
+    static const char *openers[] = {"(", "lambda: ", "[", "{",
+                                    "-", "f(",       "a[", "not "};
+    static const char *closers[] = {")", "", "]", "}", "", ")", "]", ""};
+    constexpr size_t num_openers = sizeof(openers) / sizeof(openers[0]);
+
+    std::string expr;
+    for (size_t i = 0; i < depth; i++) {
+        expr += openers[i % num_openers];
+    }
+
+    expr += "x";
+    for (size_t i = depth; i-- > 0;) {
+        expr += closers[i % num_openers];
+    }
+
+    auto path = (std::filesystem::temp_directory_path() / name).string();
+    std::ofstream{path} << expr << "\n";
+    return path;
+}
+
+/*
+    This helper will write a file with a chain of conditional and assignment
+   expressions of the given length, such as 'a if b else x := a if b else c'.
+   Each link is nested within the false case or right hand side of the one
+   before it.
+*/
+static auto write_expr_chain(const char *name, size_t length) -> std::string {
+    std::string expr;
+    for (size_t i = 0; i < length; i++) {
+        expr += i % 3 == 2 ? "x := " : "a if b else ";
+    }
+
+    expr += "c";
+
+    auto path = (std::filesystem::temp_directory_path() / name).string();
+    std::ofstream{path} << expr << "\n";
+    return path;
+}
+
+TEST_CASE("Expression parse modes are being tested", "[parser]") {
+    using tpy::Parse::ExprParseMode;
+    tpy::Source::SourceManager src_mgr;
+
+    auto parse_with_mode = [&](tpy::Source::SourceFile *src_file,
+                               ExprParseMode mode, size_t max_depth,
+                               tpy::Utility::ArenaAllocator &arena) {
+        tpy::Parse::Lexer lexer{src_file};
+        tpy::Parse::Parser parser{lexer, arena};
+        parser.set_expr_parse_mode(mode);
+        parser.set_max_nesting_depth(max_depth);
+        return parser.parse_py_compilation_unit();
+    };
+
+    SECTION("Same trees in every mode") {
+        std::string paths[] = {
+            "./tests/parser/set_literal.py", "./tests/parser/dict_literal.py",
+            "./tests/parser/attr_ref_expr.py", "./tests/parser/call_expr.py",
+            "./tests/parser/slice_expr.py", "./tests/parser/binary_expr.py",
+            "./tests/parser/precedence.py",
+            "./tests/parser/nested_children.py", "./tests/parser/grammar.py"};
+
+        for (auto &path : paths) {
+            auto *src_file = src_mgr.open_py_src_file(path.data());
+            tpy::Utility::ArenaAllocator arena;
+
+            auto *recursive = parse_with_mode(
+                src_file, ExprParseMode::Recursive,
+                tpy::Parse::Parser::DEFAULT_MAX_NESTING_DEPTH, arena);
+            auto *iterative = parse_with_mode(
+                src_file, ExprParseMode::Iterative,
+                tpy::Parse::Parser::DEFAULT_MAX_NESTING_DEPTH, arena);
+            REQUIRE(recursive);
+            REQUIRE(iterative);
+            REQUIRE(tree_to_string(recursive) == tree_to_string(iterative));
+        }
+
+        // Statements parse their expressions with the same methods.
+        auto *module_file =
+            src_mgr.open_py_src_file("./tests/parser/module.py");
+        std::string trees[2];
+        ExprParseMode modes[] = {ExprParseMode::Recursive,
+                                 ExprParseMode::Iterative};
+
+        for (size_t i = 0; i < 2; i++) {
+            tpy::Parse::Lexer lexer{module_file};
+            tpy::Utility::ArenaAllocator arena;
+            tpy::Parse::Parser parser{lexer, arena};
+            parser.set_expr_parse_mode(modes[i]);
+
+            auto *module = parser.parse_py_module();
+            REQUIRE(module);
+            trees[i] = tree_to_string(module);
+        }
+
+        REQUIRE(trees[0] == trees[1]);
+    }
+
+    SECTION("Same trees past the recursion depth") {
+        auto path = write_nested_expr("tpy_nested_600.py", 600);
+        auto *src_file = src_mgr.open_py_src_file(path.data());
+        tpy::Utility::ArenaAllocator arena;
+
+        auto *recursive =
+            parse_with_mode(src_file, ExprParseMode::Recursive, 1000, arena);
+        auto *iterative =
+            parse_with_mode(src_file, ExprParseMode::Iterative, 1000, arena);
+        auto *adaptive =
+            parse_with_mode(src_file, ExprParseMode::Adaptive, 1000, arena);
+        REQUIRE(recursive);
+        REQUIRE(iterative);
+        REQUIRE(adaptive);
+
+        auto expected = tree_to_string(recursive);
+        REQUIRE(tree_to_string(iterative) == expected);
+        REQUIRE(tree_to_string(adaptive) == expected);
+    }
+
+    SECTION("Same errors in every mode") {
+        auto *src_file =
+            src_mgr.open_py_src_file("./tests/parser/expr_errors.py");
+        size_t errors[2];
+        ExprParseMode modes[] = {ExprParseMode::Recursive,
+                                 ExprParseMode::Iterative};
+
+        for (size_t i = 0; i < 2; i++) {
+            tpy::Utility::ArenaAllocator arena;
+            auto before = tpy::Compiler::FrontendErrorHandler::error_count();
+            parse_with_mode(src_file, modes[i], 1000, arena);
+            errors[i] =
+                tpy::Compiler::FrontendErrorHandler::error_count() - before;
+        }
+
+        REQUIRE(errors[0] > 0);
+        REQUIRE(errors[0] == errors[1]);
+    }
+
+    SECTION("Pathological nesting") {
+        auto path = write_nested_expr("tpy_nested_100000.py", 100000);
+        auto *src_file = src_mgr.open_py_src_file(path.data());
+
+        // The default limit reports a single error, and the parser recovers
+        // by skipping the rest of the innermost bracket.
+        tpy::Utility::ArenaAllocator arena;
+        auto before = tpy::Compiler::FrontendErrorHandler::error_count();
+        REQUIRE(parse_with_mode(src_file, ExprParseMode::Adaptive,
+                                tpy::Parse::Parser::DEFAULT_MAX_NESTING_DEPTH,
+                                arena));
+        REQUIRE(tpy::Compiler::FrontendErrorHandler::error_count() ==
+                before + 1);
+
+        // Without the limit, the explicit stack parses it without overflowing
+        // the native stack.
+        REQUIRE(parse_with_mode(src_file, ExprParseMode::Adaptive, 1000000,
+                                arena));
+        REQUIRE(parse_with_mode(src_file, ExprParseMode::Iterative, 1000000,
+                                arena));
+    }
+
+    SECTION("Long conditional chains") {
+        auto path = write_expr_chain("tpy_chain_600.py", 600);
+        auto *src_file = src_mgr.open_py_src_file(path.data());
+        tpy::Utility::ArenaAllocator arena;
+
+        auto *recursive =
+            parse_with_mode(src_file, ExprParseMode::Recursive, 1000, arena);
+        auto *iterative =
+            parse_with_mode(src_file, ExprParseMode::Iterative, 1000, arena);
+        REQUIRE(recursive);
+        REQUIRE(iterative);
+        REQUIRE(tree_to_string(recursive) == tree_to_string(iterative));
+
+        // The links of a chain are not nested expressions, so a long chain is
+        // within the default limit, and does not overflow the native stack in
+        // any mode.
+        path = write_expr_chain("tpy_chain_100000.py", 100000);
+        src_file = src_mgr.open_py_src_file(path.data());
+
+        auto before = tpy::Compiler::FrontendErrorHandler::error_count();
+        ExprParseMode modes[] = {ExprParseMode::Recursive,
+                                 ExprParseMode::Iterative,
+                                 ExprParseMode::Adaptive};
+        for (auto mode : modes) {
+            REQUIRE(parse_with_mode(
+                src_file, mode, tpy::Parse::Parser::DEFAULT_MAX_NESTING_DEPTH,
+                arena));
+        }
+
+        REQUIRE(tpy::Compiler::FrontendErrorHandler::error_count() == before);
+    }
+}
+
+/*
+    This helper will check that the segments of an incremental parser are the
+   same as the ones that a parse of its text from scratch produces. The tokens
+   and the f-strings of the segments must also be the same as the ones that the
+   lexer produces for the whole text.
+*/
+static auto check_incremental(tpy::Parse::IncrementalParser &parser) -> void {
+    tpy::Parse::IncrementalParser fresh{parser.source()};
+    REQUIRE(parser.segment_count() == fresh.segment_count());
+
+    tpy::Parse::Lexer lexer{parser.source()};
+    auto stream = tpy::Parse::TokenStream::lex_all(lexer);
+    auto full = stream.view();
+    size_t next_tok = 0;
+    size_t next_fstring = 0;
+
+    for (size_t i = 0; i < parser.segment_count(); i++) {
+        auto &segment = parser.segment(i);
+        auto &expected = fresh.segment(i);
+        REQUIRE(segment.width == expected.width);
+
+        auto start = parser.segment_start(i);
+        auto tokens = segment.tokens.view();
+        for (size_t k = 0; k < tokens.size; k++, next_tok++) {
+            REQUIRE(next_tok < full.size);
+            REQUIRE(tokens.kinds[k] == full.kinds[next_tok]);
+            REQUIRE(tokens.offsets[k] + start == full.offsets[next_tok]);
+            REQUIRE(tokens.lens[k] == full.lens[next_tok]);
+        }
+
+        auto fstrings = tokens.fstrings;
+        for (size_t k = 0; k < fstrings.num_fstrings; k++, next_fstring++) {
+            REQUIRE(next_fstring < full.fstrings.num_fstrings);
+            auto offset = full.fstrings.token_offsets[next_fstring];
+            REQUIRE(fstrings.token_offsets[k] + start == offset);
+
+            auto [first, last] = fstrings.find(fstrings.token_offsets[k]);
+            auto [full_first, full_last] = full.fstrings.find(offset);
+            REQUIRE(last - first == full_last - full_first);
+            for (auto i = first, j = full_first; i < last; i++, j++) {
+                auto &part = fstrings.segments[i];
+                auto &full_part = full.fstrings.segments[j];
+                REQUIRE(part.offset + start == full_part.offset);
+                REQUIRE(part.len == full_part.len);
+                REQUIRE(part.kind == full_part.kind);
+                REQUIRE(part.depth == full_part.depth);
+            }
+        }
+
+        REQUIRE(segment.body.size() == expected.body.size());
+        for (size_t k = 0; k < segment.body.size(); k++) {
+            REQUIRE(tree_to_string(segment.body[k]) ==
+                    tree_to_string(expected.body[k]));
+        }
+    }
+
+    REQUIRE(next_tok == full.size);
+    REQUIRE(next_fstring == full.fstrings.num_fstrings);
+}
+
+TEST_CASE("Incremental parsing is being tested", "[parser]") {
+    using namespace tpy::Tree;
+    tpy::Source::SourceManager src_mgr;
+    auto src_file = src_mgr.open_py_src_file("./tests/parser/module.py");
+
+    tpy::Parse::IncrementalParser parser{src_file};
+    check_incremental(parser);
+
+    // The module has 11 top-level statements, one of which is a line of two
+    // statements separated by ';'.
+    REQUIRE(parser.segment_count() == 11);
+
+    auto text = [&parser]() {
+        auto *source = parser.source();
+        return std::string{source->start(), source->size()};
+    };
+
+    auto edit = [&](const char *at, size_t old_len, const char *new_text) {
+        auto pos = text().find(at);
+        REQUIRE(pos != std::string::npos);
+        parser.edit(pos, old_len, new_text);
+        check_incremental(parser);
+    };
+
+    SECTION("Edits within a statement") {
+        std::vector<ASTNode *> before;
+        for (size_t i = 0; i < parser.segment_count(); i++) {
+            before.push_back(parser.segment(i).body[0]);
+        }
+
+        edit("global count", 0, "count += 1\n    ");
+        REQUIRE(parser.reparsed_segments() == 1);
+        REQUIRE(parser.reused_segments() == 10);
+
+        // The statements around the edit are the same nodes as before.
+        for (size_t i = 0; i < parser.segment_count(); i++) {
+            if (i != 8) {
+                REQUIRE(parser.segment(i).body[0] == before[i]);
+            }
+        }
+
+        edit("self.value", 4, "that");
+        REQUIRE(parser.reparsed_segments() == 1);
+    }
+
+    SECTION("Edits that add and remove statements") {
+        edit("class C", 0, "z = 2\n\n");
+        REQUIRE(parser.segment_count() == 12);
+
+        edit("z = 2", 7, "");
+        REQUIRE(parser.segment_count() == 11);
+
+        // An indented statement belongs to the statement before it.
+        edit("class C", 0, "    ");
+        REQUIRE(parser.segment_count() == 10);
+
+        edit("    class C", 4, "");
+        REQUIRE(parser.segment_count() == 11);
+
+        edit("\"\"\"A module", 0, "\n# A comment.\nimport a\n");
+        REQUIRE(parser.segment_count() == 12);
+    }
+
+    SECTION("F-strings") {
+        edit("class C", 0, "s = f'{a!r:>{width}} and {b}'\n");
+        REQUIRE(parser.segment_count() == 12);
+
+        // The index of the f-string moves along with its segment.
+        edit("import", 0, "t = f'{c}'\n");
+        REQUIRE(parser.reparsed_segments() == 2);
+
+        edit("{b}", 3, "{b:{c}}");
+        REQUIRE(parser.reparsed_segments() == 1);
+
+        edit("and", 0, "'; u = f'{d}");
+        edit("s = f", 0, "(");
+        edit("(s = f", 1, "");
+    }
+
+    SECTION("Edits that span several statements") {
+        // An open bracket runs on until the lexer gives up on it at the next
+        // line that begins with a statement keyword. That is the 'def' after
+        // the decorators, so the lexer resyncs at the class after it.
+        edit("y = 1, 2", 0, "(");
+        REQUIRE(parser.segment_count() == 9);
+        REQUIRE(parser.reparsed_segments() == 2);
+        REQUIRE(parser.reused_segments() == 7);
+
+        edit("(y = 1, 2", 1, "");
+        REQUIRE(parser.segment_count() == 11);
+
+        auto pos = text().find("x[0]");
+        parser.edit(pos, text().find("try:") - pos, "pass\r\n");
+        check_incremental(parser);
+        REQUIRE(parser.segment_count() == 8);
+    }
+
+    SECTION("Line map") {
+        edit("import", 0, "a = 1\r\nb = 2\r");
+        edit("\rimport", 0, "\n");
+        edit("count: int", 0, "\n\r\n");
+
+        // The line map must be the same as the one that is built when the file
+        // is opened.
+        auto path = (std::filesystem::temp_directory_path() /
+                     "tpy_incremental.py")
+                        .string();
+        std::ofstream{path, std::ios::binary} << text();
+        auto *edited = src_mgr.open_py_src_file(path.data());
+
+        auto &line_map = parser.source()->line_map;
+        REQUIRE(line_map.size() == edited->line_map.size());
+        for (size_t i = 0; i < line_map.size(); i++) {
+            REQUIRE(line_map[i].pos == edited->line_map[i].pos);
+            REQUIRE(line_map[i].len == edited->line_map[i].len);
+        }
+    }
+}
+
+/*
+    This sink records the events of a module as a string of short marks, so that
+   the events can be compared against the expected ones.
+*/
+class RecordingSink : public tpy::Parse::EventSink {
+    auto group_mark(tpy::Parse::GroupKind kind) -> char {
+        return "PCDLSB"[static_cast<int>(kind)];
+    }
+
+  public:
+    std::string events;
+
+    auto enter_stmt(tpy::Parse::TokenKind kind, tpy::Source::Span) -> void {
+        events += std::string{"<"} +
+                  tpy::Parse::token_names[static_cast<int>(kind)] + " ";
+    }
+
+    auto leave_stmt(tpy::Source::Span) -> void { events += "> "; }
+
+    auto enter_block(tpy::Source::Span) -> void { events += "{ "; }
+
+    auto leave_block(tpy::Source::Span) -> void { events += "} "; }
+
+    auto enter_group(tpy::Parse::GroupKind kind, tpy::Source::Span) -> void {
+        events += std::string{"("} + group_mark(kind) + " ";
+    }
+
+    auto leave_group(tpy::Parse::GroupKind kind, tpy::Source::Span) -> void {
+        events += std::string{")"} + group_mark(kind) + " ";
+    }
+
+    auto visit_name(tpy::Source::Span) -> void { events += "n "; }
+
+    auto visit_attribute(tpy::Source::Span) -> void { events += "a "; }
+
+    auto visit_definition(tpy::Parse::TokenKind, tpy::Source::Span) -> void {
+        events += "d ";
+    }
+
+    auto visit_literal(tpy::Parse::TokenKind, tpy::Source::Span) -> void {
+        events += "l ";
+    }
+
+    auto visit_keyword(tpy::Parse::TokenKind, tpy::Source::Span) -> void {
+        events += "k ";
+    }
+};
+
+// This sink only counts the groups that are entered and left.
+class GroupCountingSink : public tpy::Parse::EventSink {
+  public:
+    size_t entered = 0, left = 0;
+
+    auto enter_group(tpy::Parse::GroupKind, tpy::Source::Span) -> void {
+        ++entered;
+    }
+
+    auto leave_group(tpy::Parse::GroupKind, tpy::Source::Span) -> void {
+        ++left;
+    }
+};
+
+// This sink only records the kinds of the literals.
+class LiteralSink : public tpy::Parse::EventSink {
+  public:
+    std::vector<tpy::Parse::TokenKind> kinds;
+
+    auto visit_literal(tpy::Parse::TokenKind kind, tpy::Source::Span) -> void {
+        kinds.push_back(kind);
+    }
+};
+
+TEST_CASE("Event parsing is being tested", "[parser]") {
+    tpy::Source::SourceManager src_mgr;
+
+    SECTION("Events") {
+        auto src_file = src_mgr.open_py_src_file("./tests/parser/events.py");
+        tpy::Parse::Lexer lexer{src_file};
+        auto stream = tpy::Parse::TokenStream::lex_all(lexer);
+
+        RecordingSink sink;
+        tpy::Parse::EventParser<RecordingSink> parser{stream.view(), src_file,
+                                                      sink};
+        parser.parse_py_module();
+
+        REQUIRE(sink.events ==
+                "<KeywordImport k n a > "
+                "<KeywordFrom k n k n > <Identifier n l > "
+                "<KeywordDef k d (D n )D > "
+                "{ <KeywordReturn k n (C n (S l )S (L l l )L "
+                "(B n (P n )P )B )C > } ");
+    }
+
+    SECTION("Ellipsis") {
+        auto path = (std::filesystem::temp_directory_path() /
+                     "tpy_events_ellipsis.py")
+                        .string();
+        std::ofstream{path} << "x = ...\n";
+
+        auto *src_file = src_mgr.open_py_src_file(path.data());
+        tpy::Parse::Lexer lexer{src_file};
+        auto stream = tpy::Parse::TokenStream::lex_all(lexer);
+
+        LiteralSink sink;
+        tpy::Parse::EventParser<LiteralSink> parser{stream.view(), src_file,
+                                                    sink};
+        parser.parse_py_module();
+
+        REQUIRE(sink.kinds.size() == 1);
+        REQUIRE(sink.kinds[0] == tpy::Parse::TokenKind::Ellipsis);
+    }
+
+    SECTION("Pathological nesting") {
+        auto path = write_nested_expr("tpy_nested_100000.py", 100000);
+        auto *src_file = src_mgr.open_py_src_file(path.data());
+        tpy::Parse::Lexer lexer{src_file};
+        auto stream = tpy::Parse::TokenStream::lex_all(lexer);
+
+        GroupCountingSink sink;
+        tpy::Parse::EventParser<GroupCountingSink> parser{stream.view(),
+                                                          src_file, sink};
+        parser.parse_py_module();
+
+        // Every group is left again, even though it is nested far deeper than
+        // the tree parser allows.
+        REQUIRE(sink.entered > 50000);
+        REQUIRE(sink.entered == sink.left);
+    }
+}
+
+/*
+    This helper will overwrite each 32-bit word after the header of the only
+   entry within a cache directory with a large value, one word at a time, and
+   call the check after every change. It returns the number of changes that the
+   check rejected, and the entry is restored at the end.
+*/
+template <class Check>
+static auto corrupt_each_word(const std::filesystem::path &cache_dir,
+                              size_t header_size, Check check) -> size_t {
+    auto path = std::filesystem::directory_iterator{cache_dir}->path();
+
+    std::string contents;
+    {
+        std::ifstream file{path, std::ios::binary};
+        contents.assign(std::istreambuf_iterator<char>{file}, {});
+    }
+
+    size_t rejected = 0;
+    for (size_t pos = header_size; pos + 4 <= contents.size(); pos += 4) {
+        auto corrupted = contents;
+        uint32_t word = 0xFFFFFF00;
+        memcpy(corrupted.data() + pos, &word, sizeof(word));
+
+        std::ofstream{path, std::ios::binary} << corrupted;
+        rejected += !check();
+    }
+
+    std::ofstream{path, std::ios::binary} << contents;
+    return rejected;
+}
+
+TEST_CASE("Token cache is being tested", "[token_cache]") {
+    using tpy::Parse::TokenKind;
+    tpy::Source::SourceManager src_mgr;
+    auto src_file =
+        src_mgr.open_py_src_file("./tests/parser/dict_literal.py");
+
+    auto cache_dir = std::filesystem::temp_directory_path() / "tpy_token_cache";
+    std::filesystem::remove_all(cache_dir);
+    tpy::Parse::TokenCache cache{cache_dir.string()};
+
+    // The first lookup must miss, as the cache is empty.
+    REQUIRE(!cache.load(src_file));
+
+    tpy::Parse::Lexer lexer{src_file};
+    auto stream = tpy::Parse::TokenStream::lex_all(lexer);
+    REQUIRE(stream.view().kind(stream.size() - 1) == TokenKind::End);
+    REQUIRE(cache.store(src_file, stream));
+
+    auto cached = cache.load(src_file);
+    REQUIRE(cached);
+
+    auto expected = stream.view();
+    auto actual = cached->view();
+    REQUIRE(actual.size == expected.size);
+    for (size_t i = 0; i < actual.size; i++) {
+        REQUIRE(actual.kinds[i] == expected.kinds[i]);
+        REQUIRE(actual.offsets[i] == expected.offsets[i]);
+        REQUIRE(actual.lens[i] == expected.lens[i]);
+    }
+
+    // Parsing the cached tokens must give the same tree as the lexer.
+    tpy::Parse::Lexer fresh_lexer{src_file};
+    tpy::Utility::ArenaAllocator arena;
+    tpy::Parse::Parser lexer_parser{fresh_lexer, arena};
+    tpy::Parse::Parser cache_parser{actual, src_file, arena};
+
+    auto *lexed_tree = lexer_parser.parse_py_compilation_unit();
+    auto *cached_tree = cache_parser.parse_py_compilation_unit();
+    REQUIRE(lexed_tree);
+    REQUIRE(cached_tree);
+    REQUIRE(tree_to_string(lexed_tree) == tree_to_string(cached_tree));
+
+    // The f-string index must be stored along with the tokens.
+    auto fstring_file =
+        src_mgr.open_py_src_file("./tests/lexer/string_literals.py");
+    tpy::Parse::Lexer fstring_lexer{fstring_file};
+    auto fstring_stream = tpy::Parse::TokenStream::lex_all(fstring_lexer);
+    REQUIRE(cache.store(fstring_file, fstring_stream));
+
+    auto cached_fstrings = cache.load(fstring_file);
+    REQUIRE(cached_fstrings);
+
+    auto expected_index = fstring_stream.view().fstrings;
+    auto actual_index = cached_fstrings->view().fstrings;
+    REQUIRE(actual_index.num_fstrings == expected_index.num_fstrings);
+    REQUIRE(actual_index.num_segments == expected_index.num_segments);
+    for (size_t i = 0; i < actual_index.num_segments; i++) {
+        REQUIRE(actual_index.segments[i].offset ==
+                expected_index.segments[i].offset);
+        REQUIRE(actual_index.segments[i].len == expected_index.segments[i].len);
+    }
+    REQUIRE(actual_index.find(cached_fstrings->view().offsets[5]) ==
+            expected_index.find(fstring_stream.view().offsets[5]));
+
+    // A corrupted entry is either a miss or a stream whose spans and segments
+    // can all be read, ending with the 'End' token.
+    std::filesystem::remove_all(cache_dir);
+    REQUIRE(cache.store(fstring_file, fstring_stream));
+
+    auto rejected =
+        corrupt_each_word(cache_dir, sizeof(tpy::Parse::TokenCacheHeader), [&] {
+            auto corrupted = cache.load(fstring_file);
+            if (!corrupted) {
+                return false;
+            }
+
+            auto view = corrupted->view();
+            size_t sum = 0;
+            for (size_t i = 0; i < view.size; i++) {
+                for (size_t k = 0; k < view.lens[i]; k++) {
+                    sum += fstring_file->start()[view.offsets[i] + k];
+                }
+
+                auto [begin, end] = view.fstrings.find(view.offsets[i]);
+                for (auto k = begin; k < end; k++) {
+                    sum += view.fstrings.segments[k].len;
+                }
+            }
+
+            return sum > 0 && view.kind(view.size - 1) == TokenKind::End;
+        });
+    REQUIRE(rejected > 0);
+    REQUIRE(cache.load(fstring_file));
+
+    std::filesystem::remove_all(cache_dir);
+}
+
+TEST_CASE("Flat AST is being tested", "[tree]") {
+    using namespace tpy::Tree;
+    tpy::Source::SourceManager src_mgr;
+
+    auto parse_module = [&](const std::string &path,
+                            tpy::Utility::ArenaAllocator &arena) {
+        auto *src_file = src_mgr.open_py_src_file(std::string{path}.data());
+        tpy::Parse::Lexer lexer{src_file};
+        tpy::Parse::Parser parser{lexer, arena};
+        return parser.parse_py_module();
+    };
+
+    SECTION("Round trip") {
+        std::string paths[] = {
+            "./tests/parser/module.py",       "./tests/parser/recovery.py",
+            "./tests/parser/set_literal.py",  "./tests/parser/dict_literal.py",
+            "./tests/parser/call_expr.py",    "./tests/parser/slice_expr.py",
+            "./tests/parser/binary_expr.py",  "./tests/parser/precedence.py",
+            "./tests/parser/grammar.py",
+            "./tests/lexer/string_literals.py"};
+
+        for (auto &path : paths) {
+            tpy::Utility::ArenaAllocator arena;
+            auto *module = parse_module(path, arena);
+            REQUIRE(module);
+
+            // The tree that is rebuilt from a copy of the columns must be the
+            // same as the original one.
+            auto flat = FlatAST::from_tree(module);
+            auto copy = flat;
+            REQUIRE(tree_to_string(copy.to_tree(arena)) ==
+                    tree_to_string(module));
+        }
+    }
+
+    SECTION("Fields") {
+        tpy::Utility::ArenaAllocator arena;
+        auto *module = dynamic_cast<ASTModuleNode *>(
+            parse_module("./tests/parser/module.py", arena));
+        REQUIRE(module);
+
+        auto flat = FlatAST::from_tree(module);
+        REQUIRE(flat.root() == 0);
+        REQUIRE(flat.kind(0) == ASTNodeKind::Module);
+
+        auto body = flat.list(0, 0);
+        REQUIRE(body.size() == 12);
+        REQUIRE(flat.loc(body[5]).local_pos == module->body[5]->loc.local_pos);
+
+        // The decorators, the name, the parameters, the return annotation,
+        // and the body of a function are its fields.
+        auto func = body[9];
+        REQUIRE(flat.kind(func) == ASTNodeKind::FunctionDef);
+        REQUIRE(flat.list(func, 0).size() == 2);
+        REQUIRE(flat.kind(flat.child(func, 1)) == ASTNodeKind::NameExpr);
+        REQUIRE(flat.list(func, 2).size() == 6);
+        REQUIRE(flat.list(func, 4).size() == 3);
+
+        // Every child comes after its parent.
+        for (auto stmt : body) {
+            REQUIRE(stmt > 0);
+        }
+
+        // A missing child is stored as 'NO_NODE'.
+        auto *import = dynamic_cast<ASTImportFromStmtNode *>(module->body[2]);
+        REQUIRE(import);
+        REQUIRE(!import->module);
+        REQUIRE(flat.child(body[2], 0) == FlatAST::NO_NODE);
+        REQUIRE(flat.payload(body[2]) == import->level);
+    }
+
+    SECTION("Deep trees") {
+        auto path = write_nested_expr("tpy_nested_100000.py", 100000);
+        auto *src_file = src_mgr.open_py_src_file(path.data());
+
+        tpy::Utility::ArenaAllocator arena;
+        tpy::Parse::Lexer lexer{src_file};
+        tpy::Parse::Parser parser{lexer, arena};
+        parser.set_max_nesting_depth(1000000);
+        auto *module = parser.parse_py_module();
+        REQUIRE(module);
+
+        // Neither direction recurses, so the depth of the tree does not matter.
+        auto flat = FlatAST::from_tree(module);
+        auto again = FlatAST::from_tree(flat.to_tree(arena));
+        REQUIRE(flat.size() > 100000);
+        REQUIRE(again.size() == flat.size());
+
+        size_t mismatches = 0;
+        for (FlatAST::NodeIndex i = 0; i < flat.size(); i++) {
+            mismatches += again.kind(i) != flat.kind(i);
+        }
+        REQUIRE(mismatches == 0);
+    }
+}
+
+TEST_CASE("AST cache is being tested", "[tree]") {
+    using namespace tpy::Tree;
+    tpy::Source::SourceManager src_mgr;
+    auto src_file = src_mgr.open_py_src_file("./tests/parser/module.py");
+
+    auto cache_dir = std::filesystem::temp_directory_path() / "tpy_ast_cache";
+    std::filesystem::remove_all(cache_dir);
+    ASTCache cache{cache_dir.string()};
+
+    // The first lookup must miss, as the cache is empty.
+    REQUIRE(!cache.load(src_file));
+
+    tpy::Parse::Lexer lexer{src_file};
+    tpy::Utility::ArenaAllocator arena;
+    tpy::Parse::Parser parser{lexer, arena};
+    auto *module = parser.parse_py_module();
+    REQUIRE(module);
+
+    auto flat = FlatAST::from_tree(module);
+    REQUIRE(cache.store(src_file, flat));
+
+    auto cached = cache.load(src_file);
+    REQUIRE(cached);
+
+    // The columns must match, apart from the payloads of the names.
+    auto tree = cached->view();
+    REQUIRE(tree.size() == flat.size());
+    for (FlatAST::NodeIndex i = 0; i < tree.size(); i++) {
+        REQUIRE(tree.kind(i) == flat.kind(i));
+        REQUIRE(tree.loc(i).local_pos == flat.loc(i).local_pos);
+        REQUIRE(tree.loc(i).absolute_pos == flat.loc(i).absolute_pos);
+        REQUIRE(tree.loc(i).len == flat.loc(i).len);
+    }
+
+    // The names can be read back without the source, and every distinct name
+    // is stored once.
+    size_t num_names = 0;
+    for (FlatAST::NodeIndex i = 0; i < tree.size(); i++) {
+        if (tree.kind(i) != ASTNodeKind::NameExpr) {
+            continue;
+        }
+
+        auto loc = tree.loc(i);
+        REQUIRE(cached->name(i) ==
+                std::string_view(src_file->start() + loc.local_pos, loc.len));
+        num_names++;
+    }
+    REQUIRE(cached->string_count() > 0);
+    REQUIRE(cached->string_count() < num_names);
+
+    // The mapped tree must rebuild the same objects as the parser.
+    REQUIRE(tree_to_string(tree.to_tree(arena)) == tree_to_string(module));
+
+    // A file with other contents must not find the entry.
+    auto other_file =
+        src_mgr.open_py_src_file("./tests/parser/dict_literal.py");
+    REQUIRE(!cache.load(other_file));
+
+    // A corrupted entry is either a miss or a tree that can be rebuilt, but it
+    // is never read out of bounds.
+    auto rejected = corrupt_each_word(cache_dir, sizeof(ASTCacheHeader), [&] {
+        auto corrupted = cache.load(src_file);
+        if (corrupted) {
+            corrupted->view().to_tree(arena);
+        }
+        return corrupted != nullptr;
+    });
+    REQUIRE(rejected > 0);
+    REQUIRE(cache.load(src_file));
+
+    std::filesystem::remove_all(cache_dir);
+}
+
+// This visitor records the kind of every node that it visits.
+class KindRecorder : public tpy::Tree::ASTVisitor<KindRecorder> {
+  public:
+    std::vector<tpy::Tree::ASTNodeKind> kinds;
+
+    auto visit_default(tpy::Tree::ASTNode *node) -> void {
+        kinds.push_back(node->kind);
+    }
+};
+
+// This visitor returns the number of direct children of the names, calls and
+// functions, and zero for every other node.
+class ChildCounter : public tpy::Tree::ASTVisitor<ChildCounter, size_t> {
+    static auto count(tpy::Tree::ASTNode *node) -> size_t {
+        size_t count = 0;
+        tpy::Tree::for_each_child(node, [&](tpy::Tree::ASTNode *) { ++count; });
+        return count;
+    }
+
+  public:
+    using ASTVisitor::visit;
+
+    auto visit(tpy::Tree::ASTNameExprNode *) -> size_t { return 1000; }
+
+    auto visit(tpy::Tree::ASTCallExprNode *node) -> size_t {
+        return count(node);
+    }
+
+    auto visit(tpy::Tree::ASTFunctionDefNode *node) -> size_t {
+        return count(node);
+    }
+};
+
+TEST_CASE("Visitors are being tested", "[tree]") {
+    using namespace tpy::Tree;
+    tpy::Source::SourceManager src_mgr;
+
+    SECTION("Kinds") {
+        tpy::Utility::ArenaAllocator arena;
+        auto *src_file = src_mgr.open_py_src_file("./tests/parser/module.py");
+        tpy::Parse::Lexer lexer{src_file};
+        tpy::Parse::Parser parser{lexer, arena};
+        auto *module = parser.parse_py_module();
+        REQUIRE(module);
+        REQUIRE(module->kind == ASTNodeKind::Module);
+
+        // The visitor visits every node once, and a parent always comes
+        // before its children.
+        KindRecorder recorder;
+        recorder.traverse(module);
+        REQUIRE(recorder.kinds.front() == ASTNodeKind::Module);
+        REQUIRE(recorder.kinds[1] == ASTNodeKind::ExprStmt);
+        REQUIRE(recorder.kinds[2] == ASTNodeKind::StringLiteral);
+
+        std::vector<size_t> visited(NUM_AST_NODE_KINDS);
+        std::vector<size_t> flattened(NUM_AST_NODE_KINDS);
+        for (auto kind : recorder.kinds) {
+            ++visited[static_cast<size_t>(kind)];
+        }
+
+        auto flat = FlatAST::from_tree(module);
+        for (FlatAST::NodeIndex i = 0; i < flat.size(); i++) {
+            ++flattened[static_cast<size_t>(flat.kind(i))];
+        }
+        REQUIRE(visited == flattened);
+
+        // The handlers are picked by the class of the node.
+        auto *body = static_cast<ASTModuleNode *>(module);
+        auto *func = body->body[9];
+        REQUIRE(func->kind == ASTNodeKind::FunctionDef);
+
+        ChildCounter counter;
+        REQUIRE(counter.visit_node(func) == 2 + 1 + 6 + 1 + 3);
+        REQUIRE(counter.visit_node(static_cast<ASTFunctionDefNode *>(func)
+                                       ->name) == 1000);
+        REQUIRE(counter.visit_node(module) == 0);
+    }
+
+    SECTION("Deep trees") {
+        auto path = write_nested_expr("tpy_nested_100000.py", 100000);
+        auto *src_file = src_mgr.open_py_src_file(path.data());
+
+        tpy::Utility::ArenaAllocator arena;
+        tpy::Parse::Lexer lexer{src_file};
+        tpy::Parse::Parser parser{lexer, arena};
+        parser.set_max_nesting_depth(1000000);
+        auto *module = parser.parse_py_module();
+        REQUIRE(module);
+
+        // The traversal does not recurse, so the depth of the tree does not
+        // matter.
+        KindRecorder recorder;
+        recorder.traverse(module);
+        REQUIRE(recorder.kinds.size() == FlatAST::from_tree(module).size());
+        REQUIRE(recorder.kinds.back() == ASTNodeKind::NameExpr);
+    }
+}
+
+// This pass records the kind of every node that it enters, and checks that
+// the nodes are left in the reverse order.
+class OrderPass : public tpy::Tree::ASTPass {
+  public:
+    std::vector<tpy::Tree::ASTNodeKind> kinds;
+    std::vector<tpy::Tree::ASTNode *> open;
+    size_t mismatched_leaves = 0;
+
+    auto enter(tpy::Tree::ASTNode *node) -> void {
+        kinds.push_back(node->kind);
+        open.push_back(node);
+    }
+
+    auto leave(tpy::Tree::ASTNode *node) -> void {
+        mismatched_leaves += open.empty() || open.back() != node;
+        if (!open.empty()) {
+            open.pop_back();
+        }
+    }
+};
+
+// This pass counts the names, and may run on several threads at once.
+class NameCountPass : public tpy::Tree::ASTPass {
+  public:
+    static constexpr const char *NAME = "names";
+    static constexpr bool THREAD_SAFE = true;
+
+    std::atomic<size_t> entered = 0, left = 0, names = 0;
+
+    auto enter(tpy::Tree::ASTNode *node) -> void {
+        ++entered;
+        names += node->kind == tpy::Tree::ASTNodeKind::NameExpr;
+    }
+
+    auto leave(tpy::Tree::ASTNode *) -> void { ++left; }
+};
+
+TEST_CASE("Pass manager is being tested", "[tree]") {
+    using namespace tpy::Tree;
+    tpy::Source::SourceManager src_mgr;
+
+    tpy::Utility::ArenaAllocator arena;
+    auto *src_file = src_mgr.open_py_src_file("./tests/parser/module.py");
+    tpy::Parse::Lexer lexer{src_file};
+    tpy::Parse::Parser parser{lexer, arena};
+    auto *module = parser.parse_py_module();
+    REQUIRE(module);
+
+    KindRecorder recorder;
+    recorder.traverse(module);
+    size_t names = std::count(recorder.kinds.begin(), recorder.kinds.end(),
+                              ASTNodeKind::NameExpr);
+
+    SECTION("Fused passes") {
+        // Every pass sees the same nodes in the same order as it would on its
+        // own.
+        OrderPass order;
+        NameCountPass counter;
+        PassManager manager{order, counter};
+        manager.run(module);
+
+        REQUIRE(order.kinds == recorder.kinds);
+        REQUIRE(order.open.empty());
+        REQUIRE(order.mismatched_leaves == 0);
+        REQUIRE(counter.entered == recorder.kinds.size());
+        REQUIRE(counter.left == recorder.kinds.size());
+        REQUIRE(counter.names == names);
+    }
+
+    SECTION("Parallel passes") {
+        OrderPass order;
+        NameCountPass counter;
+        PassManager manager{order, counter};
+        manager.set_num_threads(4);
+        manager.set_timed(true);
+
+        for (int run = 0; run < 10; run++) {
+            order = OrderPass{};
+            counter.entered = counter.left = counter.names = 0;
+            manager.run(module);
+
+            // The pass that is not thread-safe still runs in order.
+            REQUIRE(order.kinds == recorder.kinds);
+            REQUIRE(order.mismatched_leaves == 0);
+            REQUIRE(counter.entered == recorder.kinds.size());
+            REQUIRE(counter.left == recorder.kinds.size());
+            REQUIRE(counter.names == names);
+        }
+
+        REQUIRE(manager.pass_time(0) > 0);
+        REQUIRE(manager.pass_time(1) > 0);
+        REQUIRE(manager.run_time() > 0);
+
+        // Without any other passes, every node is still visited exactly once.
+        PassManager parallel_only{counter};
+        parallel_only.set_num_threads(4);
+        counter.entered = counter.left = counter.names = 0;
+        parallel_only.run(module);
+
+        REQUIRE(counter.entered == recorder.kinds.size());
+        REQUIRE(counter.left == recorder.kinds.size());
+        REQUIRE(counter.names == names);
+    }
+}
+
+TEST_CASE("AST writer is being tested", "[tree]") {
+    using namespace tpy::Tree;
+    tpy::Source::SourceManager src_mgr;
+
+    SECTION("Output buffer") {
+        // A tiny buffer is flushed many times along the way.
+        std::string result;
+        {
+            tpy::Utility::OutputBuffer out{result, 8};
+            for (uint64_t value : {0ull, 7ull, 10ull, 99ull, 100ull, 12345ull,
+                                   18446744073709551615ull}) {
+                out.write_uint(value);
+                out.put(' ');
+            }
+
+            out.write_indent(300);
+            out.write("a string that is longer than the buffer");
+        }
+
+        REQUIRE(result == "0 7 10 99 100 12345 18446744073709551615 " +
+                              std::string(300, ' ') +
+                              "a string that is longer than the buffer");
+    }
+
+    tpy::Utility::ArenaAllocator arena;
+    auto *src_file = src_mgr.open_py_src_file("./tests/tree/writer.py");
+    tpy::Parse::Lexer lexer{src_file};
+    tpy::Parse::Parser parser{lexer, arena};
+    auto *module = parser.parse_py_module();
+    REQUIRE(module);
+
+    SECTION("S-expressions") {
+        std::string result;
+        {
+            tpy::Utility::OutputBuffer out{result};
+            ASTWriter{out, ASTFormat::SExpr}.write(module);
+        }
+
+        REQUIRE(result ==
+                "(Module 0 31 :body [(AssignStmt 0 19 :targets [(NameExpr 0 "
+                "1)] :value (DictExpr 4 19 :contents [[(NameExpr 5 6) "
+                "(IntLiteral 8 9 :base 10)] [(NameExpr 11 12) (BoolLiteral 14 "
+                "18 :val true)]])) (ExprStmt 20 29 :expr (ProperSliceExpr 20 "
+                "29 :slicee (CallExpr 20 25 :callee (NameExpr 20 21) :args "
+                "[(UnaryOpExpr 22 24 :op Minus :expr (NameExpr 23 24))]) "
+                ":lower_bound (IntLiteral 26 27 :base 10)))])\n");
+    }
+
+    SECTION("JSON") {
+        auto *assign = static_cast<ASTAssignStmtNode *>(
+            static_cast<ASTModuleNode *>(module)->body[0]);
+
+        std::string result;
+        {
+            tpy::Utility::OutputBuffer out{result};
+            ASTWriter{out, ASTFormat::JSON}.write(assign->value);
+        }
+
+        REQUIRE(result == R"({
+  "kind": "DictExpr",
+  "start": 4,
+  "end": 19,
+  "contents": [
+    [
+      {
+        "kind": "NameExpr",
+        "start": 5,
+        "end": 6
+      },
+      {
+        "kind": "IntLiteral",
+        "start": 8,
+        "end": 9,
+        "base": 10
+      }
+    ],
+    [
+      {
+        "kind": "NameExpr",
+        "start": 11,
+        "end": 12
+      },
+      {
+        "kind": "BoolLiteral",
+        "start": 14,
+        "end": 18,
+        "val": true
+      }
+    ]
+  ]
+}
+)");
+
+        // The missing children are written as 'null'.
+        auto *call = static_cast<ASTExprStmtNode *>(
+            static_cast<ASTModuleNode *>(module)->body[1]);
+
+        result.clear();
+        {
+            tpy::Utility::OutputBuffer out{result};
+            ASTWriter{out, ASTFormat::JSON}.write(call);
+        }
+
+        REQUIRE(result.find("\"upper_bound\": null") != std::string::npos);
+    }
+
+    SECTION("Deep trees") {
+        auto path = write_nested_expr("tpy_nested_100000.py", 100000);
+        auto *nested_file = src_mgr.open_py_src_file(path.data());
+
+        tpy::Parse::Lexer nested_lexer{nested_file};
+        tpy::Parse::Parser nested_parser{nested_lexer, arena};
+        nested_parser.set_max_nesting_depth(1000000);
+        auto *nested = nested_parser.parse_py_module();
+        REQUIRE(nested);
+
+        // The writer does not recurse, so the depth of the tree does not
+        // matter.
+        std::string result;
+        {
+            tpy::Utility::OutputBuffer out{result};
+            ASTWriter{out, ASTFormat::SExpr}.write(nested);
+        }
+
+        auto opened = std::count(result.begin(), result.end(), '(');
+        REQUIRE(opened > 100000);
+        REQUIRE(std::count(result.begin(), result.end(), ')') == opened);
+    }
+}
+
+TEST_CASE("Structural hashing is being tested", "[tree]") {
+    using namespace tpy::Tree;
+    tpy::Source::SourceManager src_mgr;
+
+    tpy::Utility::ArenaAllocator arena;
+    auto *src_file = src_mgr.open_py_src_file("./tests/tree/repeated.py");
+    tpy::Parse::Lexer lexer{src_file};
+    tpy::Parse::Parser parser{lexer, arena};
+    auto *module = static_cast<ASTModuleNode *>(parser.parse_py_module());
+    REQUIRE(module);
+    REQUIRE(module->body.size() == 4);
+
+    auto assign = [&](size_t i) {
+        return static_cast<ASTAssignStmtNode *>(module->body[i]);
+    };
+
+    SECTION("Hashes") {
+        StructuralHasher hasher{src_file};
+        REQUIRE(hasher.hash_tree(module) == module->hash);
+
+        // The same expression has the same hash wherever it is, but the
+        // names that it is assigned to differ.
+        REQUIRE(assign(0)->value != assign(1)->value);
+        REQUIRE(assign(0)->value->hash == assign(1)->value->hash);
+        REQUIRE(assign(0)->targets[0]->hash != assign(1)->targets[0]->hash);
+
+        // A missing bound is part of the structure.
+        auto *slices = static_cast<ASTTupleExprNode *>(assign(2)->value);
+        REQUIRE(slices->elements[0]->hash != slices->elements[1]->hash);
+    }
+
+    SECTION("Hashes while parsing") {
+        auto expected = StructuralHasher{src_file}.hash_tree(module);
+
+        // A hasher that is attached to the parser gives every node the same
+        // hash as a walk of the finished tree.
+        tpy::Utility::ArenaAllocator hashed_arena;
+        StructuralHasher hasher{src_file};
+        tpy::Parse::Lexer hashed_lexer{src_file};
+        tpy::Parse::Parser hashed_parser{hashed_lexer, hashed_arena};
+        hashed_parser.attach_hasher(&hasher);
+
+        auto *hashed = hashed_parser.parse_py_module();
+        REQUIRE(hashed->hash == expected);
+
+        std::vector<uint32_t> hashes, rehashed;
+        auto collect = [](ASTNode *root, std::vector<uint32_t> &out) {
+            std::vector<ASTNode *> stack{root};
+            while (!stack.empty()) {
+                auto *node = stack.back();
+                stack.pop_back();
+                out.push_back(node->hash);
+                for_each_child(node,
+                               [&](ASTNode *child) { stack.push_back(child); });
+            }
+        };
+
+        collect(hashed, hashes);
+        hasher.hash_tree(hashed);
+        collect(hashed, rehashed);
+        REQUIRE(hashes == rehashed);
+
+        // Such a tree is interned without hashing it again.
+        HashConser conser{src_file};
+        REQUIRE(conser.intern(hashed, true) == hashed);
+        REQUIRE(conser.shared_count() >= 8);
+    }
+
+    SECTION("Hash-consing") {
+        HashConser conser{src_file};
+        REQUIRE(conser.intern(module) == module);
+
+        REQUIRE(assign(0)->value == assign(1)->value);
+        REQUIRE(assign(0)->targets[0] != assign(1)->targets[0]);
+
+        // The two f-strings are the same, even though their segments are not.
+        auto *call = static_cast<ASTCallExprNode *>(
+            static_cast<ASTExprStmtNode *>(module->body[3])->expr);
+        REQUIRE(call->args[0] == call->args[1]);
+
+        // 'config.options.verbose + 1' has six nodes, and the 'a' of the
+        // slices and the 'x' of the f-strings are shared as well.
+        REQUIRE(conser.shared_count() >= 8);
+        REQUIRE(conser.shared_bytes() < conser.total_bytes());
+        REQUIRE(conser.dedup_ratio() > 0.0);
+
+        // A copy keeps the sharing, and has the same structure.
+        tpy::Utility::ArenaAllocator copy_arena;
+        auto *copy =
+            static_cast<ASTModuleNode *>(copy_tree(module, copy_arena));
+        REQUIRE(copy != module);
+
+        auto copy_value = [&](size_t i) {
+            return static_cast<ASTAssignStmtNode *>(copy->body[i])->value;
+        };
+        REQUIRE(copy_value(0) == copy_value(1));
+        REQUIRE(copy_value(0) != assign(0)->value);
+
+        auto hash = module->hash;
+        REQUIRE(StructuralHasher{src_file}.hash_tree(copy) == hash);
+    }
+}
+
+TEST_CASE("Constant folding is being tested", "[tree]") {
+    using namespace tpy::Tree;
+
+    SECTION("Big integers") {
+        using tpy::Utility::BigInt;
+
+        BigInt value;
+        REQUIRE(BigInt::parse("1_000_000_000_000_000_000_000", 10, value));
+        REQUIRE(value.to_decimal() == "1000000000000000000000");
+        REQUIRE((-value).to_decimal() == "-1000000000000000000000");
+        REQUIRE(!BigInt::parse("12a", 10, value));
+
+        auto big = BigInt{2}.pow(100);
+        REQUIRE(big.bit_length() == 101);
+        REQUIRE((big - big).is_zero());
+        REQUIRE(big.shift_right(100) == BigInt{1});
+
+        // Division rounds down, and the bitwise operators act on two's
+        // complement, as in Python.
+        BigInt quotient, remainder;
+        BigInt::floor_divmod(-big, BigInt{7}, quotient, remainder);
+        REQUIRE(quotient * BigInt{7} + remainder == -big);
+        REQUIRE(remainder.compare(BigInt{0}) >= 0);
+        REQUIRE((BigInt{-6} & BigInt{0xFF}) == BigInt{250});
+        REQUIRE(BigInt{-7}.shift_right(1) == BigInt{-4});
+        REQUIRE(~BigInt{5} == BigInt{-6});
+
+        double result;
+        REQUIRE(big.to_double(result));
+        REQUIRE(result == 1267650600228229401496703205376.0);
+        REQUIRE(!BigInt{1}.shift_left(1024).to_double(result));
+    }
+
+    tpy::Source::SourceManager src_mgr;
+
+    tpy::Utility::ArenaAllocator arena;
+    auto *src_file = src_mgr.open_py_src_file("./tests/tree/folding.py");
+    tpy::Parse::Lexer lexer{src_file};
+    tpy::Parse::Parser parser{lexer, arena};
+    auto *module = static_cast<ASTModuleNode *>(parser.parse_py_module());
+    REQUIRE(module);
+    REQUIRE(module->body.size() == 19);
+
+    ConstantFolder folder{src_file, arena};
+    REQUIRE(folder.fold(module) == module);
+
+    auto value = [&](size_t i) {
+        return static_cast<ASTAssignStmtNode *>(module->body[i])->value;
+    };
+
+    auto element = [&](size_t i, size_t k) {
+        return static_cast<ASTTupleExprNode *>(value(i))->elements[k];
+    };
+
+    // This returns the value of a folded constant, or an empty string if the
+    // node was not folded.
+    auto repr = [](ASTNode *node) -> std::string {
+        if (node->kind != ASTNodeKind::ConstantExpr) {
+            return "";
+        }
+        return static_cast<ASTConstantExprNode *>(node)->repr();
+    };
+
+    auto boolean = [](ASTNode *node) {
+        REQUIRE(node->kind == ASTNodeKind::BoolLiteral);
+        return static_cast<ASTBoolLiteralNode *>(node)->val;
+    };
+
+    SECTION("Integers") {
+        REQUIRE(repr(value(0)) == "86400");
+        REQUIRE(repr(value(1)) == "1048576");
+        REQUIRE(repr(value(2)) == "-1");
+        REQUIRE(repr(value(7)) == "55340232221128654848");
+        REQUIRE(repr(element(8, 0)) == "-4");
+        REQUIRE(repr(element(8, 1)) == "2");
+        REQUIRE(repr(value(9)) == "26");
+        REQUIRE(repr(element(11, 0)) == "254");
+        REQUIRE(!boolean(element(11, 1)));
+
+        // The new node covers the whole expression.
+        auto *src = src_file->start();
+        auto loc = value(0)->loc;
+        REQUIRE(std::string(src + loc.local_pos, loc.len) == "60 * 60 * 24");
+    }
+
+    SECTION("Floats") {
+        REQUIRE(repr(element(8, 2)) == "3.0");
+        REQUIRE(repr(element(8, 3)) == "1.0");
+        REQUIRE(repr(value(10)) == "inf");
+        REQUIRE(repr(value(15)) == "250000000000000.5");
+        REQUIRE(repr(element(17, 0)) == "1e+22");
+        REQUIRE(repr(element(17, 1)) == "0.3333333333333333");
+        REQUIRE(repr(element(17, 2)) == "-0.0");
+        REQUIRE(repr(element(17, 3)) == "1e-05");
+    }
+
+    SECTION("Strings and booleans") {
+        REQUIRE(!boolean(value(3)));
+        REQUIRE(repr(value(4)) == "'ab'");
+        REQUIRE(repr(value(12)) == "b'\\x00ab\\x00ab\\\\'");
+        REQUIRE(repr(value(13)) == "'\xC3\xA9\\n\\\\t'");
+
+        // Adjacent literals are joined before the operators around them.
+        REQUIRE(repr(element(18, 0)) == "'abcd'");
+        REQUIRE(repr(element(18, 1)) == "b'xy'");
+    }
+
+    SECTION("Expressions that are kept") {
+        // The result would be too large, or evaluating it would raise.
+        REQUIRE(value(5)->kind == ASTNodeKind::BinaryOpExpr);
+        REQUIRE(value(6)->kind == ASTNodeKind::BinaryOpExpr);
+        REQUIRE(element(16, 0)->kind == ASTNodeKind::BinaryOpExpr);
+        REQUIRE(element(16, 1)->kind == ASTNodeKind::BinaryOpExpr);
+        REQUIRE(element(16, 2)->kind == ASTNodeKind::BinaryOpExpr);
+        REQUIRE(element(16, 3)->kind == ASTNodeKind::BinaryOpExpr);
+
+        // 'x + 1 + 2' is '(x + 1) + 2', so there is nothing to fold.
+        REQUIRE(value(14)->kind == ASTNodeKind::BinaryOpExpr);
+
+        // The value of an f-string is only known when the program runs.
+        REQUIRE(element(18, 2)->kind == ASTNodeKind::StringConcatExpr);
+
+        // The exponent of '10 ** 9' is still folded.
+        auto *repeat = static_cast<ASTBinaryOpExprNode *>(value(5));
+        REQUIRE(repr(repeat->rhs) == "1000000000");
+    }
+
+    SECTION("Cache and writer") {
+        // The folded values survive the flat tree.
+        tpy::Utility::ArenaAllocator copy_arena;
+        auto flat = FlatAST::from_tree(module);
+        auto *copy =
+            static_cast<ASTModuleNode *>(flat.to_tree(copy_arena));
+        auto *copied = static_cast<ASTAssignStmtNode *>(copy->body[12]);
+        REQUIRE(repr(copied->value) == repr(value(12)));
+
+        std::string result;
+        {
+            tpy::Utility::OutputBuffer out{result};
+            ASTWriter{out, ASTFormat::JSON}.write(value(12));
+        }
+        REQUIRE(result.find("\"value\": \"b'\\\\x00ab\\\\x00ab\\\\\\\\'\"") !=
+                std::string::npos);
+    }
+}
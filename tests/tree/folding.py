@@ -0,0 +1,19 @@
+a = 60 * 60 * 24
+b = 1 << 20
+c = -1
+d = not True
+e = 'a' + "b"
+f = 'a' * 10**9
+g = 1 / 0
+h = 2 ** 64 * 3
+i = (7 // -2, -7 % 3, 7.5 // 2, -7.0 % 2)
+j = 0x10 + 0b1_1 + 0o7
+k = 1e308 * 10 + 0.1 + 0.2
+l = ~True & 0xff, True & False
+m = b'\x00ab' * 2 + b"\\"
+n = 'é\n' + r'\t'
+o = x + 1 + 2
+p = 2 ** -1 + 10 ** 15 / 4
+q = 1 << -1, 2 ** 200, 'a' + b'b', 3 < 4
+r = 1e22 + 0.0, 1 / 3, -0.0, 1e-5 * 1
+s = 'a' "b" 'c' + 'd', b'x' b'y', 'a' f'{x}'
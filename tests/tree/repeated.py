@@ -0,0 +1,4 @@
+x = config.options.verbose + 1
+y = config.options.verbose + 1
+z = a[1:], a[:1]
+print(f"{x}", f"{x}")
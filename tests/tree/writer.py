@@ -0,0 +1,2 @@
+d = {a: 1, b: True}
+f(-x)[1:]
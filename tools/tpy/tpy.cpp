@@ -2,22 +2,82 @@
     This is the main entry point for the tpy interpreter.
 */
 #include <cstdio>
+#include <cstring>
+#include <exception>
 
+#include <unistd.h>
+
+#include "tpy/compiler/FrontendErrorHandler.h"
+#include "tpy/parse/Lexer.h"
+#include "tpy/parse/Parser.h"
 #include "tpy/source/SourceManager.h"
+#include "tpy/tree/ASTWriter.h"
+#include "tpy/utility/ArenaAllocator.h"
+#include "tpy/utility/OutputBuffer.h"
+
+static auto print_usage(const char *program) -> void {
+    fprintf(stderr, "usage: %s [--dump-ast=json|sexpr] [--mem-stats] <file>\n",
+            program);
+}
 
 int main(int argc, char *argv[]) {
-    tpy::Source::SourceManager src_mgr;
+    char *path = nullptr;
+    bool dump_ast = false;
+    bool mem_stats = false;
+    auto format = tpy::Tree::ASTFormat::JSON;
 
-    auto src_file = src_mgr.open_py_src_file(argv[1]);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--dump-ast=json") == 0) {
+            dump_ast = true;
+            format = tpy::Tree::ASTFormat::JSON;
+        } else if (strcmp(argv[i], "--dump-ast=sexpr") == 0) {
+            dump_ast = true;
+            format = tpy::Tree::ASTFormat::SExpr;
+        } else if (strcmp(argv[i], "--mem-stats") == 0) {
+            mem_stats = true;
+        } else if (argv[i][0] == '-' || path) {
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    if (!path) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    tpy::Source::SourceManager src_mgr;
 
-    // auto loc = src_file.get_loc_from_pos(13);
     try {
-        auto loc = src_file->get_loc_from_pos(9);
+        auto src_file = src_mgr.open_py_src_file(path);
+
+        // Without any options, the file is only parsed, so that its syntax
+        // errors are reported.
+        tpy::Parse::Lexer lexer{src_file};
+        tpy::Utility::ArenaAllocator arena{1 << 20};
+        tpy::Parse::Parser parser{lexer, arena};
+        auto *module = parser.parse_py_module();
+
+        // The syntax errors have already been reported, and the module holds
+        // error nodes in their place.
+        if (dump_ast) {
+            tpy::Utility::OutputBuffer out{STDOUT_FILENO};
+            tpy::Tree::ASTWriter writer{out, format};
+            writer.write(module);
+            out.flush();
+        }
+
+        // The report goes to stderr, so that it does not mix with a dump.
+        if (mem_stats) {
+            arena.print_stats(stderr);
+        }
 
-        printf("line: %llu --> col: %llu\n", loc.line, loc.col);
+        return tpy::Compiler::FrontendErrorHandler::error() ? 1 : 0;
     } catch (std::exception &e) {
-        puts(e.what());
+        fprintf(stderr, "error: %s\n", e.what());
     }
 
-    return 0;
-}
\ No newline at end of file
+    return 1;
+}